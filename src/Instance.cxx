@@ -8,6 +8,7 @@
 #include "StateFile.hxx"
 #include "Stats.hxx"
 #include "client/List.hxx"
+#include "client/CommandPool.hxx"
 #include "input/cache/Manager.hxx"
 
 #ifdef ENABLE_CURL
@@ -111,6 +112,11 @@ Instance::OnDatabaseModified() noexcept
 
 	stats_invalidate();
 
+	if (input_cache)
+		/* files which could not be prefetched may have
+		   been added or fixed */
+		input_cache->ForgetFailedPrefetches();
+
 	for (auto &partition : partitions)
 		partition.DatabaseModified(*database);
 
@@ -225,8 +231,12 @@ Instance::OnStickerCleanupDone(bool changed) noexcept
 
 	sticker_cleanup.reset();
 
-	if (changed)
+	if (changed) {
+		/* the cleanup thread has modified the database with
+		   its own connection */
+		sticker_database->ClearCache();
 		EmitIdle(IDLE_STICKER);
+	}
 
 	if (need_sticker_cleanup)
 		StartStickerCleanup();
@@ -37,6 +37,7 @@ class InotifyUpdate;
 #include <list>
 
 class ClientList;
+class CommandPool;
 struct Partition;
 class StateFile;
 class RemoteTagCache;
@@ -119,6 +120,12 @@ struct Instance final
 	std::unique_ptr<RemoteTagCache> remote_tag_cache;
 #endif
 
+	/**
+	 * Executes read-only client commands in worker threads
+	 * (setting "command_threads"); may be nullptr.
+	 */
+	std::unique_ptr<CommandPool> command_pool;
+
 	std::unique_ptr<ClientList> client_list;
 
 	std::list<Partition> partitions;
@@ -12,6 +12,7 @@
 #include "Permission.hxx"
 #include "Listen.hxx"
 #include "client/Config.hxx"
+#include "client/CommandPool.hxx"
 #include "client/List.hxx"
 #include "command/AllCommands.hxx"
 #include "Partition.hxx"
@@ -403,6 +404,7 @@ MainConfigured(const CommandLineOptions &options,
 	});
 
 	client_manager_init(raw_config);
+
 	const ScopeInputPluginsInit input_plugins_init(raw_config,
 						       instance.io_thread.GetEventLoop());
 
@@ -424,6 +426,10 @@ MainConfigured(const CommandLineOptions &options,
 	instance.io_thread.Start();
 	instance.rtio_thread.Start();
 
+	if (client_command_threads > 0)
+		instance.command_pool =
+			std::make_unique<CommandPool>(client_command_threads);
+
 #ifdef ENABLE_NEIGHBOR_PLUGINS
 	if (instance.neighbors != nullptr)
 		instance.neighbors->Open();
@@ -522,6 +528,11 @@ MainConfigured(const CommandLineOptions &options,
 
 	instance.BeginShutdownUpdate();
 	instance.BeginShutdownPartitions();
+
+	/* let running commands finish before the database gets
+	   closed */
+	if (instance.command_pool)
+		instance.command_pool->Stop();
 }
 
 #ifdef ANDROID
@@ -3,36 +3,85 @@
 
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
+#include "pcm/AudioFormat.hxx"
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <chrono>
+#include <new>
 
-MusicBuffer::MusicBuffer(unsigned num_chunks)
-	:buffer(num_chunks)
+using std::size_t;
+
+/**
+ * In automatic mode, chunks are large enough for this duration of
+ * audio, but not smaller than #DEFAULT_CHUNK_SIZE.  Fewer, larger
+ * chunks reduce the per-chunk overhead for high sample rates.
+ */
+static constexpr std::chrono::milliseconds AUTO_CHUNK_DURATION{20};
+
+/**
+ * In automatic mode, chunks are not made larger if the buffer would
+ * hold fewer than this number of chunks.
+ */
+static constexpr size_t AUTO_MIN_CHUNKS = 64;
+
+MusicBuffer::MusicBuffer(size_t size, size_t chunk_size)
+	:buffer(size,
+		chunk_size > 0 ? chunk_size : DEFAULT_CHUNK_SIZE,
+		chunk_size > 0 ? chunk_size : DEFAULT_CHUNK_SIZE),
+	 fixed_chunk_size(chunk_size)
 {
+	assert(chunk_size == 0 || chunk_size >= MIN_CHUNK_SIZE);
+	assert(chunk_size <= MAX_CHUNK_SIZE);
+	assert(chunk_size % alignof(MusicChunk) == 0);
+
 	buffer.SetName("MusicBuffer");
 }
 
+[[gnu::const]]
+static size_t
+ChooseChunkSize(AudioFormat audio_format, size_t buffer_size) noexcept
+{
+	const size_t want = sizeof(MusicChunk) +
+		audio_format.TimeToSize(AUTO_CHUNK_DURATION);
+
+	const size_t max = std::clamp(std::bit_floor(buffer_size / AUTO_MIN_CHUNKS),
+				      DEFAULT_CHUNK_SIZE, MAX_CHUNK_SIZE);
+
+	return std::clamp(std::bit_ceil(want), DEFAULT_CHUNK_SIZE, max);
+}
+
+void
+MusicBuffer::Adapt(AudioFormat audio_format) noexcept
+{
+	assert(audio_format.IsValid());
+
+	if (fixed_chunk_size > 0)
+		return;
+
+	buffer.SetSliceSize(ChooseChunkSize(audio_format,
+					    buffer.GetTotalSize()));
+}
+
 MusicChunkPtr
 MusicBuffer::Allocate() noexcept
 {
-	const std::scoped_lock<Mutex> protect(mutex);
-	return {buffer.Allocate(), MusicChunkDeleter(*this)};
+	void *p = buffer.Allocate();
+	if (p == nullptr)
+		return nullptr;
+
+	return {::new(p) MusicChunk(GetChunkCapacity()), MusicChunkDeleter(*this)};
 }
 
 void
 MusicBuffer::Return(MusicChunk *chunk) noexcept
 {
 	assert(chunk != nullptr);
-
-	/* these attributes need to be cleared before locking the
-	   mutex, because they might recursively call this method,
-	   causing a deadlock */
-	chunk->next.reset();
-	chunk->other.reset();
-
-	const std::scoped_lock<Mutex> protect(mutex);
-
 	assert(!chunk->other || !chunk->other->other);
 
+	/* this may recursively return the "other" chunk */
+	chunk->~MusicChunk();
+
 	buffer.Free(chunk);
 }
@@ -6,32 +6,36 @@
 
 #include "MusicChunk.hxx"
 #include "MusicChunkPtr.hxx"
-#include "util/SliceBuffer.hxx"
-#include "thread/Mutex.hxx"
+#include "util/LockFreeSliceBuffer.hxx"
 
 /**
- * An allocator for #MusicChunk objects.
+ * An allocator for #MusicChunk objects.  It is lock-free and may be
+ * used by multiple threads.
  */
 class MusicBuffer {
-	/** a mutex which protects #buffer */
-	mutable Mutex mutex;
+	LockFreeSliceBuffer buffer;
 
-	SliceBuffer<MusicChunk> buffer;
+	/**
+	 * The configured chunk size (including the #MusicChunk
+	 * header) or 0 if Adapt() chooses it.
+	 */
+	const std::size_t fixed_chunk_size;
 
 public:
 	/**
 	 * Creates a new #MusicBuffer object.
 	 *
-	 * @param num_chunks the number of #MusicChunk reserved in
-	 * this buffer
+	 * @param size the total size of this buffer in bytes
+	 * @param chunk_size the size of each #MusicChunk (including
+	 * its header) or 0 to choose it automatically for each audio
+	 * format
 	 */
-	explicit MusicBuffer(unsigned num_chunks);
+	MusicBuffer(std::size_t size, std::size_t chunk_size);
 
 #ifndef NDEBUG
 	/**
-	 * Check whether the buffer is empty.  This call is not
-	 * protected with the mutex, and may only be used while this
-	 * object is inaccessible to other threads.
+	 * Check whether the buffer is empty.  This may only be used
+	 * while this object is inaccessible to other threads.
 	 */
 	bool IsEmptyUnsafe() const {
 		return buffer.empty();
@@ -39,20 +43,39 @@ public:
 #endif
 
 	bool IsFull() const noexcept {
-		const std::scoped_lock<Mutex> protect(mutex);
 		return buffer.IsFull();
 	}
 
 	/**
-	 * Returns the total number of reserved chunks in this buffer.  This
-	 * is the same value which was passed to the constructor
-	 * music_buffer_new().
+	 * Returns the total number of chunks in this buffer.  This
+	 * may change after Adapt() has been called.
 	 */
 	[[gnu::pure]]
 	unsigned GetSize() const noexcept {
 		return buffer.GetCapacity();
 	}
 
+	/**
+	 * Returns the number of data bytes which fit into one
+	 * #MusicChunk.  This may change after Adapt() has been
+	 * called.
+	 */
+	[[gnu::pure]]
+	std::size_t GetChunkCapacity() const noexcept {
+		return buffer.GetSliceSize() - sizeof(MusicChunk);
+	}
+
+	/**
+	 * Choose a chunk size suitable for the given audio format
+	 * (unless the chunk size was configured explicitly).  This
+	 * is only possible while no chunk is allocated, i.e. when
+	 * playback starts; else this method does nothing.
+	 *
+	 * This must not be called while another thread may call
+	 * Allocate().
+	 */
+	void Adapt(AudioFormat audio_format) noexcept;
+
 	/**
 	 * Allocates a chunk from the buffer.  When it is not used anymore,
 	 * call Return().
@@ -12,12 +12,24 @@
 #include "pcm/AudioFormat.hxx"
 #endif
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <span>
 
-static constexpr size_t CHUNK_SIZE = 4096;
+/**
+ * The default size of a #MusicChunk including its header.
+ */
+static constexpr size_t DEFAULT_CHUNK_SIZE = 4096;
+
+static constexpr size_t MIN_CHUNK_SIZE = 1024;
+
+/**
+ * The maximum size of a #MusicChunk.  This is limited by the 16 bit
+ * #MusicChunkInfo::length attribute.
+ */
+static constexpr size_t MAX_CHUNK_SIZE = 65536;
 
 struct AudioFormat;
 struct Tag;
@@ -27,8 +39,13 @@ struct MusicChunk;
  * Meta information for #MusicChunk.
  */
 struct MusicChunkInfo {
-	/** the next chunk in a linked list */
-	MusicChunkPtr next;
+	/**
+	 * The next chunk in a #MusicPipe.  This is not an owning
+	 * pointer: the pipe owns all chunks it contains.  The pipe's
+	 * producer publishes a new chunk by setting this attribute of
+	 * the previous tail chunk, therefore it is atomic.
+	 */
+	std::atomic<MusicChunk *> next{nullptr};
 
 	/**
 	 * An optional chunk which should be mixed into this chunk.
@@ -84,6 +101,14 @@ struct MusicChunkInfo {
 		return length == 0 && tag == nullptr;
 	}
 
+	/**
+	 * Returns the next chunk in the #MusicPipe or nullptr if this
+	 * is the last one.
+	 */
+	MusicChunk *GetNext() const noexcept {
+		return next.load(std::memory_order_acquire);
+	}
+
 #ifndef NDEBUG
 	/**
 	 * Checks if the audio format if the chunk is equal to the
@@ -97,10 +122,32 @@ struct MusicChunkInfo {
 /**
  * A chunk of music data.  Its format is defined by the
  * MusicPipe::Push() caller.
+ *
+ * The data is stored right after this object in the #MusicBuffer;
+ * its size is chosen by the #MusicBuffer at runtime.
  */
 struct MusicChunk : MusicChunkInfo {
-	/** the data (probably PCM) */
-	std::byte data[CHUNK_SIZE - sizeof(MusicChunkInfo)];
+	/** the size of the buffer returned by GetData() */
+	const uint16_t capacity;
+
+	explicit MusicChunk(size_t _capacity) noexcept
+		:capacity(_capacity) {}
+
+	/**
+	 * Returns the data (probably PCM).  The buffer has #capacity
+	 * bytes, and the first #length bytes are filled.
+	 */
+	std::byte *GetData() noexcept {
+		return reinterpret_cast<std::byte *>(this + 1);
+	}
+
+	const std::byte *GetData() const noexcept {
+		return reinterpret_cast<const std::byte *>(this + 1);
+	}
+
+	std::span<const std::byte> ReadData() const noexcept {
+		return {GetData(), length};
+	}
 
 	/**
 	 * Prepares appending to the music chunk.  Returns a buffer
@@ -129,6 +176,8 @@ struct MusicChunk : MusicChunkInfo {
 	bool Expand(AudioFormat af, size_t length) noexcept;
 };
 
-static_assert(sizeof(MusicChunk) == CHUNK_SIZE, "Wrong size");
+static_assert(MAX_CHUNK_SIZE - sizeof(MusicChunk) <= UINT16_MAX,
+	      "MAX_CHUNK_SIZE too large for MusicChunkInfo::length");
+static_assert(MIN_CHUNK_SIZE % alignof(MusicChunk) == 0);
 
 #endif
@@ -16,6 +16,8 @@ public:
 	MusicChunkDeleter() = default;
 	explicit MusicChunkDeleter(MusicBuffer &_buffer):buffer(&_buffer) {}
 
+	constexpr bool operator==(const MusicChunkDeleter &) const noexcept = default;
+
 	void operator()(MusicChunk *chunk) noexcept;
 };
 
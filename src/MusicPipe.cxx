@@ -5,15 +5,14 @@
 #include "MusicChunk.hxx"
 
 #include <cassert>
+#include <thread>
 
 #ifndef NDEBUG
 
 bool
 MusicPipe::Contains(const MusicChunk *chunk) const noexcept
 {
-	const std::scoped_lock<Mutex> protect(mutex);
-
-	for (const MusicChunk *i = head.get(); i != nullptr; i = i->next.get())
+	for (const MusicChunk *i = Peek(); i != nullptr; i = i->GetNext())
 		if (i == chunk)
 			return true;
 
@@ -25,32 +24,39 @@ MusicPipe::Contains(const MusicChunk *chunk) const noexcept
 MusicChunkPtr
 MusicPipe::Shift() noexcept
 {
-	const std::scoped_lock<Mutex> protect(mutex);
-
-	auto chunk = std::move(head);
-	if (chunk != nullptr) {
-		assert(!chunk->IsEmpty());
+	MusicChunk *chunk = head.load(std::memory_order_acquire);
+	if (chunk == nullptr)
+		return nullptr;
 
-		head = std::move(chunk->next);
-		--size;
-
-		if (head == nullptr) {
-			assert(size == 0);
-			assert(tail_r == &chunk->next);
+	assert(!chunk->IsEmpty());
 
-			tail_r = &head;
-		} else {
-			assert(size > 0);
-			assert(tail_r != &chunk->next);
+	MusicChunk *next = chunk->GetNext();
+	if (next == nullptr) {
+		/* this seems to be the last chunk: detach it from
+		   #tail; clear #head first, because Push() will set
+		   it as soon as it sees the empty #tail */
+		head.store(nullptr, std::memory_order_relaxed);
+
+		MusicChunk *expected = chunk;
+		if (!tail.compare_exchange_strong(expected, nullptr,
+						  std::memory_order_acq_rel)) {
+			/* the producer is inside Push() and has
+			   already replaced #tail, but has not yet
+			   linked the new chunk; this takes only a
+			   moment */
+			while ((next = chunk->GetNext()) == nullptr)
+				std::this_thread::yield();
+
+			head.store(next, std::memory_order_release);
 		}
+	} else
+		head.store(next, std::memory_order_release);
 
-#ifndef NDEBUG
-		if (size == 0)
-			audio_format.Clear();
-#endif
-	}
+	[[maybe_unused]] const unsigned old_size =
+		size.fetch_sub(1, std::memory_order_relaxed);
+	assert(old_size > 0);
 
-	return chunk;
+	return {chunk, deleter};
 }
 
 void
@@ -64,21 +70,37 @@ MusicPipe::Push(MusicChunkPtr chunk) noexcept
 {
 	assert(!chunk->IsEmpty());
 	assert(chunk->length == 0 || chunk->audio_format.IsValid());
+	assert(deleter == MusicChunkDeleter{} ||
+	       deleter == chunk.get_deleter());
 
-	const std::scoped_lock<Mutex> protect(mutex);
+	if (deleter == MusicChunkDeleter{})
+		deleter = chunk.get_deleter();
 
-	assert(size > 0 || !audio_format.IsDefined());
-	assert(!audio_format.IsDefined() ||
-	       chunk->CheckFormat(audio_format));
+	MusicChunk *const new_tail = chunk.release();
+	new_tail->next.store(nullptr, std::memory_order_relaxed);
+
+	/* count the chunk before publishing it, so the consumer can
+	   never decrement #size below zero */
+	size.fetch_add(1, std::memory_order_relaxed);
+
+	MusicChunk *const old_tail =
+		tail.exchange(new_tail, std::memory_order_acq_rel);
 
 #ifndef NDEBUG
-	if (!audio_format.IsDefined() && chunk->length > 0)
-		audio_format = chunk->audio_format;
-#endif
+	if (old_tail == nullptr)
+		audio_format.Clear();
 
-	chunk->next.reset();
-	*tail_r = std::move(chunk);
-	tail_r = &(*tail_r)->next;
+	assert(!audio_format.IsDefined() ||
+	       new_tail->CheckFormat(audio_format));
+
+	if (!audio_format.IsDefined() && new_tail->length > 0)
+		audio_format = new_tail->audio_format;
+#endif
 
-	++size;
+	/* publish the new chunk; the consumer cannot free the old
+	   tail chunk before this, see Shift() */
+	if (old_tail != nullptr)
+		old_tail->next.store(new_tail, std::memory_order_release);
+	else
+		head.store(new_tail, std::memory_order_release);
 }
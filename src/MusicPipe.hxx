@@ -5,51 +5,81 @@
 #define MPD_PIPE_H
 
 #include "MusicChunkPtr.hxx"
-#include "thread/Mutex.hxx"
 
 #ifndef NDEBUG
 #include "pcm/AudioFormat.hxx"
 #endif
 
+#include <atomic>
+
 /**
- * A queue of #MusicChunk objects.  One party appends chunks at the
- * tail, and the other consumes them from the head.
+ * A queue of #MusicChunk objects.  One party (the producer) appends
+ * chunks at the tail, and the other (the consumer) removes them from
+ * the head.  Other threads may walk the chunks with Peek() and
+ * MusicChunk::GetNext(), but they must make sure that the consumer
+ * does not free the chunks they are looking at.
+ *
+ * This class is lock-free: the producer and the consumer synchronize
+ * only with atomic operations on #head, #tail and MusicChunk::next.
+ * There must not be more than one producer and one consumer at a
+ * time; passing one of these roles to another thread requires
+ * external synchronization.
  */
 class MusicPipe {
-	/** the first chunk */
-	MusicChunkPtr head;
+	/**
+	 * The first chunk.  Only the consumer modifies it, except
+	 * when the producer pushes to an empty pipe.
+	 */
+	std::atomic<MusicChunk *> head{nullptr};
 
-	/** a pointer to the tail of the chunk */
-	MusicChunkPtr *tail_r = &head;
+	/**
+	 * The last chunk.  Only the producer modifies it, except when
+	 * the consumer removes the last chunk.
+	 */
+	std::atomic<MusicChunk *> tail{nullptr};
 
 	/** the current number of chunks */
-	unsigned size = 0;
+	std::atomic_uint size{0};
 
-	/** a mutex which protects #head and #tail_r */
-	mutable Mutex mutex;
+	/**
+	 * Returns chunks to their #MusicBuffer.  All chunks in one
+	 * pipe must come from the same buffer; this attribute is
+	 * initialized by the first Push() call.
+	 */
+	MusicChunkDeleter deleter{};
 
 #ifndef NDEBUG
+	/**
+	 * The audio format of the chunks in this pipe.  Only the
+	 * producer accesses it.
+	 */
 	AudioFormat audio_format = AudioFormat::Undefined();
 #endif
 
 public:
+	MusicPipe() = default;
+
 	~MusicPipe() noexcept {
 		Clear();
 	}
 
+	MusicPipe(const MusicPipe &) = delete;
+	MusicPipe &operator=(const MusicPipe &) = delete;
+
 #ifndef NDEBUG
 	/**
 	 * Checks if the audio format if the chunk is equal to the specified
-	 * audio_format.
+	 * audio_format.  May only be called by the producer.
 	 */
 	[[gnu::pure]]
 	bool CheckFormat(AudioFormat other) const noexcept {
-		return !audio_format.IsDefined() ||
+		return IsEmpty() || !audio_format.IsDefined() ||
 			audio_format == other;
 	}
 
 	/**
 	 * Checks if the specified chunk is enqueued in the music pipe.
+	 * May only be called by the consumer.
 	 */
 	[[gnu::pure]]
 	bool Contains(const MusicChunk *chunk) const noexcept;
@@ -61,37 +91,40 @@ public:
 	 */
 	[[gnu::pure]]
 	const MusicChunk *Peek() const noexcept {
-		const std::scoped_lock<Mutex> protect(mutex);
-		return head.get();
+		return head.load(std::memory_order_acquire);
 	}
 
 	/**
-	 * Removes the first chunk from the head, and returns it.
+	 * Removes the first chunk from the head, and returns it.  May
+	 * only be called by the consumer.
 	 */
 	MusicChunkPtr Shift() noexcept;
 
 	/**
 	 * Clears the whole pipe and returns the chunks to the buffer.
+	 * May only be called by the consumer.
 	 */
 	void Clear() noexcept;
 
 	/**
-	 * Pushes a chunk to the tail of the pipe.
+	 * Pushes a chunk to the tail of the pipe.  May only be called
+	 * by the producer.
 	 */
 	void Push(MusicChunkPtr chunk) noexcept;
 
 	/**
-	 * Returns the number of chunks currently in this pipe.
+	 * Returns the number of chunks currently in this pipe.  While
+	 * the producer is inside Push(), the new chunk may already be
+	 * counted even though Peek() does not see it yet.
 	 */
 	[[gnu::pure]]
 	unsigned GetSize() const noexcept {
-		const std::scoped_lock<Mutex> protect(mutex);
-		return size;
+		return size.load(std::memory_order_relaxed);
 	}
 
 	[[gnu::pure]]
 	bool IsEmpty() const noexcept {
-		return GetSize() == 0;
+		return Peek() == nullptr;
 	}
 };
 
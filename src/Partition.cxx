@@ -4,17 +4,12 @@
 #include "config.h"
 #include "Partition.hxx"
 #include "Instance.hxx"
-#include "Log.hxx"
 #include "config/PartitionConfig.hxx"
-#include "lib/fmt/ExceptionFormatter.hxx"
 #include "song/DetachedSong.hxx"
 #include "IdleFlags.hxx"
 #include "client/Listener.hxx"
 #include "client/Client.hxx"
 #include "input/cache/Manager.hxx"
-#include "util/Domain.hxx"
-
-static constexpr Domain cache_domain("cache");
 
 Partition::Partition(Instance &_instance,
 		     const char *_name,
@@ -41,29 +36,10 @@ Partition::BeginShutdown() noexcept
 {
 	pc.Kill();
 	listener.reset();
-}
-
-static void
-PrefetchSong(InputCacheManager &cache, const char *uri) noexcept
-{
-	if (cache.Contains(uri))
-		return;
 
-	FmtDebug(cache_domain, "Prefetch {:?}", uri);
-
-	try {
-		cache.Prefetch(uri);
-	} catch (...) {
-		FmtError(cache_domain,
-			 "Prefetch {:?} failed: {}",
-			 uri, std::current_exception());
-	}
-}
-
-static void
-PrefetchSong(InputCacheManager &cache, const DetachedSong &song) noexcept
-{
-	PrefetchSong(cache, song.GetURI());
+	if (instance.input_cache)
+		/* cancel all prefetches on behalf of this partition */
+		instance.input_cache->SchedulePrefetch(this, {});
 }
 
 inline void
@@ -73,12 +49,27 @@ Partition::PrefetchQueue() noexcept
 		return;
 
 	auto &cache = *instance.input_cache;
+	const unsigned depth = cache.GetPrefetchDepth();
 
-	int next = playlist.GetNextPosition();
-	if (next >= 0)
-		PrefetchSong(cache, playlist.queue.Get(next));
+	std::vector<std::string> uris;
 
-	// TODO: prefetch more songs
+	if (const int current = playlist.current; current >= 0) {
+		const auto &queue = playlist.queue;
+
+		int order = current;
+		for (unsigned i = 0; i < depth; ++i) {
+			order = queue.GetNextOrder(order);
+			if (order < 0 || order == current)
+				break;
+
+			/* the input cache needs the URI which is passed
+			   to the decoder, i.e. the absolute path */
+			uris.emplace_back(queue.GetOrder(order).GetRealURI());
+		}
+	}
+
+	/* an empty list cancels all prefetches of this partition */
+	cache.SchedulePrefetch(this, std::move(uris));
 }
 
 void
@@ -137,8 +128,6 @@ Partition::SyncWithPlayer() noexcept
 {
 	playlist.SyncWithPlayer(pc);
 
-	/* TODO: invoke this function in batches, to let the hard disk
-	   spin down in between */
 	PrefetchQueue();
 }
 
@@ -152,12 +141,24 @@ void
 Partition::OnQueueModified() noexcept
 {
 	EmitIdle(IDLE_PLAYLIST);
+
+	/* songs which could not be prefetched may have been
+	   replaced, so give them another chance */
+	if (instance.input_cache)
+		instance.input_cache->ForgetFailedPrefetches();
+
+	/* the order of upcoming songs may have changed */
+	PrefetchQueue();
 }
 
 void
 Partition::OnQueueOptionsChanged() noexcept
 {
 	EmitIdle(IDLE_OPTIONS);
+
+	/* "random", "repeat" etc. may have changed the order of
+	   upcoming songs */
+	PrefetchQueue();
 }
 
 void
@@ -90,10 +90,10 @@ struct Partition final : QueueListener, PlayerListener, MixerListener {
 	}
 
 	/**
-	 * Populate the #InputCacheManager with soon-to-be-played song
-	 * files.
-	 *
-	 * Errors will be logged.
+	 * Tell the #InputCacheManager which song files are going to
+	 * be played soon; they are prefetched in the background.
+	 * Prefetches of songs which are no longer upcoming are
+	 * cancelled.
 	 */
 	void PrefetchQueue() noexcept;
 
@@ -4,17 +4,23 @@
 #include "SongPrint.hxx"
 #include "song/LightSong.hxx"
 #include "song/DetachedSong.hxx"
-#include "TimePrint.hxx"
-#include "TagPrint.hxx"
+#include "song/ResponseCache.hxx"
+#include "client/Config.hxx"
 #include "client/Response.hxx"
+#include "tag/Names.hxx"
+#include "tag/Tag.hxx"
 #include "fs/Traits.hxx"
 #include "lib/fmt/AudioFormatFormatter.hxx"
 #include "time/ChronoUtil.hxx"
+#include "time/ISO8601.hxx"
 #include "util/StringBuffer.hxx"
 #include "util/UriUtil.hxx"
 
 #include <fmt/format.h>
 
+#include <iterator>
+#include <utility>
+
 #define SONG_FILE "file: "
 
 static void
@@ -49,72 +55,152 @@ song_print_uri(Response &r, const DetachedSong &song, bool base) noexcept
 	song_print_uri(r, song.GetURI(), base);
 }
 
+using SongInfoBuffer = fmt::memory_buffer;
+
+/*
+ * The song attributes are either sent directly to the #Response or
+ * rendered into a #SongInfoBuffer which is then stored in a
+ * #SongResponseCache; these overloads let the Format*() functions
+ * write to both.
+ */
+
+template<typename S, typename... Args>
+static void
+Fmt(Response &r, const S &format_str, Args&&... args) noexcept
+{
+	r.Fmt(format_str, std::forward<Args>(args)...);
+}
+
+template<typename S, typename... Args>
+static void
+Fmt(SongInfoBuffer &b, const S &format_str, Args&&... args) noexcept
+{
+	fmt::vformat_to(std::back_inserter(b), format_str,
+			fmt::make_format_args(args...));
+}
+
 static void
-PrintRange(Response &r, SongTime start_time, SongTime end_time) noexcept
+FormatRange(auto &out, SongTime start_time, SongTime end_time) noexcept
 {
 	const unsigned start_ms = start_time.ToMS();
 	const unsigned end_ms = end_time.ToMS();
 
 	if (end_ms > 0)
-		r.Fmt(FMT_STRING("Range: {}.{:03}-{}.{:03}\n"),
-		      start_ms / 1000,
-		      start_ms % 1000,
-		      end_ms / 1000,
-		      end_ms % 1000);
+		Fmt(out, FMT_STRING("Range: {}.{:03}-{}.{:03}\n"),
+		    start_ms / 1000,
+		    start_ms % 1000,
+		    end_ms / 1000,
+		    end_ms % 1000);
 	else if (start_ms > 0)
-		r.Fmt(FMT_STRING("Range: {}.{:03}-\n"),
-		      start_ms / 1000,
-		      start_ms % 1000);
+		Fmt(out, FMT_STRING("Range: {}.{:03}-\n"),
+		    start_ms / 1000,
+		    start_ms % 1000);
 }
 
-void
-song_print_info(Response &r, const LightSong &song, bool base) noexcept
+static void
+FormatTime(auto &out, const char *name,
+	   std::chrono::system_clock::time_point t) noexcept
 {
-	song_print_uri(r, song, base);
+	StringBuffer<64> s;
 
-	PrintRange(r, song.start_time, song.end_time);
+	try {
+		s = FormatISO8601(t);
+	} catch (...) {
+		return;
+	}
+
+	Fmt(out, FMT_STRING("{}: {}\n"), name, s.c_str());
+}
 
-	if (!IsNegative(song.mtime))
-		time_print(r, "Last-Modified", song.mtime);
+/**
+ * Format all song attributes except for the URI (i.e. the part of
+ * the response which may be cached in a #SongResponseCache).
+ */
+static void
+FormatSongInfo(auto &out, TagMask tag_mask,
+	       SongTime start_time, SongTime end_time,
+	       std::chrono::system_clock::time_point mtime,
+	       std::chrono::system_clock::time_point added,
+	       const AudioFormat &audio_format,
+	       const Tag &tag, SignedSongTime duration) noexcept
+{
+	FormatRange(out, start_time, end_time);
 
-	if (!IsNegative(song.added))
-		time_print(r, "Added", song.added);
+	if (!IsNegative(mtime))
+		FormatTime(out, "Last-Modified", mtime);
 
-	if (song.audio_format.IsDefined())
-		r.Fmt(FMT_STRING("Format: {}\n"), song.audio_format);
+	if (!IsNegative(added))
+		FormatTime(out, "Added", added);
 
-	tag_print_values(r, song.tag);
+	if (audio_format.IsDefined())
+		Fmt(out, FMT_STRING("Format: {}\n"), audio_format);
+
+	for (const auto &i : tag)
+		if (tag_mask.Test(i.type))
+			Fmt(out, FMT_STRING("{}: {}\n"),
+			    tag_item_names[i.type], i.value);
 
-	const auto duration = song.GetDuration();
 	if (!duration.IsNegative())
-		r.Fmt(FMT_STRING("Time: {}\n"
-				 "duration: {:1.3f}\n"),
-		      duration.RoundS(),
-		      duration.ToDoubleS());
+		Fmt(out, FMT_STRING("Time: {}\n"
+				    "duration: {:1.3f}\n"),
+		    duration.RoundS(),
+		    duration.ToDoubleS());
 }
 
-void
-song_print_info(Response &r, const DetachedSong &song, bool base) noexcept
+/**
+ * Send the song attributes, either from the cache, or format them
+ * with the given function.  The result is rendered into a buffer
+ * and stored in the cache only if the cache is enabled; otherwise,
+ * it is sent directly to the #Response.
+ */
+static void
+PrintSongInfo(Response &r, const SongResponseCache *cache,
+	      auto format) noexcept
 {
-	song_print_uri(r, song, base);
+	const TagMask tag_mask = r.GetTagMask();
 
-	PrintRange(r, song.GetStartTime(), song.GetEndTime());
+	if (!client_song_response_cache || cache == nullptr) {
+		format(r, tag_mask);
+		return;
+	}
 
-	if (!IsNegative(song.GetLastModified()))
-		time_print(r, "Last-Modified", song.GetLastModified());
+	if (const auto *text = cache->Get(tag_mask)) {
+		r.Write(text->data(), text->size());
+		return;
+	}
 
-	if (!IsNegative(song.GetAdded()))
-		time_print(r, "Added", song.GetAdded());
+	SongInfoBuffer b;
+	format(b, tag_mask);
+	cache->Put(tag_mask, {b.data(), b.size()});
+	r.Write(b.data(), b.size());
+}
 
-	if (const auto &f = song.GetAudioFormat(); f.IsDefined())
-		r.Fmt(FMT_STRING("Format: {}\n"), f);
+void
+song_print_info(Response &r, const LightSong &song, bool base) noexcept
+{
+	song_print_uri(r, song, base);
 
-	tag_print_values(r, song.GetTag());
+	PrintSongInfo(r, song.response_cache, [&song](auto &out,
+						      TagMask tag_mask){
+		FormatSongInfo(out, tag_mask,
+			       song.start_time, song.end_time,
+			       song.mtime, song.added,
+			       song.audio_format,
+			       song.tag, song.GetDuration());
+	});
+}
 
-	const auto duration = song.GetDuration();
-	if (!duration.IsNegative())
-		r.Fmt(FMT_STRING("Time: {}\n"
-				 "duration: {:1.3f}\n"),
-		      duration.RoundS(),
-		      duration.ToDoubleS());
+void
+song_print_info(Response &r, const DetachedSong &song, bool base) noexcept
+{
+	song_print_uri(r, song, base);
+
+	PrintSongInfo(r, &song.GetResponseCache(), [&song](auto &out,
+							   TagMask tag_mask){
+		FormatSongInfo(out, tag_mask,
+			       song.GetStartTime(), song.GetEndTime(),
+			       song.GetLastModified(), song.GetAdded(),
+			       song.GetAudioFormat(),
+			       song.GetTag(), song.GetDuration());
+	});
 }
@@ -82,6 +82,7 @@ Song::UpdateFile(Storage &storage, const StorageFileInfo &info)
 	mtime = info.mtime;
 	audio_format = new_audio_format;
 	tag_builder.Commit(tag);
+	response_cache.Clear();
 	return true;
 }
 
@@ -121,6 +122,7 @@ Song::UpdateFileInArchive(ArchiveFile &archive) noexcept
 		return false;
 
 	tag_builder.Commit(tag);
+	response_cache.Clear();
 	return true;
 }
 
@@ -149,6 +151,7 @@ DetachedSong::LoadFile(Path path)
 	mtime = fi.GetModificationTime();
 	audio_format = new_audio_format;
 	tag_builder.Commit(tag);
+	response_cache.Clear();
 	return true;
 }
 
@@ -176,6 +179,7 @@ DetachedSong::Update()
 		mtime = std::chrono::system_clock::time_point::min();
 		audio_format = new_audio_format;
 		tag_builder.Commit(tag);
+		response_cache.Clear();
 		return true;
 	} else
 		// TODO: implement
@@ -5,9 +5,13 @@
 #include "StateFile.hxx"
 #include "output/State.hxx"
 #include "queue/PlaylistState.hxx"
-#include "io/FileLineReader.hxx"
+#include "queue/Save.hxx"
+#include "io/StringLineReader.hxx"
+#include "io/StringOutputStream.hxx"
 #include "io/FileOutputStream.hxx"
 #include "io/BufferedOutputStream.hxx"
+#include "fs/FileSystem.hxx"
+#include "system/Error.hxx"
 #include "storage/StorageState.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
@@ -15,15 +19,29 @@
 #include "util/Domain.hxx"
 #include "Log.hxx"
 
+#include <fmt/format.h>
+
+#include <algorithm>
 #include <exception>
 
 static constexpr Domain state_file_domain("state_file");
 
+/**
+ * The number of queue positions visited by the state journal per
+ * event loop iteration.
+ */
+static constexpr unsigned RECORD_CHUNK_SIZE = 4096;
+
+static constexpr Event::Duration RECORD_CHUNK_DELAY =
+	std::chrono::milliseconds(1);
+
 StateFile::StateFile(StateFileConfig &&_config,
 		     Partition &_partition, EventLoop &_loop)
 	:config(std::move(_config)), path_utf8(config.path.ToUTF8()),
 	 timer_event(_loop, BIND_THIS_METHOD(OnTimeout)),
-	 partition(_partition)
+	 record_event(_loop, BIND_THIS_METHOD(OnRecordEvent)),
+	 partition(_partition),
+	 journal(config.path)
 {
 }
 
@@ -65,6 +83,19 @@ StateFile::Write(BufferedOutputStream &os)
 	playlist_state_save(os, partition.playlist, partition.pc);
 }
 
+inline void
+StateFile::WriteStatus(BufferedOutputStream &os)
+{
+	partition.mixer_memento.SaveSoftwareVolumeState(os);
+	audio_output_state_save(os, partition.outputs);
+
+#ifdef ENABLE_DATABASE
+	storage_state_save(os, partition.instance);
+#endif
+
+	playlist_state_save_status(os, partition.playlist, partition.pc);
+}
+
 inline void
 StateFile::Write(OutputStream &os)
 {
@@ -79,14 +110,114 @@ StateFile::Write()
 	FmtDebug(state_file_domain,
 		 "Saving state file {}", path_utf8);
 
+	record_event.Cancel();
+	building_record = false;
+
+	/* let the journal thread finish before the state file gets
+	   replaced */
+	journal.Stop();
+
 	try {
 		FileOutputStream fos(config.path);
 		Write(fos);
 		fos.Commit();
+
+		/* the state file is complete; the journal is
+		   obsolete (if there is one) */
+		try {
+			RemoveFile(journal.GetJournalPath());
+		} catch (const std::system_error &e) {
+			if (!IsFileNotFound(e))
+				throw;
+		}
 	} catch (...) {
 		LogError(std::current_exception());
 	}
 
+	replace_record = true;
+	RememberVersions();
+}
+
+void
+StateFile::BeginRecord() noexcept
+{
+	if (journal.CheckFailed())
+		replace_record = true;
+
+	const auto &queue = partition.playlist.queue;
+
+	record = "journal_begin\n";
+	pass_since = replace_record ? 0 : journal_version;
+	pass_version = queue.version;
+	pass_position = 0;
+	building_record = true;
+
+	OnRecordEvent();
+}
+
+inline bool
+StateFile::BuildRecord()
+{
+	const auto &queue = partition.playlist.queue;
+
+	StringOutputStream sos;
+	BufferedOutputStream os{sos};
+
+	const unsigned length = queue.GetLength();
+	const unsigned end = std::min(pass_position + RECORD_CHUNK_SIZE,
+				      length);
+
+	if (pass_position < end)
+		queue.ForEachNewerPosition(pass_position, end, pass_since,
+					   [&os, &queue](unsigned position, const auto &){
+			os.Fmt(FMT_STRING("journal_position: {}\n"), position);
+			queue_save_position(os, queue, position);
+		});
+
+	pass_position = end;
+
+	bool complete = false;
+	if (pass_position < length) {
+		/* continue in the next iteration */
+	} else if (queue.version != pass_version) {
+		/* the queue was modified during this pass; start
+		   another one which collects the modified items */
+		pass_since = pass_version;
+		pass_version = queue.version;
+		pass_position = 0;
+	} else {
+		os.Fmt(FMT_STRING("journal_length: {}\n"), length);
+		WriteStatus(os);
+		os.Write("journal_end\n");
+		complete = true;
+	}
+
+	os.Flush();
+	record.append(sos.GetValue());
+	return complete;
+}
+
+void
+StateFile::OnRecordEvent() noexcept
+{
+	try {
+		if (!BuildRecord()) {
+			record_event.Schedule(RECORD_CHUNK_DELAY);
+			return;
+		}
+
+		journal.Push(std::exchange(record, std::string{}),
+			     replace_record);
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to save state journal");
+		building_record = false;
+		return;
+	}
+
+	building_record = false;
+	replace_record = false;
+	journal_version = pass_version;
 	RememberVersions();
 }
 
@@ -97,7 +228,8 @@ try {
 
 	FmtDebug(state_file_domain, "Loading state file {}", path_utf8);
 
-	FileLineReader file{config.path};
+	StringLineReader file{LoadStateFile(config.path,
+					    journal.GetJournalPath()).ToString()};
 
 #ifdef ENABLE_DATABASE
 	const SongLoader song_loader(partition.instance.GetDatabase(),
@@ -131,12 +263,13 @@ try {
 void
 StateFile::CheckModified() noexcept
 {
-	if (!timer_event.IsPending() && IsModified())
+	if (!timer_event.IsPending() && !building_record && IsModified())
 		timer_event.Schedule(config.interval);
 }
 
 void
 StateFile::OnTimeout() noexcept
 {
-	Write();
+	if (!building_record)
+		BeginRecord();
 }
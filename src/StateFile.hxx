@@ -5,9 +5,12 @@
 #define MPD_STATE_FILE_HXX
 
 #include "StateFileConfig.hxx"
+#include "StateJournal.hxx"
 #include "event/FarTimerEvent.hxx"
+#include "event/FineTimerEvent.hxx"
 #include "config.h"
 
+#include <cstdint>
 #include <string>
 
 struct Partition;
@@ -21,8 +24,59 @@ class StateFile final {
 
 	FarTimerEvent timer_event;
 
+	/**
+	 * Builds the next journal #record, a chunk of queue items at
+	 * a time.  This is a timer (and not a #DeferEvent) so the
+	 * #EventLoop handles socket events between two chunks.
+	 */
+	FineTimerEvent record_event;
+
 	Partition &partition;
 
+	StateJournal journal;
+
+	/**
+	 * The journal record being built.
+	 */
+	std::string record;
+
+	/**
+	 * Is a journal record being built?
+	 */
+	bool building_record = false;
+
+	/**
+	 * Shall the next record contain the whole queue and replace
+	 * the state file?  This is necessary for the first record
+	 * after startup, because the queue may differ from what was
+	 * loaded.
+	 */
+	bool replace_record = true;
+
+	/**
+	 * Queue items modified in this version or later are added to
+	 * the record by the current pass.
+	 */
+	uint32_t pass_since;
+
+	/**
+	 * The queue version when the current pass began.  If it
+	 * differs after the pass, another pass collects the items
+	 * which were modified meanwhile.
+	 */
+	uint32_t pass_version;
+
+	/**
+	 * The next queue position to be visited by the current pass.
+	 */
+	unsigned pass_position;
+
+	/**
+	 * The journal contains all queue modifications before this
+	 * version.
+	 */
+	uint32_t journal_version = 0;
+
 	/**
 	 * These version numbers determine whether we need to save the state
 	 * file.  If nothing has changed, we won't let the hard drive spin up.
@@ -39,6 +93,11 @@ public:
 		  Partition &partition, EventLoop &loop);
 
 	void Read();
+
+	/**
+	 * Write the whole state file synchronously (and delete the
+	 * journal).  This is used during shutdown.
+	 */
 	void Write();
 
 	/**
@@ -50,6 +109,23 @@ private:
 	void Write(OutputStream &os);
 	void Write(BufferedOutputStream &os);
 
+	/**
+	 * Write everything except for the queue.
+	 */
+	void WriteStatus(BufferedOutputStream &os);
+
+	void BeginRecord() noexcept;
+
+	/**
+	 * Add the next chunk of queue items to the #record.
+	 *
+	 * @return true if the record is complete
+	 */
+	bool BuildRecord();
+
+	/* callback for #record_event */
+	void OnRecordEvent() noexcept;
+
 	/**
 	 * Save the current state versions for use with IsModified().
 	 */
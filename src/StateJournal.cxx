@@ -0,0 +1,437 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "StateJournal.hxx"
+#include "io/FileReader.hxx"
+#include "io/FileOutputStream.hxx"
+#include "system/Error.hxx"
+#include "util/djb_hash.hxx"
+#include "util/NumberParser.hxx"
+#include "util/SpanCast.hxx"
+#include "util/StringCompare.hxx"
+#include "util/Domain.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+#include "lib/fmt/PathFormatter.hxx"
+#include "Log.hxx"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+static constexpr Domain state_file_domain("state_file");
+
+static constexpr std::string_view PLAYLIST_BEGIN = "playlist_begin";
+static constexpr std::string_view PLAYLIST_END = "playlist_end";
+static constexpr std::string_view PRIO_LABEL = "Prio: ";
+static constexpr std::string_view SONG_BEGIN = "song_begin: ";
+static constexpr std::string_view SONG_END = "song_end";
+
+static constexpr std::string_view JOURNAL_SNAPSHOT = "journal_snapshot: ";
+static constexpr std::string_view JOURNAL_BEGIN = "journal_begin";
+static constexpr std::string_view JOURNAL_POSITION = "journal_position: ";
+static constexpr std::string_view JOURNAL_LENGTH = "journal_length: ";
+static constexpr std::string_view JOURNAL_END = "journal_end";
+
+/**
+ * Remove the first line from the given text and return it (without
+ * the newline character).
+ */
+static std::string_view
+NextLine(std::string_view &text) noexcept
+{
+	const auto newline = text.find('\n');
+	if (newline == text.npos)
+		return std::exchange(text, {});
+
+	const auto line = text.substr(0, newline);
+	text.remove_prefix(newline + 1);
+	return line;
+}
+
+static void
+AppendLine(std::string &dest, std::string_view line) noexcept
+{
+	dest.append(line);
+	dest.push_back('\n');
+}
+
+/**
+ * Read one queue entry (an optional "Prio" line and a song, which is
+ * either one line or a "song_begin" block).
+ *
+ * @param line the first line of the entry
+ * @return false if the entry is incomplete
+ */
+static bool
+ReadEntry(std::string_view line, std::string_view &text,
+	  std::string &entry) noexcept
+{
+	if (line.starts_with(PRIO_LABEL)) {
+		AppendLine(entry, line);
+
+		if (text.empty())
+			return false;
+
+		line = NextLine(text);
+	}
+
+	AppendLine(entry, line);
+
+	if (line.starts_with(SONG_BEGIN)) {
+		do {
+			if (text.empty())
+				return false;
+
+			line = NextLine(text);
+			AppendLine(entry, line);
+		} while (line != SONG_END);
+	}
+
+	return true;
+}
+
+void
+StateFileContents::ParseSnapshot(std::string_view text) noexcept
+{
+	while (!text.empty()) {
+		const auto line = NextLine(text);
+		if (line != PLAYLIST_BEGIN) {
+			AppendLine(status, line);
+			continue;
+		}
+
+		have_queue = true;
+
+		while (!text.empty()) {
+			const auto entry_line = NextLine(text);
+			if (entry_line.starts_with(PLAYLIST_END))
+				break;
+
+			std::string entry;
+			if (!ReadEntry(entry_line, text, entry))
+				break;
+
+			queue.emplace_back(std::move(entry));
+		}
+	}
+}
+
+inline bool
+StateFileContents::ApplyRecord(std::string_view &text) noexcept
+{
+	std::vector<std::pair<unsigned, std::string>> entries;
+	std::string new_status;
+	std::optional<unsigned> length;
+
+	while (true) {
+		if (text.empty())
+			/* incomplete */
+			return false;
+
+		auto line = NextLine(text);
+
+		if (length) {
+			if (line == JOURNAL_END)
+				break;
+
+			AppendLine(new_status, line);
+		} else if (SkipPrefix(line, JOURNAL_POSITION)) {
+			const auto position = ParseInteger<unsigned>(line);
+			if (!position || text.empty())
+				return false;
+
+			std::string entry;
+			if (!ReadEntry(NextLine(text), text, entry))
+				return false;
+
+			entries.emplace_back(*position, std::move(entry));
+		} else if (SkipPrefix(line, JOURNAL_LENGTH)) {
+			length = ParseInteger<unsigned>(line);
+			if (!length)
+				return false;
+		} else
+			/* garbage (or the beginning of another
+			   record): this record is incomplete */
+			return false;
+	}
+
+	/* the record is complete; apply it */
+
+	for (auto &[position, entry] : entries) {
+		if (position >= queue.size())
+			queue.resize(position + 1);
+		queue[position] = std::move(entry);
+	}
+
+	queue.resize(*length);
+	status = std::move(new_status);
+	have_queue = true;
+	return true;
+}
+
+bool
+StateFileContents::ApplyRecords(std::string_view text) noexcept
+{
+	while (!text.empty()) {
+		if (NextLine(text) != JOURNAL_BEGIN)
+			continue;
+
+		if (!ApplyRecord(text))
+			return false;
+	}
+
+	return true;
+}
+
+bool
+StateFileContents::ApplyJournal(std::string_view journal,
+				std::size_t snapshot_hash) noexcept
+{
+	auto header = NextLine(journal);
+	if (!SkipPrefix(header, JOURNAL_SNAPSHOT))
+		return false;
+
+	const auto hash = ParseInteger<std::size_t>(header, 16);
+	if (!hash || *hash != snapshot_hash)
+		return false;
+
+	if (!ApplyRecords(journal))
+		LogWarning(state_file_domain,
+			   "Ignoring incomplete record in state journal");
+	return true;
+}
+
+std::string
+StateFileContents::ToString() const noexcept
+{
+	std::size_t size = status.size();
+	if (have_queue) {
+		size += PLAYLIST_BEGIN.size() + PLAYLIST_END.size() + 2;
+		for (const auto &i : queue)
+			size += i.size();
+	}
+
+	std::string result;
+	result.reserve(size);
+	result.append(status);
+
+	if (have_queue) {
+		AppendLine(result, PLAYLIST_BEGIN);
+		for (const auto &i : queue)
+			result.append(i);
+		AppendLine(result, PLAYLIST_END);
+	}
+
+	return result;
+}
+
+std::size_t
+HashStateFile(std::string_view text) noexcept
+{
+	return djb_hash(AsBytes(text));
+}
+
+static std::string
+LoadFile(Path path)
+{
+	FileReader reader{path};
+
+	std::string result;
+	result.resize(reader.GetSize() + 1);
+
+	std::size_t position = 0;
+	while (true) {
+		if (position == result.size())
+			result.resize(result.size() * 2);
+
+		const std::size_t nbytes =
+			reader.Read(std::as_writable_bytes(std::span{result}.subspan(position)));
+		if (nbytes == 0)
+			break;
+
+		position += nbytes;
+	}
+
+	result.resize(position);
+	return result;
+}
+
+static std::string
+LoadOptionalFile(Path path)
+try {
+	return LoadFile(path);
+} catch (const std::system_error &e) {
+	if (IsFileNotFound(e))
+		return {};
+	throw;
+}
+
+StateFileContents
+LoadStateFile(Path snapshot_path, Path journal_path)
+{
+	const auto snapshot = LoadFile(snapshot_path);
+
+	StateFileContents contents;
+	contents.ParseSnapshot(snapshot);
+
+	const auto journal = LoadOptionalFile(journal_path);
+	if (!journal.empty() &&
+	    !contents.ApplyJournal(journal, HashStateFile(snapshot)))
+		FmtDebug(state_file_domain,
+			 "Ignoring obsolete state journal {}",
+			 journal_path);
+
+	return contents;
+}
+
+StateJournal::StateJournal(Path _snapshot_path) noexcept
+	:snapshot_path(_snapshot_path),
+	 journal_path(_snapshot_path + ".journal")
+{
+}
+
+void
+StateJournal::Push(std::string &&record, bool replace)
+{
+	{
+		const std::scoped_lock lock{mutex};
+		if (replace)
+			/* older records are obsolete */
+			jobs.clear();
+
+		jobs.push_back({std::move(record), replace});
+	}
+
+	if (!thread.IsDefined())
+		thread.Start();
+	else
+		cond.notify_one();
+}
+
+void
+StateJournal::Stop() noexcept
+{
+	if (!thread.IsDefined())
+		return;
+
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+	}
+
+	cond.notify_one();
+	thread.Join();
+
+	quit = false;
+}
+
+void
+StateJournal::WriteSnapshot(const StateFileContents &contents)
+{
+	journal_valid = false;
+
+	const auto text = contents.ToString();
+
+	FileOutputStream snapshot{snapshot_path};
+	snapshot.Write(AsBytes(text));
+	snapshot.Commit();
+
+	snapshot_size = text.size();
+
+	const auto header = fmt::format("{}{:x}\n", JOURNAL_SNAPSHOT,
+					HashStateFile(text));
+	FileOutputStream journal{journal_path};
+	journal.Write(AsBytes(header));
+	journal.Commit();
+
+	journal_size = header.size();
+	journal_valid = true;
+}
+
+void
+StateJournal::Compact()
+{
+	FmtDebug(state_file_domain, "Compacting state journal {}",
+		 journal_path);
+
+	WriteSnapshot(LoadStateFile(snapshot_path, journal_path));
+}
+
+void
+StateJournal::Append(std::string_view record)
+{
+	if (!journal_valid)
+		Compact();
+
+	journal_valid = false;
+
+	FileOutputStream journal{journal_path,
+		FileOutputStream::Mode::APPEND_EXISTING};
+	journal.Write(AsBytes(record));
+	journal.Commit();
+
+	journal_valid = true;
+	journal_size += record.size();
+
+	if (journal_size > std::max(snapshot_size, MIN_COMPACT_SIZE))
+		Compact();
+}
+
+inline void
+StateJournal::Execute(const Job &job)
+{
+	if (job.replace) {
+		StateFileContents contents;
+		contents.ApplyRecords(job.record);
+		WriteSnapshot(contents);
+	} else
+		Append(job.record);
+}
+
+void
+StateJournal::Run() noexcept
+{
+	SetThreadName("state_file");
+
+	/* writing the journal is not urgent; let it not compete with
+	   the main thread */
+	SetThreadIdlePriority();
+
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		if (jobs.empty()) {
+			if (quit)
+				break;
+
+			cond.wait(lock);
+			continue;
+		}
+
+		const auto pending = std::exchange(jobs, {});
+		lock.unlock();
+
+		for (const auto &job : pending) {
+			if (broken && !job.replace)
+				/* this record depends on one which
+				   was lost; wait for the next
+				   replacement */
+				continue;
+
+			try {
+				Execute(job);
+				broken = false;
+			} catch (...) {
+				LogError(std::current_exception(),
+					 "Failed to write state journal");
+				broken = true;
+				failed = true;
+			}
+		}
+
+		lock.lock();
+	}
+}
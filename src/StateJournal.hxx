@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "fs/AllocatedPath.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * The state file journal is a file next to the state file (with the
+ * suffix ".journal") where changes are appended instead of rewriting
+ * the whole state file.  It begins with a line identifying the state
+ * file it belongs to:
+ *
+ *   journal_snapshot: HASH
+ *
+ * followed by records:
+ *
+ *   journal_begin
+ *   journal_position: POSITION
+ *   (queue entry, same format as in the state file)
+ *   ...
+ *   journal_length: LENGTH
+ *   (all state file lines except for the queue)
+ *   journal_end
+ *
+ * A record contains only the queue entries which were modified since
+ * the previous record; positions beyond the new queue length are
+ * discarded.  Incomplete records are ignored.
+ */
+
+/**
+ * The contents of a state file, with the queue entries split apart,
+ * so journal records can be applied to it.
+ */
+struct StateFileContents {
+	/**
+	 * All lines except for the queue section.
+	 */
+	std::string status;
+
+	/**
+	 * The queue entries (the optional "Prio" line and the song),
+	 * indexed by position.
+	 */
+	std::vector<std::string> queue;
+
+	/**
+	 * Was there a queue section?
+	 */
+	bool have_queue = false;
+
+	/**
+	 * Parse the contents of a state file.
+	 */
+	void ParseSnapshot(std::string_view text) noexcept;
+
+	/**
+	 * Apply all complete records of the given journal, unless its
+	 * header refers to a different snapshot.
+	 *
+	 * @param snapshot_hash the hash of the state file (see
+	 * HashStateFile())
+	 * @return false if the journal does not belong to the state
+	 * file
+	 */
+	bool ApplyJournal(std::string_view journal,
+			  std::size_t snapshot_hash) noexcept;
+
+	/**
+	 * Apply records (without the journal header).
+	 *
+	 * @return false if the last record was incomplete
+	 */
+	bool ApplyRecords(std::string_view records) noexcept;
+
+	/**
+	 * Format the contents as a state file.
+	 */
+	[[gnu::pure]]
+	std::string ToString() const noexcept;
+
+private:
+	bool ApplyRecord(std::string_view &text) noexcept;
+};
+
+[[gnu::pure]]
+std::size_t
+HashStateFile(std::string_view text) noexcept;
+
+/**
+ * Load the given state file and apply its journal.
+ *
+ * Throws on error (but a missing journal is not an error).
+ */
+StateFileContents
+LoadStateFile(Path snapshot_path, Path journal_path);
+
+/**
+ * Writes records to the state file journal in a separate thread.
+ * When the journal grows larger than the state file, both are merged
+ * into a new state file (in the same thread).
+ */
+class StateJournal final {
+	/**
+	 * Compact only after the journal has grown to at least this
+	 * size.
+	 */
+	static constexpr std::size_t MIN_COMPACT_SIZE = 64 * 1024;
+
+	const AllocatedPath snapshot_path, journal_path;
+
+	Thread thread{BIND_THIS_METHOD(Run)};
+
+	Mutex mutex;
+	Cond cond;
+
+	struct Job {
+		std::string record;
+
+		/**
+		 * If true, then this record contains the whole queue
+		 * and replaces the state file.
+		 */
+		bool replace;
+	};
+
+	/**
+	 * Records which have not yet been written.  Protected by
+	 * #mutex.
+	 */
+	std::vector<Job> jobs;
+
+	/**
+	 * Shall the thread exit after writing all #jobs?  Protected by
+	 * #mutex.
+	 */
+	bool quit = false;
+
+	/**
+	 * Set by the thread after writing a record has failed; the
+	 * next record must then replace the state file, because the
+	 * journal may have lost a record.
+	 */
+	std::atomic_bool failed{false};
+
+	/* the following fields are only used by the thread */
+
+	/**
+	 * Does the journal file exist and belong to the current state
+	 * file?
+	 */
+	bool journal_valid = false;
+
+	/**
+	 * Writing a record has failed; all further records are
+	 * discarded until one replaces the state file.
+	 */
+	bool broken = false;
+
+	std::size_t snapshot_size = 0, journal_size = 0;
+
+public:
+	explicit StateJournal(Path _snapshot_path) noexcept;
+
+	~StateJournal() noexcept {
+		Stop();
+	}
+
+	StateJournal(const StateJournal &) = delete;
+	StateJournal &operator=(const StateJournal &) = delete;
+
+	Path GetJournalPath() const noexcept {
+		return journal_path;
+	}
+
+	/**
+	 * Has writing a record failed since the last call?
+	 */
+	bool CheckFailed() noexcept {
+		return failed.exchange(false);
+	}
+
+	/**
+	 * Submit a record (see #Job) to the thread; starts the thread
+	 * if necessary.
+	 */
+	void Push(std::string &&record, bool replace);
+
+	/**
+	 * Write all pending records and stop the thread.
+	 */
+	void Stop() noexcept;
+
+private:
+	void Run() noexcept;
+	void Execute(const Job &job);
+
+	void Append(std::string_view record);
+
+	/**
+	 * Merge the state file with its journal into a new state
+	 * file.
+	 */
+	void Compact();
+
+	/**
+	 * Replace the state file and start a new (empty) journal.
+	 */
+	void WriteSnapshot(const StateFileContents &contents);
+};
@@ -10,6 +10,7 @@
 #include "db/Selection.hxx"
 #include "db/Interface.hxx"
 #include "db/Stats.hxx"
+#include "input/cache/Manager.hxx"
 #include "Log.hxx"
 #include "time/ChronoUtil.hxx"
 #include "util/Math.hxx"
@@ -100,6 +101,21 @@ db_stats_print(Response &r, const Database &db)
 
 #endif
 
+static void
+input_cache_stats_print(Response &r, const InputCacheManager &cache)
+{
+	const auto s = cache.GetStats();
+
+	r.Fmt(FMT_STRING("input_cache_size: {}\n"
+			 "input_cache_hits: {}\n"
+			 "input_cache_disk_hits: {}\n"
+			 "input_cache_misses: {}\n"
+			 "input_cache_prefetched: {}\n"),
+	      s.size,
+	      s.hits, s.disk_hits, s.misses,
+	      s.prefetched_bytes);
+}
+
 void
 stats_print(Response &r, const Partition &partition)
 {
@@ -119,4 +135,7 @@ stats_print(Response &r, const Partition &partition)
 	if (db != nullptr)
 		db_stats_print(r, *db);
 #endif
+
+	if (partition.instance.input_cache)
+		input_cache_stats_print(r, *partition.instance.input_cache);
 }
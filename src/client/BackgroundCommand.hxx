@@ -15,6 +15,7 @@
  * is a special case.)
  *
  * @see ThreadBackgroundCommand
+ * @see StreamBackgroundCommand
  */
 class BackgroundCommand {
 public:
@@ -26,6 +27,32 @@ public:
 	 * #Client's #EventLoop thread.
 	 */
 	virtual void Cancel() noexcept = 0;
+
+	/**
+	 * The client is being closed (e.g. because the connection
+	 * has been closed by the peer).  Like Cancel(), but a
+	 * command which cannot be interrupted without blocking the
+	 * #EventLoop may decline; it then continues to run and calls
+	 * Client::OnBackgroundCommandFinished() when it is done,
+	 * without sending a response.  It will be called from the
+	 * #Client's #EventLoop thread.
+	 *
+	 * @return true if the command has been cancelled and the
+	 * object may be deleted
+	 */
+	virtual bool Abandon() noexcept {
+		Cancel();
+		return true;
+	}
+
+	/**
+	 * The client's output buffer has been flushed completely.
+	 * Commands which stream their response may use this to
+	 * generate more of it.  It will be called from the
+	 * #Client's #EventLoop thread, and the method must not write
+	 * to the client directly.
+	 */
+	virtual void OnClientDrained() noexcept {}
 };
 
 #endif
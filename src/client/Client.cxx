@@ -2,6 +2,7 @@
 // Copyright The Music Player Daemon Project
 
 #include "Client.hxx"
+#include "Compressor.hxx"
 #include "Config.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
@@ -39,6 +40,13 @@ Client::OnBackgroundCommandFinished() noexcept
 
 	background_command.reset();
 
+	if (IsExpired()) {
+		/* the client has been closed while the command was
+		   running (see SetExpired()); dispose of it now */
+		timeout_event.Schedule(Event::Duration::zero());
+		return;
+	}
+
 	/* just in case OnSocketInput() has returned
 	   InputResult::PAUSE meanwhile */
 	ResumeInput();
@@ -46,6 +54,13 @@ Client::OnBackgroundCommandFinished() noexcept
 	timeout_event.Schedule(client_timeout);
 }
 
+void
+Client::OnSocketDrained() noexcept
+{
+	if (background_command)
+		background_command->OnClientDrained();
+}
+
 void
 Client::SetPartition(Partition &new_partition) noexcept
 {
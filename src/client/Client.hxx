@@ -55,6 +55,9 @@ class Client final
 	/** is this client waiting for an "idle" response? */
 	bool idle_waiting = false;
 
+	/** is a command list being executed right now? */
+	bool in_command_list = false;
+
 	/** idle flags pending on this client, to be sent as soon as
 	    the client enters "idle" */
 	unsigned idle_flags = 0;
@@ -62,6 +65,14 @@ class Client final
 	/** idle flags that the client wants to receive */
 	unsigned idle_subscriptions;
 
+	class Compressor;
+
+	/**
+	 * If this is set, then all output is compressed.  See
+	 * EnableCompression().
+	 */
+	std::unique_ptr<Compressor> compressor;
+
 public:
 	// TODO: make this attribute "private"
 	/**
@@ -75,6 +86,12 @@ public:
 	 */
 	size_t binary_limit = 8192;
 
+	/**
+	 * Send list responses in the "compact" format?  Can be
+	 * changed with the "responseformat" command.
+	 */
+	bool compact_responses = false;
+
 	/**
 	 * This caches the last "albumart" InputStream instance, to
 	 * avoid repeating the search for each chunk requested by this
@@ -143,6 +160,23 @@ public:
 		return Write("OK\n");
 	}
 
+	/**
+	 * Compress all following output with "gzip" (see command
+	 * "compress").  This is only available if MPD was built with
+	 * zlib.
+	 *
+	 * Throws on error.
+	 */
+	void EnableCompression();
+
+	/**
+	 * Finish the compressed stream; all following output will be
+	 * uncompressed.
+	 *
+	 * @return false if the client has been closed
+	 */
+	bool DisableCompression() noexcept;
+
 	/**
 	 * returns the uid of the client process, or a negative value
 	 * if the uid is unknown
@@ -174,6 +208,14 @@ public:
 	void IdleAdd(unsigned flags) noexcept;
 	bool IdleWait(unsigned flags) noexcept;
 
+	/**
+	 * Is the current command part of a command list?  Such
+	 * commands cannot be deferred to a #BackgroundCommand.
+	 */
+	bool IsInCommandList() const noexcept {
+		return in_command_list;
+	}
+
 	/**
 	 * Called by a command handler to defer execution to a
 	 * #BackgroundCommand.
@@ -182,8 +224,10 @@ public:
 
 	/**
 	 * Called by the current #BackgroundCommand when it has
-	 * finished, after sending the response.  This method then
-	 * deletes the #BackgroundCommand.
+	 * finished, after sending the response (or without one if
+	 * the client has been closed meanwhile, see
+	 * BackgroundCommand::Abandon()).  This method then deletes
+	 * the #BackgroundCommand.
 	 */
 	void OnBackgroundCommandFinished() noexcept;
 
@@ -253,10 +297,21 @@ public:
 
 private:
 	CommandResult ProcessCommandList(bool list_ok,
-					 std::list<std::string> &&list) noexcept;
+					 std::string &&list) noexcept;
 
 	CommandResult ProcessLine(char *line) noexcept;
 
+	/**
+	 * Pass all data pending in the compressor (if any) to the
+	 * output buffer.
+	 *
+	 * @return false if the client has been closed
+	 */
+	bool FlushCompressor() noexcept;
+
+	/* virtual methods from class FullyBufferedSocket */
+	void OnSocketDrained() noexcept override;
+
 	/* virtual methods from class BufferedSocket */
 	InputResult OnSocketInput(std::span<std::byte> src) noexcept override;
 	void OnSocketError(std::exception_ptr ep) noexcept override;
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "CommandPool.hxx"
+#include "thread/Name.hxx"
+
+#include <cassert>
+
+CommandPool::CommandPool(unsigned n_threads)
+{
+	try {
+		for (unsigned i = 0; i < n_threads; ++i)
+			threads.emplace_back(BIND_THIS_METHOD(ThreadFunc)).Start();
+	} catch (...) {
+		Stop();
+		throw;
+	}
+}
+
+CommandPool::~CommandPool() noexcept
+{
+	Stop();
+
+	assert(queue.empty());
+}
+
+void
+CommandPool::Stop() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		wake_cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		if (thread.IsDefined())
+			thread.Join();
+
+	threads.clear();
+}
+
+void
+CommandPool::Push(CommandPoolJob &job) noexcept
+{
+	const std::scoped_lock lock{mutex};
+	assert(job.state == CommandPoolJob::State::IDLE);
+
+	job.state = CommandPoolJob::State::QUEUED;
+	queue.push_back(job);
+	wake_cond.notify_one();
+}
+
+bool
+CommandPool::Remove(CommandPoolJob &job) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	switch (job.state) {
+	case CommandPoolJob::State::IDLE:
+		break;
+
+	case CommandPoolJob::State::QUEUED:
+		queue.erase(queue.iterator_to(job));
+		job.state = CommandPoolJob::State::IDLE;
+		break;
+
+	case CommandPoolJob::State::RUNNING:
+		return false;
+	}
+
+	return true;
+}
+
+inline void
+CommandPool::ThreadFunc() noexcept
+{
+	SetThreadName("command");
+
+	std::unique_lock lock{mutex};
+
+	while (!quit) {
+		if (queue.empty()) {
+			wake_cond.wait(lock);
+			continue;
+		}
+
+		auto &job = queue.pop_front();
+		job.state = CommandPoolJob::State::RUNNING;
+
+		{
+			const ScopeUnlock unlock{mutex};
+			job.Run();
+		}
+
+		job.state = CommandPoolJob::State::IDLE;
+		job.OnFinished();
+	}
+}
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_CLIENT_COMMAND_POOL_HXX
+#define MPD_CLIENT_COMMAND_POOL_HXX
+
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <cstdint>
+#include <list>
+
+/**
+ * A job which can be submitted to a #CommandPool.
+ */
+class CommandPoolJob : public IntrusiveListHook<> {
+	friend class CommandPool;
+
+	enum class State : uint_least8_t {
+		IDLE,
+		QUEUED,
+		RUNNING,
+	};
+
+	/**
+	 * Protected by CommandPool::mutex.
+	 */
+	State state = State::IDLE;
+
+public:
+	CommandPoolJob() noexcept = default;
+	CommandPoolJob(const CommandPoolJob &) = delete;
+	CommandPoolJob &operator=(const CommandPoolJob &) = delete;
+
+protected:
+	~CommandPoolJob() noexcept = default;
+
+	/**
+	 * Do the work.  This is called in a worker thread.
+	 */
+	virtual void Run() noexcept = 0;
+
+	/**
+	 * Called in the worker thread after Run() has returned,
+	 * while the pool's mutex is held.  The implementation
+	 * usually notifies the #EventLoop thread, which then calls
+	 * CommandPool::Remove().  Once the mutex is released, the
+	 * pool does not access this object anymore.
+	 */
+	virtual void OnFinished() noexcept = 0;
+};
+
+/**
+ * A pool of threads which execute client commands that only read
+ * (the database, the storage or song files), so expensive queries do
+ * not block the main #EventLoop.
+ */
+class CommandPool final {
+	Mutex mutex;
+
+	/**
+	 * Signalled when a new job has been queued or when the
+	 * threads shall quit.
+	 */
+	Cond wake_cond;
+
+	IntrusiveList<CommandPoolJob> queue;
+
+	std::list<Thread> threads;
+
+	bool quit = false;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param n_threads the number of worker threads to be
+	 * launched
+	 */
+	explicit CommandPool(unsigned n_threads);
+
+	/**
+	 * Calls Stop().  No job may be queued.
+	 */
+	~CommandPool() noexcept;
+
+	CommandPool(const CommandPool &) = delete;
+	CommandPool &operator=(const CommandPool &) = delete;
+
+	/**
+	 * Let all threads finish their current job and join them.
+	 * Jobs which are still queued will never be run; they must
+	 * be removed with Remove() later.  After this method has
+	 * returned, no job is running.
+	 */
+	void Stop() noexcept;
+
+	/**
+	 * Submit a job.  The caller must not touch the object until
+	 * Remove() has returned.
+	 */
+	void Push(CommandPoolJob &job) noexcept;
+
+	/**
+	 * Remove a job from the pool: if it has not been started
+	 * yet, it is removed from the queue.  This method never
+	 * waits for a running job.
+	 *
+	 * @return true if the job has been removed and may be
+	 * destroyed, false if it is currently running; in that case,
+	 * the caller must wait for CommandPoolJob::OnFinished() and
+	 * call this method again
+	 */
+	bool Remove(CommandPoolJob &job) noexcept;
+
+private:
+	void ThreadFunc() noexcept;
+};
+
+#endif
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "CompactEncoder.hxx"
+
+void
+CompactEncoder::Feed(std::string_view text) noexcept
+{
+	while (!text.empty()) {
+		const auto newline = text.find('\n');
+		if (newline == text.npos) {
+			partial.append(text);
+			return;
+		}
+
+		const auto line = text.substr(0, newline);
+		text.remove_prefix(newline + 1);
+
+		if (partial.empty())
+			EncodeLine(line);
+		else {
+			partial.append(line);
+			EncodeLine(partial);
+			partial.clear();
+		}
+	}
+}
+
+void
+CompactEncoder::Finish() noexcept
+{
+	if (!partial.empty()) {
+		EncodeLine(partial);
+		partial.clear();
+	}
+}
+
+inline void
+CompactEncoder::EncodeLine(std::string_view line) noexcept
+{
+	std::string_view key = line, value{};
+	if (const auto colon = line.find(": "); colon != line.npos) {
+		key = line.substr(0, colon);
+		value = line.substr(colon + 2);
+	}
+
+	output.push_back(GetKeyId(key));
+	AppendSize(value.size());
+	output.append(value);
+}
+
+inline unsigned char
+CompactEncoder::GetKeyId(std::string_view key) noexcept
+{
+	std::size_t i = last_key + 1;
+	if (i >= keys.size() || keys[i] != key) {
+		for (i = 0; i < keys.size(); ++i)
+			if (keys[i] == key)
+				break;
+
+		if (i == keys.size()) {
+			/* not yet defined; if the table is full, the
+			   last id gets redefined */
+			if (keys.size() < MAX_KEYS)
+				keys.emplace_back(key);
+			else
+				keys[--i] = key;
+
+			output.push_back(0);
+			output.push_back(i + 1);
+			AppendSize(key.size());
+			output.append(key);
+		}
+	}
+
+	last_key = i;
+	return i + 1;
+}
+
+inline void
+CompactEncoder::AppendSize(std::size_t size) noexcept
+{
+	while (size >= 0x80) {
+		output.push_back(0x80 | (size & 0x7f));
+		size >>= 7;
+	}
+
+	output.push_back(size);
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Converts "Key: value" response lines to the "compact" response
+ * format (see command "responseformat").  Each attribute is encoded
+ * as one byte key id, the value length (unsigned LEB128) and the
+ * value.  Key id 0 introduces a key definition: the id being
+ * defined, the length of the name and the name.  Each key is defined
+ * before its first use; definitions are only valid until the end of
+ * the response.
+ */
+class CompactEncoder {
+	static constexpr std::size_t MAX_KEYS = 255;
+
+	/**
+	 * Encoded data which has not yet been sent.
+	 */
+	std::string output;
+
+	/**
+	 * An incomplete line from the previous Feed() call.
+	 */
+	std::string partial;
+
+	/**
+	 * The defined keys; the id is the index plus one.
+	 */
+	std::vector<std::string> keys;
+
+	/**
+	 * The index of the key which was used last.  Attributes
+	 * usually appear in the same order for each song, so the key
+	 * after this one is checked first.
+	 */
+	std::size_t last_key = 0;
+
+public:
+	/**
+	 * Encode response text; it may end with an incomplete line,
+	 * which will be completed by the next call.
+	 */
+	void Feed(std::string_view text) noexcept;
+
+	/**
+	 * Encode the incomplete line from the last Feed() call (if
+	 * any).
+	 */
+	void Finish() noexcept;
+
+	std::string_view GetOutput() const noexcept {
+		return output;
+	}
+
+	void ConsumeOutput(std::size_t n) noexcept {
+		output.erase(0, n);
+	}
+
+private:
+	void EncodeLine(std::string_view line) noexcept;
+
+	/**
+	 * Look up (and define if necessary) the given key.
+	 *
+	 * @return the key id
+	 */
+	unsigned char GetKeyId(std::string_view key) noexcept;
+
+	void AppendSize(std::size_t size) noexcept;
+};
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Compressor.hxx"
+
+#include <stdexcept>
+
+void
+Client::Compressor::WriteCompressed(std::span<const std::byte> src)
+{
+	if (!client.FullyBufferedSocket::Write(src.data(), src.size()))
+		/* the client has been closed */
+		throw std::runtime_error("Output buffer is full");
+}
+
+void
+Client::Compressor::OnCompressorError(std::exception_ptr e) noexcept
+{
+	/* if the output buffer has overflowed, the error has
+	   already been reported */
+	if (!client.IsExpired())
+		client.OnSocketError(std::move(e));
+}
+
+void
+Client::EnableCompression()
+{
+	if (!compressor)
+		compressor = std::make_unique<Compressor>(*this);
+}
+
+bool
+Client::DisableCompression() noexcept
+{
+	if (!compressor)
+		return true;
+
+	const bool success = compressor->Finish();
+	compressor.reset();
+	return success;
+}
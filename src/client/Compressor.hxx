@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "Client.hxx"
+#include "config.h"
+
+#ifdef ENABLE_ZLIB
+
+#include "IdleCompressor.hxx"
+
+/**
+ * Compresses all output of a #Client (see command "compress").
+ * Compressed data is passed to the output buffer whenever the
+ * #EventLoop becomes idle, i.e. after each batch of responses, so
+ * the client can always decompress complete responses.
+ */
+class Client::Compressor final : public IdleCompressor {
+	Client &client;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	explicit Compressor(Client &_client)
+		:IdleCompressor(_client.GetEventLoop()),
+		 client(_client) {}
+
+private:
+	/* virtual methods from class IdleCompressor */
+	void WriteCompressed(std::span<const std::byte> src) override;
+	void OnCompressorError(std::exception_ptr e) noexcept override;
+};
+
+#else
+
+/* without zlib, this class is never instantiated */
+class Client::Compressor {};
+
+#endif
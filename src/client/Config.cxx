@@ -11,6 +11,8 @@
 Event::Duration client_timeout;
 size_t client_max_command_list_size;
 size_t client_max_output_buffer_size;
+bool client_song_response_cache;
+unsigned client_command_threads;
 
 void
 client_manager_init(const ConfigData &config)
@@ -28,4 +30,10 @@ client_manager_init(const ConfigData &config)
 		config.GetPositive(ConfigOption::MAX_OUTPUT_BUFFER_SIZE,
 				   CLIENT_MAX_OUTPUT_BUFFER_SIZE_DEFAULT / 1024)
 		* 1024;
+
+	client_song_response_cache =
+		config.GetBool(ConfigOption::SONG_RESPONSE_CACHE, false);
+
+	client_command_threads =
+		config.GetUnsigned(ConfigOption::COMMAND_THREADS, 0);
 }
@@ -12,6 +12,18 @@ extern Event::Duration client_timeout;
 extern size_t client_max_command_list_size;
 extern size_t client_max_output_buffer_size;
 
+/**
+ * Cache the formatted song attributes in each song object?  See
+ * #SongResponseCache.
+ */
+extern bool client_song_response_cache;
+
+/**
+ * The number of threads executing read-only commands; 0 means they
+ * are executed in the main thread.  See #CommandPool.
+ */
+extern unsigned client_command_threads;
+
 void
 client_manager_init(const ConfigData &config);
 
@@ -12,13 +12,15 @@ Client::SetExpired() noexcept
 	if (IsExpired())
 		return;
 
-	if (background_command) {
-		background_command->Cancel();
+	if (background_command && background_command->Abandon())
 		background_command.reset();
-	}
 
 	FullyBufferedSocket::Close();
-	timeout_event.Schedule(Event::Duration::zero());
+
+	if (!background_command)
+		/* if a command is still running, the client will be
+		   closed by OnBackgroundCommandFinished() */
+		timeout_event.Schedule(Event::Duration::zero());
 }
 
 void
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "IdleCompressor.hxx"
+
+IdleCompressor::IdleCompressor(EventLoop &event_loop)
+	:flush_event(event_loop, BIND_THIS_METHOD(OnFlushEvent)),
+	 gzip(*this)
+{
+}
+
+bool
+IdleCompressor::Compress(std::span<const std::byte> src) noexcept
+{
+	try {
+		gzip.Write(src);
+	} catch (...) {
+		OnCompressorError(std::current_exception());
+		return false;
+	}
+
+	pending = true;
+	flush_event.Schedule();
+	return true;
+}
+
+bool
+IdleCompressor::Flush() noexcept
+{
+	flush_event.Cancel();
+
+	if (!pending)
+		return true;
+
+	pending = false;
+
+	try {
+		gzip.SyncFlush();
+	} catch (...) {
+		OnCompressorError(std::current_exception());
+		return false;
+	}
+
+	return true;
+}
+
+bool
+IdleCompressor::Finish() noexcept
+{
+	flush_event.Cancel();
+
+	try {
+		gzip.Finish();
+	} catch (...) {
+		OnCompressorError(std::current_exception());
+		return false;
+	}
+
+	return true;
+}
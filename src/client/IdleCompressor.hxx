@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_CLIENT_IDLE_COMPRESSOR_HXX
+#define MPD_CLIENT_IDLE_COMPRESSOR_HXX
+
+#include "event/IdleEvent.hxx"
+#include "io/OutputStream.hxx"
+#include "lib/zlib/GzipOutputStream.hxx"
+
+#include <exception>
+#include <span>
+
+/**
+ * Compresses a stream of data with "gzip".  Compressed data is
+ * passed to WriteCompressed() whenever the #EventLoop becomes idle
+ * (with Z_SYNC_FLUSH), i.e. after each batch of writes, so the
+ * receiver can always decompress all data written so far.
+ *
+ * This is the part of #Client::Compressor which does not depend on
+ * the #Client.
+ */
+class IdleCompressor : OutputStream {
+	IdleEvent flush_event;
+
+	GzipOutputStream gzip;
+
+	/**
+	 * Has data been compressed since the last flush?
+	 */
+	bool pending = false;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	explicit IdleCompressor(EventLoop &event_loop);
+
+	IdleCompressor(const IdleCompressor &) = delete;
+	IdleCompressor &operator=(const IdleCompressor &) = delete;
+
+	/**
+	 * Compress data.
+	 *
+	 * @return false on error (after OnCompressorError() has been
+	 * called)
+	 */
+	bool Compress(std::span<const std::byte> src) noexcept;
+
+	/**
+	 * Pass all pending compressed data to WriteCompressed().
+	 *
+	 * @return false on error (after OnCompressorError() has been
+	 * called)
+	 */
+	bool Flush() noexcept;
+
+	/**
+	 * Finish the compressed stream.  This object must not be
+	 * used afterwards.
+	 *
+	 * @return false on error (after OnCompressorError() has been
+	 * called)
+	 */
+	bool Finish() noexcept;
+
+protected:
+	~IdleCompressor() noexcept = default;
+
+	/**
+	 * Consume compressed data.
+	 *
+	 * Throws on error.
+	 */
+	virtual void WriteCompressed(std::span<const std::byte> src) = 0;
+
+	/**
+	 * An error has occurred (thrown by WriteCompressed() or by
+	 * zlib).
+	 */
+	virtual void OnCompressorError(std::exception_ptr e) noexcept = 0;
+
+private:
+	void OnFlushEvent() noexcept {
+		Flush();
+	}
+
+	/* virtual methods from class OutputStream */
+	void Write(std::span<const std::byte> src) override {
+		WriteCompressed(src);
+	}
+};
+
+#endif
@@ -2,6 +2,7 @@
 // Copyright The Music Player Daemon Project
 
 #include "Client.hxx"
+#include "Compressor.hxx"
 #include "Config.hxx"
 #include "Domain.hxx"
 #include "List.hxx"
@@ -8,6 +8,9 @@
 #include "Log.hxx"
 #include "util/StringAPI.hxx"
 #include "util/CharUtil.hxx"
+#include "util/ScopeExit.hxx"
+
+#include <string.h>
 
 #define CLIENT_LIST_MODE_BEGIN "command_list_begin"
 #define CLIENT_LIST_OK_MODE_BEGIN "command_list_ok_begin"
@@ -15,12 +18,18 @@
 
 inline CommandResult
 Client::ProcessCommandList(bool list_ok,
-			   std::list<std::string> &&list) noexcept
+			   std::string &&list) noexcept
 {
+	AtScopeExit(this) { in_command_list = false; };
+	in_command_list = true;
+
 	unsigned n = 0;
 
-	for (auto &&i : list) {
-		char *cmd = &*i.begin();
+	char *const end = list.data() + list.size();
+	for (char *cmd = list.data(), *next; cmd < end; cmd = next) {
+		/* determine the next command before this one gets
+		   modified by the tokenizer */
+		next = cmd + strlen(cmd) + 1;
 
 		FmtDebug(client_domain, "process command {:?}", cmd);
 		auto ret = command_process(*this, n++, cmd);
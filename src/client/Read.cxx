@@ -44,7 +44,7 @@ Client::OnSocketInput(std::span<std::byte> src) noexcept
 		return InputResult::CLOSED;
 
 	case CommandResult::FINISH:
-		if (Flush())
+		if (FlushCompressor() && Flush())
 			Close();
 		return InputResult::CLOSED;
 
@@ -6,22 +6,86 @@
 
 #include <fmt/format.h>
 
+#include <cassert>
+
+#include <string.h>
+
 TagMask
 Response::GetTagMask() const noexcept
 {
 	return GetClient().tag_mask;
 }
 
+Response::~Response() noexcept
+{
+	if (compact)
+		FlushCompact(true);
+}
+
+void
+Response::EnableCompact() noexcept
+{
+	compact = std::make_unique<CompactEncoder>();
+}
+
 bool
-Response::Write(const void *data, size_t length) noexcept
+Response::WriteRaw(const void *data, size_t length) noexcept
 {
+	if (redirect != nullptr) {
+		if (redirect_full ||
+		    length > redirect_max_size - redirect->size()) {
+			/* like the client's output buffer, refuse to
+			   grow beyond the configured limit */
+			redirect_full = true;
+			return false;
+		}
+
+		redirect->append((const char *)data, length);
+		return true;
+	}
+
 	return client.Write(data, length);
 }
 
+bool
+Response::FlushCompact(bool finish) noexcept
+{
+	assert(compact);
+
+	if (finish)
+		compact->Finish();
+
+	const std::size_t chunk_size = client.binary_limit;
+
+	while (true) {
+		const auto output = compact->GetOutput();
+		if (output.empty() ||
+		    (!finish && output.size() < chunk_size))
+			return true;
+
+		const auto chunk = output.substr(0, chunk_size);
+		if (!WriteBinary(std::as_bytes(std::span{chunk})))
+			return false;
+
+		compact->ConsumeOutput(chunk.size());
+	}
+}
+
+bool
+Response::Write(const void *data, size_t length) noexcept
+{
+	if (compact) {
+		compact->Feed({(const char *)data, length});
+		return FlushCompact(false);
+	}
+
+	return WriteRaw(data, length);
+}
+
 bool
 Response::Write(const char *data) noexcept
 {
-	return client.Write(data);
+	return Write(data, strlen(data));
 }
 
 bool
@@ -37,15 +101,31 @@ Response::WriteBinary(std::span<const std::byte> payload) noexcept
 {
 	assert(payload.size() <= client.binary_limit);
 
+	char header[32];
+	const auto header_end = fmt::format_to_n(header, sizeof(header),
+						 "binary: {}\n",
+						 payload.size()).out;
+
 	return
-		Fmt("binary: {}\n", payload.size()) &&
-		Write(payload.data(), payload.size()) &&
-		Write("\n");
+		WriteRaw(header, header_end - header) &&
+		WriteRaw(payload.data(), payload.size()) &&
+		WriteRaw("\n", 1);
+}
+
+void
+Response::DisableCompact() noexcept
+{
+	if (compact) {
+		FlushCompact(true);
+		compact.reset();
+	}
 }
 
 void
 Response::Error(enum ack code, const char *msg) noexcept
 {
+	DisableCompact();
+
 	Fmt(FMT_STRING("ACK [{}@{}] {{{}}} "),
 	    (int)code, list_index, command);
 
@@ -57,6 +137,8 @@ void
 Response::VFmtError(enum ack code,
 		    fmt::string_view format_str, fmt::format_args args) noexcept
 {
+	DisableCompact();
+
 	Fmt(FMT_STRING("ACK [{}@{}] {{{}}} "),
 	    (int)code, list_index, command);
 
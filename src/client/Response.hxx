@@ -3,12 +3,16 @@
 
 #pragma once
 
+#include "CompactEncoder.hxx"
 #include "protocol/Ack.hxx"
 
 #include <fmt/core.h>
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <span>
+#include <string>
 
 class Client;
 class TagMask;
@@ -27,10 +31,43 @@ class Response {
 	 */
 	const char *command = "";
 
+	/**
+	 * If this is set, then the response is appended to this
+	 * buffer instead of being sent to the client.  This is used
+	 * to generate a response in advance, to be sent later.
+	 */
+	std::string *const redirect = nullptr;
+
+	/**
+	 * The maximum size of the #redirect buffer.  Everything
+	 * beyond that is discarded, and #redirect_full is set.
+	 */
+	const std::size_t redirect_max_size = 0;
+
+	bool redirect_full = false;
+
+	/**
+	 * If this is set, then the "Key: value" lines written to
+	 * this object are converted to the "compact" format and sent
+	 * in "binary" chunks.  See EnableCompact().
+	 */
+	std::unique_ptr<CompactEncoder> compact;
+
 public:
 	Response(Client &_client, unsigned _list_index) noexcept
 		:client(_client), list_index(_list_index) {}
 
+	Response(Client &_client, unsigned _list_index,
+		 std::string &_buffer,
+		 std::size_t _max_size=SIZE_MAX) noexcept
+		:client(_client), list_index(_list_index), redirect(&_buffer),
+		 redirect_max_size(_max_size) {}
+
+	/**
+	 * Sends the rest of the compact response (if any).
+	 */
+	~Response() noexcept;
+
 	Response(const Response &) = delete;
 	Response &operator=(const Response &) = delete;
 
@@ -55,6 +92,32 @@ public:
 		command = _command;
 	}
 
+	/**
+	 * Encode the following response lines in the "compact"
+	 * format (see command "responseformat").  Errors are still
+	 * sent as text.  This must not be combined with
+	 * WriteBinary().
+	 */
+	void EnableCompact() noexcept;
+
+	bool IsCompact() const noexcept {
+		return compact != nullptr;
+	}
+
+	/**
+	 * Has the redirect buffer overflowed, i.e. has some of the
+	 * response been discarded?
+	 */
+	bool IsRedirectFull() const noexcept {
+		return redirect_full;
+	}
+
+	/**
+	 * Send the rest of the compact response and switch back to
+	 * text (for an error message, which is always text).
+	 */
+	void DisableCompact() noexcept;
+
 	bool Write(const void *data, size_t length) noexcept;
 	bool Write(const char *data) noexcept;
 
@@ -85,4 +148,19 @@ public:
 		return VFmtError(code, format_str,
 				 fmt::make_format_args(args...));
 	}
+
+private:
+	/**
+	 * Write data to the client (or to the redirect buffer),
+	 * bypassing the compact encoder.
+	 */
+	bool WriteRaw(const void *data, size_t length) noexcept;
+
+	/**
+	 * Send encoded compact data in "binary" chunks.
+	 *
+	 * @param finish true to send everything (at the end of the
+	 * response); false to send only full chunks
+	 */
+	bool FlushCompact(bool finish) noexcept;
 };
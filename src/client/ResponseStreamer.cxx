@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "ResponseStreamer.hxx"
+
+#include <algorithm>
+
+ResponseStreamer::ResponseStreamer(EventLoop &event_loop) noexcept
+	:defer_generate(event_loop, BIND_THIS_METHOD(OnDeferredGenerate))
+{
+}
+
+void
+ResponseStreamer::Fill()
+{
+	if (position > 0) {
+		/* discard data which has already been sent */
+		buffer.erase(0, position);
+		position = 0;
+	}
+
+	while (!finished && GetPendingSize() < CHUNK_SIZE)
+		if (!GenerateMore(buffer))
+			finished = true;
+}
+
+bool
+ResponseStreamer::SendChunk() noexcept
+{
+	const std::size_t length = std::min(GetPendingSize(), CHUNK_SIZE);
+
+	/* this may delete this object if the peer's output buffer
+	   overflows, so don't touch any attribute after a failure */
+	if (!WriteChunk({buffer.data() + position, length}))
+		return false;
+
+	position += length;
+	if (position == buffer.size()) {
+		buffer.clear();
+		position = 0;
+	}
+
+	return true;
+}
+
+bool
+ResponseStreamer::StartStream()
+{
+	Fill();
+
+	if (!SendChunk())
+		/* the peer has been closed; let the caller clean
+		   up */
+		return true;
+
+	return finished && GetPendingSize() == 0;
+}
+
+void
+ResponseStreamer::OnDeferredGenerate() noexcept
+{
+	if (!finished) {
+		try {
+			Fill();
+		} catch (...) {
+			error = std::current_exception();
+			finished = true;
+		}
+	}
+
+	if (GetPendingSize() > 0) {
+		const bool done = finished &&
+			GetPendingSize() <= CHUNK_SIZE;
+
+		if (!SendChunk())
+			return;
+
+		if (!done)
+			/* wait for OnStreamDrained() */
+			return;
+	}
+
+	OnStreamFinished(std::move(error));
+}
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_CLIENT_RESPONSE_STREAMER_HXX
+#define MPD_CLIENT_RESPONSE_STREAMER_HXX
+
+#include "event/DeferEvent.hxx"
+
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <string_view>
+
+/**
+ * Generates a large response piece by piece, in the #EventLoop
+ * thread, and passes it to the peer in chunks.  The next chunk is
+ * only generated after the peer has received the previous one (see
+ * OnStreamDrained()), so the response never needs to fit into an
+ * output buffer.
+ *
+ * This is the part of #StreamBackgroundCommand which does not depend
+ * on the #Client.
+ */
+class ResponseStreamer {
+public:
+	/**
+	 * The amount of data passed to WriteChunk() at a time.  This
+	 * matches the "normal" size of the client's output buffer,
+	 * so the (larger) peak buffer is never needed for a streamed
+	 * response.
+	 */
+	static constexpr std::size_t CHUNK_SIZE = 16384;
+
+private:
+	DeferEvent defer_generate;
+
+	/**
+	 * Generated response data which has not yet been passed to
+	 * WriteChunk(), starting at #position.
+	 */
+	std::string buffer;
+	std::size_t position = 0;
+
+	/**
+	 * The error thrown by GenerateMore().
+	 */
+	std::exception_ptr error;
+
+	/**
+	 * Has GenerateMore() returned false (or thrown)?
+	 */
+	bool finished = false;
+
+public:
+	explicit ResponseStreamer(EventLoop &event_loop) noexcept;
+
+	ResponseStreamer(const ResponseStreamer &) = delete;
+	ResponseStreamer &operator=(const ResponseStreamer &) = delete;
+
+	/**
+	 * Generate and send the first part of the response.  Errors
+	 * are thrown, and nothing will have been sent in that case.
+	 *
+	 * @return true if the response is complete (or if
+	 * WriteChunk() has failed) and OnStreamFinished() will not
+	 * be called; false if the rest will be sent after
+	 * OnStreamDrained()
+	 */
+	bool StartStream();
+
+	/**
+	 * Stop generating the response.  Neither WriteChunk() nor
+	 * OnStreamFinished() will be called after this.
+	 */
+	void CancelStream() noexcept {
+		defer_generate.Cancel();
+	}
+
+	/**
+	 * The peer has received everything which was passed to
+	 * WriteChunk(); generate and send the next chunk (deferred,
+	 * because this is usually called while the caller must not
+	 * write).
+	 */
+	void OnStreamDrained() noexcept {
+		defer_generate.Schedule();
+	}
+
+protected:
+	~ResponseStreamer() noexcept = default;
+
+	/**
+	 * Append the next part of the response to the given buffer.
+	 * The implementation should keep the parts small, e.g. one
+	 * directory at a time.
+	 *
+	 * Throws on error.
+	 *
+	 * @return false if the response is complete
+	 */
+	virtual bool GenerateMore(std::string &dest) = 0;
+
+	/**
+	 * Send a chunk of the response to the peer.
+	 *
+	 * @return false if the peer has been closed; this object may
+	 * have been deleted already
+	 */
+	virtual bool WriteChunk(std::string_view src) noexcept = 0;
+
+	/**
+	 * The whole response has been passed to WriteChunk() or
+	 * GenerateMore() has failed.  The implementation shall
+	 * terminate the response (e.g. with "OK" or an error).  It
+	 * may delete this object.
+	 *
+	 * @param ep the exception thrown by GenerateMore() or
+	 * nullptr on success
+	 */
+	virtual void OnStreamFinished(std::exception_ptr ep) noexcept = 0;
+
+private:
+	std::size_t GetPendingSize() const noexcept {
+		return buffer.size() - position;
+	}
+
+	/**
+	 * Call GenerateMore() until at least one chunk is available
+	 * (or until the response is complete).
+	 */
+	void Fill();
+
+	/**
+	 * Pass the next chunk to WriteChunk().
+	 *
+	 * @return false if the peer has been closed
+	 */
+	bool SendChunk() noexcept;
+
+	void OnDeferredGenerate() noexcept;
+};
+
+#endif
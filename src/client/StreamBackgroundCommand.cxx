@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "StreamBackgroundCommand.hxx"
+#include "Client.hxx"
+#include "Response.hxx"
+#include "command/CommandError.hxx"
+
+StreamBackgroundCommand::StreamBackgroundCommand(Client &_client,
+						 bool _compact) noexcept
+	:ResponseStreamer(_client.GetEventLoop()),
+	 client(_client),
+	 compact(_compact)
+{
+}
+
+bool
+StreamBackgroundCommand::GenerateMore(std::string &dest)
+{
+	Response r(client, 0, dest);
+	if (compact)
+		r.EnableCompact();
+
+	return Generate(r);
+}
+
+bool
+StreamBackgroundCommand::WriteChunk(std::string_view src) noexcept
+{
+	return client.Write(src);
+}
+
+void
+StreamBackgroundCommand::OnStreamFinished(std::exception_ptr ep) noexcept
+{
+	/* finish the response */
+	Response response(client, 0);
+
+	if (ep)
+		PrintError(response, ep);
+	else
+		client.WriteOK();
+
+	/* delete this object */
+	client.OnBackgroundCommandFinished();
+}
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_STREAM_BACKGROUND_COMMAND_HXX
+#define MPD_STREAM_BACKGROUND_COMMAND_HXX
+
+#include "BackgroundCommand.hxx"
+#include "ResponseStreamer.hxx"
+
+class Client;
+class Response;
+
+/**
+ * A #BackgroundCommand which generates a large response piece by
+ * piece, in the #EventLoop thread.  The next piece is only generated
+ * after the client has received the previous one, so the response
+ * never needs to fit into the client's output buffer.
+ */
+class StreamBackgroundCommand : public BackgroundCommand, ResponseStreamer {
+	Client &client;
+
+	/**
+	 * Generate the response in the "compact" format?
+	 */
+	const bool compact;
+
+public:
+	/**
+	 * @param _compact generate the response in the "compact"
+	 * format; see Response::EnableCompact()
+	 */
+	StreamBackgroundCommand(Client &_client, bool _compact) noexcept;
+
+	/**
+	 * Generate and send the first part of the response.  Errors
+	 * are thrown, and nothing will have been sent to the client
+	 * in that case.
+	 *
+	 * @return true if the response is complete (the caller shall
+	 * delete this object and return #CommandResult::OK); false if
+	 * this object shall be passed to
+	 * Client::SetBackgroundCommand()
+	 */
+	bool Start() {
+		return StartStream();
+	}
+
+	/* virtual methods from class BackgroundCommand */
+	void Cancel() noexcept final {
+		CancelStream();
+	}
+
+	void OnClientDrained() noexcept final {
+		OnStreamDrained();
+	}
+
+protected:
+	/**
+	 * Generate the next part of the response.  The implementation
+	 * should keep the parts small, e.g. one directory at a time.
+	 *
+	 * @return false if the response is complete
+	 */
+	virtual bool Generate(Response &r) = 0;
+
+private:
+	/* virtual methods from class ResponseStreamer */
+	bool GenerateMore(std::string &dest) final;
+	bool WriteChunk(std::string_view src) noexcept final;
+	void OnStreamFinished(std::exception_ptr ep) noexcept final;
+};
+
+#endif
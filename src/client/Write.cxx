@@ -2,6 +2,9 @@
 // Copyright The Music Player Daemon Project
 
 #include "Client.hxx"
+#include "Compressor.hxx"
+
+#include <stdexcept>
 
 #include <string.h>
 
@@ -9,5 +12,40 @@ bool
 Client::Write(const void *data, size_t length) noexcept
 {
 	/* if the client is going to be closed, do nothing */
-	return !IsExpired() && FullyBufferedSocket::Write(data, length);
+	if (IsExpired())
+		return false;
+
+#ifdef ENABLE_ZLIB
+	if (compressor)
+		return compressor->Compress({(const std::byte *)data, length});
+#endif
+
+	return FullyBufferedSocket::Write(data, length);
 }
+
+bool
+Client::FlushCompressor() noexcept
+{
+#ifdef ENABLE_ZLIB
+	if (compressor)
+		return compressor->Flush();
+#endif
+
+	return true;
+}
+
+#ifndef ENABLE_ZLIB
+
+void
+Client::EnableCompression()
+{
+	throw std::runtime_error("Compression not supported");
+}
+
+bool
+Client::DisableCompression() noexcept
+{
+	return true;
+}
+
+#endif
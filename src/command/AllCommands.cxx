@@ -25,9 +25,20 @@
 #include "Instance.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/BackgroundCommand.hxx"
+#include "client/CommandPool.hxx"
+#include "client/Domain.hxx"
+#include "event/InjectEvent.hxx"
+#include "util/PerfectHash.hxx"
 #include "util/Tokenizer.hxx"
 #include "util/StaticVector.hxx"
 #include "util/StringAPI.hxx"
+#include "Log.hxx"
+
+#ifdef ENABLE_DATABASE
+#include "db/Interface.hxx"
+#include "db/DatabasePlugin.hxx"
+#endif
 
 #ifdef ENABLE_SQLITE
 #include "StickerCommands.hxx"
@@ -35,8 +46,12 @@
 
 #include <fmt/format.h>
 
+#include <array>
 #include <cassert>
 #include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <string.h>
 
@@ -81,6 +96,7 @@ static constexpr struct command commands[] = {
 	{ "cleartagid", PERMISSION_ADD, 1, 2, handle_cleartagid },
 	{ "close", PERMISSION_NONE, -1, -1, handle_close },
 	{ "commands", PERMISSION_NONE, 0, 0, handle_commands },
+	{ "compress", PERMISSION_NONE, 1, 1, handle_compress },
 	{ "config", PERMISSION_ADMIN, 0, 0, handle_config },
 	{ "consume", PERMISSION_PLAYER, 1, 1, handle_consume },
 #ifdef ENABLE_DATABASE
@@ -168,6 +184,7 @@ static constexpr struct command commands[] = {
 	{ "replay_gain_status", PERMISSION_READ, 0, 0,
 	  handle_replay_gain_status },
 	{ "rescan", PERMISSION_CONTROL, 0, 1, handle_rescan },
+	{ "responseformat", PERMISSION_NONE, 0, 1, handle_responseformat },
 	{ "rm", PERMISSION_CONTROL, 1, 1, handle_rm },
 	{ "save", PERMISSION_CONTROL, 1, 2, handle_save },
 #ifdef ENABLE_DATABASE
@@ -292,26 +309,27 @@ command_init() noexcept
 #endif
 }
 
+/**
+ * A perfect hash of all command names, generated at compile time.
+ */
+static constexpr auto command_hash = []{
+	std::array<std::string_view, num_commands> names{};
+	for (unsigned i = 0; i < num_commands; ++i)
+		names[i] = commands[i].cmd;
+	return PerfectHash<num_commands>{names};
+}();
+
 [[gnu::pure]]
 static const struct command *
-command_lookup(const char *name) noexcept
+command_lookup(const char *_name) noexcept
 {
-	unsigned a = 0, b = num_commands, i;
-
-	/* binary search */
-	do {
-		i = (a + b) / 2;
-
-		const auto cmp = strcmp(name, commands[i].cmd);
-		if (cmp == 0)
-			return &commands[i];
-		else if (cmp < 0)
-			b = i;
-		else if (cmp > 0)
-			a = i + 1;
-	} while (a < b);
-
-	return nullptr;
+	const std::string_view name{_name};
+
+	const auto i = command_hash.Find(name);
+	if (i == command_hash.NOT_FOUND || name != commands[i].cmd)
+		return nullptr;
+
+	return &commands[i];
 }
 
 static bool
@@ -369,6 +387,232 @@ command_checked_lookup(Response &r, unsigned permission,
 	return cmd;
 }
 
+/**
+ * Does this command only read the database, the storage or song
+ * files, so it may be executed by a #CommandPool thread?
+ */
+[[gnu::pure]]
+static bool
+IsReadOnlyCommand(const struct command &cmd) noexcept
+{
+	return
+#ifdef ENABLE_DATABASE
+		cmd.handler == handle_count ||
+		cmd.handler == handle_find ||
+		cmd.handler == handle_list ||
+		cmd.handler == handle_search ||
+		cmd.handler == handle_searchcount ||
+#endif
+		cmd.handler == handle_album_art ||
+		cmd.handler == handle_lsinfo ||
+		cmd.handler == handle_read_picture;
+}
+
+/**
+ * Does this command return a list of songs, directories or other
+ * entities, so its response may be sent in the "compact" format?
+ */
+[[gnu::pure]]
+static bool
+IsListCommand(const struct command &cmd) noexcept
+{
+	return
+#ifdef ENABLE_DATABASE
+		cmd.handler == handle_count ||
+		cmd.handler == handle_find ||
+		cmd.handler == handle_list ||
+		cmd.handler == handle_listall ||
+		cmd.handler == handle_listallinfo ||
+		cmd.handler == handle_search ||
+		cmd.handler == handle_searchcount ||
+#endif
+		cmd.handler == handle_listfiles ||
+		cmd.handler == handle_listplaylist ||
+		cmd.handler == handle_listplaylistinfo ||
+		cmd.handler == handle_listplaylists ||
+		cmd.handler == handle_lsinfo ||
+		cmd.handler == handle_playlistfind ||
+		cmd.handler == handle_playlistid ||
+		cmd.handler == handle_playlistinfo ||
+		cmd.handler == handle_playlistsearch ||
+		cmd.handler == handle_plchanges ||
+		cmd.handler == handle_plchangesposid;
+}
+
+/**
+ * Returns the #CommandPool which shall execute the given command, or
+ * nullptr if it shall be executed right away.
+ */
+[[gnu::pure]]
+static CommandPool *
+GetCommandPool(const Client &client, const struct command &cmd) noexcept
+{
+	auto *pool = client.GetInstance().command_pool.get();
+	if (pool == nullptr || client.IsInCommandList() ||
+	    !IsReadOnlyCommand(cmd))
+		return nullptr;
+
+#ifdef ENABLE_DATABASE
+	if (const auto *db = client.GetDatabase();
+	    db != nullptr && !db->GetPlugin().IsConcurrent())
+		return nullptr;
+#endif
+
+	return pool;
+}
+
+/**
+ * A #BackgroundCommand which executes a command handler in a
+ * #CommandPool thread.  The response is collected in a buffer (which
+ * is limited to the client's maximum output buffer size) and sent to
+ * the client when the handler has finished.
+ */
+class PooledCommand final : public BackgroundCommand, CommandPoolJob {
+	Client &client;
+	CommandPool &pool;
+
+	InjectEvent defer_finish;
+
+	const struct command &cmd;
+
+	/**
+	 * A copy of the arguments (the originals point into the
+	 * client's input buffer).
+	 */
+	const std::vector<std::string> args;
+
+	std::string response;
+
+	/**
+	 * The maximum size of #response, copied from the client's
+	 * output buffer.
+	 */
+	const std::size_t max_response_size;
+
+	CommandResult result = CommandResult::ERROR;
+
+	/**
+	 * Send the response in the "compact" format?
+	 */
+	const bool compact;
+
+	/**
+	 * Did the response exceed the client's maximum output
+	 * buffer size?
+	 */
+	bool overflow = false;
+
+public:
+	PooledCommand(Client &_client, CommandPool &_pool,
+		      const struct command &_cmd, Request _args,
+		      bool _compact) noexcept
+		:client(_client), pool(_pool),
+		 defer_finish(_client.GetEventLoop(),
+			      BIND_THIS_METHOD(DeferredFinish)),
+		 cmd(_cmd), args(_args.begin(), _args.end()),
+		 max_response_size(_client.GetOutputMaxSize()),
+		 compact(_compact) {}
+
+	void Start() noexcept {
+		/* the handler may use the client's cached
+		   "albumart" stream */
+		client.last_album_art.Suspend();
+
+		pool.Push(*this);
+	}
+
+	/* virtual methods from class BackgroundCommand */
+	void Cancel() noexcept override {
+		/* this is only called when the client is destroyed
+		   during shutdown, after CommandPool::Stop() */
+		[[maybe_unused]] const bool removed = pool.Remove(*this);
+		assert(removed);
+
+		defer_finish.Cancel();
+		client.last_album_art.Resume();
+	}
+
+	bool Abandon() noexcept override {
+		if (!pool.Remove(*this))
+			/* the handler is still running; instead of
+			   blocking the EventLoop until it returns,
+			   let DeferredFinish() dispose of this
+			   object */
+			return false;
+
+		defer_finish.Cancel();
+		client.last_album_art.Resume();
+		return true;
+	}
+
+private:
+	void DeferredFinish() noexcept {
+		if (overflow && !client.IsExpired()) {
+			/* the same as when the client's output
+			   buffer overflows: drop the client; this
+			   calls Abandon() and deletes this object */
+			LogError(client_domain, "Output buffer is full");
+			client.SetExpired();
+			return;
+		}
+
+		[[maybe_unused]] const bool removed = pool.Remove(*this);
+		assert(removed);
+
+		client.last_album_art.Resume();
+
+		if (client.IsExpired()) {
+			/* the client has been closed while the
+			   handler was running; this deletes this
+			   object and then closes the client */
+			client.OnBackgroundCommandFinished();
+			return;
+		}
+
+		if (!client.Write(response))
+			/* the client has been closed and this object
+			   has been deleted */
+			return;
+
+		if (result == CommandResult::OK)
+			client.WriteOK();
+
+		/* delete this object */
+		client.OnBackgroundCommandFinished();
+	}
+
+	/* virtual methods from class CommandPoolJob */
+	void Run() noexcept override {
+		StaticVector<const char *, COMMAND_ARGV_MAX> argv;
+		for (const auto &i : args)
+			argv.push_back(i.c_str());
+
+		/* once the response exceeds the limit, the Response
+		   discards everything else, so a huge result does
+		   not consume more memory than the client would */
+		Response r(client, 0, response, max_response_size);
+		r.SetCommand(cmd.cmd);
+		if (compact)
+			r.EnableCompact();
+
+		try {
+			result = cmd.handler(client, Request{argv}, r);
+		} catch (...) {
+			PrintError(r, std::current_exception());
+			result = CommandResult::ERROR;
+		}
+
+		/* finish the compact response */
+		r.DisableCompact();
+
+		overflow = r.IsRedirectFull();
+	}
+
+	void OnFinished() noexcept override {
+		defer_finish.Schedule();
+	}
+};
+
 CommandResult
 command_process(Client &client, unsigned num, char *line) noexcept
 {
@@ -424,6 +668,18 @@ command_process(Client &client, unsigned num, char *line) noexcept
 		if (cmd == nullptr)
 			return CommandResult::ERROR;
 
+		if (client.compact_responses && IsListCommand(*cmd))
+			r.EnableCompact();
+
+		if (auto *pool = GetCommandPool(client, *cmd)) {
+			auto bc = std::make_unique<PooledCommand>(client, *pool,
+								  *cmd, args,
+								  r.IsCompact());
+			bc->Start();
+			client.SetBackgroundCommand(std::move(bc));
+			return CommandResult::BACKGROUND;
+		}
+
 		return cmd->handler(client, args, r);
 	} catch (...) {
 		PrintError(r, std::current_exception());
@@ -11,6 +11,8 @@
 #include "tag/Type.hxx"
 #include "util/StringAPI.hxx"
 
+#include <fmt/format.h>
+
 CommandResult
 handle_close([[maybe_unused]] Client &client, [[maybe_unused]] Request args,
 	     [[maybe_unused]] Response &r)
@@ -109,3 +111,47 @@ handle_tagtypes(Client &client, Request request, Response &r)
 		return CommandResult::ERROR;
 	}
 }
+
+CommandResult
+handle_responseformat(Client &client, Request request, Response &r)
+{
+	if (request.empty()) {
+		r.Fmt(FMT_STRING("responseformat: {}\n"),
+		      client.compact_responses ? "compact" : "text");
+		return CommandResult::OK;
+	}
+
+	const char *format = request.front();
+	if (StringIsEqual(format, "text"))
+		client.compact_responses = false;
+	else if (StringIsEqual(format, "compact"))
+		client.compact_responses = true;
+	else {
+		r.Error(ACK_ERROR_ARG, "Unknown response format");
+		return CommandResult::ERROR;
+	}
+
+	return CommandResult::OK;
+}
+
+CommandResult
+handle_compress(Client &client, Request request, Response &r)
+{
+	const char *method = request.front();
+	if (StringIsEqual(method, "gzip"))
+		/* this response's "OK" is the first compressed data */
+		client.EnableCompression();
+	else if (StringIsEqual(method, "none")) {
+		/* finish the compressed stream; "OK" is sent
+		   uncompressed */
+		if (!client.DisableCompression())
+			/* the error has been reported already, and
+			   the client is being closed */
+			return CommandResult::CLOSE;
+	} else {
+		r.Error(ACK_ERROR_ARG, "Unknown compression method");
+		return CommandResult::ERROR;
+	}
+
+	return CommandResult::OK;
+}
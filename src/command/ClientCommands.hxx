@@ -25,4 +25,10 @@ handle_password(Client &client, Request request, Response &response);
 CommandResult
 handle_tagtypes(Client &client, Request request, Response &response);
 
+CommandResult
+handle_responseformat(Client &client, Request request, Response &response);
+
+CommandResult
+handle_compress(Client &client, Request request, Response &response);
+
 #endif
@@ -16,11 +16,11 @@ CommandListBuilder::Reset()
 bool
 CommandListBuilder::Add(const char *cmd)
 {
-	size_t len = strlen(cmd) + 1;
-	size += len;
-	if (size > client_max_command_list_size)
+	const size_t len = strlen(cmd) + 1;
+	if (list.size() + len > client_max_command_list_size)
 		return false;
 
-	list.emplace_back(cmd);
+	/* copy the command including its null terminator */
+	list.append(cmd, len);
 	return true;
 }
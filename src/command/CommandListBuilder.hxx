@@ -5,7 +5,6 @@
 #define MPD_COMMAND_LIST_BUILDER_HXX
 
 #include <cassert>
-#include <list>
 #include <string>
 
 class CommandListBuilder {
@@ -30,14 +29,11 @@ class CommandListBuilder {
 	} mode = Mode::DISABLED;
 
 	/**
-	 * for when in list mode
+	 * for when in list mode: all commands, each one terminated
+	 * with a null byte; this is also the memory consumed by the
+	 * list
 	 */
-	std::list<std::string> list;
-
-	/**
-	 * Memory consumed by the list.
-	 */
-	size_t size;
+	std::string list;
 
 public:
 	/**
@@ -69,7 +65,6 @@ public:
 		assert(mode == Mode::DISABLED);
 
 		mode = (Mode)ok;
-		size = 0;
 	}
 
 	/**
@@ -78,9 +73,10 @@ public:
 	bool Add(const char *cmd);
 
 	/**
-	 * Finishes the list and returns it.
+	 * Finishes the list and returns it.  The commands are
+	 * separated by null bytes.
 	 */
-	std::list<std::string> Commit() {
+	std::string Commit() {
 		assert(IsActive());
 
 		return std::move(list);
@@ -13,6 +13,7 @@
 #include "protocol/RangeArg.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/StreamBackgroundCommand.hxx"
 #include "tag/Names.hxx"
 #include "tag/ParseName.hxx"
 #include "util/Exception.hxx"
@@ -267,16 +268,59 @@ handle_searchcount(Client &client, Request args, Response &r)
 	return handle_count_internal(client, args, r, true);
 }
 
+/**
+ * Streams the response of "listall" and "listallinfo", one
+ * directory at a time.
+ */
+class ListAllCommand final : public StreamBackgroundCommand {
+	DirectoryTreePrinter printer;
+
+public:
+	ListAllCommand(Client &_client, const Database &db, bool full,
+		       bool _compact) noexcept
+		:StreamBackgroundCommand(_client, _compact), printer(db, full) {}
+
+	bool Open(const char *uri) {
+		return printer.Open(uri);
+	}
+
+protected:
+	bool Generate(Response &r) override {
+		printer.PrintNext(r);
+		return !printer.IsFinished();
+	}
+};
+
+static CommandResult
+PrintAll(Client &client, Response &r, const char *uri, bool full)
+{
+	if (!client.IsInCommandList()) {
+		auto cmd = std::make_unique<ListAllCommand>(client,
+							    client.GetDatabaseOrThrow(),
+							    full,
+							    r.IsCompact());
+		if (cmd->Open(uri)) {
+			if (cmd->Start())
+				return CommandResult::OK;
+
+			client.SetBackgroundCommand(std::move(cmd));
+			return CommandResult::BACKGROUND;
+		}
+	}
+
+	db_selection_print(r, client.GetPartition(),
+			   DatabaseSelection(uri, true),
+			   full, false);
+	return CommandResult::OK;
+}
+
 CommandResult
 handle_listall(Client &client, Request args, Response &r)
 {
 	/* default is root directory */
 	const auto uri = args.GetOptional(0, "");
 
-	db_selection_print(r, client.GetPartition(),
-			   DatabaseSelection(uri, true),
-			   false, false);
-	return CommandResult::OK;
+	return PrintAll(client, r, uri, false);
 }
 
 static CommandResult
@@ -383,8 +427,5 @@ handle_listallinfo(Client &client, Request args, Response &r)
 	/* default is root directory */
 	const auto uri = args.GetOptional(0, "");
 
-	db_selection_print(r, client.GetPartition(),
-			   DatabaseSelection(uri, true),
-			   true, false);
-	return CommandResult::OK;
+	return PrintAll(client, r, uri, true);
 }
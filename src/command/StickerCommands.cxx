@@ -27,6 +27,10 @@
 #include "db/DatabaseLock.hxx"
 #include "song/Filter.hxx"
 
+#include <span>
+#include <string>
+#include <vector>
+
 namespace {
 
 class DomainHandler {
@@ -87,19 +91,31 @@ public:
 			.is_song = StringIsEqual("song", sticker_type)
 		};
 
-		auto callback = [](const char *found_uri, const char *found_value, void *user_data) {
-			auto context = reinterpret_cast<CallbackContext *>(user_data);
-			context->response.Fmt("{}: {}\n",
- 					      context->is_song ? "file" : context->sticker_type, found_uri);
-			sticker_print_value(context->response, context->name, found_value);
-		};
-
 		sticker_database.Find(sticker_type,
 				      uri,
 				      name,
 				      op, value,
 					  sort, descending, window,
-				      callback, &data);
+				      PrintFound, &data);
+
+		return CommandResult::OK;
+	}
+
+	virtual CommandResult GetMany(std::span<const char *const> uris,
+				      const char *name) {
+		auto data = CallbackContext{
+			.name = name,
+			.sticker_type = sticker_type,
+			.response = response,
+			.is_song = StringIsEqual("song", sticker_type)
+		};
+
+		/* the URIs are not validated: looking up each object
+		   would be much more expensive than the sticker
+		   lookup, and an object which does not exist has no
+		   sticker anyway */
+		sticker_database.LoadValues(sticker_type, uris, name,
+					    PrintFound, &data);
 
 		return CommandResult::OK;
 	}
@@ -156,6 +172,14 @@ private:
 		Response &response;
 		const bool is_song;
 	};
+
+	static void PrintFound(const char *found_uri, const char *found_value,
+			       void *user_data) {
+		auto context = reinterpret_cast<CallbackContext *>(user_data);
+		context->response.Fmt("{}: {}\n",
+				      context->is_song ? "file" : context->sticker_type, found_uri);
+		sticker_print_value(context->response, context->name, found_value);
+	}
 };
 
 /**
@@ -275,6 +299,23 @@ public:
 		SelectionHandler(_response, _database, _sticker_database, "filter") {
 	}
 
+	CommandResult GetMany(std::span<const char *const> uris,
+			      const char *name) override {
+		/* stickers are stored with the normalized filter
+		   expression */
+		std::vector<std::string> normalized;
+		normalized.reserve(uris.size());
+		for (const char *uri : uris)
+			normalized.emplace_back(MakeSongFilter(uri).ToExpression());
+
+		std::vector<const char *> normalized_uris;
+		normalized_uris.reserve(normalized.size());
+		for (const auto &uri : normalized)
+			normalized_uris.push_back(uri.c_str());
+
+		return SelectionHandler::GetMany(normalized_uris, name);
+	}
+
 protected:
 	std::string ValidateUri(const char *uri) override {
 
@@ -304,7 +345,7 @@ private:
 	std::string ValidateUri(const char *uri) override {
 		PlaylistVector playlists = ListPlaylistFiles();
 
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseReadLock protect;
 		if (!playlists.exists(uri))
 			throw std::invalid_argument(fmt::format("no such playlist: {:?}", uri));
 
@@ -377,6 +418,13 @@ handle_sticker(Client &client, Request args, Response &r)
 	if (args.size() == 4 && StringIsEqual(cmd, "get"))
 		return handler->Get(uri, sticker_name);
 
+	/* getmany */
+	if (args.size() >= 4 && StringIsEqual(cmd, "getmany")) {
+		/* "sticker getmany TYPE NAME URI..." */
+		const char *name = args[2];
+		return handler->GetMany({args.begin() + 3, args.end()}, name);
+	}
+
 	/* list */
 	if (args.size() == 3 && StringIsEqual(cmd, "list"))
 		return handler->List(uri);
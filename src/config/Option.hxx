@@ -41,7 +41,9 @@ enum class ConfigOption {
 	REPLAYGAIN_LIMIT,
 	VOLUME_NORMALIZATION,
 	SAMPLERATE_CONVERTER,
+	DSD2PCM_THREADS,
 	AUDIO_BUFFER_SIZE,
+	AUDIO_CHUNK_SIZE,
 	BUFFER_BEFORE_PLAY,
 	HTTP_PROXY_HOST,
 	HTTP_PROXY_PORT,
@@ -52,6 +54,8 @@ enum class ConfigOption {
 	MAX_PLAYLIST_LENGTH,
 	MAX_COMMAND_LIST_SIZE,
 	MAX_OUTPUT_BUFFER_SIZE,
+	SONG_RESPONSE_CACHE,
+	COMMAND_THREADS,
 	FS_CHARSET,
 	ID3V1_ENCODING,
 	METADATA_TO_USE,
@@ -59,6 +63,8 @@ enum class ConfigOption {
 	GAPLESS_MP3_PLAYBACK,
 	AUTO_UPDATE,
 	AUTO_UPDATE_DEPTH,
+	UPDATE_THREADS,
+	UPDATE_READ_AHEAD,
 
 	MIXRAMP_ANALYZER,
 
@@ -9,42 +9,69 @@
 #include "lib/fmt/RuntimeError.hxx"
 #include "Log.hxx"
 #include "MusicChunk.hxx"
+#include "util/StringAPI.hxx"
 
-static constexpr
-size_t MIN_BUFFER_SIZE = std::max(CHUNK_SIZE * 32,
-				  64 * KILOBYTE);
+#include <algorithm>
 
-static unsigned
-GetBufferChunks(const ConfigData &config)
+static constexpr size_t MIN_BUFFER_CHUNKS = 32;
+
+static size_t
+GetChunkSize(const ConfigData &config)
+{
+	return config.With(ConfigOption::AUDIO_CHUNK_SIZE, [](const char *s) -> size_t {
+		if (s == nullptr || StringIsEqual(s, "auto"))
+			return 0;
+
+		size_t result = ParseSize(s);
+		if (result < MIN_CHUNK_SIZE || result > MAX_CHUNK_SIZE)
+			throw FmtRuntimeError("chunk size {:?} is out of range ({}..{})",
+					      s, MIN_CHUNK_SIZE, MAX_CHUNK_SIZE);
+
+		/* chunk data must be aligned */
+		return result - result % alignof(MusicChunk);
+	});
+}
+
+static size_t
+GetBufferSize(const ConfigData &config, size_t chunk_size)
 {
+	/* in automatic mode, chunks are never smaller than the
+	   default */
+	if (chunk_size == 0)
+		chunk_size = DEFAULT_CHUNK_SIZE;
+
+	const size_t min_buffer_size =
+		std::max(chunk_size * MIN_BUFFER_CHUNKS, 64 * KILOBYTE);
+
 	size_t buffer_size = PlayerConfig::DEFAULT_BUFFER_SIZE;
 	if (auto *param = config.GetParam(ConfigOption::AUDIO_BUFFER_SIZE)) {
-		buffer_size = param->With([](const char *s){
+		buffer_size = param->With([min_buffer_size](const char *s){
 			size_t result = ParseSize(s, KILOBYTE);
 			if (result <= 0)
 				throw FmtRuntimeError("buffer size {:?} is not a "
 						      "positive integer", s);
 
-			if (result < MIN_BUFFER_SIZE) {
+			if (result < min_buffer_size) {
 				FmtWarning(config_domain, "buffer size {} is too small, using {} bytes instead",
-					   result, MIN_BUFFER_SIZE);
-				result = MIN_BUFFER_SIZE;
+					   result, min_buffer_size);
+				result = min_buffer_size;
 			}
 
 			return result;
 		});
 	}
 
-	unsigned buffer_chunks = buffer_size / CHUNK_SIZE;
+	const size_t buffer_chunks = buffer_size / chunk_size;
 	if (buffer_chunks >= 1 << 15)
 		throw FmtRuntimeError("buffer size {:?} is too big",
 				      buffer_size);
 
-	return buffer_chunks;
+	return buffer_size;
 }
 
 PlayerConfig::PlayerConfig(const ConfigData &config)
-	:buffer_chunks(GetBufferChunks(config)),
+	:chunk_size(GetChunkSize(config)),
+	 buffer_size(GetBufferSize(config, chunk_size)),
 	 audio_format(config.With(ConfigOption::AUDIO_OUTPUT_FORMAT, [](const char *s){
 		 if (s == nullptr)
 			 return AudioFormat::Undefined();
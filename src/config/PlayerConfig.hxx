@@ -14,7 +14,16 @@ static constexpr size_t MEGABYTE = 1024 * KILOBYTE;
 struct PlayerConfig {
 	static constexpr size_t DEFAULT_BUFFER_SIZE = 8 * MEGABYTE;
 
-	unsigned buffer_chunks = DEFAULT_BUFFER_SIZE;
+	/**
+	 * The "audio_chunk_size" setting in bytes; 0 means the chunk
+	 * size is chosen automatically for each audio format.
+	 */
+	size_t chunk_size = 0;
+
+	/**
+	 * The "audio_buffer_size" setting in bytes.
+	 */
+	size_t buffer_size = DEFAULT_BUFFER_SIZE;
 
 	/**
 	 * The "audio_output_format" setting.
@@ -39,7 +39,9 @@ const ConfigTemplate config_param_templates[] = {
 	{ "replaygain_limit" },
 	{ "volume_normalization" },
 	{ "samplerate_converter" },
+	{ "dsd2pcm_threads" },
 	{ "audio_buffer_size" },
+	{ "audio_chunk_size" },
 	{ "buffer_before_play", false, true },
 	{ "http_proxy_host", false, true },
 	{ "http_proxy_port", false, true },
@@ -50,6 +52,8 @@ const ConfigTemplate config_param_templates[] = {
 	{ "max_playlist_length" },
 	{ "max_command_list_size" },
 	{ "max_output_buffer_size" },
+	{ "song_response_cache" },
+	{ "command_threads" },
 	{ "filesystem_charset" },
 	{ "id3v1_encoding", false, true },
 	{ "metadata_to_use" },
@@ -57,6 +61,8 @@ const ConfigTemplate config_param_templates[] = {
 	{ "gapless_mp3_playback", false, true },
 	{ "auto_update" },
 	{ "auto_update_depth" },
+	{ "update_threads" },
+	{ "update_read_ahead" },
 	{ "mixramp_analyzer" },
 };
 
@@ -3,8 +3,9 @@
 
 #include "DatabaseLock.hxx"
 
-Mutex db_mutex;
+SharedMutex db_mutex;
 
 #ifndef NDEBUG
 ThreadId db_mutex_holder;
+thread_local bool db_mutex_reading;
 #endif
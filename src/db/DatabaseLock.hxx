@@ -5,29 +5,54 @@
  *
  * Support for locking data structures from the database, for safe
  * multi-threading.
+ *
+ * The database lock is a reader/writer lock: any number of threads
+ * may read the database at the same time (e.g. to walk it for a
+ * "find" command), but modifications (by the database update)
+ * require exclusive access.
  */
 
 #ifndef MPD_DB_LOCK_HXX
 #define MPD_DB_LOCK_HXX
 
-#include "thread/Mutex.hxx"
+#include "thread/SharedMutex.hxx"
 
 #include <cassert>
 
-extern Mutex db_mutex;
+extern SharedMutex db_mutex;
 
 #ifndef NDEBUG
 
 #include "thread/Id.hxx"
 
+/**
+ * The thread which holds the exclusive (write) lock.
+ */
 extern ThreadId db_mutex_holder;
 
 /**
- * Does the current thread hold the database lock?
+ * Does the current thread hold the shared (read) lock?
+ */
+extern thread_local bool db_mutex_reading;
+
+/**
+ * Does the current thread hold the database lock (either shared or
+ * exclusive)?  This is sufficient for reading the database.
  */
 [[gnu::pure]]
 static inline bool
 holding_db_lock() noexcept
+{
+	return db_mutex_reading || db_mutex_holder.IsInside();
+}
+
+/**
+ * Does the current thread hold the exclusive database lock?  This is
+ * needed for modifying the database.
+ */
+[[gnu::pure]]
+static inline bool
+holding_db_write_lock() noexcept
 {
 	return db_mutex_holder.IsInside();
 }
@@ -35,8 +60,9 @@ holding_db_lock() noexcept
 #endif
 
 /**
- * Obtain the global database lock.  This is needed before
- * dereferencing a #song or #directory.  It is not recursive.
+ * Obtain the global database lock for exclusive access.  This is
+ * needed before modifying a #song or #directory.  It is not
+ * recursive.
  */
 static inline void
 db_lock(void)
@@ -57,7 +83,7 @@ db_lock(void)
 static inline void
 db_unlock(void)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 #ifndef NDEBUG
 	db_mutex_holder = ThreadId::Null();
 #endif
@@ -65,6 +91,38 @@ db_unlock(void)
 	db_mutex.unlock();
 }
 
+/**
+ * Obtain the global database lock for shared access.  This is needed
+ * before dereferencing a #song or #directory.  Other readers may hold
+ * the lock at the same time, but no writer.  It is not recursive.
+ */
+static inline void
+db_read_lock(void)
+{
+	assert(!holding_db_lock());
+
+	db_mutex.lock_shared();
+
+	assert(db_mutex_holder.IsNull());
+#ifndef NDEBUG
+	db_mutex_reading = true;
+#endif
+}
+
+/**
+ * Release the shared database lock.
+ */
+static inline void
+db_read_unlock(void)
+{
+	assert(db_mutex_reading);
+#ifndef NDEBUG
+	db_mutex_reading = false;
+#endif
+
+	db_mutex.unlock_shared();
+}
+
 class ScopeDatabaseLock {
 	bool locked = true;
 
@@ -103,4 +161,45 @@ public:
 	}
 };
 
+/**
+ * Like #ScopeDatabaseLock, but obtain only shared (read) access.
+ */
+class ScopeDatabaseReadLock {
+	bool locked = true;
+
+public:
+	ScopeDatabaseReadLock() {
+		db_read_lock();
+	}
+
+	~ScopeDatabaseReadLock() {
+		if (locked)
+			db_read_unlock();
+	}
+
+	/**
+	 * Unlock the mutex now, making the destructor a no-op.
+	 */
+	void unlock() {
+		assert(locked);
+
+		db_read_unlock();
+		locked = false;
+	}
+};
+
+/**
+ * Release the shared database lock while in the current scope.
+ */
+class ScopeDatabaseReadUnlock {
+public:
+	ScopeDatabaseReadUnlock() {
+		db_read_unlock();
+	}
+
+	~ScopeDatabaseReadUnlock() {
+		db_read_lock();
+	}
+};
+
 #endif
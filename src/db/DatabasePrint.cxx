@@ -155,6 +155,32 @@ db_selection_print(Response &r, Partition &partition,
 	db.Visit(selection, d, s, p);
 }
 
+void
+DirectoryTreePrinter::PrintNext(Response &r)
+{
+	const auto d = [&r, this](const LightDirectory &directory){
+		if (full)
+			PrintDirectoryFull(r, false, directory);
+		else
+			PrintDirectoryBrief(r, false, directory);
+	};
+
+	const auto s = [&r, this](const LightSong &song){
+		return full
+			? PrintSongFull(r, false, song)
+			: PrintSongBrief(r, false, song);
+	};
+
+	const auto p = [&r, this](const PlaylistInfo &playlist,
+				  const LightDirectory &directory){
+		return full
+			? PrintPlaylistFull(r, false, playlist, directory)
+			: PrintPlaylistBrief(r, false, playlist, directory);
+	};
+
+	walker.VisitNext(d, s, p);
+}
+
 static void
 PrintSongURIVisitor(Response &r, const LightSong &song) noexcept
 {
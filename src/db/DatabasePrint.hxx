@@ -4,11 +4,15 @@
 #ifndef MPD_DB_PRINT_H
 #define MPD_DB_PRINT_H
 
+#include "DirectoryTreeWalker.hxx"
+
 #include <cstdint>
 #include <span>
+#include <string_view>
 
 enum TagType : uint8_t;
 class SongFilter;
+class Database;
 struct DatabaseSelection;
 struct Partition;
 class Response;
@@ -22,6 +26,47 @@ db_selection_print(Response &r, Partition &partition,
 		   const DatabaseSelection &selection,
 		   bool full, bool base);
 
+/**
+ * Prints a recursive database selection without filter (like
+ * db_selection_print() does for "listall" and "listallinfo"), but
+ * one directory at a time.  The database lock is only held while one
+ * directory is being printed, which allows streaming huge responses
+ * to slow clients.
+ */
+class DirectoryTreePrinter {
+	DirectoryTreeWalker walker;
+
+	/**
+	 * print attributes/tags?
+	 */
+	const bool full;
+
+public:
+	DirectoryTreePrinter(const Database &_db, bool _full) noexcept
+		:walker(_db), full(_full) {}
+
+	/**
+	 * Prepare printing the given directory and all of its
+	 * descendants.
+	 *
+	 * @return false if the URI does not refer to a directory
+	 * (the caller shall use db_selection_print() then)
+	 */
+	bool Open(std::string_view uri) {
+		return walker.Open(uri);
+	}
+
+	bool IsFinished() const noexcept {
+		return walker.IsFinished();
+	}
+
+	/**
+	 * Print the next directory: its "directory" line, its songs
+	 * and its playlists.
+	 */
+	void PrintNext(Response &r);
+};
+
 void
 PrintSongUris(Response &r, Partition &partition,
 	      const SongFilter *filter);
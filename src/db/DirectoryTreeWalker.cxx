@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "DirectoryTreeWalker.hxx"
+#include "Interface.hxx"
+#include "Selection.hxx"
+#include "DatabaseError.hxx"
+#include "LightDirectory.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+bool
+DirectoryTreeWalker::Open(std::string_view uri)
+{
+	assert(pending.empty());
+
+	if (uri.empty()) {
+		pending.push_back({std::string{}, {}});
+		return true;
+	}
+
+	/* look up the directory in its parent to obtain its
+	   modification time; this also verifies that the URI refers
+	   to a directory and not to a song */
+
+	const auto slash = uri.rfind('/');
+	const std::string parent{slash == uri.npos
+		? std::string_view{}
+		: uri.substr(0, slash)};
+
+	const DatabaseSelection selection(parent.c_str(), false);
+
+	const auto d = [this, uri](const LightDirectory &directory){
+		if (pending.empty() && uri == directory.GetPath())
+			pending.push_back({std::string{uri}, directory.mtime});
+	};
+
+	db.Visit(selection, d, VisitSong(), VisitPlaylist());
+	return !pending.empty();
+}
+
+void
+DirectoryTreeWalker::VisitNext(VisitDirectory visit_directory,
+			       VisitSong visit_song,
+			       VisitPlaylist visit_playlist)
+{
+	assert(!pending.empty());
+
+	const auto current = std::move(pending.back());
+	pending.pop_back();
+
+	visit_directory(LightDirectory{current.uri.c_str(), current.mtime});
+
+	/* collect the child directories; they are visited by
+	   subsequent calls, in the same order as a recursive
+	   Database::Visit() would */
+	const std::size_t old_size = pending.size();
+
+	const auto d = [this](const LightDirectory &directory){
+		pending.push_back({directory.GetPath(), directory.mtime});
+	};
+
+	const DatabaseSelection selection(current.uri.c_str(), false);
+
+	try {
+		db.Visit(selection, d, visit_song, visit_playlist);
+	} catch (const DatabaseError &e) {
+		/* the directory may have been deleted by the database
+		   update meanwhile */
+		if (e.GetCode() != DatabaseErrorCode::NOT_FOUND)
+			throw;
+	}
+
+	std::reverse(std::next(pending.begin(), old_size), pending.end());
+}
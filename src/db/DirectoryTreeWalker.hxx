@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_DB_DIRECTORY_TREE_WALKER_HXX
+#define MPD_DB_DIRECTORY_TREE_WALKER_HXX
+
+#include "Visitor.hxx"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Database;
+
+/**
+ * Visits a directory and all of its descendants, one directory at a
+ * time, in the same order as a recursive Database::Visit() would.
+ * Unlike the latter, the database is only locked while one
+ * directory is being visited.
+ */
+class DirectoryTreeWalker {
+	const Database &db;
+
+	struct PendingDirectory {
+		std::string uri;
+		std::chrono::system_clock::time_point mtime;
+	};
+
+	/**
+	 * Directories which have not been visited yet; the next one
+	 * is at the end.
+	 */
+	std::vector<PendingDirectory> pending;
+
+public:
+	explicit DirectoryTreeWalker(const Database &_db) noexcept
+		:db(_db) {}
+
+	/**
+	 * Prepare visiting the given directory and all of its
+	 * descendants.
+	 *
+	 * @return false if the URI does not refer to a directory
+	 */
+	bool Open(std::string_view uri);
+
+	bool IsFinished() const noexcept {
+		return pending.empty();
+	}
+
+	/**
+	 * Visit the next directory (passed to #visit_directory, even
+	 * if it is the root directory), and then its songs and
+	 * playlists.  Its child directories are visited by subsequent
+	 * calls.
+	 */
+	void VisitNext(VisitDirectory visit_directory,
+		       VisitSong visit_song,
+		       VisitPlaylist visit_playlist);
+};
+
+#endif
@@ -19,20 +19,21 @@ protected:
 
 public:
 	using std::list<PlaylistInfo>::empty;
+	using std::list<PlaylistInfo>::size;
 	using std::list<PlaylistInfo>::begin;
 	using std::list<PlaylistInfo>::end;
 	using std::list<PlaylistInfo>::push_back;
 	using std::list<PlaylistInfo>::erase;
 
 	/**
-	 * Caller must lock the #db_mutex.
+	 * Caller must hold the exclusive #db_mutex lock.
 	 *
 	 * @return true if the vector or one of its items was modified
 	 */
 	bool UpdateOrInsert(PlaylistInfo &&pi) noexcept;
 
 	/**
-	 * Caller must lock the #db_mutex.
+	 * Caller must hold the exclusive #db_mutex lock.
 	 */
 	bool erase(std::string_view name) noexcept;
 
@@ -0,0 +1,647 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "DatabaseBinary.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "db/PlaylistVector.hxx"
+#include "db/DatabaseLock.hxx"
+#include "io/BufferedOutputStream.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "tag/Builder.hxx"
+#include "tag/Names.hxx"
+#include "tag/ParseName.hxx"
+#include "tag/Settings.hxx"
+#include "fs/Charset.hxx"
+#include "time/ChronoUtil.hxx"
+#include "util/PackedLittleEndian.hxx"
+#include "util/SpanCast.hxx"
+#include "util/StringAPI.hxx"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * File layout: a #BinaryHeader followed by these arrays (without
+ * padding): #BinaryTagName, #BinaryDirectory, #BinarySong,
+ * #BinaryTagItem, #BinaryPlaylist and finally the string table.
+ *
+ * Strings are referenced by their offset in the string table; each
+ * one is null-terminated.  Directories are stored in pre-order, each
+ * one referring to its parent's index and to a range of songs and
+ * playlists.  All integers are little-endian, and all structs have
+ * an alignment of 1, which allows accessing them directly in a
+ * memory-mapped file.
+ */
+
+static constexpr std::array<char, 8> BINARY_MAGIC{
+	'M', 'P', 'D', 'D', 'B', 'B', 'I', 'N',
+};
+
+static constexpr unsigned BINARY_DB_FORMAT = 1;
+
+static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+/**
+ * Special value for time stamps which are unknown/unavailable.
+ */
+static constexpr uint64_t NO_TIME = UINT64_MAX;
+
+enum class BinaryDirectoryType : uint8_t {
+	REGULAR,
+	ARCHIVE,
+	CONTAINER,
+	PLAYLIST,
+};
+
+enum BinarySongFlags : uint8_t {
+	IN_PLAYLIST = 0x1,
+	HAS_PLAYLIST = 0x2,
+};
+
+struct BinaryHeader {
+	std::array<char, 8> magic;
+	PackedLE32 format;
+	PackedLE32 fs_charset;
+	PackedLE32 n_tag_names;
+	PackedLE32 n_directories;
+	PackedLE32 n_songs;
+	PackedLE32 n_tag_items;
+	PackedLE32 n_playlists;
+};
+
+/**
+ * Maps the #TagType numbers used in this file to tag names.
+ */
+struct BinaryTagName {
+	PackedLE32 name;
+
+	/**
+	 * Was this tag enabled when the file was written?
+	 */
+	uint8_t enabled;
+};
+
+struct BinaryDirectory {
+	PackedLE32 name;
+	PackedLE32 parent;
+	PackedLE64 mtime;
+	PackedLE32 first_song, n_songs;
+	PackedLE32 first_playlist, n_playlists;
+	BinaryDirectoryType type;
+};
+
+struct BinarySong {
+	PackedLE32 filename;
+	PackedLE32 target;
+	PackedLE32 first_tag_item;
+	PackedLE16 n_tag_items;
+	uint8_t flags;
+	uint8_t channels;
+	PackedLE32 sample_rate;
+	uint8_t sample_format;
+	PackedLE32 duration_ms;
+	PackedLE32 start_ms, end_ms;
+	PackedLE64 mtime, added;
+};
+
+struct BinaryTagItem {
+	PackedLE32 value;
+	uint8_t type;
+};
+
+struct BinaryPlaylist {
+	PackedLE32 name;
+	PackedLE64 mtime;
+};
+
+static_assert(alignof(BinaryHeader) == 1);
+static_assert(alignof(BinaryDirectory) == 1);
+static_assert(alignof(BinarySong) == 1);
+static_assert(alignof(BinaryTagItem) == 1);
+static_assert(alignof(BinaryPlaylist) == 1);
+
+[[gnu::const]]
+static uint64_t
+ExportTime(std::chrono::system_clock::time_point t) noexcept
+{
+	return IsNegative(t)
+		? NO_TIME
+		: uint64_t(std::chrono::system_clock::to_time_t(t));
+}
+
+[[gnu::const]]
+static std::chrono::system_clock::time_point
+ImportTime(uint64_t t) noexcept
+{
+	return t == NO_TIME
+		? std::chrono::system_clock::time_point::min()
+		: std::chrono::system_clock::from_time_t(std::time_t(t));
+}
+
+[[gnu::const]]
+static constexpr BinaryDirectoryType
+ExportDirectoryType(unsigned device) noexcept
+{
+	switch (device) {
+	case DEVICE_INARCHIVE:
+		return BinaryDirectoryType::ARCHIVE;
+
+	case DEVICE_CONTAINER:
+		return BinaryDirectoryType::CONTAINER;
+
+	case DEVICE_PLAYLIST:
+		return BinaryDirectoryType::PLAYLIST;
+
+	default:
+		return BinaryDirectoryType::REGULAR;
+	}
+}
+
+[[gnu::const]]
+static constexpr unsigned
+ImportDirectoryType(BinaryDirectoryType type) noexcept
+{
+	switch (type) {
+	case BinaryDirectoryType::REGULAR:
+		break;
+
+	case BinaryDirectoryType::ARCHIVE:
+		return DEVICE_INARCHIVE;
+
+	case BinaryDirectoryType::CONTAINER:
+		return DEVICE_CONTAINER;
+
+	case BinaryDirectoryType::PLAYLIST:
+		return DEVICE_PLAYLIST;
+	}
+
+	return 0;
+}
+
+bool
+db_is_binary(std::span<const std::byte> src) noexcept
+{
+	return src.size() >= sizeof(BINARY_MAGIC) &&
+		std::memcmp(src.data(), BINARY_MAGIC.data(),
+			    sizeof(BINARY_MAGIC)) == 0;
+}
+
+namespace {
+
+/**
+ * Collects all strings referenced by the database and assigns
+ * offsets.  Duplicate strings (e.g. artist names) are stored only
+ * once.
+ */
+class BinaryStringTable {
+	std::unordered_map<std::string_view, uint32_t> map;
+	std::string data;
+
+public:
+	uint32_t Add(std::string_view s) {
+		auto [i, inserted] = map.try_emplace(s, data.size());
+		if (inserted) {
+			if (data.size() + s.size() + 1 > UINT32_MAX)
+				throw std::runtime_error("Database is too large");
+
+			data.append(s);
+			data.push_back('\0');
+		}
+
+		return i->second;
+	}
+
+	std::string_view GetData() const noexcept {
+		return data;
+	}
+};
+
+class BinaryDatabaseWriter {
+	BufferedOutputStream &os;
+
+	BinaryStringTable strings;
+
+	uint32_t n_directories = 0, n_songs = 0, n_tag_items = 0;
+	uint32_t n_playlists = 0;
+
+public:
+	explicit BinaryDatabaseWriter(BufferedOutputStream &_os) noexcept
+		:os(_os) {}
+
+	void Write(const Directory &root);
+
+private:
+	void Count(const Directory &directory) noexcept;
+
+	/**
+	 * Write all #BinaryDirectory records (pre-order).
+	 */
+	void WriteDirectories(const Directory &directory, uint32_t parent);
+
+	void WriteSongs(const Directory &directory);
+	void WriteTagItems(const Directory &directory);
+	void WritePlaylists(const Directory &directory);
+};
+
+}
+
+template<typename F>
+static void
+ForEachSavedChild(const Directory &directory, F &&f)
+{
+	for (const auto &child : directory.children)
+		/* mounted databases are saved separately */
+		if (!child.IsMount())
+			f(child);
+}
+
+void
+BinaryDatabaseWriter::Count(const Directory &directory) noexcept
+{
+	++n_directories;
+	n_songs += directory.songs.size();
+	n_playlists += directory.playlists.size();
+
+	for (const auto &song : directory.songs)
+		n_tag_items += song.tag.num_items;
+
+	ForEachSavedChild(directory, [this](const Directory &child){
+		Count(child);
+	});
+}
+
+void
+BinaryDatabaseWriter::WriteDirectories(const Directory &directory,
+				       uint32_t parent)
+{
+	const uint32_t index = n_directories++;
+
+	BinaryDirectory d{};
+	d.name = strings.Add(directory.IsRoot()
+			     ? std::string_view{}
+			     : directory.GetName());
+	d.parent = parent;
+	d.mtime = ExportTime(directory.mtime);
+	d.first_song = n_songs;
+	d.n_songs = directory.songs.size();
+	d.first_playlist = n_playlists;
+	d.n_playlists = directory.playlists.size();
+	d.type = ExportDirectoryType(directory.device);
+	os.WriteT(d);
+
+	n_songs += directory.songs.size();
+	n_playlists += directory.playlists.size();
+
+	ForEachSavedChild(directory, [this, index](const Directory &child){
+		WriteDirectories(child, index);
+	});
+}
+
+void
+BinaryDatabaseWriter::WriteSongs(const Directory &directory)
+{
+	for (const auto &song : directory.songs) {
+		BinarySong s{};
+		s.filename = strings.Add(song.filename);
+		s.target = strings.Add(song.target);
+		s.first_tag_item = n_tag_items;
+		s.n_tag_items = song.tag.num_items;
+
+		if (song.in_playlist)
+			s.flags |= IN_PLAYLIST;
+		if (song.tag.has_playlist)
+			s.flags |= HAS_PLAYLIST;
+
+		s.channels = song.audio_format.channels;
+		s.sample_rate = song.audio_format.sample_rate;
+		s.sample_format = uint8_t(song.audio_format.format);
+		s.duration_ms = uint32_t(song.tag.duration.ToMS());
+		s.start_ms = song.start_time.ToMS();
+		s.end_ms = song.end_time.ToMS();
+		s.mtime = ExportTime(song.mtime);
+		s.added = ExportTime(song.added);
+		os.WriteT(s);
+
+		n_tag_items += song.tag.num_items;
+	}
+
+	ForEachSavedChild(directory, [this](const Directory &child){
+		WriteSongs(child);
+	});
+}
+
+void
+BinaryDatabaseWriter::WriteTagItems(const Directory &directory)
+{
+	for (const auto &song : directory.songs) {
+		for (const auto &item : song.tag) {
+			BinaryTagItem i{};
+			i.value = strings.Add(item.value);
+			i.type = item.type;
+			os.WriteT(i);
+		}
+	}
+
+	ForEachSavedChild(directory, [this](const Directory &child){
+		WriteTagItems(child);
+	});
+}
+
+void
+BinaryDatabaseWriter::WritePlaylists(const Directory &directory)
+{
+	for (const auto &playlist : directory.playlists) {
+		BinaryPlaylist p{};
+		p.name = strings.Add(playlist.name);
+		p.mtime = ExportTime(playlist.mtime);
+		os.WriteT(p);
+	}
+
+	ForEachSavedChild(directory, [this](const Directory &child){
+		WritePlaylists(child);
+	});
+}
+
+void
+BinaryDatabaseWriter::Write(const Directory &root)
+{
+	Count(root);
+
+	BinaryHeader header{};
+	header.magic = BINARY_MAGIC;
+	header.format = BINARY_DB_FORMAT;
+	header.fs_charset = strings.Add(GetFSCharset());
+	header.n_tag_names = TAG_NUM_OF_ITEM_TYPES;
+	header.n_directories = n_directories;
+	header.n_songs = n_songs;
+	header.n_tag_items = n_tag_items;
+	header.n_playlists = n_playlists;
+	os.WriteT(header);
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+		BinaryTagName t{};
+		t.name = strings.Add(tag_item_names[i]);
+		t.enabled = IsTagEnabled(i);
+		os.WriteT(t);
+	}
+
+	n_directories = n_songs = n_playlists = 0;
+	WriteDirectories(root, NO_PARENT);
+
+	n_tag_items = 0;
+	WriteSongs(root);
+	WriteTagItems(root);
+	WritePlaylists(root);
+
+	os.Write(AsBytes(strings.GetData()));
+}
+
+void
+db_save_binary(BufferedOutputStream &os, const Directory &root)
+{
+	BinaryDatabaseWriter{os}.Write(root);
+}
+
+namespace {
+
+/**
+ * Helper class which extracts the sections of a binary database
+ * file, checking all bounds.
+ */
+class BinaryDatabaseReader {
+	std::span<const std::byte> src;
+
+public:
+	explicit BinaryDatabaseReader(std::span<const std::byte> _src) noexcept
+		:src(_src) {}
+
+	template<typename T>
+	std::span<const T> ReadArray(std::size_t n) {
+		if (n > src.size() / sizeof(T))
+			throw std::runtime_error("Database is truncated");
+
+		const std::span<const T> result{
+			reinterpret_cast<const T *>(src.data()),
+			n,
+		};
+
+		src = src.subspan(n * sizeof(T));
+		return result;
+	}
+
+	template<typename T>
+	const T &ReadT() {
+		return ReadArray<T>(1).front();
+	}
+
+	std::span<const std::byte> ReadRest() noexcept {
+		return std::exchange(src, std::span<const std::byte>{});
+	}
+};
+
+class BinaryDatabaseLoader {
+	std::span<const BinaryTagName> tag_names;
+	std::span<const BinaryDirectory> directories;
+	std::span<const BinarySong> songs;
+	std::span<const BinaryTagItem> tag_items;
+	std::span<const BinaryPlaylist> playlists;
+	std::string_view string_table;
+
+	const char *fs_charset;
+
+	/**
+	 * Maps the tag numbers used by the file to #TagType.
+	 */
+	std::vector<TagType> tag_map;
+
+public:
+	explicit BinaryDatabaseLoader(std::span<const std::byte> src);
+
+	void CheckConfig() const;
+
+	void Load(Directory &root) const;
+
+private:
+	const char *GetString(uint32_t offset) const {
+		if (offset >= string_table.size())
+			throw std::runtime_error("Malformed string reference");
+
+		return string_table.data() + offset;
+	}
+
+	static void CheckRange(uint32_t first, uint32_t n, std::size_t size) {
+		if (first > size || n > size - first)
+			throw std::runtime_error("Malformed database record");
+	}
+
+	void LoadSong(const BinarySong &src, Directory &directory) const;
+};
+
+}
+
+BinaryDatabaseLoader::BinaryDatabaseLoader(std::span<const std::byte> src)
+{
+	if (!db_is_binary(src))
+		throw std::runtime_error("Not a binary database");
+
+	BinaryDatabaseReader reader{src};
+
+	const auto &header = reader.ReadT<BinaryHeader>();
+	if (header.format != BINARY_DB_FORMAT)
+		throw std::runtime_error("Database format mismatch, "
+					 "discarding database file");
+
+	tag_names = reader.ReadArray<BinaryTagName>(header.n_tag_names);
+	directories = reader.ReadArray<BinaryDirectory>(header.n_directories);
+	songs = reader.ReadArray<BinarySong>(header.n_songs);
+	tag_items = reader.ReadArray<BinaryTagItem>(header.n_tag_items);
+	playlists = reader.ReadArray<BinaryPlaylist>(header.n_playlists);
+	string_table = ToStringView(reader.ReadRest());
+
+	/* with a null terminator at the end, every offset inside the
+	   table refers to a valid C string */
+	if (string_table.empty() || string_table.back() != '\0')
+		throw std::runtime_error("Malformed string table");
+
+	if (directories.empty() ||
+	    directories.front().parent != NO_PARENT)
+		throw std::runtime_error("Database has no root directory");
+
+	fs_charset = GetString(header.fs_charset);
+
+	tag_map.reserve(tag_names.size());
+	for (const auto &i : tag_names)
+		tag_map.push_back(tag_name_parse(GetString(i.name)));
+}
+
+void
+BinaryDatabaseLoader::CheckConfig() const
+{
+	const char *const old_charset = GetFSCharset();
+	const char *new_charset = fs_charset;
+	if (*old_charset != 0 && !StringIsEqual(new_charset, old_charset))
+		throw FmtRuntimeError("Existing database has charset "
+				      "{:?} instead of {:?}; "
+				      "discarding database file",
+				      new_charset, old_charset);
+
+	bool tags[TAG_NUM_OF_ITEM_TYPES]{};
+	for (std::size_t i = 0; i < tag_names.size(); ++i) {
+		if (!tag_names[i].enabled)
+			continue;
+
+		if (tag_map[i] == TAG_NUM_OF_ITEM_TYPES)
+			throw FmtRuntimeError("Unrecognized tag {:?}, "
+					      "discarding database file",
+					      GetString(tag_names[i].name));
+
+		tags[tag_map[i]] = true;
+	}
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (IsTagEnabled(i) && !tags[i])
+			throw std::runtime_error("Tag list mismatch, "
+						 "discarding database file");
+}
+
+inline void
+BinaryDatabaseLoader::LoadSong(const BinarySong &src,
+			       Directory &directory) const
+{
+	auto song = std::make_unique<Song>(GetString(src.filename),
+					   directory);
+	song->target = GetString(src.target);
+	song->in_playlist = src.flags & IN_PLAYLIST;
+	song->mtime = ImportTime(src.mtime);
+	song->added = ImportTime(src.added);
+	song->start_time = SongTime::FromMS(src.start_ms);
+	song->end_time = SongTime::FromMS(src.end_ms);
+
+	const AudioFormat audio_format(src.sample_rate,
+				       SampleFormat(src.sample_format),
+				       src.channels);
+	if (audio_format.IsValid())
+		song->audio_format = audio_format;
+
+	CheckRange(src.first_tag_item, src.n_tag_items, tag_items.size());
+
+	TagBuilder tag;
+	tag.Reserve(src.n_tag_items);
+
+	for (const auto &item : tag_items.subspan(src.first_tag_item,
+						  src.n_tag_items)) {
+		if (item.type >= tag_map.size())
+			throw std::runtime_error("Malformed tag item");
+
+		const TagType type = tag_map[item.type];
+		if (type != TAG_NUM_OF_ITEM_TYPES)
+			tag.AddItemUnchecked(type, GetString(item.value));
+	}
+
+	tag.SetDuration(SignedSongTime::FromMS(int32_t(uint32_t(src.duration_ms))));
+	tag.SetHasPlaylist(src.flags & HAS_PLAYLIST);
+	tag.Commit(song->tag);
+
+	directory.AddSong(std::move(song));
+}
+
+void
+BinaryDatabaseLoader::Load(Directory &root) const
+{
+	std::vector<Directory *> loaded;
+	loaded.reserve(directories.size());
+
+	for (const auto &src : directories) {
+		Directory *directory;
+		if (loaded.empty()) {
+			directory = &root;
+		} else {
+			/* pre-order: the parent has already been
+			   loaded */
+			if (src.parent >= loaded.size())
+				throw std::runtime_error("Malformed directory record");
+
+			directory = loaded[src.parent]->CreateChild(GetString(src.name));
+		}
+
+		loaded.push_back(directory);
+
+		const uint64_t mtime = src.mtime;
+		if (mtime != NO_TIME && mtime > 0)
+			directory->mtime = ImportTime(mtime);
+
+		directory->device = ImportDirectoryType(src.type);
+
+		CheckRange(src.first_song, src.n_songs, songs.size());
+		for (const auto &song : songs.subspan(src.first_song,
+						      src.n_songs))
+			LoadSong(song, *directory);
+
+		CheckRange(src.first_playlist, src.n_playlists,
+			   playlists.size());
+		for (const auto &playlist : playlists.subspan(src.first_playlist,
+							      src.n_playlists))
+			directory->playlists.push_back(PlaylistInfo{
+					GetString(playlist.name),
+					ImportTime(playlist.mtime),
+				});
+	}
+}
+
+void
+db_load_binary(std::span<const std::byte> src, Directory &root,
+	       bool ignore_config_mismatches)
+{
+	const BinaryDatabaseLoader loader{src};
+
+	if (!ignore_config_mismatches)
+		loader.CheckConfig();
+
+	const ScopeDatabaseLock protect;
+	loader.Load(root);
+}
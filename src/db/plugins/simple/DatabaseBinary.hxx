@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_DATABASE_BINARY_HXX
+#define MPD_DATABASE_BINARY_HXX
+
+#include <cstddef>
+#include <span>
+
+struct Directory;
+class BufferedOutputStream;
+
+/**
+ * Does the given buffer look like a binary database file?
+ */
+[[gnu::pure]]
+bool
+db_is_binary(std::span<const std::byte> src) noexcept;
+
+/**
+ * Write the database in the binary format.  This format consists of
+ * a string table and fixed-size records which can be loaded quickly
+ * from a memory-mapped file.
+ *
+ * Throws on I/O error.
+ */
+void
+db_save_binary(BufferedOutputStream &os, const Directory &root);
+
+/**
+ * Load a database in the binary format (see db_save_binary()).
+ *
+ * Throws #std::runtime_error on error.
+ *
+ * @param src the file contents (usually memory-mapped)
+ * @param ignore_config_mismatches if true, then configuration
+ * mismatches (e.g. enabled tags or filesystem charset) are ignored
+ */
+void
+db_load_binary(std::span<const std::byte> src, Directory &root,
+	       bool ignore_config_mismatches=false);
+
+#endif
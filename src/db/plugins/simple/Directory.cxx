@@ -46,7 +46,7 @@ Directory::~Directory() noexcept
 void
 Directory::Delete() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(parent != nullptr);
 
 	parent->children.erase_and_dispose(parent->children.iterator_to(*this),
@@ -72,7 +72,7 @@ Directory::GetName() const noexcept
 Directory *
 Directory::CreateChild(std::string_view name_utf8) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(!name_utf8.empty());
 
 	std::string path_utf8 = IsRoot()
@@ -114,7 +114,7 @@ Directory::LookupTargetSong(std::string_view target) noexcept
 void
 Directory::ClearInPlaylist() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	for (auto &child : children)
 		child.ClearInPlaylist();
@@ -126,7 +126,7 @@ Directory::ClearInPlaylist() noexcept
 void
 Directory::PruneEmpty() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	for (auto child = children.begin(), end = children.end();
 	     child != end;) {
@@ -172,7 +172,7 @@ Directory::LookupDirectory(std::string_view _uri) noexcept
 void
 Directory::AddSong(SongPtr song) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
@@ -182,7 +182,7 @@ Directory::AddSong(SongPtr song) noexcept
 SongPtr
 Directory::RemoveSong(Song *song) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
@@ -215,7 +215,7 @@ directory_cmp(const Directory &a, const Directory &b) noexcept
 void
 Directory::Sort() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	SortList(children, directory_cmp);
 	song_list_sort(songs);
@@ -236,7 +236,7 @@ Directory::Walk(bool recursive, const SongFilter *filter,
 		/* TODO: eliminate this unlock/lock; it is necessary
 		   because the child's SimpleDatabasePlugin::Visit()
 		   call will lock it again */
-		const ScopeDatabaseUnlock unlock;
+		const ScopeDatabaseReadUnlock unlock;
 		WalkMount(GetPath(), *mounted_database,
 			  "", DatabaseSelection("", recursive, filter),
 			  visit_directory, visit_song,
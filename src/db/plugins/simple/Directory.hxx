@@ -123,14 +123,14 @@ public:
 	 * Remove this #Directory object from its parent and free it.  This
 	 * must not be called with the root Directory.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must hold the exclusive #db_mutex lock.
 	 */
 	void Delete() noexcept;
 
 	/**
 	 * Create a new #Directory object as a child of the given one.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must hold the exclusive #db_mutex lock.
 	 *
 	 * @param name_utf8 the UTF-8 encoded name of the new sub directory
 	 */
@@ -152,7 +152,7 @@ public:
 	 * Look up a sub directory, and create the object if it does not
 	 * exist.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must hold the exclusive #db_mutex lock.
 	 */
 	Directory *MakeChild(std::string_view name_utf8) noexcept {
 		Directory *child = FindChild(name_utf8);
@@ -267,19 +267,19 @@ public:
 	 * Recursively walk through the whole tree and set all
 	 * `Song::in_playlist` fields to `false`.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must hold the exclusive #db_mutex lock.
 	 */
 	void ClearInPlaylist() noexcept;
 
 	/**
-	 * Caller must lock the #db_mutex.
+	 * Caller must hold the exclusive #db_mutex lock.
 	 */
 	void PruneEmpty() noexcept;
 
 	/**
 	 * Sort all directory entries recursively.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must hold the exclusive #db_mutex lock.
 	 */
 	void Sort() noexcept;
 
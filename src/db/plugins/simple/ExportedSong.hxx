@@ -38,7 +38,12 @@ public:
 			      which its LightSong::tag field refers
 			      to */
 			   src.OwnsTag() ? tag_buffer : src.tag),
-		 tag_buffer(std::move(src.tag_buffer)) {}
+		 tag_buffer(std::move(src.tag_buffer))
+	{
+		/* the Tag contents are the same (only moved), so
+		   the cached response is still valid */
+		response_cache = src.response_cache;
+	}
 
 	ExportedSong &operator=(ExportedSong &&) = delete;
 
@@ -14,39 +14,105 @@
 #include "db/LightDirectory.hxx"
 #include "Directory.hxx"
 #include "Song.hxx"
+#include "SongSort.hxx"
 #include "DatabaseSave.hxx"
+#include "DatabaseBinary.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/DatabaseError.hxx"
+#include "song/Filter.hxx"
+#include "song/TagSongFilter.hxx"
+#include "tag/ParseName.hxx"
+#include "tag/VisitFallback.hxx"
 #include "lib/fmt/PathFormatter.hxx"
+#include "lib/icu/Collate.hxx"
 #include "lib/zlib/AutoGunzipFileLineReader.hxx"
 #include "io/BufferedOutputStream.hxx"
 #include "io/FileOutputStream.hxx"
+#include "io/MappedFile.hxx"
 #include "fs/FileInfo.hxx"
 #include "config/Block.hxx"
 #include "fs/FileSystem.hxx"
+#include "lib/fmt/RuntimeError.hxx"
 #include "lib/fmt/SystemError.hxx"
 #include "util/CharUtil.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/StringStrip.hxx"
 #include "util/Domain.hxx"
 #include "util/RecursiveMap.hxx"
+#include "util/StringAPI.hxx"
 #include "Log.hxx"
 
 #ifdef ENABLE_ZLIB
 #include "lib/zlib/GzipOutputStream.hxx"
 #endif
 
+#include <algorithm>
 #include <cerrno>
 #include <memory>
+#include <vector>
 
 static constexpr Domain simple_db_domain("simple_db");
 
+/**
+ * Parse the "format" setting.
+ *
+ * @return true for the binary format
+ */
+static bool
+ParseDatabaseFormat(const ConfigBlock &block)
+{
+	const char *value = block.GetBlockValue("format", "text");
+	if (StringIsEqual(value, "text"))
+		return false;
+	else if (StringIsEqual(value, "binary"))
+		return true;
+	else
+		throw FmtRuntimeError("Unrecognized database format: {:?}",
+				      value);
+}
+
+/**
+ * Parse the "tag_index" setting.
+ *
+ * @return the new #TagIndex or nullptr if indexing is disabled
+ */
+static std::unique_ptr<TagIndex>
+ParseTagIndex(const ConfigBlock &block)
+{
+	const char *value = block.GetBlockValue("tag_index");
+	if (value == nullptr)
+		return nullptr;
+
+	TagMask types = TagMask::None();
+	for (std::string_view name : IterableSplitString(value, ',')) {
+		name = Strip(name);
+		if (name.empty())
+			continue;
+
+		const auto type = tag_name_parse_i(name);
+		if (type == TAG_NUM_OF_ITEM_TYPES)
+			throw FmtRuntimeError("Unrecognized tag {:?} in \"tag_index\"",
+					      name);
+
+		types.Set(type);
+	}
+
+	if (!types.TestAny())
+		return nullptr;
+
+	return std::make_unique<TagIndex>(types);
+}
+
 inline SimpleDatabase::SimpleDatabase(const ConfigBlock &block)
 	:Database(simple_db_plugin),
 	 path(block.GetPath("path")),
 	 cache_path(block.GetPath("cache_directory")),
+	 tag_index(ParseTagIndex(block)),
 #ifdef ENABLE_ZLIB
 	 compress(block.GetBlockValue("compress", true)),
 #endif
-	 hide_playlist_targets(block.GetBlockValue("hide_playlist_targets", true))
+	 hide_playlist_targets(block.GetBlockValue("hide_playlist_targets", true)),
+	 binary(ParseDatabaseFormat(block))
 {
 	if (path.IsNull())
 		throw std::runtime_error("No \"path\" parameter specified");
@@ -60,7 +126,8 @@ SimpleDatabase::SimpleDatabase(AllocatedPath &&_path,
 			       [[maybe_unused]]
 #endif
 			       bool _compress,
-			       bool _hide_playlist_targets) noexcept
+			       bool _hide_playlist_targets,
+			       bool _binary) noexcept
 	:Database(simple_db_plugin),
 	 path(std::move(_path)),
 	 path_utf8(path.ToUTF8()),
@@ -68,7 +135,8 @@ SimpleDatabase::SimpleDatabase(AllocatedPath &&_path,
 #ifdef ENABLE_ZLIB
 	 compress(_compress),
 #endif
-	 hide_playlist_targets(_hide_playlist_targets)
+	 hide_playlist_targets(_hide_playlist_targets),
+	 binary(_binary)
 {
 }
 
@@ -135,11 +203,27 @@ SimpleDatabase::Load()
 	assert(!path.IsNull());
 	assert(root != nullptr);
 
-	AutoGunzipFileLineReader file{path};
-
 	LogDebug(simple_db_domain, "reading DB");
 
-	db_load_internal(file, *root);
+	{
+		/* the binary format is detected automatically, which
+		   allows switching the "format" setting without
+		   losing the existing database */
+		const MappedFile mapped{path};
+		if (db_is_binary(mapped.GetData())) {
+			db_load_binary(mapped.GetData(), *root);
+		} else {
+			AutoGunzipFileLineReader file{path};
+			db_load_internal(file, *root);
+		}
+	}
+
+	if (tag_index != nullptr) {
+		LogDebug(simple_db_domain, "building tag index");
+
+		const ScopeDatabaseLock protect;
+		tag_index->AddDirectory(*root);
+	}
 
 	FileInfo fi;
 	if (GetFileInfo(path, fi))
@@ -152,6 +236,7 @@ SimpleDatabase::Open()
 	assert(prefixed_light_song == nullptr);
 
 	root = Directory::NewRoot();
+	n_mounts = 0;
 	mtime = std::chrono::system_clock::time_point::min();
 
 #ifndef NDEBUG
@@ -163,6 +248,9 @@ SimpleDatabase::Open()
 	} catch (...) {
 		LogError(std::current_exception());
 
+		if (tag_index != nullptr)
+			tag_index->Clear();
+
 		delete root;
 
 		Check();
@@ -178,6 +266,9 @@ SimpleDatabase::Close() noexcept
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
 
+	if (tag_index != nullptr)
+		tag_index->Clear();
+
 	delete root;
 }
 
@@ -185,10 +276,15 @@ const LightSong *
 SimpleDatabase::GetSong(std::string_view uri) const
 {
 	assert(root != nullptr);
+
+	/* this lock is held until ReturnSong() is called; this
+	   serializes all borrowers (see #borrow_mutex) */
+	std::unique_lock borrow_lock{borrow_mutex};
+
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
 
-	ScopeDatabaseLock protect;
+	ScopeDatabaseReadLock protect;
 
 	auto r = root->LookupDirectory(uri);
 
@@ -204,6 +300,7 @@ SimpleDatabase::GetSong(std::string_view uri) const
 		prefixed_light_song =
 			new PrefixedLightSong(*song, r.uri);
 		r.directory->mounted_database->ReturnSong(song);
+		borrow_lock.release();
 		return prefixed_light_song;
 	}
 
@@ -229,6 +326,7 @@ SimpleDatabase::GetSong(std::string_view uri) const
 	++borrowed_song_count;
 #endif
 
+	borrow_lock.release();
 	return &exported_song.Get();
 }
 
@@ -249,6 +347,9 @@ SimpleDatabase::ReturnSong([[maybe_unused]] const LightSong *song) const noexcep
 
 		exported_song.Destruct();
 	}
+
+	/* this was locked by GetSong() */
+	borrow_mutex.unlock();
 }
 
 [[gnu::const]]
@@ -266,7 +367,7 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		      VisitSong visit_song,
 		      VisitPlaylist visit_playlist) const
 {
-	ScopeDatabaseLock protect;
+	ScopeDatabaseReadLock protect;
 
 	auto r = root->LookupDirectory(selection.uri);
 
@@ -287,6 +388,16 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 	if (r.rest.data() == nullptr) {
 		/* it's a directory */
 
+		if (selection.recursive && visit_song &&
+		    !visit_directory && !visit_playlist) {
+			if (const auto *indexed = FindIndexedFilter(selection)) {
+				VisitIndexed(*r.directory, *indexed,
+					     selection.filter, visit_song);
+				helper.Commit();
+				return;
+			}
+		}
+
 		if (selection.recursive && visit_directory)
 			visit_directory(r.directory->Export());
 
@@ -316,10 +427,175 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 			    "No such directory");
 }
 
+inline bool
+SimpleDatabase::IsVisible(const Song &song) const noexcept
+{
+	return !hide_playlist_targets || !song.in_playlist;
+}
+
+/**
+ * Is the given song inside the given directory (recursively)?
+ */
+[[gnu::pure]]
+static bool
+IsInside(const Song &song, const Directory &directory) noexcept
+{
+	for (const Directory *i = &song.parent; i != nullptr; i = i->parent)
+		if (i == &directory)
+			return true;
+
+	return false;
+}
+
+[[gnu::pure]]
+static unsigned
+GetDepth(const Directory &directory) noexcept
+{
+	unsigned depth = 0;
+	for (const Directory *i = directory.parent; i != nullptr; i = i->parent)
+		++depth;
+	return depth;
+}
+
+/**
+ * Compare two songs in the order in which Directory::Walk() visits
+ * them after Directory::Sort(): songs of a directory come before
+ * its children, siblings are sorted by collation.
+ */
+[[gnu::pure]]
+static bool
+CompareWalkOrder(const Song *a, const Song *b) noexcept
+{
+	const Directory *da = &a->parent, *db = &b->parent;
+	if (da == db)
+		return song_cmp(*a, *b);
+
+	unsigned depth_a = GetDepth(*da), depth_b = GetDepth(*db);
+
+	for (; depth_a > depth_b; --depth_a) {
+		da = da->parent;
+		if (da == db)
+			/* b's directory contains a */
+			return false;
+	}
+
+	for (; depth_b > depth_a; --depth_b) {
+		db = db->parent;
+		if (db == da)
+			/* a's directory contains b */
+			return true;
+	}
+
+	while (da->parent != db->parent) {
+		da = da->parent;
+		db = db->parent;
+	}
+
+	return IcuCollate(da->path, db->path) < 0;
+}
+
+const TagSongFilter *
+SimpleDatabase::FindIndexedFilter(const DatabaseSelection &selection) const noexcept
+{
+	assert(holding_db_lock());
+
+	if (tag_index == nullptr || n_mounts > 0 || selection.filter == nullptr)
+		return nullptr;
+
+	for (const auto &i : selection.filter->GetItems()) {
+		const auto *f = dynamic_cast<const TagSongFilter *>(i.get());
+		if (f != nullptr && f->IsExactMatch() &&
+		    tag_index->IsIndexed(f->GetTagType()))
+			return f;
+	}
+
+	return nullptr;
+}
+
+void
+SimpleDatabase::VisitIndexed(const Directory &directory,
+			     const TagSongFilter &indexed,
+			     const SongFilter *filter,
+			     const VisitSong &visit_song) const
+{
+	assert(holding_db_lock());
+	assert(tag_index != nullptr);
+
+	std::vector<const Song *> candidates;
+
+	const auto add = [this, &directory, &candidates](const Song *song){
+		if (IsVisible(*song) && IsInside(*song, directory))
+			candidates.push_back(song);
+	};
+
+	if (const auto *songs = tag_index->Find(indexed.GetTagType(),
+						indexed.GetValue()))
+		std::for_each(songs->begin(), songs->end(), add);
+
+	const auto &unindexed = tag_index->GetUnindexed();
+	std::for_each(unindexed.begin(), unindexed.end(), add);
+
+	/* the index is unordered; restore the order of a full
+	   database walk */
+	std::sort(candidates.begin(), candidates.end(), CompareWalkOrder);
+
+	for (const Song *song : candidates) {
+		const auto song2 = song->Export();
+		if (filter == nullptr || filter->Match(song2))
+			visit_song(song2);
+	}
+}
+
+RecursiveMap<std::string>
+SimpleDatabase::CollectIndexedUniqueTags(TagType tag_type) const
+{
+	assert(holding_db_lock());
+	assert(tag_index != nullptr);
+
+	RecursiveMap<std::string> result;
+
+	tag_index->ForEachValue(tag_type, [this, &result](std::string_view value,
+							  const TagIndex::SongSet &songs){
+		/* the value is listed if at least one of its songs
+		   is visible */
+		for (const Song *song : songs) {
+			if (IsVisible(*song)) {
+				result.emplace(value, RecursiveMap<std::string>{});
+				break;
+			}
+		}
+	});
+
+	for (const Song *song : tag_index->GetUnindexed()) {
+		if (!IsVisible(*song))
+			continue;
+
+		const auto song2 = song->Export();
+		VisitTagWithFallbackOrEmpty(song2.tag, tag_type, [&result](const char *value){
+			result.emplace(value, RecursiveMap<std::string>{});
+		});
+	}
+
+	return result;
+}
+
 RecursiveMap<std::string>
 SimpleDatabase::CollectUniqueTags(const DatabaseSelection &selection,
 				  std::span<const TagType> tag_types) const
 {
+	if (tag_index != nullptr && tag_types.size() == 1 &&
+	    tag_index->IsIndexed(tag_types.front()) &&
+	    selection.uri.empty() && selection.recursive &&
+	    (selection.filter == nullptr || selection.filter->IsEmpty())) {
+		/* a plain "list" command without filter: answer it
+		   from the index keys */
+		const ScopeDatabaseReadLock protect;
+		if (n_mounts == 0)
+			return CollectIndexedUniqueTags(tag_types.front());
+	}
+
+	/* if the filter can be answered from the index, Visit()
+	   will do that */
 	return ::CollectUniqueTags(*this, selection, tag_types);
 }
 
@@ -349,8 +625,10 @@ SimpleDatabase::Save()
 	OutputStream *os = &fos;
 
 #ifdef ENABLE_ZLIB
+	/* the binary format is not compressed because it is meant to
+	   be memory-mapped */
 	std::unique_ptr<GzipOutputStream> gzip;
-	if (compress) {
+	if (compress && !binary) {
 		gzip = std::make_unique<GzipOutputStream>(*os);
 		os = gzip.get();
 	}
@@ -358,7 +636,10 @@ SimpleDatabase::Save()
 
 	BufferedOutputStream bos(*os);
 
-	db_save_internal(bos, *root);
+	if (binary)
+		db_save_binary(bos, *root);
+	else
+		db_save_internal(bos, *root);
 
 	bos.Flush();
 
@@ -399,6 +680,7 @@ SimpleDatabase::Mount(const char *uri, DatabasePtr db)
 
 	Directory *mnt = r.directory->CreateChild(r.rest);
 	mnt->mounted_database = std::move(db);
+	++n_mounts;
 }
 
 static constexpr bool
@@ -429,7 +711,8 @@ SimpleDatabase::Mount(const char *local_uri, const char *storage_uri)
 	constexpr bool compress = false;
 #endif
 	auto db = std::make_unique<SimpleDatabase>(cache_path / name_fs,
-						   compress, hide_playlist_targets);
+						   compress, hide_playlist_targets,
+						   binary);
 	db->Open();
 
 	bool exists = db->FileExists();
@@ -451,6 +734,9 @@ SimpleDatabase::LockUmountSteal(const char *uri) noexcept
 	auto db = std::move(r.directory->mounted_database);
 	r.directory->Delete();
 
+	assert(n_mounts > 0);
+	--n_mounts;
+
 	return db;
 }
 
@@ -467,6 +753,6 @@ SimpleDatabase::Unmount(const char *uri) noexcept
 
 constexpr DatabasePlugin simple_db_plugin = {
 	"simple",
-	DatabasePlugin::FLAG_REQUIRE_STORAGE,
+	DatabasePlugin::FLAG_REQUIRE_STORAGE|DatabasePlugin::FLAG_CONCURRENT,
 	SimpleDatabase::Create,
 };
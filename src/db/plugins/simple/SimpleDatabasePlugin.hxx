@@ -5,13 +5,16 @@
 #define MPD_SIMPLE_DATABASE_PLUGIN_HXX
 
 #include "ExportedSong.hxx"
+#include "TagIndex.hxx"
 #include "db/Interface.hxx"
 #include "db/Ptr.hxx"
 #include "fs/AllocatedPath.hxx"
+#include "thread/Mutex.hxx"
 #include "util/Manual.hxx"
 #include "config.h"
 
 #include <cassert>
+#include <memory>
 
 struct ConfigBlock;
 struct Directory;
@@ -19,6 +22,8 @@ struct DatabasePlugin;
 class EventLoop;
 class DatabaseListener;
 class PrefixedLightSong;
+class SongFilter;
+class TagSongFilter;
 
 class SimpleDatabase : public Database {
 	const AllocatedPath path;
@@ -31,8 +36,37 @@ class SimpleDatabase : public Database {
 
 	Directory *root;
 
+	/**
+	 * An optional index for tag lookups (setting "tag_index").
+	 * It is protected by #db_mutex.
+	 */
+	const std::unique_ptr<TagIndex> tag_index;
+
+	/**
+	 * The number of mounted databases.  Their songs are not in
+	 * the #tag_index, so it can only be used if there are none.
+	 * It is protected by #db_mutex.
+	 */
+	unsigned n_mounts;
+
 	std::chrono::system_clock::time_point mtime;
 
+	/**
+	 * Protects #prefixed_light_song and #exported_song.  It is
+	 * locked by GetSong() and unlocked by ReturnSong(), because
+	 * GetSong() may be called by several threads (see
+	 * DatabasePlugin::FLAG_CONCURRENT).
+	 *
+	 * This means only one song can be borrowed at a time: while
+	 * a #CommandPool thread holds a song, the #EventLoop thread
+	 * blocks in GetSong() until it is returned (and vice versa).
+	 * That is acceptable because callers return the song after
+	 * a short operation (copying or printing it, or looking up
+	 * its stickers), and they never borrow a second song before
+	 * that.
+	 */
+	mutable Mutex borrow_mutex;
+
 	/**
 	 * A buffer for GetSong() when prefixing the #LightSong
 	 * instance from a mounted #Database.
@@ -54,10 +88,16 @@ class SimpleDatabase : public Database {
 
 	const bool hide_playlist_targets;
 
+	/**
+	 * Write the database in the binary format (see
+	 * db_save_binary()) instead of the text format?
+	 */
+	const bool binary;
+
 public:
 	SimpleDatabase(const ConfigBlock &block);
 	SimpleDatabase(AllocatedPath &&_path, bool _compress,
-		       bool _hide_playlist_targets) noexcept;
+		       bool _hide_playlist_targets, bool _binary) noexcept;
 
 	static DatabasePtr Create(EventLoop &main_event_loop,
 				  EventLoop &io_event_loop,
@@ -71,6 +111,14 @@ public:
 		return *root;
 	}
 
+	/**
+	 * Returns the #TagIndex which needs to be kept in sync by
+	 * the database update, or nullptr if there is none.
+	 */
+	TagIndex *GetTagIndex() noexcept {
+		return tag_index.get();
+	}
+
 	bool HasCache() const noexcept {
 		return !cache_path.IsNull();
 	}
@@ -128,6 +176,41 @@ private:
 
 	void Check() const;
 
+	/**
+	 * Is this song visible to Visit()?
+	 */
+	[[gnu::pure]]
+	bool IsVisible(const Song &song) const noexcept;
+
+	/**
+	 * Find a #TagSongFilter in the given selection which can be
+	 * looked up in the #tag_index.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	[[gnu::pure]]
+	const TagSongFilter *FindIndexedFilter(const DatabaseSelection &selection) const noexcept;
+
+	/**
+	 * Visit the songs matching the given filter (which was
+	 * returned by FindIndexedFilter()) inside the given directory
+	 * using the #tag_index.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	void VisitIndexed(const Directory &directory,
+			  const TagSongFilter &indexed,
+			  const SongFilter *filter,
+			  const VisitSong &visit_song) const;
+
+	/**
+	 * Collect the values of the given tag type from the
+	 * #tag_index keys.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	RecursiveMap<std::string> CollectIndexedUniqueTags(TagType tag_type) const;
+
 	/**
 	 * Throws #std::runtime_error on error.
 	 */
@@ -115,6 +115,11 @@ Song::Export() const noexcept
 		dest.directory = parent.GetPath();
 	if (!target.empty())
 		dest.real_uri = target.c_str();
+	else
+		/* songs with a target may inherit attributes from
+		   another song, therefore only plain songs can use
+		   the cache */
+		dest.response_cache = &response_cache;
 	dest.mtime = IsNegative(mtime) && target_song != nullptr
 		? target_song->mtime
 		: mtime;
@@ -7,6 +7,7 @@
 #include "Ptr.hxx"
 #include "Chrono.hxx"
 #include "tag/Tag.hxx"
+#include "song/ResponseCache.hxx"
 #include "pcm/AudioFormat.hxx"
 #include "util/IntrusiveList.hxx"
 #include "config.h"
@@ -81,6 +82,13 @@ struct Song : IntrusiveListHook<> {
 	 */
 	AudioFormat audio_format = AudioFormat::Undefined();
 
+	/**
+	 * The formatted protocol response.  It must be cleared (while
+	 * holding the exclusive database lock) whenever one of the
+	 * other attributes is modified.
+	 */
+	SongResponseCache response_cache;
+
 	/**
 	 * Is this song referenced by at least one playlist file that
 	 * is part of the database?
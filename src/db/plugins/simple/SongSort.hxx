@@ -8,6 +8,14 @@
 
 struct Song;
 
+/**
+ * The order of songs within a directory established by
+ * song_list_sort().
+ */
+[[gnu::pure]]
+bool
+song_cmp(const Song &a, const Song &b) noexcept;
+
 void
 song_list_sort(IntrusiveList<Song> &songs) noexcept;
 
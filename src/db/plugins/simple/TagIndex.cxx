@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "TagIndex.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "tag/VisitFallback.hxx"
+
+#include <cassert>
+
+void
+TagIndex::Clear() noexcept
+{
+	for (auto &i : values)
+		i.clear();
+
+	unindexed.clear();
+}
+
+void
+TagIndex::Add(const Song &song) noexcept
+{
+	assert(holding_db_write_lock());
+
+	if (!song.target.empty()) {
+		unindexed.insert(&song);
+		return;
+	}
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+		const auto type = TagType(i);
+		if (!types.Test(type))
+			continue;
+
+		auto &map = values[type];
+		VisitTagWithFallbackOrEmpty(song.tag, type, [&map, &song](std::string_view value){
+			auto j = map.find(value);
+			if (j == map.end())
+				j = map.emplace(value, SongSet{}).first;
+
+			j->second.insert(&song);
+		});
+	}
+}
+
+void
+TagIndex::Remove(const Song &song) noexcept
+{
+	assert(holding_db_write_lock());
+
+	if (!song.target.empty()) {
+		unindexed.erase(&song);
+		return;
+	}
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+		const auto type = TagType(i);
+		if (!types.Test(type))
+			continue;
+
+		auto &map = values[type];
+		VisitTagWithFallbackOrEmpty(song.tag, type, [&map, &song](std::string_view value){
+			auto j = map.find(value);
+			if (j == map.end())
+				return;
+
+			j->second.erase(&song);
+			if (j->second.empty())
+				map.erase(j);
+		});
+	}
+}
+
+void
+TagIndex::AddDirectory(const Directory &directory) noexcept
+{
+	for (const auto &song : directory.songs)
+		Add(song);
+
+	for (const auto &child : directory.children)
+		AddDirectory(child);
+}
+
+const TagIndex::SongSet *
+TagIndex::Find(TagType type, std::string_view value) const noexcept
+{
+	assert(IsIndexed(type));
+
+	const auto &map = values[type];
+	auto i = map.find(value);
+	return i != map.end()
+		? &i->second
+		: nullptr;
+}
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_TAG_INDEX_HXX
+#define MPD_TAG_INDEX_HXX
+
+#include "tag/Mask.hxx"
+#include "tag/Type.hxx"
+
+#include <array>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+struct Song;
+struct Directory;
+
+/**
+ * An inverted index which maps tag values to #Song objects.  It
+ * allows answering exact tag matches and "list" queries without
+ * walking the whole #Directory tree.
+ *
+ * Values are indexed with tag fallbacks applied (see
+ * VisitTagWithFallbackOrEmpty()), i.e. exactly the way
+ * #TagSongFilter and CollectUniqueTags() see them.  Songs which lack
+ * a tag are indexed with an empty value.
+ *
+ * Songs with a "target" (e.g. tracks of a CUE sheet) are not indexed
+ * by value, because their exported tags are merged with the target
+ * song's tags; they are returned as candidates for all queries.
+ *
+ * All methods must be called while holding the #db_mutex; methods
+ * which modify the index need the exclusive lock.
+ */
+class TagIndex {
+public:
+	using SongSet = std::unordered_set<const Song *>;
+
+private:
+	/**
+	 * The tag types which are indexed.
+	 */
+	const TagMask types;
+
+	std::array<std::map<std::string, SongSet, std::less<>>,
+		   TAG_NUM_OF_ITEM_TYPES> values;
+
+	/**
+	 * Songs which are not indexed by value.
+	 */
+	SongSet unindexed;
+
+public:
+	explicit TagIndex(TagMask _types) noexcept
+		:types(_types) {}
+
+	TagIndex(const TagIndex &) = delete;
+	TagIndex &operator=(const TagIndex &) = delete;
+
+	bool IsIndexed(TagType type) const noexcept {
+		return type < TAG_NUM_OF_ITEM_TYPES && types.Test(type);
+	}
+
+	void Clear() noexcept;
+
+	/**
+	 * Add a song which was just added to the database.
+	 */
+	void Add(const Song &song) noexcept;
+
+	/**
+	 * Remove a song before it gets removed from the database or
+	 * before its tag gets modified.  The song's tag must be the
+	 * same as it was when Add() was called.
+	 */
+	void Remove(const Song &song) noexcept;
+
+	/**
+	 * Add all songs in the given directory recursively.
+	 */
+	void AddDirectory(const Directory &directory) noexcept;
+
+	/**
+	 * Look up the songs having the given tag value.
+	 *
+	 * @param type an indexed tag type
+	 * @return the set of songs or nullptr if there is no such
+	 * value
+	 */
+	[[gnu::pure]]
+	const SongSet *Find(TagType type,
+			    std::string_view value) const noexcept;
+
+	/**
+	 * Invoke a function for each distinct value of the given tag
+	 * type.
+	 *
+	 * @param type an indexed tag type
+	 * @param f a function taking the value (std::string_view)
+	 * and the #SongSet
+	 */
+	template<typename F>
+	void ForEachValue(TagType type, F &&f) const {
+		for (const auto &[value, songs] : values[type])
+			f(std::string_view{value}, songs);
+	}
+
+	const SongSet &GetUnindexed() const noexcept {
+		return unindexed;
+	}
+};
+
+#endif
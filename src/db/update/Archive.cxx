@@ -31,7 +31,7 @@ LockMakeChild(Directory &directory, std::string_view name) noexcept
 static Song *
 LockFindSong(Directory &directory, std::string_view name) noexcept
 {
-	const ScopeDatabaseLock protect;
+	const ScopeDatabaseReadLock protect;
 	return directory.FindSong(name);
 }
 
@@ -68,17 +68,21 @@ UpdateWalk::UpdateArchiveTree(ArchiveFile &archive, Directory &directory,
 		if (song == nullptr) {
 			auto new_song = Song::LoadFromArchive(archive, name, directory);
 			if (new_song) {
-				{
-					const ScopeDatabaseLock protect;
-					directory.AddSong(std::move(new_song));
-				}
+				editor.LockAddSong(directory, std::move(new_song));
 
 				modified = true;
 				FmtNotice(update_domain, "added {}/{}",
 					  directory.GetPath(), name);
 			}
 		} else {
-			if (!song->UpdateFileInArchive(archive)) {
+			/* scan into a temporary object, so the new tag
+			   can be applied (and indexed) while holding
+			   the database lock */
+			auto new_song = Song::LoadFromArchive(archive, name, directory);
+			if (new_song) {
+				const ScopeDatabaseLock protect;
+				editor.UpdateSongTag(*song, std::move(new_song->tag));
+			} else {
 				FmtDebug(update_domain,
 					 "deleting unrecognized file {}/{}",
 					 directory.GetPath(), name);
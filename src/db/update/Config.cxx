@@ -4,6 +4,7 @@
 #include "Config.hxx"
 #include "config/Data.hxx"
 #include "config/Option.hxx"
+#include "config/Parser.hxx"
 
 UpdateConfig::UpdateConfig(const ConfigData &config)
 {
@@ -15,7 +16,14 @@ UpdateConfig::UpdateConfig(const ConfigData &config)
 	follow_outside_symlinks =
 		config.GetBool(ConfigOption::FOLLOW_OUTSIDE_SYMLINKS,
 			       DEFAULT_FOLLOW_OUTSIDE_SYMLINKS);
-#else
-	(void)config;
 #endif
+
+	threads = config.GetPositive(ConfigOption::UPDATE_THREADS,
+				     DEFAULT_THREADS);
+
+	read_ahead = config.With(ConfigOption::UPDATE_READ_AHEAD, [](const char *s){
+		return s != nullptr
+			? ParseSize(s, 1024)
+			: DEFAULT_READ_AHEAD;
+	});
 }
@@ -4,6 +4,8 @@
 #ifndef MPD_UPDATE_CONFIG_HXX
 #define MPD_UPDATE_CONFIG_HXX
 
+#include <cstddef>
+
 struct ConfigData;
 
 struct UpdateConfig {
@@ -15,6 +17,23 @@ struct UpdateConfig {
 	bool follow_outside_symlinks = DEFAULT_FOLLOW_OUTSIDE_SYMLINKS;
 #endif
 
+	static constexpr unsigned DEFAULT_THREADS = 1;
+
+	/**
+	 * The number of threads which scan song files, including the
+	 * update thread.
+	 */
+	unsigned threads = DEFAULT_THREADS;
+
+	static constexpr std::size_t DEFAULT_READ_AHEAD = 64 * 1024;
+
+	/**
+	 * The number of bytes at the beginning of each new or
+	 * modified song file which are read in advance (see
+	 * #UpdateReadAhead); 0 disables this.
+	 */
+	std::size_t read_ahead = DEFAULT_READ_AHEAD;
+
 	explicit UpdateConfig(const ConfigData &config);
 };
 
@@ -7,14 +7,49 @@
 #include "db/DatabaseLock.hxx"
 #include "db/plugins/simple/Directory.hxx"
 #include "db/plugins/simple/Song.hxx"
+#include "db/plugins/simple/TagIndex.hxx"
 
 #include <cassert>
 
+void
+DatabaseEditor::AddSong(Directory &directory, SongPtr song) noexcept
+{
+	assert(&song->parent == &directory);
+
+	if (tag_index != nullptr)
+		tag_index->Add(*song);
+
+	directory.AddSong(std::move(song));
+}
+
+void
+DatabaseEditor::LockAddSong(Directory &directory, SongPtr song) noexcept
+{
+	const ScopeDatabaseLock protect;
+	AddSong(directory, std::move(song));
+}
+
+void
+DatabaseEditor::UpdateSongTag(Song &song, Tag &&tag) noexcept
+{
+	if (tag_index != nullptr)
+		tag_index->Remove(song);
+
+	song.tag = std::move(tag);
+	song.response_cache.Clear();
+
+	if (tag_index != nullptr)
+		tag_index->Add(song);
+}
+
 void
 DatabaseEditor::DeleteSong(Directory &dir, Song *del)
 {
 	assert(&del->parent == &dir);
 
+	if (tag_index != nullptr)
+		tag_index->Remove(*del);
+
 	/* first, prevent traversers in main task from getting this */
 	const SongPtr song = dir.RemoveSong(del);
 
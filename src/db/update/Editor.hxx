@@ -5,17 +5,50 @@
 #define MPD_UPDATE_DATABASE_HXX
 
 #include "Remove.hxx"
+#include "db/plugins/simple/Ptr.hxx"
 
 struct Directory;
 struct Song;
+struct Tag;
+class TagIndex;
 
 class DatabaseEditor final {
 	UpdateRemoveService remove;
 
+	/**
+	 * The #TagIndex of the database being edited (or nullptr if
+	 * it has none).  It is kept in sync with all songs added,
+	 * modified or deleted by this object.
+	 */
+	TagIndex *tag_index = nullptr;
+
 public:
 	DatabaseEditor(EventLoop &_loop, DatabaseListener &_listener)
 		:remove(_loop, _listener) {}
 
+	void SetTagIndex(TagIndex *_tag_index) noexcept {
+		tag_index = _tag_index;
+	}
+
+	/**
+	 * Add a new song to the given directory.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	void AddSong(Directory &directory, SongPtr song) noexcept;
+
+	/**
+	 * AddSong() with automatic locking.
+	 */
+	void LockAddSong(Directory &directory, SongPtr song) noexcept;
+
+	/**
+	 * Replace the tag of an existing song.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	void UpdateSongTag(Song &song, Tag &&tag) noexcept;
+
 	/**
 	 * Caller must lock the #db_mutex.
 	 */
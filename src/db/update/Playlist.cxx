@@ -44,10 +44,7 @@ UpdateWalk::UpdatePlaylistFile(Directory &directory,
 			: "../" + db_song->filename;
 		db_song->filename = fmt::format("track{:04}", ++track);
 
-		{
-			const ScopeDatabaseLock protect;
-			directory.AddSong(std::move(db_song));
-		}
+		editor.LockAddSong(directory, std::move(db_song));
 	}
 }
 
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "ReadAhead.hxx"
+#include "UpdateDomain.hxx"
+#include "fs/Path.hxx"
+#include "io/Open.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "Log.hxx"
+
+#ifdef HAVE_URING
+#include "io/uring/Ring.hxx"
+#endif
+
+#include <algorithm>
+
+#include <fcntl.h>
+
+UpdateReadAhead::UpdateReadAhead(std::size_t _size) noexcept
+	:size(_size)
+{
+#ifdef HAVE_URING
+	if (size == 0)
+		return;
+
+	try {
+		ring = std::make_unique<Uring::Ring>(MAX_INFLIGHT, 0);
+	} catch (...) {
+		LogDebug(update_domain, "io_uring not available for read-ahead");
+		return;
+	}
+
+	free_slots.reserve(MAX_INFLIGHT);
+	for (std::size_t i = MAX_INFLIGHT; i > 0; --i)
+		free_slots.push_back(i - 1);
+#endif
+}
+
+UpdateReadAhead::~UpdateReadAhead() noexcept
+{
+#ifdef HAVE_URING
+	if (ring) {
+		/* the kernel may still write into our buffers */
+
+		try {
+			/* in case a previous Submit() has failed */
+			ring->Submit();
+		} catch (...) {
+		}
+
+		while (free_slots.size() < MAX_INFLIGHT && ReapOne(true)) {}
+	}
+#endif
+}
+
+#ifdef HAVE_URING
+
+inline bool
+UpdateReadAhead::ReapOne(bool wait) noexcept
+{
+	struct io_uring_cqe *cqe;
+
+	try {
+		cqe = wait
+			? ring->WaitCompletion()
+			: ring->PeekCompletion();
+	} catch (...) {
+		LogError(std::current_exception());
+		return false;
+	}
+
+	if (cqe == nullptr)
+		return false;
+
+	const auto *slot = static_cast<const Slot *>(io_uring_cqe_get_data(cqe));
+	const std::size_t i = slot - slots.data();
+	ring->SeenCompletion(*cqe);
+
+	/* the data is not needed, it's only in the page cache
+	   now; keep the buffer for the next read */
+	slots[i].fd.Close();
+	free_slots.push_back(i);
+	return true;
+}
+
+inline bool
+UpdateReadAhead::SubmitUring(Path path, std::size_t nbytes) noexcept
+{
+	if (free_slots.empty() && !ReapOne(true))
+		return false;
+
+	const std::size_t i = free_slots.back();
+	auto &slot = slots[i];
+
+	try {
+		slot.fd = OpenReadOnly(path.c_str());
+	} catch (...) {
+		/* the tag scanner will report this */
+		return true;
+	}
+
+	if (!slot.buffer)
+		slot.buffer = std::make_unique<std::byte[]>(size);
+
+	auto *sqe = ring->GetSubmitEntry();
+	if (sqe == nullptr) {
+		slot.fd.Close();
+		return false;
+	}
+
+	slot.iov.iov_base = slot.buffer.get();
+	slot.iov.iov_len = nbytes;
+
+	io_uring_prep_readv(sqe, slot.fd.Get(), &slot.iov, 1, 0);
+	io_uring_sqe_set_data(sqe, &slot);
+
+	try {
+		ring->Submit();
+	} catch (...) {
+		/* the entry remains in the submission queue and may
+		   be submitted later; we can't reuse this slot */
+		LogError(std::current_exception());
+		free_slots.pop_back();
+		return true;
+	}
+
+	free_slots.pop_back();
+	return true;
+}
+
+#endif
+
+void
+UpdateReadAhead::Add(Path path, uint_least64_t file_size) noexcept
+{
+	if (size == 0 || path.IsNull() || file_size == 0)
+		return;
+
+	const std::size_t nbytes = std::min<uint_least64_t>(file_size, size);
+
+#ifdef HAVE_URING
+	if (ring && SubmitUring(path, nbytes))
+		return;
+#endif
+
+#ifdef POSIX_FADV_WILLNEED
+	try {
+		auto fd = OpenReadOnly(path.c_str());
+		posix_fadvise(fd.Get(), 0, nbytes, POSIX_FADV_WILLNEED);
+	} catch (...) {
+		/* the tag scanner will report this */
+	}
+#else
+	(void)path;
+	(void)nbytes;
+#endif
+}
+
+void
+UpdateReadAhead::Collect() noexcept
+{
+#ifdef HAVE_URING
+	if (ring)
+		while (free_slots.size() < MAX_INFLIGHT && ReapOne(false)) {}
+#endif
+}
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_UPDATE_READ_AHEAD_HXX
+#define MPD_UPDATE_READ_AHEAD_HXX
+
+#include "io/uring/Features.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef HAVE_URING
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <sys/uio.h> // for struct iovec
+
+namespace Uring { class Ring; }
+#endif
+
+class Path;
+
+/**
+ * Reads the beginning (i.e. the headers) of song files in advance,
+ * before their tags get scanned.  Reads for many files are submitted
+ * at once, which allows the kernel to queue and reorder them instead
+ * of waiting for each file's headers in turn; this makes scanning a
+ * cold library on a rotating disk much faster.  The data is
+ * discarded; the goal is to populate the page cache.
+ *
+ * With io_uring, the reads are submitted to a private ring which is
+ * owned by the update thread.  Without it (or if the ring cannot be
+ * created), this falls back to posix_fadvise(POSIX_FADV_WILLNEED).
+ *
+ * This class is not thread-safe; it is only used by the update
+ * thread.
+ */
+class UpdateReadAhead {
+	/**
+	 * The number of bytes to be read from each file; 0 means
+	 * this object is disabled.
+	 */
+	const std::size_t size;
+
+#ifdef HAVE_URING
+	/**
+	 * The maximum number of reads in flight.
+	 */
+	static constexpr std::size_t MAX_INFLIGHT = 32;
+
+	struct Slot {
+		UniqueFileDescriptor fd;
+		std::unique_ptr<std::byte[]> buffer;
+		struct iovec iov;
+	};
+
+	std::unique_ptr<Uring::Ring> ring;
+
+	std::array<Slot, MAX_INFLIGHT> slots;
+
+	/**
+	 * Indexes of #slots which are not in flight.
+	 */
+	std::vector<std::size_t> free_slots;
+#endif
+
+public:
+	/**
+	 * @param _size the number of bytes to be read from each file;
+	 * 0 disables this object
+	 */
+	explicit UpdateReadAhead(std::size_t _size) noexcept;
+
+	/**
+	 * Waits for all reads in flight.
+	 */
+	~UpdateReadAhead() noexcept;
+
+	UpdateReadAhead(const UpdateReadAhead &) = delete;
+	UpdateReadAhead &operator=(const UpdateReadAhead &) = delete;
+
+	/**
+	 * Start reading the beginning of the given file.  Errors are
+	 * ignored silently, because they will be reported by the tag
+	 * scanner anyway.
+	 *
+	 * @param path the local path of the file; nullptr if the
+	 * file is not local (ignored)
+	 * @param file_size the size of the file (obtained while
+	 * walking the directory); nothing is read beyond it
+	 */
+	void Add(Path path, uint_least64_t file_size) noexcept;
+
+	/**
+	 * Release the resources of all reads which have completed
+	 * already.  This does not block.
+	 */
+	void Collect() noexcept;
+
+	/**
+	 * Returns the number of reads which have been submitted to
+	 * io_uring and whose resources have not been released yet
+	 * by Collect().  This is always 0 with the
+	 * posix_fadvise() fallback.
+	 */
+	[[gnu::pure]]
+	std::size_t GetInFlight() const noexcept {
+#ifdef HAVE_URING
+		if (ring)
+			return MAX_INFLIGHT - free_slots.size();
+#endif
+		return 0;
+	}
+
+private:
+#ifdef HAVE_URING
+	bool SubmitUring(Path path, std::size_t nbytes) noexcept;
+
+	/**
+	 * Release the resources of one completed read.
+	 *
+	 * @param wait if true, then wait for a read to complete
+	 * @return false if no read was completed
+	 */
+	bool ReapOne(bool wait) noexcept;
+#endif
+};
+
+#endif
@@ -61,7 +61,7 @@ UpdateService::CancelMount(const char *uri) noexcept
 
 	Directory::LookupResult lr;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseReadLock protect;
 		lr = db.GetRoot().LookupDirectory(uri);
 	}
 
@@ -103,8 +103,8 @@ UpdateService::Task() noexcept
 
 	SetThreadIdlePriority();
 
-	modified = walk->Walk(next.db->GetRoot(), next.path_utf8.c_str(),
-			      next.discard);
+	modified = walk->Walk(next.db->GetRoot(), next.db->GetTagIndex(),
+			      next.path_utf8.c_str(), next.discard);
 
 	if (modified || !next.db->FileExists()) {
 		try {
@@ -162,7 +162,7 @@ UpdateService::Enqueue(std::string_view path, bool discard)
 
 	Directory::LookupResult lr;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseReadLock protect;
 		lr = db.GetRoot().LookupDirectory(path);
 	}
 
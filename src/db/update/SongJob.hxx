@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_UPDATE_SONG_JOB_HXX
+#define MPD_UPDATE_SONG_JOB_HXX
+
+#include "WorkerPool.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "storage/FileInfo.hxx"
+
+#include <atomic>
+#include <exception>
+#include <string>
+
+/**
+ * Scan the tags of one song file in an #UpdateWorkerPool thread.
+ * The result is merged into the #Directory by the update thread
+ * (see UpdateWalk::FinishSongJob()).
+ */
+class UpdateSongJob final : public UpdateJob {
+	Storage &storage;
+
+	const std::atomic_bool &cancel;
+
+public:
+	Directory &directory;
+
+	/**
+	 * The existing #Song object which shall be updated or
+	 * nullptr if this is a new file.  It is only read by the
+	 * update thread.
+	 */
+	Song *const song;
+
+	const std::string name;
+
+	const StorageFileInfo info;
+
+	/**
+	 * The newly loaded song (detached from #directory) or
+	 * nullptr if the file was not recognized.
+	 */
+	SongPtr result;
+
+	std::exception_ptr error;
+
+	/**
+	 * Set if the job was skipped because the update was
+	 * canceled.
+	 */
+	bool canceled = false;
+
+	UpdateSongJob(Storage &_storage, const std::atomic_bool &_cancel,
+		      Directory &_directory, Song *_song,
+		      std::string_view _name,
+		      const StorageFileInfo &_info) noexcept
+		:storage(_storage), cancel(_cancel),
+		 directory(_directory), song(_song),
+		 name(_name), info(_info) {}
+
+protected:
+	/* virtual methods from class UpdateJob */
+	void Run() noexcept override {
+		if (cancel) {
+			canceled = true;
+			return;
+		}
+
+		try {
+			result = Song::LoadFile(storage, name, info, directory);
+		} catch (...) {
+			error = std::current_exception();
+		}
+	}
+};
+
+#endif
@@ -2,6 +2,7 @@
 // Copyright The Music Player Daemon Project
 
 #include "Walk.hxx"
+#include "SongJob.hxx"
 #include "UpdateIO.hxx"
 #include "UpdateDomain.hxx"
 #include "lib/fmt/ExceptionFormatter.hxx"
@@ -10,8 +11,12 @@
 #include "db/plugins/simple/Song.hxx"
 #include "decoder/DecoderList.hxx"
 #include "storage/FileInfo.hxx"
+#include "storage/StorageInterface.hxx"
+#include "fs/AllocatedPath.hxx"
 #include "Log.hxx"
 
+#include <cassert>
+
 #include <unistd.h>
 
 inline void
@@ -21,7 +26,7 @@ UpdateWalk::UpdateSongFile2(Directory &directory,
 try {
 	Song *song;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseReadLock protect;
 		song = directory.FindSong(name);
 	}
 
@@ -41,45 +46,96 @@ try {
 		FmtDebug(update_domain, "reading {}/{}",
 			 directory.GetPath(), name);
 
-		auto new_song = Song::LoadFile(storage, name, info,
-					       directory);
-		if (!new_song) {
+		read_ahead.Add(storage.MapChildFS(directory.GetPath(), name),
+			       info.size);
+		workers.Push(song_jobs.emplace_back(storage, cancel,
+						    directory, nullptr,
+						    name, info));
+	} else if (info.mtime != song->mtime || walk_discard) {
+		FmtNotice(update_domain, "updating {}/{}",
+			  directory.GetPath(), name);
+
+		read_ahead.Add(storage.MapChildFS(directory.GetPath(), name),
+			       info.size);
+		workers.Push(song_jobs.emplace_back(storage, cancel,
+						    directory, song,
+						    name, info));
+	} else {
+		/* not modified */
+		song->mark = true;
+	}
+} catch (...) {
+	FmtError(update_domain,
+		 "error reading file {}/{}: {}",
+		 directory.GetPath(), name, std::current_exception());
+}
+
+void
+UpdateWalk::FinishSongJob(UpdateSongJob &job) noexcept
+{
+	workers.Wait(job);
+
+	Directory &directory = job.directory;
+	Song *song = job.song;
+
+	if (job.canceled) {
+		/* don't let PurgeDeletedFromDirectory() delete songs
+		   which have not been looked at */
+		if (song != nullptr)
+			song->mark = true;
+		return;
+	}
+
+	if (job.error) {
+		FmtError(update_domain,
+			 "error reading file {}/{}: {}",
+			 directory.GetPath(), job.name, job.error);
+		return;
+	}
+
+	if (song == nullptr) {
+		if (!job.result) {
 			FmtDebug(update_domain,
 				 "ignoring unrecognized file {}/{}",
-				 directory.GetPath(), name);
+				 directory.GetPath(), job.name);
 			return;
 		}
 
+		auto &new_song = job.result;
 		new_song->mark = true;
 		new_song->added = std::chrono::system_clock::now();
 
-		{
-			const ScopeDatabaseLock protect;
-			directory.AddSong(std::move(new_song));
-		}
+		editor.LockAddSong(directory, std::move(new_song));
 
 		modified = true;
 		FmtNotice(update_domain, "added {}/{}",
-			  directory.GetPath(), name);
-	} else if (info.mtime != song->mtime || walk_discard) {
-		FmtNotice(update_domain, "updating {}/{}",
-			  directory.GetPath(), name);
-		if (song->UpdateFile(storage, info))
+			  directory.GetPath(), job.name);
+	} else {
+		if (job.result) {
+			const ScopeDatabaseLock protect;
+			editor.UpdateSongTag(*song, std::move(job.result->tag));
+			song->mtime = job.result->mtime;
+			song->audio_format = job.result->audio_format;
 			song->mark = true;
-		else
+		} else
 			FmtDebug(update_domain,
 				 "deleting unrecognized file {}/{}",
-				 directory.GetPath(), name);
+				 directory.GetPath(), job.name);
 
 		modified = true;
-	} else {
-		/* not modified */
-		song->mark = true;
 	}
-} catch (...) {
-	FmtError(update_domain,
-		 "error reading file {}/{}: {}",
-		 directory.GetPath(), name, std::current_exception());
+}
+
+void
+UpdateWalk::FinishSongJobs(std::size_t n_keep) noexcept
+{
+	assert(n_keep <= song_jobs.size());
+
+	while (song_jobs.size() > n_keep) {
+		auto i = std::next(song_jobs.begin(), n_keep);
+		FinishSongJob(*i);
+		song_jobs.erase(i);
+	}
 }
 
 bool
@@ -2,6 +2,7 @@
 // Copyright The Music Player Daemon Project
 
 #include "Walk.hxx"
+#include "SongJob.hxx"
 #include "UpdateIO.hxx"
 #include "Editor.hxx"
 #include "UpdateDomain.hxx"
@@ -35,10 +36,17 @@ UpdateWalk::UpdateWalk(const UpdateConfig &_config,
 		       Storage &_storage) noexcept
 	:config(_config), cancel(false),
 	 storage(_storage),
-	 editor(_loop, _listener)
+	 editor(_loop, _listener),
+	 workers(config.threads - 1),
+	 read_ahead(config.read_ahead)
 {
 }
 
+UpdateWalk::~UpdateWalk() noexcept
+{
+	assert(song_jobs.empty());
+}
+
 static void
 directory_set_stat(Directory &dir, const StorageFileInfo &info)
 {
@@ -347,6 +355,8 @@ UpdateWalk::UpdateDirectory(Directory &directory,
 		return false;
 	}
 
+	const std::size_t n_song_jobs = song_jobs.size();
+
 	ExcludeList child_exclude_list(exclude_list);
 	LoadExcludeListOrLog(storage, directory, child_exclude_list);
 
@@ -380,6 +390,11 @@ UpdateWalk::UpdateDirectory(Directory &directory,
 		UpdateDirectoryChild(directory, child_exclude_list, name_utf8, info2);
 	}
 
+	/* merge the songs scanned by the worker threads in the order
+	   they were found */
+	FinishSongJobs(n_song_jobs);
+	read_ahead.Collect();
+
 	PurgeDeletedFromDirectory(directory);
 
 	directory.mtime = info.mtime;
@@ -395,7 +410,7 @@ UpdateWalk::DirectoryMakeChildChecked(Directory &parent,
 {
 	Directory *directory;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseReadLock protect;
 		directory = parent.FindChild(name_utf8);
 	}
 
@@ -503,8 +518,10 @@ try {
 }
 
 bool
-UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
+UpdateWalk::Walk(Directory &root, TagIndex *tag_index,
+		 const char *path, bool discard) noexcept
 {
+	editor.SetTagIndex(tag_index);
 	walk_discard = discard;
 	modified = false;
 
@@ -526,6 +543,8 @@ UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
 		UpdateDirectory(root, exclude_list, info);
 	}
 
+	FinishSongJobs(0);
+
 	{
 		const ScopeDatabaseLock protect;
 		root.ClearInPlaylist();
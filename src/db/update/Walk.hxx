@@ -6,9 +6,12 @@
 
 #include "Config.hxx"
 #include "Editor.hxx"
+#include "WorkerPool.hxx"
+#include "ReadAhead.hxx"
 #include "config.h"
 
 #include <atomic>
+#include <list>
 #include <string_view>
 
 struct StorageFileInfo;
@@ -19,6 +22,8 @@ class SongEnumerator;
 class ArchiveFile;
 class Storage;
 class ExcludeList;
+class UpdateSongJob;
+class TagIndex;
 
 class UpdateWalk final {
 #ifdef ENABLE_ARCHIVE
@@ -41,11 +46,30 @@ class UpdateWalk final {
 
 	DatabaseEditor editor;
 
+	UpdateWorkerPool workers;
+
+	/**
+	 * Reads the headers of song files before they are submitted
+	 * to #workers.  Only accessed by the update thread.
+	 */
+	UpdateReadAhead read_ahead;
+
+	/**
+	 * Song files which are being scanned by #workers, in the
+	 * order they were found.  Each UpdateDirectory() call
+	 * appends its jobs and finishes them before it returns, so
+	 * this list contains the jobs of the current directory and
+	 * its ancestors.  Only accessed by the update thread.
+	 */
+	std::list<UpdateSongJob> song_jobs;
+
 public:
 	UpdateWalk(const UpdateConfig &_config,
 		   EventLoop &_loop, DatabaseListener &_listener,
 		   Storage &_storage) noexcept;
 
+	~UpdateWalk() noexcept;
+
 	/**
 	 * Cancel the current update and quit the Walk() method as
 	 * soon as possible.
@@ -56,8 +80,12 @@ public:
 
 	/**
 	 * Returns true if the database was modified.
+	 *
+	 * @param tag_index the database's #TagIndex which shall be
+	 * kept in sync (or nullptr)
 	 */
-	bool Walk(Directory &root, const char *path, bool discard) noexcept;
+	bool Walk(Directory &root, TagIndex *tag_index,
+		  const char *path, bool discard) noexcept;
 
 private:
 	[[gnu::pure]]
@@ -82,6 +110,18 @@ private:
 			     std::string_view name, std::string_view suffix,
 			     const StorageFileInfo &info) noexcept;
 
+	/**
+	 * Wait for the given #UpdateSongJob to complete and merge its
+	 * result into its #Directory.
+	 */
+	void FinishSongJob(UpdateSongJob &job) noexcept;
+
+	/**
+	 * Finish all jobs in #song_jobs except for the first
+	 * #n_keep, in the order they were submitted.
+	 */
+	void FinishSongJobs(std::size_t n_keep) noexcept;
+
 	bool UpdateSongFile(Directory &directory,
 			    std::string_view name, std::string_view suffix,
 			    const StorageFileInfo &info) noexcept;
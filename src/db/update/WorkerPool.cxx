@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "WorkerPool.hxx"
+#include "UpdateDomain.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+#include "Log.hxx"
+
+#include <cassert>
+
+UpdateWorkerPool::UpdateWorkerPool(unsigned n_threads) noexcept
+{
+	for (unsigned i = 0; i < n_threads; ++i) {
+		auto &thread = threads.emplace_back(BIND_THIS_METHOD(ThreadFunc));
+
+		try {
+			thread.Start();
+		} catch (...) {
+			threads.pop_back();
+			LogError(std::current_exception(),
+				 "Failed to start update worker thread");
+			break;
+		}
+	}
+}
+
+UpdateWorkerPool::~UpdateWorkerPool() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		assert(queue.empty());
+		quit = true;
+		wake_cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		thread.Join();
+}
+
+void
+UpdateWorkerPool::Push(UpdateJob &job) noexcept
+{
+	const std::scoped_lock lock{mutex};
+	assert(!job.done);
+	queue.push_back(job);
+	wake_cond.notify_one();
+}
+
+void
+UpdateWorkerPool::Wait(UpdateJob &job) noexcept
+{
+	std::unique_lock lock{mutex};
+
+	while (!job.done) {
+		if (queue.empty()) {
+			/* all remaining jobs are being handled by
+			   worker threads */
+			done_cond.wait(lock);
+			continue;
+		}
+
+		/* help the worker threads instead of sleeping */
+		auto &other = queue.pop_front();
+
+		{
+			const ScopeUnlock unlock{mutex};
+			other.Run();
+		}
+
+		other.done = true;
+		done_cond.notify_all();
+	}
+}
+
+inline void
+UpdateWorkerPool::ThreadFunc() noexcept
+{
+	SetThreadName("update_worker");
+	SetThreadIdlePriority();
+
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		if (queue.empty()) {
+			if (quit)
+				break;
+
+			wake_cond.wait(lock);
+			continue;
+		}
+
+		auto &job = queue.pop_front();
+
+		{
+			const ScopeUnlock unlock{mutex};
+			job.Run();
+		}
+
+		job.done = true;
+		done_cond.notify_all();
+	}
+}
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_UPDATE_WORKER_POOL_HXX
+#define MPD_UPDATE_WORKER_POOL_HXX
+
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <list>
+
+/**
+ * A job which can be submitted to an #UpdateWorkerPool.
+ */
+class UpdateJob : public IntrusiveListHook<> {
+	friend class UpdateWorkerPool;
+
+	/**
+	 * Set to true by the #UpdateWorkerPool after Run() has
+	 * returned.  Protected by UpdateWorkerPool::mutex.
+	 */
+	bool done = false;
+
+public:
+	UpdateJob() noexcept = default;
+	UpdateJob(const UpdateJob &) = delete;
+	UpdateJob &operator=(const UpdateJob &) = delete;
+
+protected:
+	~UpdateJob() noexcept = default;
+
+	/**
+	 * Do the work.  This may be called in any thread and without
+	 * holding any lock.
+	 */
+	virtual void Run() noexcept = 0;
+};
+
+/**
+ * A pool of threads which run #UpdateJob instances on behalf of the
+ * update thread.  The update thread itself participates while it
+ * waits for a job to complete, therefore a pool without threads
+ * simply runs all jobs in the update thread.
+ */
+class UpdateWorkerPool final {
+	Mutex mutex;
+
+	/**
+	 * Signalled when a new job has been queued or when the
+	 * threads shall quit.
+	 */
+	Cond wake_cond;
+
+	/**
+	 * Signalled when a job has completed.
+	 */
+	Cond done_cond;
+
+	IntrusiveList<UpdateJob> queue;
+
+	std::list<Thread> threads;
+
+	bool quit = false;
+
+public:
+	/**
+	 * @param n_threads the number of worker threads to be
+	 * launched; failures to launch a thread are logged and
+	 * ignored
+	 */
+	explicit UpdateWorkerPool(unsigned n_threads) noexcept;
+
+	/**
+	 * Stops and joins all threads.  All jobs must have been
+	 * completed (see Wait()).
+	 */
+	~UpdateWorkerPool() noexcept;
+
+	UpdateWorkerPool(const UpdateWorkerPool &) = delete;
+	UpdateWorkerPool &operator=(const UpdateWorkerPool &) = delete;
+
+	/**
+	 * Submit a job.  The caller must not touch the object until
+	 * Wait() has returned.
+	 */
+	void Push(UpdateJob &job) noexcept;
+
+	/**
+	 * Wait until the given job has completed.  While waiting,
+	 * other queued jobs are run in the calling thread.
+	 */
+	void Wait(UpdateJob &job) noexcept;
+
+private:
+	void ThreadFunc() noexcept;
+};
+
+#endif
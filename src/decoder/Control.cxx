@@ -2,6 +2,7 @@
 // Copyright The Music Player Daemon Project
 
 #include "Control.hxx"
+#include "MusicBuffer.hxx"
 #include "MusicPipe.hxx"
 #include "song/DetachedSong.hxx"
 
@@ -36,6 +37,11 @@ DecoderControl::SetReady(const AudioFormat audio_format,
 	in_audio_format = audio_format;
 	out_audio_format = audio_format.WithMask(configured_audio_format);
 
+	/* now that the audio format is known, the buffer may choose
+	   a suitable chunk size (unless there are still chunks of
+	   the previous song) */
+	buffer->Adapt(out_audio_format);
+
 	seekable = _seekable;
 	total_time = _duration;
 
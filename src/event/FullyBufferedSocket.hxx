@@ -60,6 +60,14 @@ protected:
 
 	void OnIdle() noexcept;
 
+	/**
+	 * The output buffer has been flushed completely.  This may be
+	 * used to generate more output on demand.  The method must not
+	 * write or close the socket; it should schedule that for
+	 * later.
+	 */
+	virtual void OnSocketDrained() noexcept {}
+
 	/* virtual methods from class BufferedSocket */
 	void OnSocketReady(unsigned flags) noexcept override;
 };
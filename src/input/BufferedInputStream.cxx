@@ -19,6 +19,8 @@ BufferedInputStream::BufferedInputStream(InputStreamPtr _input)
 	InputStream::offset = GetInput().GetOffset();
 
 	SetReady();
+
+	BufferingInputStream::Start();
 }
 
 void
@@ -21,6 +21,10 @@ class BufferedInputStream final : public InputStream, BufferingInputStream {
 public:
 	BufferedInputStream(InputStreamPtr _input);
 
+	~BufferedInputStream() noexcept override {
+		BufferingInputStream::Stop();
+	}
+
 	/**
 	 * Check whether the given #InputStream can be used as input
 	 * for this class.
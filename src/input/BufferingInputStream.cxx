@@ -16,12 +16,25 @@ BufferingInputStream::BufferingInputStream(InputStreamPtr _input)
 	input->SetHandler(this);
 
 	buffer.SetName("InputCache");
+}
+
+BufferingInputStream::~BufferingInputStream() noexcept
+{
+	Stop();
+}
 
+void
+BufferingInputStream::Start()
+{
 	thread.Start();
 }
 
-BufferingInputStream::~BufferingInputStream() noexcept
+void
+BufferingInputStream::Stop() noexcept
 {
+	if (!thread.IsDefined())
+		return;
+
 	{
 		const std::scoped_lock<Mutex> lock(mutex);
 		stop = true;
@@ -51,12 +64,24 @@ BufferingInputStream::IsAvailable(size_t offset) const noexcept
 		return true;
 
 	/* if no data is available now, make sure it will be soon */
-	if (want_offset == INVALID_OFFSET)
+	if (want_offset == INVALID_OFFSET) {
 		want_offset = offset;
+		wake_cond.notify_one();
+	}
 
 	return false;
 }
 
+std::span<const uint8_t>
+BufferingInputStream::GetCompleteBuffer() const noexcept
+{
+	auto r = buffer.Read(0);
+	if (r.undefined_size > 0 || r.defined_buffer.size() < size())
+		return {};
+
+	return r.defined_buffer;
+}
+
 size_t
 BufferingInputStream::Read(std::unique_lock<Mutex> &lock, size_t offset,
 			   void *ptr, size_t s)
@@ -76,8 +101,10 @@ BufferingInputStream::Read(std::unique_lock<Mutex> &lock, size_t offset,
 		if (error)
 			std::rethrow_exception(error);
 
-		if (want_offset == INVALID_OFFSET)
+		if (want_offset == INVALID_OFFSET) {
 			want_offset = offset;
+			wake_cond.notify_one();
+		}
 
 		client_cond.wait(lock);
 	}
@@ -155,6 +182,11 @@ BufferingInputStream::RunThreadLocked(std::unique_lock<Mutex> &lock)
 
 			client_cond.notify_all();
 			OnBufferAvailable();
+
+			if (const auto delay = OnBufferRead(nbytes);
+			    delay > std::chrono::steady_clock::duration::zero() &&
+			    want_offset == INVALID_OFFSET)
+				wake_cond.wait_for(lock, delay);
 		} else
 			wake_cond.wait(lock);
 	}
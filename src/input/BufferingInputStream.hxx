@@ -11,7 +11,9 @@
 #include "thread/Cond.hxx"
 #include "util/SparseBuffer.hxx"
 
+#include <chrono>
 #include <exception>
+#include <span>
 
 /**
  * A "huge" buffer which remembers the (partial) contents of an
@@ -31,8 +33,11 @@ private:
 	 * This #Cond wakes up the #Thread.  It is used by both the
 	 * "client" thread (to submit commands) and #input's handler
 	 * (to notify new data being available).
+	 *
+	 * It is mutable because IsAvailable() may need to interrupt
+	 * the delay requested by OnBufferRead().
 	 */
-	Cond wake_cond;
+	mutable Cond wake_cond;
 
 	/**
 	 * This #Cond wakes up the client upon command completion.
@@ -53,8 +58,8 @@ private:
 
 public:
 	/**
-	 * Allocate a buffer which fits the given #InputStream and
-	 * start a thread reading into the buffer.
+	 * Allocate a buffer which fits the given #InputStream.  Call
+	 * Start() to start reading into the buffer.
 	 *
 	 * Throws on error.
 	 *
@@ -62,8 +67,21 @@ public:
 	 */
 	explicit BufferingInputStream(InputStreamPtr _input);
 
+	/**
+	 * Calls Stop().
+	 */
 	~BufferingInputStream() noexcept;
 
+	/**
+	 * Start a thread reading into the buffer.  This is not done
+	 * by the constructor, because the thread invokes the virtual
+	 * methods, which must not happen before the derived class
+	 * has been constructed completely.
+	 *
+	 * Throws on error.
+	 */
+	void Start();
+
 	/**
 	 * Caller must lock the mutex.
 	 */
@@ -90,6 +108,28 @@ public:
 	 */
 	bool IsAvailable(size_t offset) const noexcept;
 
+	/**
+	 * Has the file been read completely, or has an error
+	 * occurred?
+	 *
+	 * Caller must lock the mutex.
+	 */
+	[[gnu::pure]]
+	bool IsFinished() const noexcept {
+		return error || !GetCompleteBuffer().empty();
+	}
+
+	/**
+	 * Returns the whole buffer if the file has been read
+	 * completely, or an empty span if not (yet).  After the file
+	 * has been read completely, the buffer is never modified
+	 * again.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	[[gnu::pure]]
+	std::span<const uint8_t> GetCompleteBuffer() const noexcept;
+
 	/**
 	 * Copy data from the buffer into the given pointer.
 	 *
@@ -99,6 +139,13 @@ public:
 		    void *ptr, size_t size);
 
 protected:
+	/**
+	 * Stop the thread and wait for it to exit.  A derived class
+	 * which overrides virtual methods must call this in its
+	 * destructor.
+	 */
+	void Stop() noexcept;
+
 	/**
 	 * This virtual method gets called each time data has been
 	 * added to the buffer.  During this method call, the mutex is
@@ -106,6 +153,17 @@ protected:
 	 */
 	virtual void OnBufferAvailable() noexcept {}
 
+	/**
+	 * This virtual method gets called each time data has been
+	 * read from the input.  It may return a duration which the
+	 * thread shall wait before reading more data (unless a client
+	 * is waiting for data); this can be used to limit the
+	 * bandwidth.  During this method call, the mutex is locked.
+	 */
+	virtual std::chrono::steady_clock::duration OnBufferRead([[maybe_unused]] std::size_t nbytes) noexcept {
+		return {};
+	}
+
 private:
 	size_t FindFirstHole() const noexcept;
 
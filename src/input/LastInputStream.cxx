@@ -18,7 +18,9 @@ LastInputStream::Close() noexcept
 {
 	uri.clear();
 	is.reset();
-	close_timer.Cancel();
+
+	if (!suspended)
+		close_timer.Cancel();
 }
 
 void
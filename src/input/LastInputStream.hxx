@@ -16,7 +16,8 @@
  * automatically after some time.
  *
  * This class is not thread-safe.  All methods must be called on the
- * thread which runs the #EventLoop.
+ * thread which runs the #EventLoop, except for Open() while
+ * suspended (see Suspend()).
  */
 class LastInputStream {
 	std::string uri;
@@ -27,6 +28,12 @@ class LastInputStream {
 
 	CoarseTimerEvent close_timer;
 
+	/**
+	 * If true, then the #InputStream is not closed automatically,
+	 * and Open() does not touch #close_timer.
+	 */
+	bool suspended = false;
+
 public:
 	explicit LastInputStream(EventLoop &event_loop) noexcept;
 	~LastInputStream() noexcept;
@@ -41,7 +48,7 @@ public:
 	template<typename U, typename O>
 	InputStream *Open(U &&new_uri, O &&open) {
 		if (new_uri == uri) {
-			if (is)
+			if (is && !suspended)
 				/* refresh the timeout */
 				ScheduleClose();
 
@@ -52,13 +59,32 @@ public:
 
 		is = open(new_uri, mutex);
 		uri = std::forward<U>(new_uri);
-		if (is)
+		if (is && !suspended)
 			ScheduleClose();
 		return is.get();
 	}
 
 	void Close() noexcept;
 
+	/**
+	 * Stop the timer which closes the #InputStream, to allow
+	 * another thread to call Open() and use the #InputStream
+	 * until Resume() is called.
+	 */
+	void Suspend() noexcept {
+		close_timer.Cancel();
+		suspended = true;
+	}
+
+	/**
+	 * Undo Suspend().
+	 */
+	void Resume() noexcept {
+		suspended = false;
+		if (is)
+			ScheduleClose();
+	}
+
 private:
 	void ScheduleClose() noexcept {
 		close_timer.Schedule(std::chrono::seconds(20));
@@ -0,0 +1,302 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Chunks.hxx"
+#include "input/InputStream.hxx"
+#include "thread/Name.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include <string.h>
+
+InputCacheChunks::InputCacheChunks(InputStreamPtr _input,
+				   std::size_t _max_chunks)
+	:input(std::move(_input)),
+	 mutex(input->mutex),
+	 file_size(input->GetSize()),
+	 n_chunks((file_size + CHUNK_SIZE - 1) / CHUNK_SIZE),
+	 max_chunks(_max_chunks),
+	 /* leave room for the two pinned chunks, the chunk before
+	    the playhead and the playhead chunk itself, and split the
+	    rest between read-ahead and recently used chunks */
+	 read_ahead((max_chunks - 4) / 2),
+	 thread(BIND_THIS_METHOD(RunThread))
+{
+	assert(input);
+	assert(input->IsReady());
+	assert(input->IsSeekable());
+	assert(input->KnownSize());
+	assert(max_chunks >= MIN_CHUNKS);
+
+	input->SetHandler(this);
+}
+
+InputCacheChunks::~InputCacheChunks() noexcept
+{
+	Stop();
+}
+
+void
+InputCacheChunks::Start()
+{
+	thread.Start();
+}
+
+void
+InputCacheChunks::Stop() noexcept
+{
+	if (!thread.IsDefined())
+		return;
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		stop = true;
+		wake_cond.notify_one();
+	}
+
+	thread.Join();
+}
+
+void
+InputCacheChunks::Check()
+{
+	if (error)
+		std::rethrow_exception(error);
+
+	if (input)
+		input->Check();
+}
+
+bool
+InputCacheChunks::IsChunkComplete(std::size_t index) const noexcept
+{
+	auto i = chunks.find(index);
+	return i != chunks.end() && i->second.fill >= GetChunkLength(index);
+}
+
+bool
+InputCacheChunks::IsProtected(std::size_t index) const noexcept
+{
+	if (index == 0 || index == n_chunks - 1)
+		/* headers, seek tables and tags */
+		return true;
+
+	if (want_offset != INVALID_OFFSET && index == want_offset / CHUNK_SIZE)
+		return true;
+
+	return index + 1 >= playhead && index <= playhead + read_ahead;
+}
+
+std::size_t
+InputCacheChunks::FindNextChunk() const noexcept
+{
+	if (want_offset != INVALID_OFFSET)
+		return want_offset / CHUNK_SIZE;
+
+	if (!IsChunkComplete(0))
+		return 0;
+
+	if (!IsChunkComplete(n_chunks - 1))
+		return n_chunks - 1;
+
+	const std::size_t end = std::min(playhead + read_ahead + 1, n_chunks);
+	for (std::size_t i = playhead; i < end; ++i)
+		if (!IsChunkComplete(i))
+			return i;
+
+	return INVALID_OFFSET;
+}
+
+bool
+InputCacheChunks::IsFinished() const noexcept
+{
+	return error || FindNextChunk() == INVALID_OFFSET;
+}
+
+inline InputCacheChunks::Chunk *
+InputCacheChunks::Touch(std::size_t index) noexcept
+{
+	auto i = chunks.find(index);
+	if (i == chunks.end())
+		return nullptr;
+
+	auto &chunk = i->second;
+	lru.erase(lru.iterator_to(chunk));
+	lru.push_back(chunk);
+	return &chunk;
+}
+
+inline InputCacheChunks::Chunk *
+InputCacheChunks::Allocate(std::size_t index)
+{
+	if (auto *chunk = Touch(index))
+		return chunk;
+
+	if (chunks.size() >= max_chunks) {
+		auto victim = std::find_if(lru.begin(), lru.end(),
+					   [this](const Chunk &chunk){
+						   return !IsProtected(chunk.index);
+					   });
+		if (victim == lru.end())
+			return nullptr;
+
+		const std::size_t victim_index = victim->index;
+		lru.erase(victim);
+		chunks.erase(victim_index);
+	}
+
+	auto &chunk = chunks.emplace(std::piecewise_construct,
+				     std::forward_as_tuple(index),
+				     std::forward_as_tuple(index)).first->second;
+	lru.push_back(chunk);
+	return &chunk;
+}
+
+bool
+InputCacheChunks::IsAvailable(std::size_t offset) const noexcept
+{
+	if (offset >= file_size || error)
+		return true;
+
+	const std::size_t index = offset / CHUNK_SIZE;
+	playhead = index;
+
+	if (auto i = chunks.find(index);
+	    i != chunks.end() && i->second.fill > offset % CHUNK_SIZE)
+		return true;
+
+	/* if no data is available now, make sure it will be soon */
+	if (want_offset == INVALID_OFFSET) {
+		want_offset = offset;
+		wake_cond.notify_one();
+	}
+
+	return false;
+}
+
+std::size_t
+InputCacheChunks::Read(std::unique_lock<Mutex> &lock, std::size_t offset,
+		       void *ptr, std::size_t s)
+{
+	if (offset >= file_size)
+		return 0;
+
+	const std::size_t index = offset / CHUNK_SIZE;
+	const std::size_t chunk_offset = offset % CHUNK_SIZE;
+
+	if (playhead != index) {
+		/* the read-ahead window has moved */
+		playhead = index;
+		wake_cond.notify_one();
+	}
+
+	while (true) {
+		if (const auto *chunk = Touch(index);
+		    chunk != nullptr && chunk->fill > chunk_offset) {
+			/* yay, we have some data */
+			const std::size_t nbytes =
+				std::min(s, chunk->fill - chunk_offset);
+			memcpy(ptr, chunk->data.get() + chunk_offset, nbytes);
+			return nbytes;
+		}
+
+		if (error)
+			std::rethrow_exception(error);
+
+		if (want_offset == INVALID_OFFSET) {
+			want_offset = offset;
+			wake_cond.notify_one();
+		}
+
+		client_cond.wait(lock);
+	}
+}
+
+inline void
+InputCacheChunks::RunThreadLocked(std::unique_lock<Mutex> &lock)
+{
+	while (!stop) {
+		const std::size_t index = FindNextChunk();
+		if (index == INVALID_OFFSET) {
+			wake_cond.wait(lock);
+			continue;
+		}
+
+		if (!input->IsAvailable()) {
+			wake_cond.wait(lock);
+			continue;
+		}
+
+		auto *chunk = Allocate(index);
+		if (chunk == nullptr) {
+			/* all chunks are protected; wait until the
+			   playhead moves */
+			wake_cond.wait(lock);
+			continue;
+		}
+
+		const std::size_t length = GetChunkLength(index);
+		if (chunk->fill >= length) {
+			/* another client's request has already been
+			   fulfilled */
+			want_offset = INVALID_OFFSET;
+			continue;
+		}
+
+		const std::size_t read_offset = index * CHUNK_SIZE + chunk->fill;
+		if (input->GetOffset() != offset_type(read_offset))
+			input->Seek(lock, read_offset);
+
+		/* see BufferingInputStream::RunThreadLocked() */
+		constexpr std::size_t MAX_READ = 64 * 1024;
+
+		const std::size_t nbytes =
+			input->Read(lock, chunk->data.get() + chunk->fill,
+				    std::min(length - chunk->fill, MAX_READ));
+		if (nbytes == 0)
+			throw std::runtime_error("Premature end of file");
+
+		chunk->fill += nbytes;
+
+		if (want_offset != INVALID_OFFSET &&
+		    want_offset / CHUNK_SIZE == index &&
+		    want_offset % CHUNK_SIZE < chunk->fill)
+			want_offset = INVALID_OFFSET;
+
+		client_cond.notify_all();
+		OnBufferAvailable();
+
+		if (const auto delay = OnBufferRead(nbytes);
+		    delay > std::chrono::steady_clock::duration::zero() &&
+		    want_offset == INVALID_OFFSET)
+			wake_cond.wait_for(lock, delay);
+	}
+}
+
+void
+InputCacheChunks::RunThread() noexcept
+{
+	SetThreadName("input_chunks");
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	try {
+		RunThreadLocked(lock);
+	} catch (...) {
+		error = std::current_exception();
+		client_cond.notify_all();
+		OnBufferAvailable();
+	}
+
+	/* clear the "input" attribute while holding the mutex */
+	auto _input = std::move(input);
+
+	/* the mutex must be unlocked while an InputStream can be
+	   destructed */
+	lock.unlock();
+
+	/* and now actually destruct the InputStream */
+	_input.reset();
+}
@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_INPUT_CACHE_CHUNKS_HXX
+#define MPD_INPUT_CACHE_CHUNKS_HXX
+
+#include "input/Ptr.hxx"
+#include "input/Handler.hxx"
+#include "thread/Thread.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <memory>
+
+/**
+ * Like #BufferingInputStream, but keeps only some fixed-size chunks
+ * of a file in RAM.  This is used for files which are too large to
+ * be cached completely.
+ *
+ * The first and the last chunk (which usually contain headers, seek
+ * tables and tags) are always kept, and so is a window around the
+ * most recent read position ("playhead") which is read ahead by a
+ * separate thread.  Other chunks are evicted when the given limit is
+ * reached, the least recently used one first.
+ */
+class InputCacheChunks : InputStreamHandler {
+public:
+	static constexpr std::size_t CHUNK_SIZE = 256 * 1024;
+
+	/**
+	 * The smallest number of chunks which allows keeping the
+	 * pinned chunks and a read-ahead window.
+	 */
+	static constexpr std::size_t MIN_CHUNKS = 8;
+
+private:
+	InputStreamPtr input;
+
+public:
+	Mutex &mutex;
+
+private:
+	struct Chunk final : IntrusiveListHook<> {
+		const std::size_t index;
+
+		const std::unique_ptr<std::byte[]> data;
+
+		/**
+		 * The number of bytes at the beginning of #data which
+		 * have been read already.
+		 */
+		std::size_t fill = 0;
+
+		explicit Chunk(std::size_t _index)
+			:index(_index), data(new std::byte[CHUNK_SIZE]) {}
+	};
+
+	/**
+	 * The file size.
+	 */
+	const std::size_t file_size;
+
+	/**
+	 * The number of chunks of the file.
+	 */
+	const std::size_t n_chunks;
+
+	/**
+	 * The maximum number of chunks kept in RAM.
+	 */
+	const std::size_t max_chunks;
+
+	/**
+	 * The number of chunks after the playhead which are read
+	 * ahead.
+	 */
+	const std::size_t read_ahead;
+
+	Thread thread;
+
+	/**
+	 * This #Cond wakes up the #Thread.
+	 */
+	mutable Cond wake_cond;
+
+	/**
+	 * This #Cond wakes up clients waiting in Read().
+	 */
+	Cond client_cond;
+
+	/**
+	 * All chunks in RAM, indexed by their number.
+	 */
+	std::map<std::size_t, Chunk> chunks;
+
+	/**
+	 * All chunks in RAM, the least recently used one first.
+	 */
+	IntrusiveList<Chunk> lru;
+
+	/**
+	 * The index of the chunk which was read most recently.
+	 * Mutable because IsAvailable() updates it.
+	 */
+	mutable std::size_t playhead = 0;
+
+	/* must be mutable because IsAvailable() acts as a hint to
+	   modify this attribute */
+	mutable std::size_t want_offset = INVALID_OFFSET;
+
+	bool stop = false;
+
+	std::exception_ptr error;
+
+	static constexpr std::size_t INVALID_OFFSET = ~std::size_t(0);
+
+public:
+	/**
+	 * Call Start() to start reading chunks of the given
+	 * #InputStream.
+	 *
+	 * @param _input a seekable #InputStream with a known size
+	 * @param _max_chunks the maximum number of chunks kept in
+	 * RAM; must be at least #MIN_CHUNKS
+	 */
+	InputCacheChunks(InputStreamPtr _input, std::size_t _max_chunks);
+
+	/**
+	 * Calls Stop().
+	 */
+	~InputCacheChunks() noexcept;
+
+	/**
+	 * Start the thread.  Same as BufferingInputStream::Start().
+	 *
+	 * Throws on error.
+	 */
+	void Start();
+
+	std::size_t size() const noexcept {
+		return file_size;
+	}
+
+	/**
+	 * The maximum amount of memory occupied by this object.
+	 */
+	std::size_t GetMaxResidentSize() const noexcept {
+		return max_chunks * CHUNK_SIZE;
+	}
+
+	/**
+	 * The amount of memory currently occupied by this object.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	std::size_t GetResidentSize() const noexcept {
+		return chunks.size() * CHUNK_SIZE;
+	}
+
+	/**
+	 * Wrapper for InputStream::Check().
+	 *
+	 * Throws on error.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void Check();
+
+	/**
+	 * Check whether data is available at the given offset.  If
+	 * not, the thread is asked to read it as soon as possible.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	bool IsAvailable(std::size_t offset) const noexcept;
+
+	/**
+	 * Have the pinned chunks and the read-ahead window been read
+	 * completely, or has an error occurred?
+	 *
+	 * Caller must lock the mutex.
+	 */
+	[[gnu::pure]]
+	bool IsFinished() const noexcept;
+
+	/**
+	 * Copy data into the given pointer, waiting until it has been
+	 * read.
+	 *
+	 * Caller must lock the mutex.
+	 *
+	 * @return the number of bytes copied into the given pointer.
+	 */
+	std::size_t Read(std::unique_lock<Mutex> &lock, std::size_t offset,
+			 void *ptr, std::size_t size);
+
+protected:
+	/**
+	 * Same as BufferingInputStream::Stop().
+	 */
+	void Stop() noexcept;
+
+	/**
+	 * This virtual method gets called after some data has been
+	 * read into a chunk.  During this method call, the mutex is
+	 * locked.
+	 */
+	virtual void OnBufferAvailable() noexcept {}
+
+	/**
+	 * Same as BufferingInputStream::OnBufferRead().
+	 */
+	virtual std::chrono::steady_clock::duration OnBufferRead([[maybe_unused]] std::size_t nbytes) noexcept {
+		return {};
+	}
+
+private:
+	std::size_t GetChunkLength(std::size_t index) const noexcept {
+		return std::min(file_size - index * CHUNK_SIZE, CHUNK_SIZE);
+	}
+
+	[[gnu::pure]]
+	bool IsChunkComplete(std::size_t index) const noexcept;
+
+	/**
+	 * Shall this chunk be kept in RAM?
+	 */
+	[[gnu::pure]]
+	bool IsProtected(std::size_t index) const noexcept;
+
+	/**
+	 * Determine which chunk shall be read next.
+	 *
+	 * @return the chunk index or #INVALID_OFFSET if there is
+	 * nothing to do
+	 */
+	[[gnu::pure]]
+	std::size_t FindNextChunk() const noexcept;
+
+	/**
+	 * Look up a chunk and mark it as "recently used".
+	 */
+	Chunk *Touch(std::size_t index) noexcept;
+
+	/**
+	 * Return the given chunk, allocating it (and evicting an old
+	 * one) if necessary.
+	 *
+	 * @return nullptr if no chunk could be evicted
+	 */
+	Chunk *Allocate(std::size_t index);
+
+	void RunThreadLocked(std::unique_lock<Mutex> &lock);
+	void RunThread() noexcept;
+
+	/* virtual methods from class InputStreamHandler */
+	void OnInputStreamReady() noexcept final {
+		/* this should never be called, because our input must
+		   be "ready" already */
+	}
+
+	void OnInputStreamAvailable() noexcept final {
+		wake_cond.notify_one();
+	}
+};
+
+#endif
@@ -7,6 +7,7 @@
 
 static constexpr size_t KILOBYTE = 1024;
 static constexpr size_t MEGABYTE = 1024 * KILOBYTE;
+static constexpr uint_least64_t GIGABYTE = 1024 * MEGABYTE;
 
 InputCacheConfig::InputCacheConfig(const ConfigBlock &block)
 {
@@ -16,4 +17,30 @@ InputCacheConfig::InputCacheConfig(const ConfigBlock &block)
 		size = size_param->With([](const char *s){
 			return ParseSize(s);
 		});
+
+	disk_path = block.GetPath("disk_path");
+
+	disk_size = 4 * GIGABYTE;
+	const auto *disk_size_param = block.GetBlockParam("disk_size");
+	if (disk_size_param != nullptr)
+		disk_size = disk_size_param->With([](const char *s){
+			return ParseSize(s);
+		});
+
+	prefetch_depth = block.GetBlockValue("prefetch_depth", 1U);
+	prefetch_threads = block.GetPositiveValue("prefetch_threads", 1U);
+
+	prefetch_bandwidth = 0;
+	const auto *bandwidth_param = block.GetBlockParam("prefetch_bandwidth");
+	if (bandwidth_param != nullptr)
+		prefetch_bandwidth = bandwidth_param->With([](const char *s){
+			return ParseSize(s);
+		});
+
+	partial_size = 32 * MEGABYTE;
+	const auto *partial_size_param = block.GetBlockParam("partial_size");
+	if (partial_size_param != nullptr)
+		partial_size = partial_size_param->With([](const char *s){
+			return ParseSize(s);
+		});
 }
@@ -4,13 +4,47 @@
 #ifndef MPD_INPUT_CACHE_CONFIG_HXX
 #define MPD_INPUT_CACHE_CONFIG_HXX
 
+#include "fs/AllocatedPath.hxx"
+
 #include <cstddef>
+#include <cstdint>
 
 struct ConfigBlock;
 
 struct InputCacheConfig {
 	size_t size;
 
+	/**
+	 * The directory of the #InputCacheDisk; nullptr if the disk
+	 * tier is disabled.
+	 */
+	AllocatedPath disk_path = nullptr;
+
+	uint_least64_t disk_size;
+
+	/**
+	 * The number of upcoming songs to be prefetched.
+	 */
+	unsigned prefetch_depth;
+
+	/**
+	 * The maximum number of files to be prefetched concurrently.
+	 */
+	unsigned prefetch_threads;
+
+	/**
+	 * The maximum transfer rate of all prefetches [bytes per
+	 * second]; 0 means unlimited.  This does not apply to files
+	 * which are being played.
+	 */
+	size_t prefetch_bandwidth;
+
+	/**
+	 * The maximum amount of RAM for each file which is too large
+	 * to be cached completely; 0 disables caching such files.
+	 */
+	size_t partial_size;
+
 	explicit InputCacheConfig(const ConfigBlock &block);
 };
 
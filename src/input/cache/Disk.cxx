@@ -0,0 +1,344 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Disk.hxx"
+#include "fs/DirectoryReader.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/Path.hxx"
+#include "io/FileOutputStream.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "lib/fmt/PathFormatter.hxx"
+#include "util/DeleteDisposer.hxx"
+#include "util/Domain.hxx"
+#include "util/HexFormat.hxx"
+#include "util/NumberParser.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+static constexpr Domain input_cache_disk_domain("input_cache_disk");
+
+/**
+ * The binary header at the beginning of each file.  It is followed
+ * by the URI (not null-terminated); the contents of the original file
+ * begin at #InputCacheDisk::HEADER_SIZE.
+ *
+ * The integers are in host byte order; the files are not meant to be
+ * portable.
+ */
+struct InputCacheDiskHeader {
+	static constexpr std::array<char, 8> MAGIC{
+		'M', 'P', 'D', 'c', 'a', 'c', 'h', '1',
+	};
+
+	std::array<char, 8> magic;
+
+	/**
+	 * The size of the original file.
+	 */
+	uint64_t size;
+
+	/**
+	 * The modification time of the original file [ns since the
+	 * epoch].
+	 */
+	int64_t mtime;
+
+	uint32_t uri_length;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(InputCacheDiskHeader) < InputCacheDisk::HEADER_SIZE);
+
+static constexpr std::size_t MAX_URI_LENGTH =
+	InputCacheDisk::HEADER_SIZE - sizeof(InputCacheDiskHeader);
+
+/**
+ * Calculate the 64 bit hash which names the file for the given URI:
+ * FNV-1a, followed by a finalizer (from MurmurHash3) which spreads
+ * the bits of similar URIs (e.g. files in the same directory) over
+ * the whole value.
+ */
+[[gnu::pure]]
+static uint_least64_t
+HashUri(std::string_view uri) noexcept
+{
+	uint_least64_t hash = 0xcbf29ce484222325ULL;
+	for (const char ch : uri) {
+		hash ^= static_cast<unsigned char>(ch);
+		hash *= 0x100000001b3ULL;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+static int64_t
+ExportTime(std::chrono::system_clock::time_point t) noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+static const InputCacheDiskHeader &
+GetHeader(const MappedFile &file) noexcept
+{
+	return *(const InputCacheDiskHeader *)(const void *)file.GetData().data();
+}
+
+InputCacheMapping::InputCacheMapping(Path path)
+	:file(path)
+{
+	const auto raw = file.GetData();
+	if (raw.size() < InputCacheDisk::HEADER_SIZE)
+		throw std::runtime_error("Cache file is too small");
+
+	const auto &header = GetHeader(file);
+	if (header.magic != InputCacheDiskHeader::MAGIC ||
+	    header.uri_length > MAX_URI_LENGTH)
+		throw std::runtime_error("Malformed cache file header");
+
+	if (header.size != raw.size() - InputCacheDisk::HEADER_SIZE)
+		throw std::runtime_error("Cache file is truncated");
+
+	data = raw.subspan(InputCacheDisk::HEADER_SIZE);
+}
+
+std::string_view
+InputCacheMapping::GetUri() const noexcept
+{
+	const auto &header = GetHeader(file);
+	return {(const char *)(&header + 1), header.uri_length};
+}
+
+std::chrono::system_clock::time_point
+InputCacheMapping::GetModificationTime() const noexcept
+{
+	const std::chrono::nanoseconds d{GetHeader(file).mtime};
+	return std::chrono::system_clock::time_point{
+		std::chrono::duration_cast<std::chrono::system_clock::duration>(d),
+	};
+}
+
+InputCacheDisk::InputCacheDisk(AllocatedPath &&_directory,
+			       uint_least64_t _max_total_size) noexcept
+	:directory(std::move(_directory)),
+	 max_total_size(_max_total_size)
+{
+	CreateDirectoryNoThrow(directory);
+}
+
+InputCacheDisk::~InputCacheDisk() noexcept
+{
+	entries_by_time.clear_and_dispose(DeleteDisposer{});
+}
+
+AllocatedPath
+InputCacheDisk::MakePath(uint_least64_t hash) const noexcept
+{
+	char name[16];
+	HexFormatUint64Fixed(name, hash);
+	return directory / AllocatedPath::FromUTF8(std::string_view{name, sizeof(name)});
+}
+
+inline void
+InputCacheDisk::Insert(uint_least64_t hash, uint_least64_t size) noexcept
+{
+	auto *entry = new Entry(hash, size);
+	entries_by_time.push_back(*entry);
+	entries_by_hash.insert(*entry);
+	total_size += size;
+}
+
+inline void
+InputCacheDisk::Remove(Entry &entry) noexcept
+{
+	assert(total_size >= entry.size);
+	total_size -= entry.size;
+
+	entries_by_time.erase(entries_by_time.iterator_to(entry));
+	entries_by_hash.erase(entries_by_hash.iterator_to(entry));
+}
+
+void
+InputCacheDisk::Delete(Entry &entry) noexcept
+{
+	try {
+		RemoveFile(MakePath(entry.hash));
+	} catch (...) {
+		LogError(std::current_exception());
+	}
+
+	Remove(entry);
+	delete &entry;
+}
+
+void
+InputCacheDisk::Shrink() noexcept
+{
+	while (total_size > max_total_size && !entries_by_time.empty())
+		Delete(entries_by_time.front());
+}
+
+void
+InputCacheDisk::Load()
+{
+	/* (modification time, hash, size) */
+	std::vector<std::tuple<std::chrono::system_clock::time_point,
+			       uint_least64_t, uint_least64_t>> found;
+
+	DirectoryReader reader{directory};
+	while (reader.ReadEntry()) {
+		const auto name = reader.GetEntry().ToUTF8();
+		if (name.size() != 16)
+			continue;
+
+		const auto hash = ParseInteger<uint64_t>(name, 16);
+		if (!hash)
+			continue;
+
+		FileInfo info;
+		if (!GetFileInfo(directory / reader.GetEntry(), info, false) ||
+		    !info.IsRegular())
+			continue;
+
+		found.emplace_back(info.GetModificationTime(),
+				   *hash, info.GetSize());
+	}
+
+	/* the least recently used entries first */
+	std::sort(found.begin(), found.end());
+
+	const std::scoped_lock lock{mutex};
+
+	for (const auto &[mtime, hash, size] : found)
+		if (entries_by_hash.find(hash) == entries_by_hash.end())
+			Insert(hash, size);
+
+	FmtDebug(input_cache_disk_domain, "Loaded {} files, {} bytes",
+		 found.size(), total_size);
+
+	Shrink();
+}
+
+std::unique_ptr<InputCacheMapping>
+InputCacheDisk::Lookup(std::string_view uri) noexcept
+{
+	const uint_least64_t hash = HashUri(uri);
+
+	{
+		const std::scoped_lock lock{mutex};
+
+		auto i = entries_by_hash.find(hash);
+		if (i == entries_by_hash.end())
+			return nullptr;
+
+		/* refresh */
+		entries_by_time.erase(entries_by_time.iterator_to(*i));
+		entries_by_time.push_back(*i);
+	}
+
+	const auto path = MakePath(hash);
+
+	std::unique_ptr<InputCacheMapping> mapping;
+
+	try {
+		mapping = std::make_unique<InputCacheMapping>(path);
+	} catch (...) {
+		FmtError(input_cache_disk_domain, "Failed to load {:?}: {}",
+			 path, std::current_exception());
+	}
+
+	if (mapping) {
+		if (mapping->GetUri() != uri)
+			/* hash collision; this file belongs to another
+			   URI (and will be replaced by the next Store()
+			   call for this one) */
+			return nullptr;
+
+		FileInfo info;
+		if (GetFileInfo(AllocatedPath::FromUTF8(uri), info) &&
+		    info.IsRegular() &&
+		    info.GetSize() == mapping->GetData().size() &&
+		    ExportTime(info.GetModificationTime()) == ExportTime(mapping->GetModificationTime())) {
+#ifndef _WIN32
+			/* remember the access for the next Load() call */
+			utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+#endif
+
+			return mapping;
+		}
+
+		FmtDebug(input_cache_disk_domain,
+			 "Discarding obsolete copy of {:?}", uri);
+		mapping.reset();
+	}
+
+	const std::scoped_lock lock{mutex};
+
+	if (auto i = entries_by_hash.find(hash); i != entries_by_hash.end())
+		Delete(*i);
+
+	return nullptr;
+}
+
+bool
+InputCacheDisk::Store(std::string_view uri,
+		      std::chrono::system_clock::time_point mtime,
+		      std::span<const std::byte> data)
+{
+	if (uri.size() > MAX_URI_LENGTH)
+		return false;
+
+	const uint_least64_t size = HEADER_SIZE + data.size();
+	if (size > max_total_size)
+		return false;
+
+	const uint_least64_t hash = HashUri(uri);
+	const auto path = MakePath(hash);
+
+	std::array<std::byte, HEADER_SIZE> header_buffer{};
+	InputCacheDiskHeader header{};
+	header.magic = InputCacheDiskHeader::MAGIC;
+	header.size = data.size();
+	header.mtime = ExportTime(mtime);
+	header.uri_length = uri.size();
+	memcpy(header_buffer.data(), &header, sizeof(header));
+	memcpy(header_buffer.data() + sizeof(header), uri.data(), uri.size());
+
+	FileOutputStream file{path};
+	file.Write(header_buffer);
+	file.Write(data);
+	file.Commit();
+
+	const std::scoped_lock lock{mutex};
+
+	if (auto i = entries_by_hash.find(hash); i != entries_by_hash.end()) {
+		/* the old file (which may have belonged to another
+		   URI with the same hash) has already been
+		   replaced */
+		auto &old = *i;
+		Remove(old);
+		delete &old;
+	}
+
+	Insert(hash, size);
+	Shrink();
+	return true;
+}
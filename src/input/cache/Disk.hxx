@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_INPUT_CACHE_DISK_HXX
+#define MPD_INPUT_CACHE_DISK_HXX
+
+#include "fs/AllocatedPath.hxx"
+#include "io/MappedFile.hxx"
+#include "thread/Mutex.hxx"
+#include "util/IntrusiveHashSet.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+
+/**
+ * A file from the #InputCacheDisk mapped into memory.
+ */
+class InputCacheMapping {
+	MappedFile file;
+
+	std::span<const std::byte> data;
+
+public:
+	/**
+	 * Throws on error (including a malformed header).
+	 */
+	explicit InputCacheMapping(Path path);
+
+	/**
+	 * Returns the URI of the original file.
+	 */
+	[[gnu::pure]]
+	std::string_view GetUri() const noexcept;
+
+	/**
+	 * Returns the modification time of the original file at the
+	 * time this copy was made.
+	 */
+	[[gnu::pure]]
+	std::chrono::system_clock::time_point GetModificationTime() const noexcept;
+
+	/**
+	 * Returns the contents of the cached file (after the
+	 * header).
+	 */
+	std::span<const std::byte> GetData() const noexcept {
+		return data;
+	}
+};
+
+/**
+ * The second tier of the #InputCacheManager: a directory which
+ * contains copies of local files, each in a file named after a
+ * 64 bit hash of its URI (i.e. files are addressed by URI, not by
+ * contents).  Each file begins with a header which contains the URI
+ * and the size and modification time of the original file; if the
+ * original file gets modified, the copy becomes invalid.
+ *
+ * If two URIs have the same hash, they share one file, so storing
+ * one evicts the other.  Lookup() compares the URI in the header, so
+ * this is never mistaken for a hit.
+ *
+ * The least recently used files are deleted when the total size
+ * exceeds the configured limit.
+ *
+ * This class is thread-safe.
+ */
+class InputCacheDisk {
+public:
+	/**
+	 * The size of the header which precedes the contents in each
+	 * file.  It contains the URI of the original file, which
+	 * therefore must not be longer than this.
+	 */
+	static constexpr std::size_t HEADER_SIZE = 4096;
+
+private:
+	const AllocatedPath directory;
+
+	const uint_least64_t max_total_size;
+
+	mutable Mutex mutex;
+
+	uint_least64_t total_size = 0;
+
+	struct Entry final
+		: IntrusiveListHook<>, IntrusiveHashSetHook<>
+	{
+		const uint_least64_t hash;
+
+		/**
+		 * The size of the file (including the header).
+		 */
+		const uint_least64_t size;
+
+		Entry(uint_least64_t _hash, uint_least64_t _size) noexcept
+			:hash(_hash), size(_size) {}
+	};
+
+	struct EntryGetHash {
+		constexpr uint_least64_t operator()(const Entry &entry) const noexcept {
+			return entry.hash;
+		}
+	};
+
+	/**
+	 * All entries, the least recently used first.
+	 */
+	IntrusiveList<Entry> entries_by_time;
+
+	IntrusiveHashSet<Entry, 4093,
+			 IntrusiveHashSetOperators<Entry, EntryGetHash,
+						   std::hash<uint_least64_t>,
+						   std::equal_to<uint_least64_t>>> entries_by_hash;
+
+public:
+	/**
+	 * @param _directory the directory which contains the cache
+	 * files; it is created if it does not exist
+	 * @param _max_total_size the maximum total size of all
+	 * files in the directory
+	 */
+	InputCacheDisk(AllocatedPath &&_directory,
+		       uint_least64_t _max_total_size) noexcept;
+
+	~InputCacheDisk() noexcept;
+
+	InputCacheDisk(const InputCacheDisk &) = delete;
+	InputCacheDisk &operator=(const InputCacheDisk &) = delete;
+
+	/**
+	 * Scan the directory for files created by a previous
+	 * process.  This may block for a long time and should be
+	 * called in a separate thread.
+	 *
+	 * Throws on error.
+	 */
+	void Load();
+
+	/**
+	 * Look up a cached copy of the given file.  Verifies that the
+	 * original file has not been modified; if it has been, the
+	 * copy is deleted.
+	 *
+	 * @param uri the absolute path of the original file (UTF-8)
+	 * @return the mapped copy or nullptr if there is no (valid)
+	 * copy
+	 */
+	std::unique_ptr<InputCacheMapping> Lookup(std::string_view uri) noexcept;
+
+	/**
+	 * Store a copy of the given file, evicting old files if
+	 * necessary (including the copy of another URI with the same
+	 * hash).  This may block for a long time and should be
+	 * called in a separate thread.
+	 *
+	 * Throws on error.
+	 *
+	 * @param uri the absolute path of the original file (UTF-8)
+	 * @param mtime the modification time of the original file at
+	 * the time its contents were read
+	 * @param data the contents of the original file
+	 * @return false if the file is not eligible for this cache
+	 * (e.g. too large)
+	 */
+	bool Store(std::string_view uri,
+		   std::chrono::system_clock::time_point mtime,
+		   std::span<const std::byte> data);
+
+private:
+	[[gnu::pure]]
+	AllocatedPath MakePath(uint_least64_t hash) const noexcept;
+
+	/**
+	 * Caller must lock the mutex.
+	 */
+	void Insert(uint_least64_t hash, uint_least64_t size) noexcept;
+
+	/**
+	 * Caller must lock the mutex.
+	 */
+	void Remove(Entry &entry) noexcept;
+
+	/**
+	 * Remove the given entry and delete its file.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void Delete(Entry &entry) noexcept;
+
+	/**
+	 * Delete the least recently used files until the total size
+	 * is within the limit.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void Shrink() noexcept;
+};
+
+#endif
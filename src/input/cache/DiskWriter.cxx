@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "DiskWriter.hxx"
+#include "Disk.hxx"
+#include "Item.hxx"
+#include "Lease.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileInfo.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+
+static constexpr Domain input_cache_disk_domain("input_cache_disk");
+
+class InputCacheDiskWriter::Job final : public InputCacheLease {
+	InputCacheDiskWriter &writer;
+
+public:
+	/**
+	 * The modification time of the original file.  Gets
+	 * initialized by the thread as soon as possible (i.e. while
+	 * the item is still being read).
+	 */
+	std::optional<std::chrono::system_clock::time_point> mtime;
+
+	/**
+	 * Has the item been read completely (or has it failed)?
+	 * Protected by InputCacheDiskWriter::mutex.
+	 */
+	bool done = false;
+
+	Job(InputCacheDiskWriter &_writer, InputCacheItem &_item) noexcept
+		:InputCacheLease(_item), writer(_writer) {}
+
+private:
+	/* virtual methods from class InputCacheLease */
+	void OnInputCacheAvailable() noexcept override {
+		if (!GetCacheItem().IsFinished())
+			return;
+
+		const std::scoped_lock lock{writer.mutex};
+		done = true;
+		writer.cond.notify_one();
+	}
+};
+
+InputCacheDiskWriter::InputCacheDiskWriter(InputCacheDisk &_disk)
+	:disk(_disk)
+{
+	thread.Start();
+}
+
+InputCacheDiskWriter::~InputCacheDiskWriter() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		cond.notify_one();
+	}
+
+	thread.Join();
+}
+
+void
+InputCacheDiskWriter::Add(InputCacheItem &item) noexcept
+{
+	std::list<Job> tmp;
+	auto &job = tmp.emplace_back(*this, item);
+
+	bool done;
+
+	{
+		/* the item may have been read completely before our
+		   lease was added */
+		const std::scoped_lock item_lock{item.mutex};
+		done = item.IsFinished();
+	}
+
+	const std::scoped_lock lock{mutex};
+	job.done |= done;
+	jobs.splice(jobs.end(), tmp);
+	cond.notify_one();
+}
+
+void
+InputCacheDiskWriter::Remove(const InputCacheItem &item) noexcept
+{
+	std::list<Job> tmp;
+
+	{
+		const std::scoped_lock lock{mutex};
+
+		auto i = std::find_if(jobs.begin(), jobs.end(), [&item](const Job &job){
+			return &job.GetCacheItem() == &item;
+		});
+
+		if (i != jobs.end())
+			tmp.splice(tmp.end(), jobs, i);
+	}
+
+	/* the lease is released here, after our mutex has been
+	   unlocked */
+}
+
+inline void
+InputCacheDiskWriter::Execute(Job &job) noexcept
+{
+	auto &item = job.GetCacheItem();
+
+	std::span<const std::byte> data;
+
+	{
+		const std::scoped_lock item_lock{item.mutex};
+		data = item.GetCompleteData();
+	}
+
+	if (data.empty() || !job.mtime)
+		/* the item has failed */
+		return;
+
+	/* after the item has been read completely, its buffer is
+	   never modified again, therefore we can now access it
+	   without holding the mutex */
+
+	try {
+		if (disk.Store(item.GetUri(), *job.mtime, data))
+			FmtDebug(input_cache_disk_domain, "Stored {:?}",
+				 item.GetUri());
+	} catch (...) {
+		FmtError(input_cache_disk_domain, "Failed to store {:?}: {}",
+			 item.GetUri(), std::current_exception());
+	}
+}
+
+void
+InputCacheDiskWriter::Run() noexcept
+{
+	SetThreadName("input_cache");
+	SetThreadIdlePriority();
+
+	try {
+		disk.Load();
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to load the input cache directory");
+	}
+
+	std::unique_lock lock{mutex};
+
+	while (!quit) {
+		/* first obtain the modification time of all new
+		   items, while they are still being read */
+		auto i = std::find_if(jobs.begin(), jobs.end(), [](const Job &job){
+			return !job.mtime;
+		});
+
+		if (i != jobs.end()) {
+			auto &job = *i;
+			const auto path = AllocatedPath::FromUTF8(job->GetUri());
+			lock.unlock();
+
+			FileInfo info;
+			const bool success = GetFileInfo(path, info) &&
+				info.IsRegular();
+
+			if (success) {
+				lock.lock();
+				job.mtime = info.GetModificationTime();
+				continue;
+			}
+
+			/* cannot be copied; release the lease while
+			   our mutex is not locked */
+			lock.lock();
+			std::list<Job> tmp;
+			tmp.splice(tmp.end(), jobs, i);
+			lock.unlock();
+			tmp.clear();
+			lock.lock();
+			continue;
+		}
+
+		i = std::find_if(jobs.begin(), jobs.end(), [](const Job &job){
+			return job.done;
+		});
+
+		if (i == jobs.end()) {
+			cond.wait(lock);
+			continue;
+		}
+
+		std::list<Job> tmp;
+		tmp.splice(tmp.end(), jobs, i);
+		lock.unlock();
+
+		Execute(tmp.front());
+
+		/* release the lease while our mutex is not locked */
+		tmp.clear();
+
+		lock.lock();
+	}
+}
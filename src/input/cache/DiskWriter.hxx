@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_INPUT_CACHE_DISK_WRITER_HXX
+#define MPD_INPUT_CACHE_DISK_WRITER_HXX
+
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <list>
+
+class InputCacheDisk;
+class InputCacheItem;
+
+/**
+ * Copies #InputCacheItem instances to the #InputCacheDisk in a
+ * separate thread as soon as they have been read completely.  Until
+ * then, it holds a lease on the item, which prevents its eviction
+ * from RAM.
+ *
+ * Before that, the thread loads the #InputCacheDisk index.
+ */
+class InputCacheDiskWriter {
+	InputCacheDisk &disk;
+
+	Thread thread{BIND_THIS_METHOD(Run)};
+
+	Mutex mutex;
+	Cond cond;
+
+	class Job;
+
+	/**
+	 * Protected by #mutex.
+	 */
+	std::list<Job> jobs;
+
+	/**
+	 * Protected by #mutex.
+	 */
+	bool quit = false;
+
+public:
+	explicit InputCacheDiskWriter(InputCacheDisk &_disk);
+
+	/**
+	 * Stops the thread.  Items which have not yet been copied
+	 * are discarded.
+	 */
+	~InputCacheDiskWriter() noexcept;
+
+	InputCacheDiskWriter(const InputCacheDiskWriter &) = delete;
+	InputCacheDiskWriter &operator=(const InputCacheDiskWriter &) = delete;
+
+	/**
+	 * Copy the given item to the #InputCacheDisk as soon as it has
+	 * been read completely.
+	 */
+	void Add(InputCacheItem &item) noexcept;
+
+	/**
+	 * Forget the given item (if it has been added) without
+	 * copying it.  The caller may lock the item's mutex.
+	 */
+	void Remove(const InputCacheItem &item) noexcept;
+
+private:
+	void Execute(Job &job) noexcept;
+	void Run() noexcept;
+};
+
+#endif
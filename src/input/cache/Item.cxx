@@ -3,13 +3,65 @@
 
 #include "Item.hxx"
 #include "Lease.hxx"
+#include "Disk.hxx"
+#include "RateLimiter.hxx"
 #include "input/InputStream.hxx"
 
+#include <algorithm>
 #include <cassert>
 
-InputCacheItem::InputCacheItem(InputStreamPtr _input) noexcept
+#include <string.h>
+
+InputCacheItem::Buffer::Buffer(InputCacheItem &_item, InputStreamPtr _input)
 	:BufferingInputStream(std::move(_input)),
-	 uri(GetInput().GetURI())
+	 item(_item)
+{
+	/* start the thread only now that #item is initialized */
+	Start();
+}
+
+std::chrono::steady_clock::duration
+InputCacheItem::Buffer::OnBufferRead(std::size_t nbytes) noexcept
+{
+	return item.throttle != nullptr
+		? item.throttle->Consume(nbytes)
+		: std::chrono::steady_clock::duration::zero();
+}
+
+InputCacheItem::Chunks::Chunks(InputCacheItem &_item, InputStreamPtr _input,
+			       std::size_t _max_chunks)
+	:InputCacheChunks(std::move(_input), _max_chunks),
+	 item(_item)
+{
+	Start();
+}
+
+std::chrono::steady_clock::duration
+InputCacheItem::Chunks::OnBufferRead(std::size_t nbytes) noexcept
+{
+	return item.throttle != nullptr
+		? item.throttle->Consume(nbytes)
+		: std::chrono::steady_clock::duration::zero();
+}
+
+InputCacheItem::InputCacheItem(InputStreamPtr _input,
+			       InputCacheRateLimiter *_throttle,
+			       std::size_t max_chunks)
+	:uri(_input->GetURI()),
+	 mutex(_input->mutex),
+	 throttle(_throttle)
+{
+	if (max_chunks > 0)
+		chunks = std::make_unique<Chunks>(*this, std::move(_input),
+						  max_chunks);
+	else
+		buffer = std::make_unique<Buffer>(*this, std::move(_input));
+}
+
+InputCacheItem::InputCacheItem(std::string_view _uri, Mutex &_mutex,
+			       std::unique_ptr<InputCacheMapping> _mapping) noexcept
+	:uri(_uri), mutex(_mutex), throttle(nullptr),
+	 mapping(std::move(_mapping))
 {
 }
 
@@ -18,6 +70,90 @@ InputCacheItem::~InputCacheItem() noexcept
 	assert(leases.empty());
 }
 
+std::size_t
+InputCacheItem::size() const noexcept
+{
+	if (buffer)
+		return buffer->size();
+
+	if (chunks)
+		return chunks->size();
+
+	return mapping->GetData().size();
+}
+
+std::size_t
+InputCacheItem::GetCacheSize() const noexcept
+{
+	return chunks
+		? chunks->GetMaxResidentSize()
+		: size();
+}
+
+void
+InputCacheItem::Check()
+{
+	if (buffer)
+		buffer->Check();
+	else if (chunks)
+		chunks->Check();
+}
+
+bool
+InputCacheItem::IsAvailable(std::size_t offset) const noexcept
+{
+	if (buffer)
+		return buffer->IsAvailable(offset);
+
+	if (chunks)
+		return chunks->IsAvailable(offset);
+
+	return true;
+}
+
+std::size_t
+InputCacheItem::Read(std::unique_lock<Mutex> &lock, std::size_t offset,
+		     void *ptr, std::size_t _size)
+{
+	if (buffer)
+		return buffer->Read(lock, offset, ptr, _size);
+
+	if (chunks)
+		return chunks->Read(lock, offset, ptr, _size);
+
+	const auto data = mapping->GetData();
+	if (offset >= data.size())
+		return 0;
+
+	const std::size_t nbytes = std::min(_size, data.size() - offset);
+	memcpy(ptr, data.data() + offset, nbytes);
+	return nbytes;
+}
+
+bool
+InputCacheItem::IsFinished() const noexcept
+{
+	if (buffer)
+		return buffer->IsFinished();
+
+	if (chunks)
+		return chunks->IsFinished();
+
+	return true;
+}
+
+std::span<const std::byte>
+InputCacheItem::GetCompleteData() const noexcept
+{
+	if (buffer)
+		return std::as_bytes(buffer->GetCompleteBuffer());
+
+	if (chunks)
+		return {};
+
+	return mapping->GetData();
+}
+
 void
 InputCacheItem::AddLease(InputCacheLease &lease) noexcept
 {
@@ -37,7 +173,7 @@ InputCacheItem::RemoveLease(InputCacheLease &lease) noexcept
 	// TODO: ensure that OnBufferAvailable() isn't currently running
 }
 
-void
+inline void
 InputCacheItem::OnBufferAvailable() noexcept
 {
 	for (auto i = leases.begin(); i != leases.end(); i = next_lease) {
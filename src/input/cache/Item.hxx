@@ -4,55 +4,223 @@
 #ifndef MPD_INPUT_CACHE_ITEM_HXX
 #define MPD_INPUT_CACHE_ITEM_HXX
 
+#include "Chunks.hxx"
 #include "input/BufferingInputStream.hxx"
 #include "thread/Mutex.hxx"
 #include "util/IntrusiveList.hxx"
 #include "util/IntrusiveHashSet.hxx"
 
+#include <memory>
+#include <span>
 #include <string>
 
 class InputCacheLease;
+class InputCacheMapping;
+class InputCacheRateLimiter;
 
 /**
  * An item in the #InputCacheManager.  It caches the contents of a
- * file, and reading and managing it through the base class
- * #BufferingInputStream.
+ * file, either in RAM (reading and managing it through an internal
+ * #BufferingInputStream) or in a file of the #InputCacheDisk which
+ * is mapped into memory.  Files which are too large for that are
+ * cached partially by #InputCacheChunks.
  *
  * Use the class #CacheInputStream to read from it.
  */
 class InputCacheItem final
-	: public BufferingInputStream,
-	  public AutoUnlinkIntrusiveListHook,
+	: public AutoUnlinkIntrusiveListHook,
 	  public IntrusiveHashSetHook<>
 {
+	class Buffer final : public BufferingInputStream {
+		InputCacheItem &item;
+
+	public:
+		Buffer(InputCacheItem &_item, InputStreamPtr _input);
+
+		~Buffer() noexcept {
+			Stop();
+		}
+
+	private:
+		/* virtual methods from class BufferingInputStream */
+		void OnBufferAvailable() noexcept override {
+			item.OnBufferAvailable();
+		}
+
+		std::chrono::steady_clock::duration OnBufferRead(std::size_t nbytes) noexcept override;
+	};
+
+	class Chunks final : public InputCacheChunks {
+		InputCacheItem &item;
+
+	public:
+		Chunks(InputCacheItem &_item, InputStreamPtr _input,
+		       std::size_t _max_chunks);
+
+		~Chunks() noexcept {
+			Stop();
+		}
+
+	private:
+		/* virtual methods from class InputCacheChunks */
+		void OnBufferAvailable() noexcept override {
+			item.OnBufferAvailable();
+		}
+
+		std::chrono::steady_clock::duration OnBufferRead(std::size_t nbytes) noexcept override;
+	};
+
 	const std::string uri;
 
+public:
+	Mutex &mutex;
+
+private:
+	/* these must be initialized before #buffer, because its
+	   thread may invoke OnBufferAvailable() right away */
 	using LeaseList = IntrusiveList<InputCacheLease>;
 
 	LeaseList leases;
 	LeaseList::iterator next_lease = leases.end();
 
+	/**
+	 * If not nullptr, then reading into the #buffer is throttled
+	 * by this object.  Protected by #mutex.
+	 */
+	InputCacheRateLimiter *throttle;
+
+	/**
+	 * The RAM buffer; nullptr if this item was loaded from the
+	 * #InputCacheDisk or if it is partial.
+	 */
+	std::unique_ptr<Buffer> buffer;
+
+	/**
+	 * The chunks of a file which is too large to be cached
+	 * completely; nullptr if this item is not partial.
+	 */
+	std::unique_ptr<Chunks> chunks;
+
+	/**
+	 * The file mapping if this item was loaded from the
+	 * #InputCacheDisk.
+	 */
+	std::unique_ptr<InputCacheMapping> mapping;
+
 public:
-	explicit InputCacheItem(InputStreamPtr _input) noexcept;
+	/**
+	 * Throws on error.
+	 *
+	 * @param _input a seekable #InputStream with a known size
+	 * @param _throttle an optional object which limits the
+	 * bandwidth; see Unthrottle()
+	 * @param max_chunks if non-zero, then only this number of
+	 * chunks is kept in RAM (see #InputCacheChunks)
+	 */
+	explicit InputCacheItem(InputStreamPtr _input,
+				InputCacheRateLimiter *_throttle=nullptr,
+				std::size_t max_chunks=0);
+
+	InputCacheItem(std::string_view _uri, Mutex &_mutex,
+		       std::unique_ptr<InputCacheMapping> _mapping) noexcept;
+
 	~InputCacheItem() noexcept;
 
 	const std::string &GetUri() const noexcept {
 		return uri;
 	}
 
-	using BufferingInputStream::size;
+	/**
+	 * The size of the file.
+	 */
+	[[gnu::pure]]
+	std::size_t size() const noexcept;
+
+	/**
+	 * The amount of memory accounted for this item by the
+	 * #InputCacheManager.  This is the file size unless this item
+	 * is partial.
+	 */
+	[[gnu::pure]]
+	std::size_t GetCacheSize() const noexcept;
+
+	/**
+	 * Was this item loaded from the #InputCacheDisk?
+	 */
+	bool IsMapped() const noexcept {
+		return mapping != nullptr;
+	}
+
+	/**
+	 * Does this item keep only some chunks of the file?
+	 */
+	bool IsPartial() const noexcept {
+		return chunks != nullptr;
+	}
 
 	bool IsInUse() const noexcept {
 		const std::scoped_lock<Mutex> lock(mutex);
 		return !leases.empty();
 	}
 
+	/**
+	 * Has the file been read completely, or has an error
+	 * occurred?  For a partial item, this checks whether the
+	 * chunks which shall be read ahead are available.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	[[gnu::pure]]
+	bool IsFinished() const noexcept;
+
+	/**
+	 * Stop limiting the bandwidth, because somebody is waiting
+	 * for this file now.
+	 */
+	void Unthrottle() noexcept {
+		const std::scoped_lock<Mutex> lock(mutex);
+		throttle = nullptr;
+	}
+
+	/**
+	 * Wrapper for BufferingInputStream::Check().
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void Check();
+
+	/**
+	 * Wrapper for BufferingInputStream::IsAvailable().
+	 *
+	 * Caller must lock the mutex.
+	 */
+	[[gnu::pure]]
+	bool IsAvailable(std::size_t offset) const noexcept;
+
+	/**
+	 * Wrapper for BufferingInputStream::Read().
+	 *
+	 * Caller must lock the mutex.
+	 */
+	std::size_t Read(std::unique_lock<Mutex> &lock, std::size_t offset,
+			 void *ptr, std::size_t size);
+
+	/**
+	 * Returns the whole contents if the file has been read
+	 * completely, or an empty span if not (yet) or if this item
+	 * is partial.  The returned
+	 * span remains valid as long as this item exists.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	[[gnu::pure]]
+	std::span<const std::byte> GetCompleteData() const noexcept;
+
 	void AddLease(InputCacheLease &lease) noexcept;
 	void RemoveLease(InputCacheLease &lease) noexcept;
 
 private:
-	/* virtual methods from class BufferingInputStream */
-	void OnBufferAvailable() noexcept override;
+	void OnBufferAvailable() noexcept;
 };
 
 #endif
@@ -5,10 +5,16 @@
 #include "Config.hxx"
 #include "Item.hxx"
 #include "Lease.hxx"
+#include "Disk.hxx"
+#include "DiskWriter.hxx"
+#include "Prefetcher.hxx"
+#include "Chunks.hxx"
 #include "input/InputStream.hxx"
 #include "fs/Traits.hxx"
 #include "util/DeleteDisposer.hxx"
 
+#include <algorithm>
+
 #include <string.h>
 
 inline std::string_view
@@ -17,25 +23,55 @@ InputCacheManager::ItemGetUri::operator()(const InputCacheItem &item) const noex
 	return item.GetUri();
 }
 
-InputCacheManager::InputCacheManager(const InputCacheConfig &config) noexcept
-	:max_total_size(config.size)
+static constexpr std::size_t
+CalcMaxPartialChunks(std::size_t max_total_size,
+		     std::size_t partial_size) noexcept
 {
+	const std::size_t n = std::min(partial_size, max_total_size / 2)
+		/ InputCacheChunks::CHUNK_SIZE;
+	return n >= InputCacheChunks::MIN_CHUNKS ? n : 0;
+}
+
+InputCacheManager::InputCacheManager(const InputCacheConfig &config)
+	:max_total_size(config.size),
+	 max_partial_chunks(CalcMaxPartialChunks(config.size,
+						 config.partial_size)),
+	 prefetch_depth(config.prefetch_depth)
+{
+	if (!config.disk_path.IsNull()) {
+		disk = std::make_unique<InputCacheDisk>(AllocatedPath{config.disk_path},
+							config.disk_size);
+		disk_writer = std::make_unique<InputCacheDiskWriter>(*disk);
+	}
+
+	if (prefetch_depth > 0)
+		prefetcher = std::make_unique<InputCachePrefetcher>(*this, config);
 }
 
 InputCacheManager::~InputCacheManager() noexcept
 {
+	/* the rate limiter is owned by the prefetcher */
+	for (auto &i : items_by_time)
+		i.Unthrottle();
+
+	/* this releases the leases held by these objects */
+	prefetcher.reset();
+	disk_writer.reset();
+
 	items_by_time.clear_and_dispose(DeleteDisposer());
 }
 
 void
 InputCacheManager::Flush() noexcept
 {
+	const std::scoped_lock lock{items_mutex};
+
 	items_by_time.remove_and_dispose_if([](const InputCacheItem &item){
 		return !item.IsInUse();
 	}, [this](InputCacheItem *item){
 		// TODO: eliminate code duplication, see method Remove()
-		assert(total_size >= item->size());
-		total_size -= item->size();
+		assert(total_size >= item->GetCacheSize());
+		total_size -= item->GetCacheSize();
 		items_by_uri.erase(items_by_uri.iterator_to(*item));
 		delete item;
 	});
@@ -53,6 +89,18 @@ InputCacheManager::IsEligible(const InputStream &input) const noexcept
 		input.GetSize() <= max_total_size / 2;
 }
 
+bool
+InputCacheManager::IsPartialEligible(const InputStream &input) const noexcept
+{
+	assert(input.IsReady());
+
+	return max_partial_chunks > 0 &&
+		input.IsSeekable() && input.KnownSize() &&
+		input.GetSize() > max_total_size / 2 &&
+		/* a partial item must be smaller than the file */
+		std::size_t(input.GetSize()) > max_partial_chunks * InputCacheChunks::CHUNK_SIZE;
+}
+
 bool
 InputCacheManager::Contains(const char *uri) noexcept
 {
@@ -66,51 +114,190 @@ InputCacheManager::Get(const char *uri, bool create)
 	if (!PathTraitsUTF8::IsAbsolute(uri))
 		return {};
 
-	if (auto iter = items_by_uri.find(uri); iter != items_by_uri.end()) {
-		auto &item = *iter;
+	{
+		const std::scoped_lock lock{items_mutex};
+
+		if (auto iter = items_by_uri.find(uri); iter != items_by_uri.end()) {
+			auto &item = *iter;
+
+			/* refresh */
+			items_by_time.erase(items_by_time.iterator_to(item));
+			items_by_time.push_back(item);
 
-		/* refresh */
-		items_by_time.erase(items_by_time.iterator_to(item));
-		items_by_time.push_back(item);
+			// TODO revalidate the cache item using the file's mtime?
+			// TODO if cache item contains error, retry now?
 
-		// TODO revalidate the cache item using the file's mtime?
-		// TODO if cache item contains error, retry now?
+			if (create) {
+				++n_hits;
 
-		return InputCacheLease(item);
+				/* this file is going to be played: read
+				   the rest of it as quickly as
+				   possible */
+				item.Unthrottle();
+			}
+
+			return InputCacheLease(item);
+		}
 	}
 
 	if (!create)
 		return {};
 
+	return Load(uri, false, nullptr);
+}
+
+void
+InputCacheManager::SchedulePrefetch(const void *owner,
+				    std::vector<std::string> &&uris) noexcept
+{
+	if (prefetcher)
+		prefetcher->Schedule(owner, std::move(uris));
+}
+
+void
+InputCacheManager::ForgetFailedPrefetches() noexcept
+{
+	if (prefetcher)
+		prefetcher->ForgetFailures();
+}
+
+InputCacheLease
+InputCacheManager::Prefetch(const char *uri, InputCacheRateLimiter *throttle)
+{
+	if (!PathTraitsUTF8::IsAbsolute(uri) || Contains(uri))
+		return {};
+
+	return Load(uri, true, throttle);
+}
+
+void
+InputCacheManager::CancelPrefetch(const char *uri) noexcept
+{
+	const std::scoped_lock lock{items_mutex};
+
+	auto iter = items_by_uri.find(uri);
+	if (iter == items_by_uri.end())
+		return;
+
+	auto &item = *iter;
+
+	{
+		const std::scoped_lock item_lock{item.mutex};
+		if (item.IsFinished())
+			/* it's complete; keep it */
+			return;
+	}
+
+	if (disk_writer)
+		disk_writer->Remove(item);
+
+	if (!item.IsInUse())
+		Delete(&item);
+}
+
+InputCacheStats
+InputCacheManager::GetStats() const noexcept
+{
+	const std::scoped_lock lock{items_mutex};
+
+	return {
+		.size = total_size,
+		.hits = n_hits,
+		.disk_hits = n_disk_hits,
+		.misses = n_misses,
+		.prefetched_bytes = prefetched_bytes,
+	};
+}
+
+InputCacheLease
+InputCacheManager::Load(const char *uri, bool prefetch,
+			InputCacheRateLimiter *throttle)
+{
+	if (disk) {
+		if (auto mapping = disk->Lookup(uri)) {
+			if (!prefetch) {
+				const std::scoped_lock lock{items_mutex};
+				++n_disk_hits;
+			}
+
+			return Add(new InputCacheItem(uri, mutex,
+						      std::move(mapping)),
+				   prefetch);
+		}
+	}
+
+	if (!prefetch) {
+		const std::scoped_lock lock{items_mutex};
+		++n_misses;
+	}
+
 	// TODO: wait for "ready" without blocking here
 	auto is = InputStream::OpenReady(uri, mutex);
 
-	if (!IsEligible(*is))
+	InputCacheItem *item;
+	if (IsEligible(*is))
+		item = new InputCacheItem(std::move(is), throttle);
+	else if (IsPartialEligible(*is))
+		item = new InputCacheItem(std::move(is), throttle,
+					  max_partial_chunks);
+	else
 		return {};
 
-	const size_t size = is->GetSize();
-	total_size += size;
+	auto lease = Add(item, prefetch);
 
-	while (total_size > max_total_size && EvictOldestUnused()) {}
+	if (lease && &lease.GetCacheItem() == item) {
+		if (prefetch) {
+			const std::scoped_lock lock{items_mutex};
+			prefetched_bytes += item->GetCacheSize();
+		}
 
-	auto *item = new InputCacheItem(std::move(is));
-	items_by_uri.insert(*item);
-	items_by_time.push_back(*item);
+		/* partial items are never complete, and thus
+		   cannot be copied */
+		if (disk_writer && !item->IsPartial())
+			disk_writer->Add(*item);
+	}
 
-	return InputCacheLease(*item);
+	return lease;
 }
 
-void
-InputCacheManager::Prefetch(const char *uri)
+InputCacheLease
+InputCacheManager::Add(InputCacheItem *item, bool prefetch) noexcept
 {
-	Get(uri, true);
+	std::unique_lock lock{items_mutex};
+
+	if (auto iter = items_by_uri.find(item->GetUri());
+	    iter != items_by_uri.end()) {
+		/* another thread was quicker */
+		InputCacheLease lease{*iter};
+		lock.unlock();
+		delete item;
+		return lease;
+	}
+
+	const std::size_t size = item->GetCacheSize();
+
+	while (total_size + size > max_total_size && EvictOldestUnused()) {}
+
+	if (prefetch && total_size + size > max_total_size) {
+		/* don't evict files which are being played or which
+		   are going to be played soon */
+		lock.unlock();
+		delete item;
+		return {};
+	}
+
+	total_size += size;
+	items_by_uri.insert(*item);
+	items_by_time.push_back(*item);
+
+	return InputCacheLease(*item);
 }
 
 void
 InputCacheManager::Remove(InputCacheItem &item) noexcept
 {
-	assert(total_size >= item.size());
-	total_size -= item.size();
+	assert(total_size >= item.GetCacheSize());
+	total_size -= item.GetCacheSize();
 
 	items_by_time.erase(items_by_time.iterator_to(item));
 	items_by_uri.erase(items_by_uri.iterator_to(item));
@@ -127,7 +314,8 @@ InputCacheItem *
 InputCacheManager::FindOldestUnused() noexcept
 {
 	for (auto &i : items_by_time)
-		if (!i.IsInUse())
+		if (!i.IsInUse() &&
+		    (!prefetcher || !prefetcher->IsWanted(i.GetUri())))
 			return &i;
 
 	return nullptr;
@@ -8,22 +8,86 @@
 #include "util/IntrusiveHashSet.hxx"
 #include "util/IntrusiveList.hxx"
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 class InputStream;
+class InputCacheDisk;
+class InputCacheDiskWriter;
 class InputCacheItem;
 class InputCacheLease;
+class InputCachePrefetcher;
+class InputCacheRateLimiter;
 struct InputCacheConfig;
 
+struct InputCacheStats {
+	/**
+	 * The total size of all items in RAM (the maximum size for
+	 * partial items).
+	 */
+	std::size_t size;
+
+	/**
+	 * The number of files played from RAM.
+	 */
+	uint_least64_t hits;
+
+	/**
+	 * The number of files played from the #InputCacheDisk.
+	 */
+	uint_least64_t disk_hits;
+
+	/**
+	 * The number of files played from their original location.
+	 */
+	uint_least64_t misses;
+
+	/**
+	 * The number of bytes prefetched from original files.
+	 */
+	uint_least64_t prefetched_bytes;
+};
+
 /**
  * A class which caches files in RAM.  It is supposed to prefetch
  * files before they are played.
+ *
+ * Optionally, an #InputCacheDisk keeps copies of all cached files
+ * on a (local) disk; files which have been evicted from RAM (or
+ * which were cached by a previous process) are mapped from there
+ * instead of being read again from their (maybe slow) original
+ * location.
  */
 class InputCacheManager {
 	const size_t max_total_size;
 
+	/**
+	 * The number of chunks of a partial item (see
+	 * #InputCacheChunks); 0 if partial items are disabled.
+	 */
+	const std::size_t max_partial_chunks;
+
+	const unsigned prefetch_depth;
+
+	/**
+	 * The mutex for all #InputStream and #InputCacheItem
+	 * instances.
+	 */
 	mutable Mutex mutex;
 
+	/**
+	 * Protects the item lists, #total_size and the statistics.
+	 * This is used by the decoder and the prefetch threads.
+	 */
+	mutable Mutex items_mutex;
+
 	size_t total_size = 0;
 
+	uint_least64_t n_hits = 0, n_disk_hits = 0, n_misses = 0;
+	uint_least64_t prefetched_bytes = 0;
+
 	struct ItemGetUri {
 		[[gnu::pure]]
 		std::string_view operator()(const InputCacheItem &item) const noexcept;
@@ -36,8 +100,13 @@ class InputCacheManager {
 						   std::hash<std::string_view>,
 						   std::equal_to<std::string_view>>> items_by_uri;
 
+	std::unique_ptr<InputCacheDisk> disk;
+	std::unique_ptr<InputCacheDiskWriter> disk_writer;
+
+	std::unique_ptr<InputCachePrefetcher> prefetcher;
+
 public:
-	explicit InputCacheManager(const InputCacheConfig &config) noexcept;
+	explicit InputCacheManager(const InputCacheConfig &config);
 	~InputCacheManager() noexcept;
 
 	void Flush() noexcept;
@@ -49,17 +118,58 @@ public:
 	 * Throws if opening the #InputStream fails.
 	 *
 	 * @param create if true, then the cache item will be created
-	 * if it did not exist
+	 * if it did not exist; this is a request to play the file,
+	 * and it is accounted in the statistics
 	 * @return a lease of the new item or nullptr if the file is
 	 * not eligible for caching
 	 */
 	InputCacheLease Get(const char *uri, bool create);
 
 	/**
-	 * Shortcut for "Get(uri,true)", discarding the returned
-	 * lease.
+	 * The number of upcoming songs which shall be passed to
+	 * SchedulePrefetch().
+	 */
+	unsigned GetPrefetchDepth() const noexcept {
+		return prefetch_depth;
+	}
+
+	/**
+	 * Replace the list of files which shall be prefetched in the
+	 * background on behalf of the given owner.  See
+	 * InputCachePrefetcher::Schedule().
+	 */
+	void SchedulePrefetch(const void *owner,
+			      std::vector<std::string> &&uris) noexcept;
+
+	/**
+	 * Retry files which could not be prefetched.  See
+	 * InputCachePrefetcher::ForgetFailures().
 	 */
-	void Prefetch(const char *uri);
+	void ForgetFailedPrefetches() noexcept;
+
+	/**
+	 * Load the given file into the cache (unless it is already
+	 * there).  This is called by #InputCachePrefetcher.
+	 *
+	 * Throws if opening the #InputStream fails.
+	 *
+	 * @param throttle an optional object which limits the
+	 * bandwidth of reading the file
+	 * @return a lease of the new item or nullptr if it was
+	 * already cached or if the file is not eligible for caching
+	 */
+	InputCacheLease Prefetch(const char *uri,
+				 InputCacheRateLimiter *throttle);
+
+	/**
+	 * Discard the given file if it has not been read completely
+	 * and is not being played.  This is called by
+	 * #InputCachePrefetcher after a prefetch was cancelled.
+	 */
+	void CancelPrefetch(const char *uri) noexcept;
+
+	[[gnu::pure]]
+	InputCacheStats GetStats() const noexcept;
 
 private:
 	/**
@@ -68,12 +178,55 @@ private:
 	 */
 	bool IsEligible(const InputStream &input) const noexcept;
 
+	/**
+	 * Check whether the given #InputStream is too large for
+	 * IsEligible(), but can be cached partially.
+	 */
+	bool IsPartialEligible(const InputStream &input) const noexcept;
+
+	/**
+	 * Look up the given file in the #InputCacheDisk or open it
+	 * and create a new item.
+	 *
+	 * Throws if opening the #InputStream fails.
+	 *
+	 * @param prefetch true if this is a prefetch; it fails
+	 * instead of exceeding the maximum size
+	 * @return a lease of the new item or nullptr if the file is
+	 * not eligible for caching or was already cached
+	 */
+	InputCacheLease Load(const char *uri, bool prefetch,
+			     InputCacheRateLimiter *throttle);
+
+	/**
+	 * Add a new item, evicting old ones if necessary.  If an
+	 * item with the same URI exists already (added concurrently
+	 * by another thread), the new item is deleted and a lease of
+	 * the existing one is returned.
+	 *
+	 * @return a lease of the item or nullptr if this is a
+	 * prefetch and the item does not fit
+	 */
+	InputCacheLease Add(InputCacheItem *item, bool prefetch) noexcept;
+
+	/**
+	 * Caller must lock #items_mutex.
+	 */
 	void Remove(InputCacheItem &item) noexcept;
+
+	/**
+	 * Caller must lock #items_mutex.
+	 */
 	void Delete(InputCacheItem *item) noexcept;
 
+	/**
+	 * Caller must lock #items_mutex.
+	 */
 	InputCacheItem *FindOldestUnused() noexcept;
 
 	/**
+	 * Caller must lock #items_mutex.
+	 *
 	 * @return true if one item has been evicted, false if no
 	 * unused item was found
 	 */
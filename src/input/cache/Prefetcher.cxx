@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Prefetcher.hxx"
+#include "Config.hxx"
+#include "Manager.hxx"
+#include "Lease.hxx"
+#include "RateLimiter.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "thread/Name.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+
+static constexpr Domain cache_domain("cache");
+
+class InputCachePrefetcher::Job final : public InputCacheLease {
+	InputCachePrefetcher &prefetcher;
+
+public:
+	const std::string uri;
+
+	/**
+	 * Has a thread picked up this job?
+	 */
+	bool running = false;
+
+	/**
+	 * Has this job been cancelled by Schedule() while it was
+	 * running?
+	 */
+	bool cancelled = false;
+
+	/**
+	 * Has the item been read completely (or has it failed)?
+	 */
+	bool done = false;
+
+	Job(InputCachePrefetcher &_prefetcher, std::string_view _uri) noexcept
+		:prefetcher(_prefetcher), uri(_uri) {}
+
+private:
+	/* virtual methods from class InputCacheLease */
+	void OnInputCacheAvailable() noexcept override {
+		if (!GetCacheItem().IsFinished())
+			return;
+
+		const std::scoped_lock lock{prefetcher.mutex};
+		done = true;
+		prefetcher.cond.notify_all();
+	}
+};
+
+InputCachePrefetcher::InputCachePrefetcher(InputCacheManager &_manager,
+					   const InputCacheConfig &config)
+	:manager(_manager),
+	 limiter(config.prefetch_bandwidth > 0
+		 ? std::make_unique<InputCacheRateLimiter>(config.prefetch_bandwidth)
+		 : nullptr)
+{
+	for (unsigned i = 0; i < config.prefetch_threads; ++i)
+		threads.emplace_back(BIND_THIS_METHOD(Run)).Start();
+}
+
+InputCachePrefetcher::~InputCachePrefetcher() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		cond.notify_all();
+	}
+
+	for (auto &i : threads)
+		i.Join();
+}
+
+bool
+InputCachePrefetcher::IsWantedLocked(std::string_view uri) const noexcept
+{
+	for (const auto &[owner, uris] : wanted)
+		if (std::find(uris.begin(), uris.end(), uri) != uris.end())
+			return true;
+
+	return false;
+}
+
+bool
+InputCachePrefetcher::IsWanted(std::string_view uri) noexcept
+{
+	const std::scoped_lock lock{mutex};
+	return IsWantedLocked(uri);
+}
+
+void
+InputCachePrefetcher::Schedule(const void *owner,
+			       std::vector<std::string> &&uris) noexcept
+{
+	/* check this before locking our mutex, because
+	   InputCacheManager may call IsWanted() while holding its
+	   own mutex */
+	std::vector<std::string_view> missing;
+	for (const auto &uri : uris)
+		if (!manager.Contains(uri.c_str()))
+			missing.emplace_back(uri);
+
+	const std::scoped_lock lock{mutex};
+
+	if (uris.empty())
+		wanted.erase(owner);
+	else if (auto &w = wanted[owner]; w != uris)
+		w = std::move(uris);
+
+	/* cancel prefetches which are not wanted anymore */
+	for (auto i = jobs.begin(); i != jobs.end();) {
+		if (IsWantedLocked(i->uri)) {
+			++i;
+		} else if (!i->running) {
+			i = jobs.erase(i);
+		} else {
+			i->cancelled = true;
+			++i;
+		}
+	}
+
+	for (const auto &uri : missing) {
+		if (failed.contains(uri))
+			/* don't retry until ForgetFailures() */
+			continue;
+
+		auto i = std::find_if(jobs.begin(), jobs.end(), [uri](const Job &job){
+			return job.uri == uri;
+		});
+
+		if (i != jobs.end())
+			/* wanted again */
+			i->cancelled = false;
+		else
+			jobs.emplace_back(*this, uri);
+	}
+
+	cond.notify_all();
+}
+
+void
+InputCachePrefetcher::ForgetFailures() noexcept
+{
+	const std::scoped_lock lock{mutex};
+	failed.clear();
+}
+
+inline void
+InputCachePrefetcher::RunJob(std::unique_lock<Mutex> &lock, Job &job) noexcept
+{
+	lock.unlock();
+
+	FmtDebug(cache_domain, "Prefetch {:?}", job.uri);
+
+	InputCacheLease lease;
+
+	try {
+		lease = manager.Prefetch(job.uri.c_str(), limiter.get());
+	} catch (...) {
+		FmtError(cache_domain, "Prefetch {:?} failed: {}",
+			 job.uri, std::current_exception());
+
+		lock.lock();
+		failed.emplace(job.uri);
+		return;
+	}
+
+	if (!lease) {
+		lock.lock();
+		return;
+	}
+
+	/* keep the lease until the item has been read completely;
+	   this keeps this thread busy, which limits the number of
+	   concurrent prefetches */
+	static_cast<InputCacheLease &>(job) = std::move(lease);
+
+	bool finished;
+
+	{
+		const std::scoped_lock item_lock{job->mutex};
+		finished = job->IsFinished();
+	}
+
+	lock.lock();
+	job.done |= finished;
+}
+
+void
+InputCachePrefetcher::Run() noexcept
+{
+	SetThreadName("prefetch");
+
+	std::unique_lock lock{mutex};
+
+	while (!quit) {
+		auto i = std::find_if(jobs.begin(), jobs.end(), [](const Job &job){
+			return !job.running;
+		});
+
+		if (i == jobs.end()) {
+			cond.wait(lock);
+			continue;
+		}
+
+		auto &job = *i;
+		job.running = true;
+
+		RunJob(lock, job);
+
+		cond.wait(lock, [this, &job]{
+			return !job || job.done || job.cancelled || quit;
+		});
+
+		const bool cancel = job && job.cancelled && !job.done;
+		const std::string uri = cancel ? job.uri : std::string{};
+
+		/* release the lease while our mutex is not locked */
+		std::list<Job> tmp;
+		tmp.splice(tmp.end(), jobs, i);
+		lock.unlock();
+		tmp.clear();
+
+		if (cancel)
+			/* don't waste any more bandwidth */
+			manager.CancelPrefetch(uri.c_str());
+
+		lock.lock();
+	}
+}
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_INPUT_CACHE_PREFETCHER_HXX
+#define MPD_INPUT_CACHE_PREFETCHER_HXX
+
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct InputCacheConfig;
+class InputCacheManager;
+class InputCacheRateLimiter;
+
+/**
+ * Loads files into the #InputCacheManager in worker threads before
+ * they are going to be played.  The number of worker threads limits
+ * the number of concurrent prefetches, and an optional
+ * #InputCacheRateLimiter limits their bandwidth.
+ */
+class InputCachePrefetcher {
+	InputCacheManager &manager;
+
+	const std::unique_ptr<InputCacheRateLimiter> limiter;
+
+	Mutex mutex;
+	Cond cond;
+
+	/**
+	 * The files which shall be prefetched, for each owner (see
+	 * Schedule()).  Protected by #mutex.
+	 */
+	std::map<const void *, std::vector<std::string>> wanted;
+
+	class Job;
+
+	/**
+	 * Files which have not been prefetched yet.  Protected by
+	 * #mutex.
+	 */
+	std::list<Job> jobs;
+
+	/**
+	 * Files which could not be prefetched.  They are not
+	 * retried by Schedule() until ForgetFailures() is called
+	 * (i.e. until the queue or the database changes).  Protected
+	 * by #mutex.
+	 */
+	std::set<std::string, std::less<>> failed;
+
+	std::list<Thread> threads;
+
+	/**
+	 * Protected by #mutex.
+	 */
+	bool quit = false;
+
+public:
+	InputCachePrefetcher(InputCacheManager &_manager,
+			     const InputCacheConfig &config);
+
+	/**
+	 * Stops all threads.  Prefetches which are still running are
+	 * not cancelled.
+	 */
+	~InputCachePrefetcher() noexcept;
+
+	InputCachePrefetcher(const InputCachePrefetcher &) = delete;
+	InputCachePrefetcher &operator=(const InputCachePrefetcher &) = delete;
+
+	/**
+	 * Replace the list of files which shall be prefetched on
+	 * behalf of the given owner (e.g. a #Partition).  Unfinished
+	 * prefetches of files which are not in the new list are
+	 * cancelled.
+	 *
+	 * @param owner an arbitrary pointer which identifies the
+	 * caller
+	 * @param uris the files to be prefetched, the most urgent one
+	 * first
+	 */
+	void Schedule(const void *owner, std::vector<std::string> &&uris) noexcept;
+
+	/**
+	 * Forget which files could not be prefetched, so the next
+	 * Schedule() call tries them again.  This shall be called
+	 * when the queue or the database has been modified.
+	 */
+	void ForgetFailures() noexcept;
+
+	/**
+	 * Shall the given file be prefetched on behalf of any owner?
+	 * Such files shall not be evicted from the cache.
+	 */
+	[[gnu::pure]]
+	bool IsWanted(std::string_view uri) noexcept;
+
+private:
+	[[gnu::pure]]
+	bool IsWantedLocked(std::string_view uri) const noexcept;
+
+	void RunJob(std::unique_lock<Mutex> &lock, Job &job) noexcept;
+	void Run() noexcept;
+};
+
+#endif
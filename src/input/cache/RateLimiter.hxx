@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_INPUT_CACHE_RATE_LIMITER_HXX
+#define MPD_INPUT_CACHE_RATE_LIMITER_HXX
+
+#include "thread/Mutex.hxx"
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ * Limits the total transfer rate of several threads.
+ */
+class InputCacheRateLimiter {
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * Bytes per second.
+	 */
+	const std::size_t rate;
+
+	Mutex mutex;
+
+	/**
+	 * The time when the next transfer may begin.  Protected by
+	 * #mutex.
+	 */
+	Clock::time_point next{};
+
+public:
+	explicit InputCacheRateLimiter(std::size_t _rate) noexcept
+		:rate(_rate) {}
+
+	/**
+	 * Account for a transfer of the given number of bytes.
+	 *
+	 * @return the duration the caller shall wait before
+	 * transferring more data
+	 */
+	Clock::duration Consume(std::size_t nbytes) noexcept {
+		const auto now = Clock::now();
+		const std::chrono::duration<double> cost{double(nbytes) / rate};
+
+		const std::scoped_lock lock{mutex};
+
+		if (next < now)
+			next = now;
+
+		next += std::chrono::duration_cast<Clock::duration>(cost);
+		return next - now;
+	}
+};
+
+#endif
@@ -50,7 +50,7 @@ CacheInputStream::IsAvailable() const noexcept
 }
 
 size_t
-CacheInputStream::Read(std::unique_lock<Mutex> &lock,
+CacheInputStream::Read(std::unique_lock<Mutex> &,
 		       void *ptr, size_t read_size)
 {
 	const auto _offset = offset;
@@ -60,9 +60,12 @@ CacheInputStream::Read(std::unique_lock<Mutex> &lock,
 
 	{
 		const ScopeUnlock unlock(mutex);
-		const std::scoped_lock<Mutex> protect(i.mutex);
 
-		nbytes = i.Read(lock, _offset, ptr, read_size);
+		/* InputCacheItem::Read() may wait for data, and it
+		   needs a lock on the item's mutex for that */
+		std::unique_lock<Mutex> protect(i.mutex);
+
+		nbytes = i.Read(protect, _offset, ptr, read_size);
 	}
 
 	offset += nbytes;
@@ -18,6 +18,7 @@
 #include "tag/Tag.hxx"
 #include "lib/fmt/ToBuffer.hxx"
 #include "event/Call.hxx"
+#include "event/DeferEvent.hxx"
 #include "event/Loop.hxx"
 #include "util/ASCII.hxx"
 #include "util/CNumberParser.hxx"
@@ -33,10 +34,13 @@
 #include "util/UriQueryParser.hxx"
 #endif
 
-#include <fmt/format.h>
-
+#include <algorithm>
 #include <cassert>
 #include <cinttypes>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 #include <string.h>
 
@@ -54,7 +58,14 @@ static const size_t CURL_MAX_BUFFERED = 512 * 1024;
  */
 static const size_t CURL_RESUME_AT = 384 * 1024;
 
+/**
+ * The size of each "Range" request if "parallel_ranges" is enabled.
+ */
+static constexpr size_t CURL_RANGE_SIZE = 1024 * 1024;
+
 class CurlInputStream final : public AsyncInputStream, CurlResponseHandler {
+	class RangeRequest;
+
 	/* some buffers which were passed to libcurl, which we have
 	   too free */
 	CurlSlist request_headers;
@@ -64,6 +75,52 @@ class CurlInputStream final : public AsyncInputStream, CurlResponseHandler {
 	/** parser for icy-metadata */
 	std::shared_ptr<IcyMetaDataParser> icy;
 
+	/**
+	 * Moves data from #ranges to the buffer and starts more
+	 * "Range" requests.  This is deferred because libcurl does
+	 * not allow adding requests from within its callbacks.
+	 */
+	DeferEvent defer_flush;
+
+	/**
+	 * "Range" requests for the data after #request, ordered by
+	 * offset.  They receive data into their own buffers in
+	 * parallel, and Flush() copies it to the #AsyncInputStream
+	 * buffer in the right order.
+	 *
+	 * Only accessed in the I/O thread.
+	 */
+	std::list<RangeRequest> ranges;
+
+	/**
+	 * The URL for #ranges, i.e. the URL of the first response
+	 * after redirects have been followed.
+	 */
+	std::string range_url;
+
+	/**
+	 * The file offset where the next item of #ranges will start.
+	 */
+	offset_type next_range_offset = 0;
+
+	/**
+	 * The number of bytes still expected from #request.  Only
+	 * used if #segmented is set.
+	 */
+	offset_type request_remaining = 0;
+
+	/**
+	 * Is #request still receiving data?
+	 */
+	bool request_active = false;
+
+	/**
+	 * Is the file being fetched with #ranges?  This is set after
+	 * the server has responded to the first "Range" request with
+	 * "206 Partial Content" (see "parallel_ranges").
+	 */
+	bool segmented = false;
+
 public:
 	template<typename I>
 	CurlInputStream(EventLoop &event_loop, const char *_url,
@@ -115,6 +172,39 @@ private:
 	 */
 	void SeekInternal(offset_type new_offset);
 
+	/**
+	 * The SeekInternal() implementation for #segmented mode.
+	 * Data which has already been received by #ranges is reused.
+	 */
+	void SeekRanges(offset_type new_offset);
+
+	/**
+	 * Start more "Range" requests until "parallel_ranges" are
+	 * in flight.
+	 *
+	 * Runs in the I/O thread.  The mutex must not be locked.
+	 *
+	 * Throws on error.
+	 */
+	void ScheduleRanges();
+
+	/**
+	 * Copy data from #ranges to the buffer, and release the
+	 * ranges which have been copied completely.
+	 *
+	 * Runs in the I/O thread.  Caller must lock the mutex.
+	 */
+	void Flush() noexcept;
+
+	/**
+	 * Stop fetching the file after an error.  Caller must lock
+	 * the mutex.
+	 */
+	void FailRanges(std::exception_ptr e) noexcept;
+
+	/* callback for #defer_flush */
+	void OnDeferredFlush() noexcept;
+
 	/* virtual methods from CurlResponseHandler */
 	void OnHeaders(unsigned status, Curl::Headers &&headers) override;
 	void OnData(std::span<const std::byte> data) override;
@@ -126,6 +216,73 @@ private:
 	void DoSeek(offset_type new_offset) override;
 };
 
+/**
+ * Fetches one part of the file for #CurlInputStream with a "Range"
+ * request.
+ */
+class CurlInputStream::RangeRequest final : CurlResponseHandler {
+	CurlInputStream &parent;
+
+	CurlRequest request;
+
+	const std::unique_ptr<std::byte[]> buffer;
+
+public:
+	const offset_type start;
+	const size_t length;
+
+	/**
+	 * The number of bytes which have been received into #buffer.
+	 */
+	size_t fill = 0;
+
+	/**
+	 * The number of bytes at the beginning of #buffer which have
+	 * been copied to the #AsyncInputStream buffer (or which have
+	 * been skipped after seeking).
+	 */
+	size_t position = 0;
+
+	std::exception_ptr error;
+
+	/**
+	 * Has the response ended (successfully or not)?
+	 */
+	bool done = false;
+
+	RangeRequest(CurlInputStream &_parent,
+		     offset_type _start, size_t _length);
+
+	RangeRequest(const RangeRequest &) = delete;
+	RangeRequest &operator=(const RangeRequest &) = delete;
+
+	void Start() {
+		request.Start();
+	}
+
+	bool Contains(offset_type _offset) const noexcept {
+		return _offset >= start && _offset < start + length;
+	}
+
+	/**
+	 * Return the data which has been received but not yet
+	 * copied to the #AsyncInputStream buffer.
+	 */
+	std::span<const std::byte> Read() const noexcept {
+		if (fill <= position)
+			return {};
+
+		return {buffer.get() + position, fill - position};
+	}
+
+private:
+	/* virtual methods from CurlResponseHandler */
+	void OnHeaders(unsigned status, Curl::Headers &&headers) override;
+	void OnData(std::span<const std::byte> data) override;
+	void OnEnd() override;
+	void OnError(std::exception_ptr e) noexcept override;
+};
+
 /** libcurl should accept "ICY 200 OK" */
 static struct curl_slist *http_200_aliases;
 
@@ -181,6 +338,11 @@ static long tcp_keepidle = default_tcp_keepidle;
 static const unsigned default_tcp_keepintvl = 60;
 static long tcp_keepintvl = default_tcp_keepintvl;
 
+/**
+ * The maximum number of "Range" requests per stream which receive
+ * data at the same time; 1 disables parallel fetching.
+ */
+static unsigned parallel_ranges = 1;
 
 static CurlInit *curl_init;
 
@@ -191,6 +353,12 @@ CurlInputStream::DoResume()
 {
 	assert(GetEventLoop().IsInside());
 
+	if (!request_active) {
+		/* the remaining data is in #ranges */
+		Flush();
+		return;
+	}
+
 	const ScopeUnlock unlock(mutex);
 	request->Resume();
 }
@@ -200,6 +368,8 @@ CurlInputStream::FreeEasy() noexcept
 {
 	assert(GetEventLoop().IsInside());
 
+	request_active = false;
+
 	if (request == nullptr)
 		return;
 
@@ -211,10 +381,34 @@ void
 CurlInputStream::FreeEasyIndirect() noexcept
 {
 	BlockingCall(GetEventLoop(), [this](){
+			defer_flush.Cancel();
+			ranges.clear();
 			FreeEasy();
 		});
 }
 
+/**
+ * Parse the complete length from a "Content-Range" response header,
+ * e.g. "bytes 0-1023/4096".
+ *
+ * @return the complete length or 0 if it is unknown
+ */
+[[gnu::pure]]
+static offset_type
+ParseContentRangeLength(const char *s) noexcept
+{
+	const char *slash = strchr(s, '/');
+	if (slash == nullptr)
+		return 0;
+
+	char *endptr;
+	const offset_type length = ParseUint64(slash + 1, &endptr);
+	if (endptr == slash + 1)
+		return 0;
+
+	return length;
+}
+
 #ifdef HAVE_ICU_CONVERTER
 
 static std::unique_ptr<IcuConverter>
@@ -274,12 +468,38 @@ CurlInputStream::OnHeaders(unsigned status,
 		return;
 	}
 
-	if (headers.find("accept-ranges") != headers.end())
-		seekable = true;
+	auto i = headers.end();
 
-	auto i = headers.find("content-length");
-	if (i != headers.end())
-		size = offset + ParseUint64(i->second.c_str());
+	if (status == 206) {
+		/* the server has accepted the "Range" request sent by
+		   Open(); fetch the rest of the file with parallel
+		   "Range" requests */
+		i = headers.find("content-range");
+		const offset_type length = i != headers.end()
+			? ParseContentRangeLength(i->second.c_str())
+			: 0;
+		if (length == 0)
+			throw std::runtime_error("Malformed Content-Range response header");
+
+		size = length;
+		seekable = true;
+		segmented = true;
+		request_remaining = std::min<offset_type>(size, CURL_RANGE_SIZE);
+		next_range_offset = request_remaining;
+
+		const char *url = nullptr;
+		request->GetEasy().GetInfo(CURLINFO_EFFECTIVE_URL, &url);
+		range_url = url != nullptr ? url : GetURI();
+
+		defer_flush.Schedule();
+	} else {
+		if (headers.find("accept-ranges") != headers.end())
+			seekable = true;
+
+		i = headers.find("content-length");
+		if (i != headers.end())
+			size = offset + ParseUint64(i->second.c_str());
+	}
 
 	i = headers.find("content-type");
 	if (i != headers.end())
@@ -340,12 +560,29 @@ CurlInputStream::OnData(std::span<const std::byte> data)
 	}
 
 	AppendToBuffer(data);
+
+	if (segmented)
+		request_remaining -= std::min<offset_type>(request_remaining,
+							   data.size());
 }
 
 void
 CurlInputStream::OnEnd()
 {
 	const std::scoped_lock<Mutex> protect(mutex);
+	request_active = false;
+
+	if (segmented) {
+		if (request_remaining > 0) {
+			FailRanges(std::make_exception_ptr(std::runtime_error("Premature end of response")));
+			return;
+		}
+
+		/* continue with the data received by #ranges */
+		defer_flush.Schedule();
+		return;
+	}
+
 	InvokeOnAvailable();
 
 	AsyncInputStream::SetClosed();
@@ -355,8 +592,15 @@ void
 CurlInputStream::OnError(std::exception_ptr e) noexcept
 {
 	const std::scoped_lock<Mutex> protect(mutex);
+	request_active = false;
 	postponed_exception = std::move(e);
 
+	if (segmented) {
+		/* cancel all #ranges */
+		segmented = false;
+		defer_flush.Schedule();
+	}
+
 	if (IsSeekPending())
 		SeekDone();
 	else if (!IsReady())
@@ -367,6 +611,161 @@ CurlInputStream::OnError(std::exception_ptr e) noexcept
 	AsyncInputStream::SetClosed();
 }
 
+void
+CurlInputStream::FailRanges(std::exception_ptr e) noexcept
+{
+	postponed_exception = std::move(e);
+
+	/* cancel all #ranges in the next Flush() call */
+	segmented = false;
+	defer_flush.Schedule();
+
+	InvokeOnAvailable();
+	AsyncInputStream::SetClosed();
+}
+
+void
+CurlInputStream::Flush() noexcept
+{
+	assert(GetEventLoop().IsInside());
+
+	if (!segmented) {
+		ranges.clear();
+		return;
+	}
+
+	if (request_active)
+		/* #request must deliver its data first */
+		return;
+
+	while (!ranges.empty()) {
+		auto &r = ranges.front();
+
+		if (auto src = r.Read(); !src.empty()) {
+			const size_t space = GetBufferSpace();
+			if (src.size() > space) {
+				/* resume in DoResume() after the client
+				   has consumed some of the buffer */
+				if (space > 0) {
+					AppendToBuffer(src.first(space));
+					r.position += space;
+				}
+
+				AsyncInputStream::Pause();
+				return;
+			}
+
+			AppendToBuffer(src);
+			r.position += src.size();
+		}
+
+		if (!r.done)
+			return;
+
+		if (r.error) {
+			FailRanges(std::move(r.error));
+			return;
+		}
+
+		ranges.pop_front();
+
+		/* start the next "Range" request */
+		defer_flush.Schedule();
+	}
+
+	if (next_range_offset >= size) {
+		/* all data has been received */
+		InvokeOnAvailable();
+		AsyncInputStream::SetClosed();
+	}
+}
+
+void
+CurlInputStream::ScheduleRanges()
+{
+	assert(GetEventLoop().IsInside());
+
+	if (!segmented)
+		return;
+
+	size_t n = ranges.size() + request_active;
+	while (n < parallel_ranges && next_range_offset < size) {
+		const size_t length =
+			std::min<offset_type>(size - next_range_offset,
+					      CURL_RANGE_SIZE);
+
+		auto &r = ranges.emplace_back(*this, next_range_offset,
+					      length);
+
+		try {
+			r.Start();
+		} catch (...) {
+			ranges.pop_back();
+			throw;
+		}
+
+		next_range_offset += length;
+		++n;
+	}
+}
+
+inline void
+CurlInputStream::OnDeferredFlush() noexcept
+{
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		Flush();
+	}
+
+	/* the mutex must not be locked while starting new requests,
+	   because libcurl may invoke #request's callbacks */
+	try {
+		ScheduleRanges();
+	} catch (...) {
+		const std::scoped_lock<Mutex> protect(mutex);
+		FailRanges(std::current_exception());
+	}
+}
+
+void
+CurlInputStream::RangeRequest::OnHeaders(unsigned status, Curl::Headers &&)
+{
+	if (status != 206)
+		throw HttpStatusError(status,
+				      FmtBuffer<64>("got HTTP status {} for Range request",
+						    status).c_str());
+}
+
+void
+CurlInputStream::RangeRequest::OnData(std::span<const std::byte> data)
+{
+	if (data.size() > length - fill)
+		throw std::runtime_error("Range response is too long");
+
+	std::copy(data.begin(), data.end(), buffer.get() + fill);
+	fill += data.size();
+
+	parent.defer_flush.Schedule();
+}
+
+void
+CurlInputStream::RangeRequest::OnEnd()
+{
+	if (fill < length)
+		error = std::make_exception_ptr(std::runtime_error("Premature end of Range response"));
+
+	done = true;
+	parent.defer_flush.Schedule();
+}
+
+void
+CurlInputStream::RangeRequest::OnError(std::exception_ptr e) noexcept
+{
+	error = std::move(e);
+	done = true;
+	parent.defer_flush.Schedule();
+}
+
 /*
  * InputPlugin methods
  *
@@ -422,6 +821,8 @@ input_curl_init(EventLoop &event_loop, const ConfigBlock &block)
 	tcp_keepidle  = block.GetBlockValue("tcp_keepidle",default_tcp_keepidle);
 
 	tcp_keepintvl = block.GetBlockValue("tcp_keepintvl",default_tcp_keepintvl);
+
+	parallel_ranges = block.GetPositiveValue("parallel_ranges", 1U);
 }
 
 static void
@@ -442,7 +843,8 @@ CurlInputStream::CurlInputStream(EventLoop &event_loop, const char *_url,
 	:AsyncInputStream(event_loop, _url, _mutex,
 			  CURL_MAX_BUFFERED,
 			  CURL_RESUME_AT),
-	 icy(std::forward<I>(_icy))
+	 icy(std::forward<I>(_icy)),
+	 defer_flush(event_loop, BIND_THIS_METHOD(OnDeferredFlush))
 {
 	request_headers.Append("Icy-Metadata: 1");
 
@@ -525,6 +927,23 @@ void
 CurlInputStream::StartRequest()
 {
 	request->Start();
+	request_active = true;
+}
+
+CurlInputStream::RangeRequest::RangeRequest(CurlInputStream &_parent,
+					    offset_type _start,
+					    size_t _length)
+	:parent(_parent),
+	 request(**curl_init,
+		 CreateEasy(parent.range_url.c_str(),
+			    parent.request_headers.Get()),
+		 *this),
+	 buffer(new std::byte[_length]),
+	 start(_start), length(_length)
+{
+	request.GetEasy().SetOption(CURLOPT_RANGE,
+				    FmtBuffer<64>("{}-{}", start,
+						  start + length - 1).c_str());
 }
 
 void
@@ -535,6 +954,12 @@ CurlInputStream::SeekInternal(offset_type new_offset)
 	FreeEasy();
 
 	offset = new_offset;
+
+	if (segmented) {
+		SeekRanges(new_offset);
+		return;
+	}
+
 	if (offset == size) {
 		/* seek to EOF: simulate empty result; avoid
 		   triggering a "416 Requested Range Not Satisfiable"
@@ -549,11 +974,52 @@ CurlInputStream::SeekInternal(offset_type new_offset)
 
 	if (offset > 0)
 		request->GetEasy().SetOption(CURLOPT_RANGE,
-					     fmt::format_int{offset}.c_str());
+					     FmtBuffer<40>("{}-", offset).c_str());
 
 	StartRequest();
 }
 
+void
+CurlInputStream::SeekRanges(offset_type new_offset)
+{
+	/* keep the range containing the new offset and all following
+	   ones */
+	auto i = std::find_if(ranges.begin(), ranges.end(),
+			      [new_offset](const RangeRequest &r){
+				      return r.Contains(new_offset);
+			      });
+	ranges.erase(ranges.begin(), i);
+
+	if (ranges.empty()) {
+		next_range_offset = new_offset;
+	} else if (auto &r = ranges.front();
+		   r.fill > new_offset - r.start) {
+		/* the data has already been received */
+		r.position = new_offset - r.start;
+	} else {
+		/* the data has not yet been received; instead of
+		   waiting for everything before it, request the rest
+		   of this range separately */
+		auto &n = ranges.emplace_front(*this, new_offset,
+					       r.start + r.length - new_offset);
+
+		try {
+			n.Start();
+		} catch (...) {
+			ranges.pop_front();
+			throw;
+		}
+
+		ranges.erase(std::next(ranges.begin()));
+	}
+
+	ScheduleRanges();
+
+	const std::scoped_lock<Mutex> protect(mutex);
+	SeekDone();
+	Flush();
+}
+
 void
 CurlInputStream::DoSeek(offset_type new_offset)
 {
@@ -581,6 +1047,15 @@ CurlInputStream::Open(const char *url,
 
 	BlockingCall(c->GetEventLoop(), [&c](){
 			c->InitEasy();
+
+			if (parallel_ranges > 1)
+				/* ask for the first part only; if the
+				   server supports this, the rest will
+				   be fetched by parallel "Range"
+				   requests (see OnHeaders()) */
+				c->request->GetEasy().SetOption(CURLOPT_RANGE,
+								FmtBuffer<64>("0-{}", CURL_RANGE_SIZE - 1).c_str());
+
 			c->StartRequest();
 		});
 
@@ -12,6 +12,9 @@
 #include "io/uring/ReadOperation.hxx"
 #include "io/uring/Queue.hxx"
 
+#include <algorithm>
+#include <list>
+
 #include <sys/stat.h>
 
 /**
@@ -19,6 +22,13 @@
  */
 static const size_t URING_MAX_READ = 256 * 1024;
 
+/**
+ * Submit at most this number of read requests at a time.  Keeping
+ * several requests in flight allows the kernel to merge them and
+ * hides the latency of slow storage.
+ */
+static constexpr std::size_t URING_MAX_INFLIGHT = 4;
+
 /**
  * Do not buffer more than this number of bytes.  It should be a
  * reasonable limit that doesn't make low-end machines suffer too
@@ -34,14 +44,67 @@ static const size_t URING_RESUME_AT = 384 * 1024;
 static EventLoop *uring_input_event_loop;
 static Uring::Queue *uring_input_queue;
 
-class UringInputStream final : public AsyncInputStream, Uring::ReadHandler {
+class UringInputStream final : public AsyncInputStream {
 	Uring::Queue &uring;
 
 	UniqueFileDescriptor fd;
 
+	/**
+	 * The file offset of the next read request to be submitted.
+	 */
 	uint64_t next_offset = 0;
 
-	std::unique_ptr<Uring::ReadOperation> read_operation;
+	/**
+	 * One read request of a contiguous range of the file.
+	 */
+	class Request final : public Uring::ReadHandler {
+		UringInputStream &stream;
+
+	public:
+		std::unique_ptr<Uring::ReadOperation> operation;
+
+		/**
+		 * The data read by the kernel; nullptr if the request
+		 * is still in flight.
+		 */
+		std::unique_ptr<std::byte[]> data;
+
+		/**
+		 * The number of bytes requested.
+		 */
+		const std::size_t size;
+
+		/**
+		 * The number of bytes actually read.
+		 */
+		std::size_t nbytes = 0;
+
+		Request(UringInputStream &_stream, std::size_t _size) noexcept
+			:stream(_stream), size(_size) {}
+
+		bool IsDone() const noexcept {
+			return !operation;
+		}
+
+	private:
+		/* virtual methods from class Uring::ReadHandler */
+		void OnRead(std::unique_ptr<std::byte[]> buffer,
+			    std::size_t _nbytes) noexcept override;
+		void OnReadError(int error) noexcept override;
+	};
+
+	/**
+	 * Submitted read requests in file order.  Their completions
+	 * may arrive in any order, but their data is appended to the
+	 * buffer in this order.
+	 */
+	std::list<Request> requests;
+
+	/**
+	 * The sum of all #requests sizes; this much buffer space is
+	 * reserved for them.
+	 */
+	std::size_t inflight_bytes = 0;
 
 public:
 	UringInputStream(EventLoop &event_loop, Uring::Queue &_uring,
@@ -60,102 +123,167 @@ public:
 		SetReady();
 
 		BlockingCall(GetEventLoop(), [this](){
-			SubmitRead();
+			SubmitReads();
 		});
 	}
 
 	~UringInputStream() noexcept override {
 		BlockingCall(GetEventLoop(), [this](){
-			CancelRead();
+			CancelReads();
 		});
 	}
 
 private:
-	void SubmitRead() noexcept;
+	void SubmitReads() noexcept;
 
-	void CancelRead() noexcept {
-		if (read_operation)
-			read_operation.release()->Cancel();
-	}
+	void CancelReads() noexcept;
+
+	/**
+	 * Append the data of all completed requests at the front of
+	 * #requests to the buffer.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void FlushRequests() noexcept;
+
+	void OnRequestDone(Request &request,
+			   std::unique_ptr<std::byte[]> data,
+			   std::size_t nbytes) noexcept;
+	void OnRequestError(int error) noexcept;
 
 protected:
 	/* virtual methods from AsyncInputStream */
 	void DoResume() override;
 	void DoSeek(offset_type new_offset) override;
 
-private:
-	/* virtual methods from class Uring::Operation */
-	void OnRead(std::unique_ptr<std::byte[]> buffer,
-		    std::size_t size) noexcept override;
-	void OnReadError(int error) noexcept override;
 };
 
 void
-UringInputStream::SubmitRead() noexcept
+UringInputStream::Request::OnRead(std::unique_ptr<std::byte[]> buffer,
+				  std::size_t _nbytes) noexcept
 {
-	assert(!read_operation);
+	operation.reset();
+	stream.OnRequestDone(*this, std::move(buffer), _nbytes);
+}
 
-	int64_t remaining = size - next_offset;
-	if (remaining <= 0)
-		return;
+void
+UringInputStream::Request::OnReadError(int error) noexcept
+{
+	operation.reset();
+	stream.OnRequestError(error);
+}
 
-	auto w = PrepareWriteBuffer();
-	if (w.empty()) {
-		Pause();
-		return;
+void
+UringInputStream::SubmitReads() noexcept
+{
+	while (requests.size() < URING_MAX_INFLIGHT) {
+		int64_t remaining = size - next_offset;
+		if (remaining <= 0)
+			return;
+
+		const std::size_t space = GetBufferSpace();
+		if (space <= inflight_bytes) {
+			if (requests.empty())
+				Pause();
+			return;
+		}
+
+		const std::size_t nbytes =
+			std::min<uint64_t>({space - inflight_bytes,
+					    URING_MAX_READ,
+					    uint64_t(remaining)});
+
+		auto &request = requests.emplace_back(*this, nbytes);
+		request.operation = std::make_unique<Uring::ReadOperation>();
+		request.operation->Start(uring, fd, next_offset, nbytes,
+					 request);
+
+		next_offset += nbytes;
+		inflight_bytes += nbytes;
 	}
+}
+
+void
+UringInputStream::CancelReads() noexcept
+{
+	for (auto &i : requests)
+		if (i.operation)
+			i.operation.release()->Cancel();
 
-	read_operation = std::make_unique<Uring::ReadOperation>();
-	read_operation->Start(uring, fd, next_offset,
-			      std::min(w.size(), URING_MAX_READ),
-			      *this);
+	requests.clear();
+	inflight_bytes = 0;
 }
 
 void
 UringInputStream::DoResume()
 {
-	SubmitRead();
+	SubmitReads();
 }
 
 void
 UringInputStream::DoSeek(offset_type new_offset)
 {
-	CancelRead();
+	CancelReads();
 
 	next_offset = offset = new_offset;
 	SeekDone();
-	SubmitRead();
+	SubmitReads();
+}
+
+inline void
+UringInputStream::FlushRequests() noexcept
+{
+	while (!requests.empty() && requests.front().IsDone()) {
+		auto &request = requests.front();
+
+		if (request.nbytes == 0) {
+			CancelReads();
+			postponed_exception = std::make_exception_ptr(std::runtime_error("Premature end of file"));
+			InvokeOnAvailable();
+			return;
+		}
+
+		AppendToBuffer({request.data.get(), request.nbytes});
+
+		if (request.nbytes < request.size) {
+			/* short read: the following requests are
+			   misaligned; discard them and continue
+			   after the data we got */
+			const uint64_t new_offset = next_offset - inflight_bytes
+				+ request.nbytes;
+			CancelReads();
+			next_offset = new_offset;
+			return;
+		}
+
+		inflight_bytes -= request.size;
+		requests.pop_front();
+	}
 }
 
 void
-UringInputStream::OnRead(std::unique_ptr<std::byte[]> data,
-			 std::size_t nbytes) noexcept
+UringInputStream::OnRequestDone(Request &request,
+				std::unique_ptr<std::byte[]> data,
+				std::size_t nbytes) noexcept
 {
-	read_operation.reset();
+	request.data = std::move(data);
+	request.nbytes = nbytes;
 
 	const std::scoped_lock<Mutex> protect(mutex);
 
-	if (nbytes == 0) {
-		postponed_exception = std::make_exception_ptr(std::runtime_error("Premature end of file"));
-		InvokeOnAvailable();
-		return;
-	}
+	FlushRequests();
 
-	auto w = PrepareWriteBuffer();
-	assert(w.size() >= nbytes);
-	memcpy(w.data(), data.get(), nbytes);
-	CommitWriteBuffer(nbytes);
-	next_offset += nbytes;
-	SubmitRead();
+	if (!postponed_exception)
+		SubmitReads();
 }
 
 void
-UringInputStream::OnReadError(int error) noexcept
+UringInputStream::OnRequestError(int error) noexcept
 {
-	read_operation.reset();
-
 	const std::scoped_lock<Mutex> protect(mutex);
 
+	CancelReads();
+
 	postponed_exception = std::make_exception_ptr(MakeErrno(error, "Read failed"));
 	InvokeOnAvailable();
 }
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "MappedFile.hxx"
+#include "FileReader.hxx"
+#include "fs/Path.hxx"
+#include "lib/fmt/SystemError.hxx"
+
+#include <cstdint>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+MappedFile::MappedFile(Path path)
+{
+	FileReader reader{path};
+
+	const auto size = reader.GetSize();
+	if (size == 0)
+		return;
+
+	if (size > SIZE_MAX)
+		throw std::runtime_error("File is too large");
+
+#ifdef _WIN32
+	buffer.ResizeDiscard(size);
+
+	std::size_t position = 0;
+	while (position < size) {
+		const std::size_t nbytes =
+			reader.Read(std::span<std::byte>{buffer}.subspan(position));
+		if (nbytes == 0)
+			throw std::runtime_error("Unexpected end of file");
+
+		position += nbytes;
+	}
+
+	data = buffer;
+#else
+	void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE,
+		       reader.GetFD().Get(), 0);
+	if (p == MAP_FAILED)
+		throw MakeErrno("Failed to map file");
+
+	/* we'll read the whole file sequentially */
+	madvise(p, size, MADV_WILLNEED);
+
+	data = {static_cast<const std::byte *>(p), std::size_t(size)};
+#endif
+}
+
+MappedFile::~MappedFile() noexcept
+{
+#ifndef _WIN32
+	if (!data.empty())
+		munmap(const_cast<std::byte *>(data.data()), data.size());
+#endif
+}
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_IO_MAPPED_FILE_HXX
+#define MPD_IO_MAPPED_FILE_HXX
+
+#ifdef _WIN32
+#include "util/AllocatedArray.hxx"
+#endif
+
+#include <cstddef>
+#include <span>
+
+class Path;
+
+/**
+ * Map a whole file into memory for reading.  On Windows, the file is
+ * read into a heap buffer instead.
+ */
+class MappedFile {
+#ifdef _WIN32
+	AllocatedArray<std::byte> buffer;
+#endif
+
+	std::span<const std::byte> data;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	explicit MappedFile(Path path);
+
+	~MappedFile() noexcept;
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	std::span<const std::byte> GetData() const noexcept {
+		return data;
+	}
+};
+
+#endif
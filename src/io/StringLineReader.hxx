@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "LineReader.hxx"
+
+#include <cstring>
+#include <string>
+
+/**
+ * A #LineReader which reads from a string in memory.
+ */
+class StringLineReader final : public LineReader {
+	std::string buffer;
+
+	std::size_t position = 0;
+
+public:
+	explicit StringLineReader(std::string &&_buffer) noexcept
+		:buffer(std::move(_buffer)) {}
+
+	/* virtual methods from class LineReader */
+	char *ReadLine() override {
+		if (position >= buffer.size())
+			return nullptr;
+
+		char *line = buffer.data() + position;
+		char *end = buffer.data() + buffer.size();
+		char *newline = (char *)std::memchr(line, '\n', end - line);
+		if (newline == nullptr)
+			/* the last line is not terminated; std::string
+			   has a null terminator at the end */
+			newline = end;
+
+		position = newline + 1 - buffer.data();
+
+		if (newline > line && newline[-1] == '\r')
+			--newline;
+		*newline = 0;
+		return line;
+	}
+};
@@ -89,6 +89,11 @@ CurlGlobal::CurlGlobal(EventLoop &_loop)
 
 	multi.SetOption(CURLMOPT_TIMERFUNCTION, TimerFunction);
 	multi.SetOption(CURLMOPT_TIMERDATA, this);
+
+	/* all requests share this multi handle's connection pool;
+	   allow concurrent requests to the same host to be
+	   multiplexed over one HTTP/2 connection */
+	multi.SetOption(CURLMOPT_PIPELINING, long(CURLPIPE_MULTIPLEX));
 }
 
 int
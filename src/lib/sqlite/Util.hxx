@@ -83,7 +83,7 @@ ExecuteBusy(sqlite3_stmt *stmt)
  *
  * Throws #SqliteError on error.
  */
-static bool
+static inline bool
 ExecuteRow(sqlite3_stmt *stmt)
 {
 	int result = ExecuteBusy(stmt);
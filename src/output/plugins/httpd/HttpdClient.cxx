@@ -15,12 +15,23 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
 
 using std::string_view_literals::operator""sv;
 
 HttpdClient::~HttpdClient() noexcept
 {
+	if (state == State::RESPONSE)
+		stream->RemoveClient();
+
 	if (IsDefined())
 		BufferedSocket::Close();
 }
@@ -42,12 +53,21 @@ void
 HttpdClient::BeginResponse() noexcept
 {
 	assert(state != State::RESPONSE);
+	assert(stream != nullptr);
+
+	{
+		const std::scoped_lock<Mutex> protect(httpd.mutex);
+		stream->AddClient();
+	}
 
 	state = State::RESPONSE;
 	current_page = nullptr;
 
-	if (!head_method)
-		httpd.SendHeader(*this);
+	/* send only pages which get broadcast from now on */
+	next_page = stream->GetPageRing().GetHead();
+
+	if (!head_method && stream->GetHeader() != nullptr)
+		PushHeader(stream->GetHeader());
 }
 
 bool
@@ -75,6 +95,9 @@ HttpdClient::HandleLine(std::string_view line) noexcept
 			should_reject = true;
 		}
 
+		stream = &httpd.FindStream(uri);
+		metadata_supported = !stream->ImplementsTag();
+
 		if (!rest.starts_with("HTTP/"sv)) {
 			/* HTTP/0.9 without request headers */
 
@@ -127,7 +150,7 @@ HttpdClient::SendResponse() noexcept
 		allocated =
 			icy_server_metadata_header(httpd.name, httpd.genre,
 						   httpd.website,
-						   httpd.content_type,
+						   stream->GetMimeType(),
 						   metaint);
 		response = allocated;
 	} else { /* revert to a normal HTTP request */
@@ -138,7 +161,7 @@ HttpdClient::SendResponse() noexcept
 					"Cache-Control: no-cache, no-store\r\n"
 					"Access-Control-Allow-Origin: *\r\n"
 					"\r\n",
-					httpd.content_type);
+					stream->GetMimeType());
 		response = allocated;
 	}
 
@@ -156,30 +179,10 @@ HttpdClient::SendResponse() noexcept
 }
 
 HttpdClient::HttpdClient(HttpdOutput &_httpd, UniqueSocketDescriptor _fd,
-			 EventLoop &_loop,
-			 bool _metadata_supported)
+			 EventLoop &_loop)
 	:BufferedSocket(_fd.Release(), _loop),
-	 httpd(_httpd),
-	 metadata_supported(_metadata_supported)
-{
-}
-
-void
-HttpdClient::ClearQueue() noexcept
+	 httpd(_httpd)
 {
-	assert(state == State::RESPONSE);
-
-	while (!pages.empty()) {
-#ifndef NDEBUG
-		auto &page = pages.front();
-		assert(queue_size >= page->size());
-		queue_size -= page->size();
-#endif
-
-		pages.pop();
-	}
-
-	assert(queue_size == 0);
 }
 
 void
@@ -188,7 +191,8 @@ HttpdClient::CancelQueue() noexcept
 	if (state != State::RESPONSE)
 		return;
 
-	ClearQueue();
+	/* skip all pages which have been broadcast so far */
+	next_page = stream->GetPageRing().GetHead();
 
 	if (current_page == nullptr)
 		event.CancelWrite();
@@ -203,46 +207,114 @@ HttpdClient::TryWritePage(const Page &page, size_t position) noexcept
 }
 
 ssize_t
-HttpdClient::TryWritePageN(const Page &page,
-			   size_t position, ssize_t n) noexcept
+HttpdClient::TryWritePages(ssize_t max_size) noexcept
 {
-	return n >= 0
-		? GetSocket().WriteNoWait({page.data() + position, (std::size_t)n})
-		: TryWritePage(page, position);
+	assert(current_page != nullptr);
+	assert(current_position < current_page->size());
+
+	std::size_t limit = max_size >= 0 ? std::size_t(max_size) : SIZE_MAX;
+
+#ifdef _WIN32
+	/* no sendmsg() on Windows; send only the current page */
+	return GetSocket().WriteNoWait({
+		current_page->data() + current_position,
+		std::min(current_page->size() - current_position, limit),
+	});
+#else
+	/* the pages are shared by all clients and are sent without
+	   copying them to a per-client buffer */
+	std::array<struct iovec, 64> v;
+	std::size_t n = 0;
+
+	const auto append = [&v, &n, &limit](const Page &page, std::size_t position){
+		const std::size_t size = std::min(page.size() - position, limit);
+		v[n++] = {
+			.iov_base = const_cast<std::byte *>(page.data() + position),
+			.iov_len = size,
+		};
+		limit -= size;
+	};
+
+	append(*current_page, current_position);
+
+	const auto &ring = stream->GetPageRing();
+	for (auto i = next_page;
+	     limit > 0 && n < v.size() && ring.IsAvailable(i); ++i)
+		append(*ring[i], 0);
+
+	return GetSocket().Send(std::span{v.data(), n}, MSG_DONTWAIT);
+#endif
 }
 
 ssize_t
 HttpdClient::GetBytesTillMetaData() const noexcept
 {
-	if (metadata_requested &&
-	    current_page->size() - current_position > metaint - metadata_fill)
+	if (metadata_requested)
 		return metaint - metadata_fill;
 
 	return -1;
 }
 
 inline bool
-HttpdClient::TryWrite() noexcept
+HttpdClient::NextPage() noexcept
 {
-	const std::scoped_lock<Mutex> protect(httpd.mutex);
+	const auto &ring = stream->GetPageRing();
 
-	assert(state == State::RESPONSE);
+	if (next_page < ring.GetTail()) {
+		/* the pages this client was going to send have
+		   already been discarded; continue with the newest
+		   one */
+		LogDebug(httpd_output_domain,
+			 "client is too slow, skipping pages");
+		next_page = std::max(ring.GetTail(), ring.GetHead() - 1);
+	}
 
-	if (current_page == nullptr) {
-		if (pages.empty()) {
-			/* another thread has removed the event source
-			   while this thread was waiting for
-			   httpd.mutex */
-			event.CancelWrite();
-			return true;
+	if (!ring.IsAvailable(next_page))
+		return false;
+
+	current_page = ring[next_page++];
+	current_position = 0;
+	return true;
+}
+
+inline void
+HttpdClient::ConsumePages(std::size_t nbytes) noexcept
+{
+	while (true) {
+		assert(current_page != nullptr);
+
+		const std::size_t remaining = current_page->size() - current_position;
+		if (nbytes < remaining) {
+			current_position += nbytes;
+			break;
 		}
 
-		current_page = pages.front();
-		pages.pop();
-		current_position = 0;
+		nbytes -= remaining;
 
-		assert(queue_size >= current_page->size());
-		queue_size -= current_page->size();
+		if (!NextPage()) {
+			assert(nbytes == 0);
+			current_page.reset();
+			break;
+		}
+
+		if (nbytes == 0)
+			break;
+	}
+}
+
+inline bool
+HttpdClient::TryWrite() noexcept
+{
+	const std::scoped_lock<Mutex> protect(httpd.mutex);
+
+	assert(state == State::RESPONSE);
+
+	if (current_page == nullptr && !NextPage()) {
+		/* another thread has removed the event source
+		   while this thread was waiting for
+		   httpd.mutex */
+		event.CancelWrite();
+		return true;
 	}
 
 	const ssize_t bytes_to_write = GetBytesTillMetaData();
@@ -297,9 +369,7 @@ HttpdClient::TryWrite() noexcept
 			metadata_current_position = 0;
 		}
 	} else {
-		ssize_t nbytes =
-			TryWritePageN(*current_page, current_position,
-				      bytes_to_write);
+		ssize_t nbytes = TryWritePages(bytes_to_write);
 		if (nbytes < 0) {
 			auto e = GetSocketError();
 			if (IsSocketErrorSendWouldBlock(e))
@@ -316,40 +386,46 @@ HttpdClient::TryWrite() noexcept
 			return false;
 		}
 
-		current_position += nbytes;
-		assert(current_position <= current_page->size());
+		ConsumePages(nbytes);
 
 		if (metadata_requested)
 			metadata_fill += nbytes;
 
-		if (current_position >= current_page->size()) {
-			current_page.reset();
-
-			if (pages.empty())
-				/* all pages are sent: remove the
-				   event source */
-				event.CancelWrite();
-		}
+		if (current_page == nullptr)
+			/* all pages are sent: remove the event
+			   source */
+			event.CancelWrite();
 	}
 
 	return true;
 }
 
 void
-HttpdClient::PushPage(PagePtr page) noexcept
+HttpdClient::PushHeader(PagePtr page) noexcept
 {
 	if (state != State::RESPONSE)
 		/* the client is still writing the HTTP request */
 		return;
 
-	if (queue_size > 256 * 1024) {
-		LogDebug(httpd_output_domain,
-			 "client is too slow, flushing its queue");
-		ClearQueue();
-	}
+	assert(current_page == nullptr);
+
+	current_page = std::move(page);
+	current_position = 0;
+
+	event.ScheduleWrite();
+}
+
+void
+HttpdClient::OnPagesAvailable() noexcept
+{
+	if (state != State::RESPONSE)
+		/* the client is still writing the HTTP request */
+		return;
 
-	queue_size += page->size();
-	pages.emplace(std::move(page));
+	if (current_page == nullptr &&
+	    next_page >= stream->GetPageRing().GetHead())
+		/* no new pages for the stream of this client */
+		return;
 
 	event.ScheduleWrite();
 }
@@ -8,12 +8,12 @@
 #include "util/IntrusiveList.hxx"
 
 #include <cstddef>
-#include <list>
-#include <queue>
+#include <cstdint>
 #include <string_view>
 
 class UniqueSocketDescriptor;
 class HttpdOutput;
+class HttpdStream;
 
 class HttpdClient final
 	: BufferedSocket,
@@ -24,6 +24,12 @@ class HttpdClient final
 	 */
 	HttpdOutput &httpd;
 
+	/**
+	 * The stream selected by the request path.  It is set after
+	 * the request line has been parsed.
+	 */
+	HttpdStream *stream = nullptr;
+
 	/**
 	 * The current state of the client.
 	 */
@@ -39,14 +45,10 @@ class HttpdClient final
 	} state = State::REQUEST;
 
 	/**
-	 * A queue of #Page objects to be sent to the client.
-	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
-
-	/**
-	 * The sum of all page sizes in #pages.
+	 * The sequence number of the next #PageRing page to be sent
+	 * after #current_page.
 	 */
-	size_t queue_size = 0;
+	uint_least64_t next_page;
 
 	/**
 	 * The #page which is currently being sent to the client.
@@ -73,9 +75,10 @@ class HttpdClient final
 
 	/**
 	 * Do we support sending Icy-Metadata to the client?  This is
-	 * disabled if the httpd audio output uses encoder tags.
+	 * disabled if the encoder of the selected stream implements
+	 * tags.
 	 */
-	bool metadata_supported;
+	bool metadata_supported = false;
 
 	/**
 	 * If we should sent icy metadata.
@@ -117,8 +120,7 @@ public:
 	 * @param _fd the socket file descriptor
 	 */
 	HttpdClient(HttpdOutput &httpd, UniqueSocketDescriptor _fd,
-		    EventLoop &_loop,
-		    bool _metadata_supported);
+		    EventLoop &_loop);
 
 	/**
 	 * Note: this does not remove the client from the
@@ -159,15 +161,29 @@ public:
 	ssize_t GetBytesTillMetaData() const noexcept;
 
 	ssize_t TryWritePage(const Page &page, size_t position) noexcept;
-	ssize_t TryWritePageN(const Page &page,
-			      size_t position, ssize_t n) noexcept;
+
+	/**
+	 * Send #current_page and the following pages from the
+	 * #PageRing with one system call.
+	 *
+	 * @param max_size the maximum number of bytes to send; -1 if
+	 * there is no limit
+	 */
+	ssize_t TryWritePages(ssize_t max_size) noexcept;
 
 	bool TryWrite() noexcept;
 
 	/**
-	 * Appends a page to the client's queue.
+	 * Sends this page before any page from the #PageRing.  This
+	 * is used for the encoder header right after the response
+	 * has begun.
 	 */
-	void PushPage(PagePtr page) noexcept;
+	void PushHeader(PagePtr page) noexcept;
+
+	/**
+	 * New pages have been added to the #PageRing.
+	 */
+	void OnPagesAvailable() noexcept;
 
 	/**
 	 * Sends the passed metadata.
@@ -175,7 +191,18 @@ public:
 	void PushMetaData(PagePtr page) noexcept;
 
 private:
-	void ClearQueue() noexcept;
+	/**
+	 * Make the next page from the #PageRing the #current_page.
+	 *
+	 * @return false if there is no such page
+	 */
+	bool NextPage() noexcept;
+
+	/**
+	 * Advance #current_page and #current_position after bytes
+	 * have been sent.
+	 */
+	void ConsumePages(std::size_t nbytes) noexcept;
 
 protected:
 	/* virtual methods from class BufferedSocket */
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "HttpdClient.hxx"
+#include "HttpdStream.hxx"
 #include "output/Interface.hxx"
 #include "output/Timer.hxx"
 #include "thread/Mutex.hxx"
@@ -18,17 +19,18 @@
 #include "util/Cast.hxx"
 #include "util/IntrusiveList.hxx"
 
-#include <queue>
+#include <forward_list>
 #include <list>
 #include <memory>
 #include <span>
+#include <string_view>
+#include <vector>
 
 struct ConfigBlock;
 class EventLoop;
 class ServerSocket;
 class HttpdClient;
-class PreparedEncoder;
-class Encoder;
+class WorkerGroup;
 struct Tag;
 
 class HttpdOutput final : AudioOutput, ServerSocket {
@@ -41,25 +43,39 @@ class HttpdOutput final : AudioOutput, ServerSocket {
 	bool pause;
 
 	/**
-	 * The configured encoder plugin.
+	 * All encodings of this output.  The first one is the
+	 * default stream, which is configured in the
+	 * "audio_output" block itself; the others are configured
+	 * with the "streams" setting.
 	 */
-	std::unique_ptr<PreparedEncoder> prepared_encoder;
-	Encoder *encoder = nullptr;
+	std::list<HttpdStream> streams;
 
 	/**
-	 * Number of bytes which were fed into the encoder, without
-	 * ever receiving new output.  This is used to estimate
-	 * whether MPD should manually flush the encoder, to avoid
-	 * buffer underruns in the client.
+	 * The PCM conversions needed by the streams whose encoders
+	 * want a different audio format.  Only valid while the output
+	 * is open.
 	 */
-	size_t unflushed_input = 0;
+	std::forward_list<HttpdConversion> conversions;
+
+	/**
+	 * Threads which run the encoders of all streams in
+	 * parallel.  Only valid while the output is open, and only if
+	 * there is more than one stream.
+	 */
+	std::unique_ptr<WorkerGroup> encoder_threads;
+
+	/**
+	 * The configured number of #encoder_threads.
+	 */
+	unsigned n_encoder_threads;
 
-public:
 	/**
-	 * The MIME type produced by the #encoder.
+	 * The streams which are encoded in the current Play() call.
+	 * This is a member only to avoid allocating it each time.
 	 */
-	const char *content_type;
+	std::vector<HttpdStream *> active_streams;
 
+public:
 	/**
 	 * This mutex protects the listener socket and the client
 	 * list.
@@ -67,8 +83,8 @@ public:
 	mutable Mutex mutex;
 
 	/**
-	 * This condition gets signalled when an item is removed from
-	 * #pages.
+	 * This condition gets signalled when pages are removed from
+	 * an #HttpdStream.
 	 */
 	Cond cond;
 
@@ -79,24 +95,11 @@ private:
 	 */
 	Timer *timer;
 
-	/**
-	 * The header page, which is sent to every client on connect.
-	 */
-	PagePtr header;
-
 	/**
 	 * The metadata, which is sent to every client.
 	 */
 	PagePtr metadata;
 
-	/**
-	 * The page queue, i.e. pages from the encoder to be
-	 * broadcasted to all clients.  This container is necessary to
-	 * pass pages from the OutputThread to the IOThread.  It is
-	 * protected by #mutex, and removing signals #cond.
-	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
-
 	InjectEvent defer_broadcast;
 
  public:
@@ -131,6 +134,7 @@ private:
 
 public:
 	HttpdOutput(EventLoop &_loop, const ConfigBlock &block);
+	~HttpdOutput() noexcept override;
 
 	static AudioOutput *Create(EventLoop &event_loop,
 				   const ConfigBlock &block) {
@@ -151,11 +155,11 @@ public:
 	}
 
 	/**
-	 * Caller must lock the mutex.
-	 *
 	 * Throws on error.
 	 */
-	void OpenEncoder(AudioFormat &audio_format);
+	void OpenEncoders(AudioFormat &audio_format);
+
+	void CloseEncoders() noexcept;
 
 	/**
 	 * Caller must lock the mutex.
@@ -186,6 +190,22 @@ public:
 		return HasClients();
 	}
 
+	/**
+	 * Find the stream for the given request path (without the
+	 * leading slash).  Falls back to the default stream.
+	 */
+	[[gnu::pure]]
+	HttpdStream &FindStream(std::string_view uri) noexcept;
+
+	/**
+	 * Schedule moving the pages of all streams into their
+	 * #PageRing and waking up the clients.  This method is
+	 * thread-safe.
+	 */
+	void ScheduleBroadcast() noexcept {
+		defer_broadcast.Schedule();
+	}
+
 	/**
 	 * Caller must lock the mutex.
 	 */
@@ -198,36 +218,13 @@ public:
 	 */
 	void RemoveClient(HttpdClient &client) noexcept;
 
-	/**
-	 * Sends the encoder header to the client.  This is called
-	 * right after the response headers have been sent.
-	 */
-	void SendHeader(HttpdClient &client) const noexcept;
-
 	[[gnu::pure]]
 	std::chrono::steady_clock::duration Delay() const noexcept override;
 
 	/**
-	 * Reads data from the encoder (as much as available) and
-	 * returns it as a new #page object.
-	 */
-	PagePtr ReadPage() noexcept;
-
-	/**
-	 * Broadcasts a page struct to all clients.
-	 *
-	 * Mutext must not be locked.
-	 */
-	void BroadcastPage(PagePtr page) noexcept;
-
-	/**
-	 * Broadcasts data from the encoder to all clients.
+	 * Convert and encode the data for all streams which have
+	 * clients, and broadcast the encoder output.
 	 *
-	 * Mutext must not be locked.
-	 */
-	void BroadcastFromEncoder() noexcept;
-
-	/**
 	 * Mutext must not be locked.
 	 *
 	 * Throws on error.
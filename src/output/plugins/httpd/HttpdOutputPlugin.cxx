@@ -5,30 +5,63 @@
 #include "HttpdInternal.hxx"
 #include "HttpdClient.hxx"
 #include "output/OutputAPI.hxx"
-#include "encoder/EncoderInterface.hxx"
-#include "encoder/Configured.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 #include "net/SocketAddress.hxx"
 #include "Page.hxx"
 #include "IcyMetaDataServer.hxx"
 #include "event/Call.hxx"
 #include "net/DscpParser.hxx"
+#include "thread/WorkerGroup.hxx"
+#include "lib/fmt/RuntimeError.hxx"
 #include "util/Domain.hxx"
 #include "util/DeleteDisposer.hxx"
+#include "util/IterableSplitString.hxx"
+#include "config/Block.hxx"
 #include "config/Net.hxx"
+#include "Log.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
+#include <string>
+#include <thread>
 
 #include <string.h>
 
 const Domain httpd_output_domain("httpd_output");
 
+/**
+ * Create a #ConfigBlock for an additional stream from all settings of
+ * the "audio_output" block whose names begin with the stream name
+ * and an underscore (e.g. "low_encoder" becomes "encoder").
+ */
+static ConfigBlock
+MakeStreamBlock(const ConfigBlock &block, std::string_view name)
+{
+	ConfigBlock result(block.line);
+
+	for (const auto &i : block.block_params) {
+		std::string_view param_name = i.name;
+		if (!param_name.starts_with(name))
+			continue;
+
+		param_name.remove_prefix(name.size());
+		if (!param_name.starts_with('_'))
+			continue;
+
+		param_name.remove_prefix(1);
+
+		i.used = true;
+		result.AddBlockParam(std::string{param_name}, i.value, i.line);
+	}
+
+	return result;
+}
+
 inline
 HttpdOutput::HttpdOutput(EventLoop &_loop, const ConfigBlock &block)
 	:AudioOutput(FLAG_ENABLE_DISABLE|FLAG_PAUSE),
 	 ServerSocket(_loop),
-	 prepared_encoder(CreateConfiguredEncoder(block)),
 	 defer_broadcast(_loop, BIND_THIS_METHOD(OnDeferredBroadcast)),
 	 name(block.GetBlockValue("name", "Set name in config")),
 	 genre(block.GetBlockValue("genre", "Set genre in config")),
@@ -48,12 +81,45 @@ HttpdOutput::HttpdOutput(EventLoop &_loop, const ConfigBlock &block)
 
 	ServerSocketAddGeneric(*this, block.GetBlockValue("bind_to_address"), block.GetBlockValue("port", 8000U));
 
-	/* determine content type */
-	content_type = prepared_encoder->GetMimeType();
-	if (content_type == nullptr)
-		content_type = "application/octet-stream";
+	/* set up the streams */
+
+	streams.emplace_back(*this, block, std::string_view{});
+
+	if (const auto *p = block.GetBlockParam("streams")) {
+		for (const std::string_view stream_name : IterableSplitString(p->value, ' ')) {
+			if (stream_name.empty())
+				continue;
+
+			const auto stream_block = MakeStreamBlock(block, stream_name);
+
+			try {
+				std::string_view path = stream_block.GetBlockValue("path", "");
+				if (path.empty())
+					path = stream_name;
+				else if (path.starts_with('/'))
+					path.remove_prefix(1);
+
+				if (std::any_of(streams.begin(), streams.end(),
+						[path](const HttpdStream &i){ return i.path == path; }))
+					throw FmtRuntimeError("Duplicate path {:?}", path);
+
+				streams.emplace_back(*this, stream_block, path);
+			} catch (...) {
+				std::throw_with_nested(FmtRuntimeError("Failed to configure stream {:?}",
+								       stream_name));
+			}
+		}
+	}
+
+	/* by default, run one encoder in the OutputThread and the
+	   others in one thread per CPU core */
+	n_encoder_threads = block.GetBlockValue("encoder_threads",
+						std::min<unsigned>(streams.size(),
+								   std::max(std::thread::hardware_concurrency(), 1U)) - 1);
 }
 
+HttpdOutput::~HttpdOutput() noexcept = default;
+
 inline void
 HttpdOutput::Bind()
 {
@@ -81,8 +147,7 @@ HttpdOutput::Unbind() noexcept
 inline void
 HttpdOutput::AddClient(UniqueSocketDescriptor fd) noexcept
 {
-	auto *client = new HttpdClient(*this, std::move(fd), GetEventLoop(),
-				       !encoder->ImplementsTag());
+	auto *client = new HttpdClient(*this, std::move(fd), GetEventLoop());
 	clients.push_front(*client);
 
 	/* pass metadata to client */
@@ -98,13 +163,14 @@ HttpdOutput::OnDeferredBroadcast() noexcept
 
 	const std::scoped_lock<Mutex> protect(mutex);
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
+	bool modified = false;
+	for (auto &stream : streams)
+		if (stream.FlushPages())
+			modified = true;
 
+	if (modified)
 		for (auto &client : clients)
-			client.PushPage(page);
-	}
+			client.OnPagesAvailable();
 
 	/* wake up the client that may be waiting for the queue to be
 	   flushed */
@@ -125,70 +191,79 @@ HttpdOutput::OnAccept(UniqueSocketDescriptor fd,
 		AddClient(std::move(fd));
 }
 
-PagePtr
-HttpdOutput::ReadPage() noexcept
+HttpdStream &
+HttpdOutput::FindStream(std::string_view uri) noexcept
 {
-	if (unflushed_input >= 65536) {
-		/* we have fed a lot of input into the encoder, but it
-		   didn't give anything back yet - flush now to avoid
-		   buffer underruns */
-		try {
-			encoder->Flush();
-		} catch (...) {
-			/* ignore */
-		}
-
-		unflushed_input = 0;
-	}
+	/* ignore the query string */
+	uri = uri.substr(0, uri.find('?'));
 
-	std::byte buffer[32768];
-
-	size_t size = 0;
-	do {
-		const auto b = std::span{buffer}.subspan(size);
-		const auto r = encoder->Read(b);
-		if (r.empty())
-			break;
-
-		unflushed_input = 0;
-
-		if (r.data() != b.data()) {
-			if (size == 0 && r.size() >= sizeof(buffer) / 2)
-				/* if the returned memory area is
-				   large (and nothing has been written
-				   to the stack buffer yet), copy
-				   right from the returned memory
-				   area, avoiding the copy into the
-				   buffer*/
-				return std::make_shared<Page>(r);
-
-			/* if the encoder did not write to the given
-			   buffer but instead returned its own buffer,
-			   we need to copy it so we have a contiguous
-			   buffer */
-			std::copy(r.begin(), r.end(), b.begin());
-		}
+	for (auto &stream : streams)
+		if (stream.path == uri)
+			return stream;
 
-		size += r.size();
-	} while (size < sizeof(buffer));
+	return streams.front();
+}
 
-	if (size == 0)
-		return nullptr;
+inline void
+HttpdOutput::OpenEncoders(AudioFormat &audio_format)
+{
+	/* one past the last stream which has been opened */
+	auto end = streams.begin();
+
+	try {
+		/* the default stream's encoder determines the
+		   format of this output */
+		audio_format = end->Open(audio_format);
+		++end;
+
+		/* the other encoders get their input from
+		   conversions; streams which need the same
+		   format share one */
+		while (end != streams.end()) {
+			auto &stream = *end;
+			const AudioFormat stream_format = stream.Open(audio_format);
+			++end;
+
+			if (stream_format == audio_format)
+				continue;
+
+			auto c = std::find_if(conversions.begin(), conversions.end(),
+					      [stream_format](const HttpdConversion &i){
+						      return i.format == stream_format;
+					      });
+			if (c == conversions.end())
+				c = conversions.emplace_after(conversions.before_begin(),
+							      audio_format, stream_format);
+
+			stream.SetConversion(&*c);
+		}
+	} catch (...) {
+		std::for_each(streams.begin(), end,
+			      [](HttpdStream &s){ s.Close(); });
+		conversions.clear();
+		throw;
+	}
 
-	return std::make_shared<Page>(std::span{buffer, size});
+	if (n_encoder_threads > 0 && streams.size() > 1) {
+		try {
+			encoder_threads = std::make_unique<WorkerGroup>(n_encoder_threads,
+									"httpd");
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to start encoder threads");
+		}
+	}
 }
 
 inline void
-HttpdOutput::OpenEncoder(AudioFormat &audio_format)
+HttpdOutput::CloseEncoders() noexcept
 {
-	encoder = prepared_encoder->Open(audio_format);
+	encoder_threads.reset();
 
-	/* we have to remember the encoder header, i.e. the first
-	   bytes of encoder output after opening it, because it has to
-	   be sent to every new client */
-	header = ReadPage();
+	for (auto &stream : streams)
+		stream.Close();
 
-	unflushed_input = 0;
+	conversions.clear();
 }
 
 void
@@ -199,7 +274,7 @@ HttpdOutput::Open(AudioFormat &audio_format)
 
 	const std::scoped_lock<Mutex> protect(mutex);
 
-	OpenEncoder(audio_format);
+	OpenEncoders(audio_format);
 
 	/* initialize other attributes */
 
@@ -222,11 +297,12 @@ HttpdOutput::Close() noexcept
 			const std::scoped_lock<Mutex> protect(mutex);
 			open = false;
 			clients.clear_and_dispose(DeleteDisposer());
-		});
 
-	header.reset();
+			for (auto &stream : streams)
+				stream.ClearPages();
+		});
 
-	delete encoder;
+	CloseEncoders();
 }
 
 void
@@ -238,13 +314,6 @@ HttpdOutput::RemoveClient(HttpdClient &client) noexcept
 				  DeleteDisposer());
 }
 
-void
-HttpdOutput::SendHeader(HttpdClient &client) const noexcept
-{
-	if (header != nullptr)
-		client.PushPage(header);
-}
-
 std::chrono::steady_clock::duration
 HttpdOutput::Delay() const noexcept
 {
@@ -266,49 +335,45 @@ HttpdOutput::Delay() const noexcept
 		: std::chrono::steady_clock::duration::zero();
 }
 
-void
-HttpdOutput::BroadcastPage(PagePtr page) noexcept
+inline void
+HttpdOutput::EncodeAndPlay(std::span<const std::byte> src)
 {
-	assert(page != nullptr);
+	active_streams.clear();
 
 	{
-		const std::scoped_lock<Mutex> lock(mutex);
-		pages.emplace(std::move(page));
+		const std::scoped_lock<Mutex> protect(mutex);
+		for (auto &stream : streams)
+			if (stream.HasClients())
+				active_streams.push_back(&stream);
 	}
 
-	defer_broadcast.Schedule();
-}
+	if (active_streams.empty())
+		return;
 
-void
-HttpdOutput::BroadcastFromEncoder() noexcept
-{
-	/* synchronize with the IOThread */
-	{
-		std::unique_lock<Mutex> lock(mutex);
-		cond.wait(lock, [this]{ return pages.empty(); });
-	}
+	/* run each conversion only once, even if several streams
+	   need it */
 
-	bool empty = true;
+	for (auto &c : conversions)
+		c.active = false;
 
-	PagePtr page;
-	while ((page = ReadPage()) != nullptr) {
-		const std::scoped_lock<Mutex> lock(mutex);
-		pages.emplace(std::move(page));
-		empty = false;
-	}
-
-	if (!empty)
-		defer_broadcast.Schedule();
-}
+	for (const auto *stream : active_streams)
+		if (auto *c = stream->GetConversion())
+			c->active = true;
 
-inline void
-HttpdOutput::EncodeAndPlay(std::span<const std::byte> src)
-{
-	encoder->Write(src);
+	for (auto &c : conversions)
+		if (c.active)
+			c.output = c.convert.Convert(src);
 
-	unflushed_input += src.size();
+	if (encoder_threads && active_streams.size() > 1)
+		encoder_threads->ForEach(active_streams.size(), [this, src](unsigned i){
+			active_streams[i]->Encode(src);
+		});
+	else
+		for (auto *stream : active_streams)
+			stream->Encode(src);
 
-	BroadcastFromEncoder();
+	for (auto *stream : active_streams)
+		stream->CheckError();
 }
 
 std::size_t
@@ -316,8 +381,7 @@ HttpdOutput::Play(std::span<const std::byte> src)
 {
 	pause = false;
 
-	if (LockHasClients())
-		EncodeAndPlay(src);
+	EncodeAndPlay(src);
 
 	if (!timer->IsStarted())
 		timer->Start();
@@ -342,39 +406,17 @@ HttpdOutput::Pause()
 void
 HttpdOutput::SendTag(const Tag &tag)
 {
-	if (encoder->ImplementsTag()) {
-		/* embed encoder tags */
-
-		/* flush the current stream, and end it */
-
-		try {
-			encoder->PreTag();
-		} catch (...) {
-			/* ignore */
-		}
-
-		BroadcastFromEncoder();
-
-		/* send the tag to the encoder - which starts a new
-		   stream now */
-
-		try {
-			encoder->SendTag(tag);
-			encoder->Flush();
-		} catch (...) {
-			/* ignore */
-		}
-
-		/* the first page generated by the encoder will now be
-		   used as the new "header" page, which is sent to all
-		   new clients */
+	bool icy = false;
+
+	for (auto &stream : streams) {
+		if (stream.ImplementsTag())
+			/* embed encoder tags */
+			stream.SendTag(tag);
+		else
+			icy = true;
+	}
 
-		auto page = ReadPage();
-		if (page != nullptr) {
-			header = page;
-			BroadcastPage(page);
-		}
-	} else {
+	if (icy) {
 		/* use Icy-Metadata */
 
 		static constexpr TagType types[] = {
@@ -396,10 +438,8 @@ HttpdOutput::CancelAllClients() noexcept
 {
 	const std::scoped_lock<Mutex> protect(mutex);
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
-	}
+	for (auto &stream : streams)
+		stream.ClearPages();
 
 	for (auto &client : clients)
 		client.CancelQueue();
@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "HttpdStream.hxx"
+#include "HttpdInternal.hxx"
+#include "encoder/EncoderInterface.hxx"
+#include "encoder/Configured.hxx"
+#include "config/Block.hxx"
+#include "pcm/AudioParser.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+HttpdStream::HttpdStream(HttpdOutput &_httpd, const ConfigBlock &block,
+			 std::string_view _path)
+	:httpd(_httpd), path(_path),
+	 prepared_encoder(CreateConfiguredEncoder(block))
+{
+	if (const auto *p = block.GetBlockParam("format"))
+		config_audio_format = p->With([](const char *s){
+			return ParseAudioFormat(s, true);
+		});
+	else
+		config_audio_format.Clear();
+}
+
+HttpdStream::~HttpdStream() noexcept = default;
+
+const char *
+HttpdStream::GetMimeType() const noexcept
+{
+	const char *mime_type = prepared_encoder->GetMimeType();
+	if (mime_type == nullptr)
+		mime_type = "application/octet-stream";
+
+	return mime_type;
+}
+
+AudioFormat
+HttpdStream::Open(AudioFormat audio_format)
+{
+	audio_format.ApplyMask(config_audio_format);
+
+	encoder = prepared_encoder->Open(audio_format);
+
+	/* we have to remember the encoder header, i.e. the first
+	   bytes of encoder output after opening it, because it has to
+	   be sent to every new client */
+	header = ReadPage();
+
+	unflushed_input = 0;
+	conversion = nullptr;
+	error = {};
+
+	return audio_format;
+}
+
+void
+HttpdStream::Close() noexcept
+{
+	assert(pages.empty());
+
+	header.reset();
+
+	delete encoder;
+	encoder = nullptr;
+	conversion = nullptr;
+}
+
+bool
+HttpdStream::ImplementsTag() const noexcept
+{
+	return encoder->ImplementsTag();
+}
+
+bool
+HttpdStream::FlushPages() noexcept
+{
+	if (pages.empty())
+		return false;
+
+	for (auto &page : pages)
+		ring.Push(std::move(page));
+	pages.clear();
+	return true;
+}
+
+void
+HttpdStream::ClearPages() noexcept
+{
+	pages.clear();
+	ring.Clear();
+}
+
+PagePtr
+HttpdStream::ReadPage() noexcept
+{
+	if (unflushed_input >= 65536) {
+		/* we have fed a lot of input into the encoder, but it
+		   didn't give anything back yet - flush now to avoid
+		   buffer underruns */
+		try {
+			encoder->Flush();
+		} catch (...) {
+			/* ignore */
+		}
+
+		unflushed_input = 0;
+	}
+
+	std::byte buffer[32768];
+
+	size_t size = 0;
+	do {
+		const auto b = std::span{buffer}.subspan(size);
+		const auto r = encoder->Read(b);
+		if (r.empty())
+			break;
+
+		unflushed_input = 0;
+
+		if (r.data() != b.data()) {
+			if (size == 0 && r.size() >= sizeof(buffer) / 2)
+				/* if the returned memory area is
+				   large (and nothing has been written
+				   to the stack buffer yet), copy
+				   right from the returned memory
+				   area, avoiding the copy into the
+				   buffer*/
+				return std::make_shared<Page>(r);
+
+			/* if the encoder did not write to the given
+			   buffer but instead returned its own buffer,
+			   we need to copy it so we have a contiguous
+			   buffer */
+			std::copy(r.begin(), r.end(), b.begin());
+		}
+
+		size += r.size();
+	} while (size < sizeof(buffer));
+
+	if (size == 0)
+		return nullptr;
+
+	return std::make_shared<Page>(std::span{buffer, size});
+}
+
+void
+HttpdStream::BroadcastPage(PagePtr page) noexcept
+{
+	assert(page != nullptr);
+
+	{
+		const std::scoped_lock<Mutex> lock(httpd.mutex);
+		pages.emplace_back(std::move(page));
+	}
+
+	httpd.ScheduleBroadcast();
+}
+
+void
+HttpdStream::BroadcastFromEncoder() noexcept
+{
+	/* synchronize with the IOThread */
+	{
+		std::unique_lock<Mutex> lock(httpd.mutex);
+		httpd.cond.wait(lock, [this]{ return pages.empty(); });
+	}
+
+	bool empty = true;
+
+	PagePtr page;
+	while ((page = ReadPage()) != nullptr) {
+		const std::scoped_lock<Mutex> lock(httpd.mutex);
+		pages.emplace_back(std::move(page));
+		empty = false;
+	}
+
+	if (!empty)
+		httpd.ScheduleBroadcast();
+}
+
+void
+HttpdStream::Encode(std::span<const std::byte> src) noexcept
+{
+	if (conversion != nullptr)
+		src = conversion->output;
+
+	try {
+		encoder->Write(src);
+	} catch (...) {
+		error = std::current_exception();
+		return;
+	}
+
+	unflushed_input += src.size();
+
+	BroadcastFromEncoder();
+}
+
+void
+HttpdStream::CheckError()
+{
+	if (error)
+		std::rethrow_exception(std::exchange(error, {}));
+}
+
+void
+HttpdStream::SendTag(const Tag &tag) noexcept
+{
+	assert(ImplementsTag());
+
+	/* flush the current stream, and end it */
+
+	try {
+		encoder->PreTag();
+	} catch (...) {
+		/* ignore */
+	}
+
+	BroadcastFromEncoder();
+
+	/* send the tag to the encoder - which starts a new
+	   stream now */
+
+	try {
+		encoder->SendTag(tag);
+		encoder->Flush();
+	} catch (...) {
+		/* ignore */
+	}
+
+	/* the first page generated by the encoder will now be
+	   used as the new "header" page, which is sent to all
+	   new clients */
+
+	auto page = ReadPage();
+	if (page != nullptr) {
+		header = page;
+		BroadcastPage(page);
+	}
+}
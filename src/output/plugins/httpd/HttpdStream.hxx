@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "Page.hxx"
+#include "PageRing.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "pcm/Convert.hxx"
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ConfigBlock;
+class HttpdOutput;
+class PreparedEncoder;
+class Encoder;
+struct Tag;
+
+/**
+ * Converts the PCM data of an #HttpdOutput to the audio format
+ * needed by the encoder of one or more #HttpdStream instances.
+ * Streams whose encoders want the same format share one instance,
+ * so each conversion runs only once per chunk.
+ */
+struct HttpdConversion {
+	const AudioFormat format;
+
+	PcmConvert convert;
+
+	/**
+	 * The converted data of the current chunk.
+	 */
+	std::span<const std::byte> output;
+
+	/**
+	 * Does at least one stream with clients need this conversion
+	 * for the current chunk?
+	 */
+	bool active = false;
+
+	/**
+	 * Throws on error.
+	 */
+	HttpdConversion(AudioFormat src_format, AudioFormat _format)
+		:format(_format), convert(src_format, _format) {}
+};
+
+/**
+ * One encoding of the audio stream served by an #HttpdOutput.  All
+ * streams are fed with the same (filtered) PCM data; each one has its
+ * own encoder and page queue.  Clients select a stream with the
+ * request path.
+ *
+ * Unless noted otherwise, all methods must be called in the
+ * OutputThread, and the #HttpdOutput mutex must not be locked.
+ */
+class HttpdStream {
+	HttpdOutput &httpd;
+
+public:
+	/**
+	 * The request path which selects this stream, without the
+	 * leading slash.  It is empty for the default stream.
+	 */
+	const std::string path;
+
+private:
+	/**
+	 * The configured encoder plugin.
+	 */
+	std::unique_ptr<PreparedEncoder> prepared_encoder;
+	Encoder *encoder = nullptr;
+
+	/**
+	 * Number of bytes which were fed into the encoder, without
+	 * ever receiving new output.  This is used to estimate
+	 * whether MPD should manually flush the encoder, to avoid
+	 * buffer underruns in the client.
+	 */
+	std::size_t unflushed_input = 0;
+
+	/**
+	 * The configured audio format of this stream; fields which
+	 * are not set are taken from the #HttpdOutput.
+	 */
+	AudioFormat config_audio_format;
+
+	/**
+	 * The conversion from the #HttpdOutput's audio format to the
+	 * one of this stream's encoder; nullptr if no conversion is
+	 * necessary.  The object is owned by the #HttpdOutput.
+	 */
+	HttpdConversion *conversion = nullptr;
+
+	/**
+	 * The header page, which is sent to every client on connect.
+	 */
+	PagePtr header;
+
+	/**
+	 * Pages from the encoder to be broadcasted to all clients of
+	 * this stream.  This container is necessary to pass pages
+	 * from the OutputThread to the IOThread.  It is protected by
+	 * the #HttpdOutput mutex, and removing signals its condition.
+	 */
+	std::vector<PagePtr> pages;
+
+	/**
+	 * The pages which were broadcast to all clients; each client
+	 * sends them from its own position.  This is only accessed in
+	 * the IOThread.
+	 */
+	PageRing ring{256 * 1024};
+
+	/**
+	 * The number of clients which receive this stream.
+	 * Protected by the #HttpdOutput mutex.
+	 */
+	unsigned n_clients = 0;
+
+	/**
+	 * An error which occurred in Encode().
+	 */
+	std::exception_ptr error;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param _path the request path without the leading slash
+	 */
+	HttpdStream(HttpdOutput &_httpd, const ConfigBlock &block,
+		    std::string_view _path);
+
+	~HttpdStream() noexcept;
+
+	HttpdStream(const HttpdStream &) = delete;
+	HttpdStream &operator=(const HttpdStream &) = delete;
+
+	/**
+	 * The MIME type produced by the encoder.
+	 */
+	const char *GetMimeType() const noexcept;
+
+	/**
+	 * Open the encoder.
+	 *
+	 * Throws on error.
+	 *
+	 * @param audio_format the audio format of the #HttpdOutput
+	 * @return the audio format expected by the encoder
+	 */
+	AudioFormat Open(AudioFormat audio_format);
+
+	void Close() noexcept;
+
+	void SetConversion(HttpdConversion *_conversion) noexcept {
+		conversion = _conversion;
+	}
+
+	HttpdConversion *GetConversion() const noexcept {
+		return conversion;
+	}
+
+	[[gnu::pure]]
+	bool ImplementsTag() const noexcept;
+
+	/**
+	 * Caller must lock the mutex.
+	 */
+	bool HasClients() const noexcept {
+		return n_clients > 0;
+	}
+
+	/**
+	 * Caller must lock the mutex.
+	 */
+	void AddClient() noexcept {
+		++n_clients;
+	}
+
+	/**
+	 * Caller must lock the mutex.
+	 */
+	void RemoveClient() noexcept {
+		--n_clients;
+	}
+
+	/**
+	 * Returns the encoder header, which is sent to every new
+	 * client.
+	 */
+	const PagePtr &GetHeader() const noexcept {
+		return header;
+	}
+
+	/**
+	 * Returns the pages to be sent to all clients.  May only be
+	 * used in the IOThread.
+	 */
+	const PageRing &GetPageRing() const noexcept {
+		return ring;
+	}
+
+	/**
+	 * Move all pages from the encoder into the #PageRing.
+	 *
+	 * Caller must lock the mutex.  May only be used in the
+	 * IOThread.
+	 *
+	 * @return true if there were new pages
+	 */
+	bool FlushPages() noexcept;
+
+	/**
+	 * Discard all pages which have not been sent yet.
+	 *
+	 * Caller must lock the mutex.  May only be used in the
+	 * IOThread.
+	 */
+	void ClearPages() noexcept;
+
+	/**
+	 * Feed PCM data (in the #HttpdOutput's audio format) into the
+	 * encoder and broadcast its output.  If a conversion is
+	 * configured, its output of the current chunk is used
+	 * instead of the given data.  This method may be called in a
+	 * worker thread; errors are stored and need to be collected
+	 * with CheckError().
+	 */
+	void Encode(std::span<const std::byte> src) noexcept;
+
+	/**
+	 * Rethrow the error which occurred in Encode() (if any).
+	 */
+	void CheckError();
+
+	/**
+	 * Pass a tag to an encoder which implements tags, and
+	 * broadcast the new stream header.
+	 */
+	void SendTag(const Tag &tag) noexcept;
+
+private:
+	/**
+	 * Reads data from the encoder (as much as available) and
+	 * returns it as a new #page object.
+	 */
+	PagePtr ReadPage() noexcept;
+
+	/**
+	 * Broadcasts a page struct to all clients.
+	 */
+	void BroadcastPage(PagePtr page) noexcept;
+
+	/**
+	 * Broadcasts data from the encoder to all clients.
+	 */
+	void BroadcastFromEncoder() noexcept;
+};
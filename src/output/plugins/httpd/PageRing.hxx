@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_PAGE_RING_HXX
+#define MPD_PAGE_RING_HXX
+
+#include "Page.hxx"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The most recent #Page objects broadcast to all clients of an
+ * #HttpdOutput.  Each page gets a sequence number, and each client
+ * remembers the sequence number of the next page it needs to send,
+ * instead of keeping its own queue.
+ *
+ * If the total size exceeds the limit, the oldest pages are
+ * discarded; clients which still need them are too slow.
+ */
+class PageRing {
+	/**
+	 * The maximum number of pages; must be a power of two.
+	 */
+	static constexpr std::size_t CAPACITY = 1024;
+
+	std::array<PagePtr, CAPACITY> pages;
+
+	/**
+	 * The sequence number of the next page to be pushed.
+	 */
+	uint_least64_t head = 0;
+
+	/**
+	 * The sequence number of the oldest page.
+	 */
+	uint_least64_t tail = 0;
+
+	/**
+	 * The sum of all page sizes.
+	 */
+	std::size_t size = 0;
+
+	const std::size_t max_size;
+
+public:
+	explicit constexpr PageRing(std::size_t _max_size) noexcept
+		:max_size(_max_size) {}
+
+	PageRing(const PageRing &) = delete;
+	PageRing &operator=(const PageRing &) = delete;
+
+	/**
+	 * Returns the sequence number which the next Push() call
+	 * will assign.
+	 */
+	uint_least64_t GetHead() const noexcept {
+		return head;
+	}
+
+	/**
+	 * Returns the sequence number of the oldest page which is
+	 * still available.
+	 */
+	uint_least64_t GetTail() const noexcept {
+		return tail;
+	}
+
+	bool IsAvailable(uint_least64_t sequence) const noexcept {
+		return sequence >= tail && sequence < head;
+	}
+
+	const PagePtr &operator[](uint_least64_t sequence) const noexcept {
+		assert(IsAvailable(sequence));
+
+		return pages[sequence % CAPACITY];
+	}
+
+	void Push(PagePtr page) noexcept {
+		assert(page != nullptr);
+
+		while (head - tail >= CAPACITY ||
+		       (tail < head && size + page->size() > max_size))
+			PopOldest();
+
+		size += page->size();
+		pages[head++ % CAPACITY] = std::move(page);
+	}
+
+	/**
+	 * Discard all pages.  Sequence numbers are not reused.
+	 */
+	void Clear() noexcept {
+		while (tail < head)
+			PopOldest();
+	}
+
+private:
+	void PopOldest() noexcept {
+		assert(tail < head);
+
+		auto &page = pages[tail++ % CAPACITY];
+		assert(size >= page->size());
+		size -= page->size();
+		page.reset();
+	}
+};
+
+#endif
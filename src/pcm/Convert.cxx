@@ -3,6 +3,8 @@
 
 #include "Convert.hxx"
 #include "ConfiguredResampler.hxx"
+#include "config/Data.hxx"
+#include "config/Option.hxx"
 #include "util/SpanCast.hxx"
 
 #include <cassert>
@@ -12,6 +14,10 @@ void
 pcm_convert_global_init(const ConfigData &config)
 {
 	pcm_resampler_global_init(config);
+
+#ifdef ENABLE_DSD
+	pcm_dsd_global_init(config.GetUnsigned(ConfigOption::DSD2PCM_THREADS, 0));
+#endif
 }
 
 PcmConvert::PcmConvert(const AudioFormat _src_format,
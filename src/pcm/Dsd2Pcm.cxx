@@ -31,10 +31,12 @@ or implied, of Sebastian Gesemann.
  */
 
 #include "Dsd2Pcm.hxx"
+#include "Simd.hxx"
 #include "Traits.hxx"
 #include "util/BitReverse.hxx"
 #include "util/GenerateArray.hxx"
 
+#include <algorithm> // for std::min()
 #include <cassert>
 
 #include <stdlib.h>
@@ -47,6 +49,19 @@ static constexpr size_t HTAPS = 48;
 static constexpr size_t CTABLES = (HTAPS + 7) / 8;
 
 static_assert(Dsd2Pcm::FIFOSIZE * 8 >= HTAPS * 2, "FIFOSIZE too small");
+static_assert(CTABLES == PcmSimdKernels::DSD2PCM_TABLES);
+
+/** number of previous DSD bytes needed for one output sample */
+static constexpr size_t HISTORY = CTABLES * 2 - 1;
+
+/** number of DSD bytes per Dsd2Pcm::TranslateWindow() iteration */
+static constexpr size_t WINDOW_BLOCK = 256;
+
+/**
+ * Below this number of samples, copying the FIFO to the window and
+ * back costs more than the SIMD kernel saves.
+ */
+static constexpr size_t WINDOW_MIN = 64;
 
 /*
  * Properties of this 96-tap lowpass filter when applied on a signal
@@ -225,11 +240,118 @@ Dsd2Pcm::TranslateSampleS24(size_t ffp, std::byte src) noexcept
 	return CalcOutputSampleS24(ffp);
 }
 
+/**
+ * Like Dsd2Pcm::CalcOutputSample(), but with a linear window instead
+ * of the FIFO (see #PcmSimdKernels::dsd2pcm_float).
+ */
+template<typename T>
+static T
+CalcWindowSample(const std::byte *window,
+		 const std::byte *reversed) noexcept;
+
+template<>
+inline float
+CalcWindowSample<float>(const std::byte *window,
+			const std::byte *reversed) noexcept
+{
+	double acc = 0;
+	for (size_t i = 0; i < CTABLES; ++i) {
+		std::byte bite1 = window[-ptrdiff_t(i)];
+		std::byte bite2 = reversed[ptrdiff_t(i) - ptrdiff_t(HISTORY)];
+		acc += double(ctables[i][static_cast<std::size_t>(bite1)]
+			      + ctables[i][static_cast<std::size_t>(bite2)]);
+	}
+	return float(acc);
+}
+
+template<>
+inline int32_t
+CalcWindowSample<int32_t>(const std::byte *window,
+			  const std::byte *reversed) noexcept
+{
+	int32_t acc = 0;
+	for (size_t i = 0; i < CTABLES; ++i) {
+		std::byte bite1 = window[-ptrdiff_t(i)];
+		std::byte bite2 = reversed[ptrdiff_t(i) - ptrdiff_t(HISTORY)];
+		acc += ctables_s24[i][static_cast<std::size_t>(bite1)]
+			+ ctables_s24[i][static_cast<std::size_t>(bite2)];
+	}
+	return acc;
+}
+
+template<typename T, typename K>
+inline void
+Dsd2Pcm::TranslateWindow(size_t samples,
+			 const std::byte *gcc_restrict src, ptrdiff_t src_stride,
+			 T *dst, ptrdiff_t dst_stride,
+			 K kernel, const T *tables) noexcept
+{
+	std::array<std::byte, HISTORY + WINDOW_BLOCK> window, reversed;
+	std::array<T, WINDOW_BLOCK> out;
+
+	/* load the history from the FIFO; ApplySample() has
+	   already bit-reversed all but the CTABLES newest bytes */
+	for (size_t k = 1; k <= HISTORY; ++k) {
+		std::byte b = fifo[(fifopos - k) & FIFOMASK];
+		if (k > CTABLES)
+			b = BitReverse(b);
+
+		window[HISTORY - k] = b;
+		reversed[HISTORY - k] = BitReverse(b);
+	}
+
+	fifopos = (fifopos + samples) & FIFOMASK;
+
+	while (samples > 0) {
+		const size_t n = std::min(samples, WINDOW_BLOCK);
+		samples -= n;
+
+		for (size_t j = 0; j < n; ++j) {
+			window[HISTORY + j] = *src;
+			reversed[HISTORY + j] = BitReverse(*src);
+			src += src_stride;
+		}
+
+		const std::byte *w = window.data() + HISTORY;
+		const std::byte *r = reversed.data() + HISTORY;
+
+		size_t j = kernel(out.data(), w, r, n, tables);
+		for (; j < n; ++j)
+			out[j] = CalcWindowSample<T>(w + j, r + j);
+
+		for (j = 0; j < n; ++j) {
+			*dst = out[j];
+			dst += dst_stride;
+		}
+
+		/* the newest bytes are the history of the next
+		   block */
+		memmove(window.data(), window.data() + n, HISTORY);
+		memmove(reversed.data(), reversed.data() + n, HISTORY);
+	}
+
+	/* store the history in the FIFO just like ApplySample()
+	   would have */
+	for (size_t k = 1; k <= HISTORY; ++k) {
+		const std::byte b = window[HISTORY - k];
+		fifo[(fifopos - k) & FIFOMASK] = k > CTABLES ? BitReverse(b) : b;
+	}
+}
+
 void
 Dsd2Pcm::Translate(size_t samples,
 		   const std::byte *gcc_restrict src, ptrdiff_t src_stride,
 		   float *dst, ptrdiff_t dst_stride) noexcept
 {
+	if (samples >= WINDOW_MIN) {
+		if (const auto kernel = GetPcmSimdKernel(&PcmSimdKernels::dsd2pcm_float)) {
+			TranslateWindow(samples, src, src_stride,
+					dst, dst_stride,
+					kernel, ctables.front().data());
+			return;
+		}
+	}
+
 	size_t ffp = fifopos;
 	while (samples-- > 0) {
 		std::byte bite1 = *src;
@@ -246,6 +368,15 @@ Dsd2Pcm::TranslateS24(size_t samples,
 		      const std::byte *gcc_restrict src, ptrdiff_t src_stride,
 		      int32_t *dst, ptrdiff_t dst_stride) noexcept
 {
+	if (samples >= WINDOW_MIN) {
+		if (const auto kernel = GetPcmSimdKernel(&PcmSimdKernels::dsd2pcm_s24)) {
+			TranslateWindow(samples, src, src_stride,
+					dst, dst_stride,
+					kernel, ctables_s24.front().data());
+			return;
+		}
+	}
+
 	size_t ffp = fifopos;
 	while (samples-- > 0) {
 		std::byte bite1 = *src;
@@ -263,7 +394,10 @@ MultiDsd2Pcm::Translate(unsigned channels, size_t n_frames,
 {
 	assert(channels <= per_channel.max_size());
 
-	if (channels == 2) {
+	/* the SIMD kernel is faster than the interleaved stereo
+	   loop */
+	if (channels == 2 &&
+	    GetPcmSimdKernel(&PcmSimdKernels::dsd2pcm_float) == nullptr) {
 		TranslateStereo(n_frames, src, dest);
 		return;
 	}
@@ -279,13 +413,13 @@ inline void
 MultiDsd2Pcm::TranslateStereo(size_t n_frames,
 			      const std::byte *src, float *dest) noexcept
 {
-	size_t ffp = fifopos;
+	size_t ffp = per_channel[0].fifopos;
 	while (n_frames-- > 0) {
 		*dest++ = per_channel[0].TranslateSample(ffp, *src++);
 		*dest++ = per_channel[1].TranslateSample(ffp, *src++);
 		ffp = (ffp + 1) & Dsd2Pcm::FIFOMASK;
 	}
-	fifopos = ffp;
+	per_channel[0].fifopos = per_channel[1].fifopos = ffp;
 }
 
 void
@@ -294,7 +428,10 @@ MultiDsd2Pcm::TranslateS24(unsigned channels, size_t n_frames,
 {
 	assert(channels <= per_channel.max_size());
 
-	if (channels == 2) {
+	/* the SIMD kernel is faster than the interleaved stereo
+	   loop */
+	if (channels == 2 &&
+	    GetPcmSimdKernel(&PcmSimdKernels::dsd2pcm_s24) == nullptr) {
 		TranslateStereoS24(n_frames, src, dest);
 		return;
 	}
@@ -310,11 +447,11 @@ inline void
 MultiDsd2Pcm::TranslateStereoS24(size_t n_frames,
 				 const std::byte *src, int32_t *dest) noexcept
 {
-	size_t ffp = fifopos;
+	size_t ffp = per_channel[0].fifopos;
 	while (n_frames-- > 0) {
 		*dest++ = per_channel[0].TranslateSampleS24(ffp, *src++);
 		*dest++ = per_channel[1].TranslateSampleS24(ffp, *src++);
 		ffp = (ffp + 1) & Dsd2Pcm::FIFOMASK;
 	}
-	fifopos = ffp;
+	per_channel[0].fifopos = per_channel[1].fifopos = ffp;
 }
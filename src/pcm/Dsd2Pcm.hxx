@@ -89,18 +89,26 @@ private:
 
 	int32_t CalcOutputSampleS24(size_t ffp) const noexcept;
 	int32_t TranslateSampleS24(size_t ffp, std::byte src) noexcept;
+
+	/**
+	 * Translate with a SIMD kernel (see #PcmSimdKernels) which
+	 * operates on a linear window of DSD bytes instead of the
+	 * FIFO.
+	 */
+	template<typename T, typename K>
+	void TranslateWindow(size_t samples,
+			     const std::byte *src, ptrdiff_t src_stride,
+			     T *dst, ptrdiff_t dst_stride,
+			     K kernel, const T *tables) noexcept;
 };
 
 class MultiDsd2Pcm {
 	std::array<Dsd2Pcm, MAX_CHANNELS> per_channel;
 
-	size_t fifopos = 0;
-
 public:
 	void Reset() noexcept {
 		for (auto &i : per_channel)
 			i.Reset();
-		fifopos = 0;
 	}
 
 	void Translate(unsigned channels, size_t n_frames,
@@ -109,6 +117,25 @@ public:
 	void TranslateS24(unsigned channels, size_t n_frames,
 			  const std::byte *src, int32_t *dest) noexcept;
 
+	/**
+	 * Translate only one channel of interleaved DSD input into
+	 * a non-interleaved buffer.  Different channels may be
+	 * translated by different threads concurrently.
+	 */
+	void TranslateChannel(unsigned channel, unsigned channels,
+			      size_t n_frames,
+			      const std::byte *src, float *dest) noexcept {
+		per_channel[channel].Translate(n_frames, src + channel, channels,
+					       dest, 1);
+	}
+
+	void TranslateChannelS24(unsigned channel, unsigned channels,
+				 size_t n_frames,
+				 const std::byte *src, int32_t *dest) noexcept {
+		per_channel[channel].TranslateS24(n_frames, src + channel, channels,
+						  dest, 1);
+	}
+
 private:
 	/**
 	 * Optimized implementation for the common case.
@@ -4,6 +4,7 @@
 #include "Mix.hxx"
 #include "Volume.hxx"
 #include "Clamp.hxx"
+#include "Simd.hxx"
 #include "Traits.hxx"
 #include "util/Clamp.hxx"
 #include "util/Math.hxx"
@@ -59,6 +60,14 @@ static void
 pcm_add_vol_float(float *buffer1, const float *buffer2,
 		  unsigned num_samples, float volume1, float volume2) noexcept
 {
+	if (const auto simd = GetPcmSimdKernel(&PcmSimdKernels::add_volume_float)) {
+		const size_t done = simd(buffer1, buffer2, num_samples,
+					 volume1, volume2);
+		buffer1 += done;
+		buffer2 += done;
+		num_samples -= done;
+	}
+
 	while (num_samples > 0) {
 		float sample1 = *buffer1;
 		float sample2 = *buffer2++;
@@ -125,32 +134,47 @@ PcmAdd(typename Traits::value_type _a, typename Traits::value_type _b) noexcept
 	return PcmClamp<F, Traits>(a + b);
 }
 
-template<SampleFormat F, class Traits=SampleTraits<F>>
+/**
+ * @param simd the #PcmSimdKernels attribute which implements this
+ * operation
+ */
+template<SampleFormat F, auto simd, class Traits=SampleTraits<F>>
 static void
 PcmAdd(typename Traits::pointer a,
        typename Traits::const_pointer b,
        size_t n) noexcept
 {
-	for (size_t i = 0; i != n; ++i)
+	size_t i = 0;
+	if (const auto kernel = GetPcmSimdKernel(simd))
+		i = kernel(a, b, n);
+
+	for (; i != n; ++i)
 		a[i] = PcmAdd<F, Traits>(a[i], b[i]);
 }
 
-template<SampleFormat F, class Traits=SampleTraits<F>>
+template<SampleFormat F, auto simd, class Traits=SampleTraits<F>>
 static void
 PcmAddVoid(void *a, const void *b, size_t size) noexcept
 {
 	constexpr size_t sample_size = Traits::SAMPLE_SIZE;
 	assert(size % sample_size == 0);
 
-	PcmAdd<F, Traits>(typename Traits::pointer(a),
-			  typename Traits::const_pointer(b),
-			  size / sample_size);
+	PcmAdd<F, simd, Traits>(typename Traits::pointer(a),
+				typename Traits::const_pointer(b),
+				size / sample_size);
 }
 
 static void
 pcm_add_float(float *buffer1, const float *buffer2,
 	      unsigned num_samples) noexcept
 {
+	if (const auto simd = GetPcmSimdKernel(&PcmSimdKernels::add_float)) {
+		const size_t done = simd(buffer1, buffer2, num_samples);
+		buffer1 += done;
+		buffer2 += done;
+		num_samples -= done;
+	}
+
 	while (num_samples > 0) {
 		float sample1 = *buffer1;
 		float sample2 = *buffer2++;
@@ -170,19 +194,23 @@ pcm_add(void *buffer1, const void *buffer2, size_t size,
 		return false;
 
 	case SampleFormat::S8:
-		PcmAddVoid<SampleFormat::S8>(buffer1, buffer2, size);
+		PcmAddVoid<SampleFormat::S8,
+			   &PcmSimdKernels::add_8>(buffer1, buffer2, size);
 		return true;
 
 	case SampleFormat::S16:
-		PcmAddVoid<SampleFormat::S16>(buffer1, buffer2, size);
+		PcmAddVoid<SampleFormat::S16,
+			   &PcmSimdKernels::add_16>(buffer1, buffer2, size);
 		return true;
 
 	case SampleFormat::S24_P32:
-		PcmAddVoid<SampleFormat::S24_P32>(buffer1, buffer2, size);
+		PcmAddVoid<SampleFormat::S24_P32,
+			   &PcmSimdKernels::add_24>(buffer1, buffer2, size);
 		return true;
 
 	case SampleFormat::S32:
-		PcmAddVoid<SampleFormat::S32>(buffer1, buffer2, size);
+		PcmAddVoid<SampleFormat::S32,
+			   &PcmSimdKernels::add_32>(buffer1, buffer2, size);
 		return true;
 
 	case SampleFormat::FLOAT:
@@ -3,8 +3,80 @@
 
 #include "PcmDsd.hxx"
 #include "Dsd2Pcm.hxx"
+#include "thread/WorkerGroup.hxx"
+#include "Interleave.hxx"
+#include "Log.hxx"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <type_traits>
+
+/**
+ * Below this number of frames, waking up the threads costs more than
+ * converting in the calling thread.
+ */
+static constexpr std::size_t THREADS_MIN_FRAMES = 512;
+
+static unsigned pcm_dsd_threads = 0;
+
+void
+pcm_dsd_global_init(unsigned n_threads) noexcept
+{
+	pcm_dsd_threads = n_threads;
+}
+
+PcmDsd::PcmDsd() noexcept = default;
+PcmDsd::~PcmDsd() noexcept = default;
+
+WorkerGroup *
+PcmDsd::GetThreads(unsigned channels, std::size_t num_frames) noexcept
+{
+	if (pcm_dsd_threads == 0 || channels < 2 ||
+	    num_frames < THREADS_MIN_FRAMES || threads_failed)
+		return nullptr;
+
+	if (!threads) {
+		try {
+			threads = std::make_unique<WorkerGroup>(std::min(pcm_dsd_threads,
+									 channels - 1),
+								"pcm");
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to start DSD conversion threads");
+			threads_failed = true;
+			return nullptr;
+		}
+	}
+
+	return threads.get();
+}
+
+/**
+ * Convert each channel into its own part of a non-interleaved
+ * buffer, one channel per thread, and interleave the result.
+ */
+template<typename T, typename F>
+static void
+TranslateParallel(WorkerGroup &threads, PcmBuffer &planar_buffer,
+		  unsigned channels, std::size_t num_frames,
+		  T *dest, F &&f) noexcept
+{
+	auto *planar = planar_buffer.GetT<T>(channels * num_frames);
+
+	threads.ForEach(channels, [planar, num_frames, &f](unsigned i){
+		f(i, planar + i * num_frames);
+	});
+
+	std::array<const T *, MAX_CHANNELS> src;
+	for (unsigned i = 0; i < channels; ++i)
+		src[i] = planar + i * num_frames;
+
+	if constexpr (std::is_same_v<T, float>)
+		PcmInterleaveFloat(dest, {src.data(), channels}, num_frames);
+	else
+		PcmInterleave32(dest, {src.data(), channels}, num_frames);
+}
 
 std::span<const float>
 PcmDsd::ToFloat(unsigned channels, std::span<const std::byte> src) noexcept
@@ -17,7 +89,15 @@ PcmDsd::ToFloat(unsigned channels, std::span<const std::byte> src) noexcept
 
 	auto *dest = buffer.GetT<float>(num_samples);
 
-	dsd2pcm.Translate(channels, num_frames, src.data(), dest);
+	if (auto *t = GetThreads(channels, num_frames)) {
+		TranslateParallel(*t, planar_buffer, channels, num_frames, dest,
+				  [this, channels, num_frames, src](unsigned i, float *planar){
+					  dsd2pcm.TranslateChannel(i, channels, num_frames,
+								   src.data(), planar);
+				  });
+	} else
+		dsd2pcm.Translate(channels, num_frames, src.data(), dest);
+
 	return { dest, num_samples };
 }
 
@@ -32,6 +112,14 @@ PcmDsd::ToS24(unsigned channels, std::span<const std::byte> src) noexcept
 
 	auto *dest = buffer.GetT<int32_t>(num_samples);
 
-	dsd2pcm.TranslateS24(channels, num_frames, src.data(), dest);
+	if (auto *t = GetThreads(channels, num_frames)) {
+		TranslateParallel(*t, planar_buffer, channels, num_frames, dest,
+				  [this, channels, num_frames, src](unsigned i, int32_t *planar){
+					  dsd2pcm.TranslateChannelS24(i, channels, num_frames,
+								      src.data(), planar);
+				  });
+	} else
+		dsd2pcm.TranslateS24(channels, num_frames, src.data(), dest);
+
 	return { dest, num_samples };
 }
@@ -7,17 +7,51 @@
 #include "Dsd2Pcm.hxx"
 
 #include <cstdint>
+#include <memory>
 #include <span>
 
+class WorkerGroup;
+
+/**
+ * Set the number of additional threads which may be used by each
+ * #PcmDsd instance to convert channels in parallel.  Zero (the
+ * default) disables multi-threading.
+ */
+void
+pcm_dsd_global_init(unsigned n_threads) noexcept;
+
 /**
  * Wrapper for the dsd2pcm library.
  */
 class PcmDsd {
 	PcmBuffer buffer;
 
+	/**
+	 * Non-interleaved output of the channel threads.
+	 */
+	PcmBuffer planar_buffer;
+
 	MultiDsd2Pcm dsd2pcm;
 
+	/**
+	 * Created on demand if pcm_dsd_global_init() has enabled
+	 * multi-threading.
+	 */
+	std::unique_ptr<WorkerGroup> threads;
+
+	/**
+	 * Set to true if launching the #threads has failed; don't
+	 * try again.
+	 */
+	bool threads_failed = false;
+
 public:
+	PcmDsd() noexcept;
+	~PcmDsd() noexcept;
+
+	PcmDsd(const PcmDsd &) = delete;
+	PcmDsd &operator=(const PcmDsd &) = delete;
+
 	void Reset() noexcept {
 		dsd2pcm.Reset();
 	}
@@ -27,4 +61,12 @@ public:
 
 	std::span<const int32_t> ToS24(unsigned channels,
 				       std::span<const std::byte> src) noexcept;
+
+private:
+	/**
+	 * Returns the #WorkerGroup for converting this number
+	 * of channels or nullptr to convert in the calling thread.
+	 */
+	WorkerGroup *GetThreads(unsigned channels,
+				std::size_t num_frames) noexcept;
 };
@@ -6,6 +6,7 @@
 #include "Traits.hxx"
 #include "FloatConvert.hxx"
 #include "ShiftConvert.hxx"
+#include "Simd.hxx"
 #include "util/SpanCast.hxx"
 #include "util/TransformN.hxx"
 
@@ -27,6 +28,27 @@ struct PerSampleConvert : C {
 	}
 };
 
+/**
+ * Wrapper for a class that converts a buffer at a time; it uses a
+ * #PcmSimdKernels function (if available) for the bulk of the
+ * buffer, and the wrapped class for the rest.
+ */
+template<typename C, auto simd>
+struct SimdConvert : C {
+	using SrcTraits = typename C::SrcTraits;
+	using DstTraits = typename C::DstTraits;
+
+	void Convert(typename DstTraits::pointer gcc_restrict out,
+		     typename SrcTraits::const_pointer gcc_restrict in,
+		     size_t n) const {
+		size_t done = 0;
+		if (const auto kernel = GetPcmSimdKernel(simd))
+			done = kernel(out, in, n);
+
+		C::Convert(out + done, in + done, n - done);
+	}
+};
+
 struct Convert8To16
 	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
 						  SampleFormat::S16>> {};
@@ -64,6 +86,16 @@ struct PortableFloatToInteger
 template<SampleFormat F, class Traits=SampleTraits<F>>
 struct FloatToInteger : PortableFloatToInteger<F, Traits> {};
 
+template<>
+struct FloatToInteger<SampleFormat::S24_P32, SampleTraits<SampleFormat::S24_P32>>
+	: SimdConvert<PortableFloatToInteger<SampleFormat::S24_P32>,
+		      &PcmSimdKernels::convert_float_to_24> {};
+
+template<>
+struct FloatToInteger<SampleFormat::S32, SampleTraits<SampleFormat::S32>>
+	: SimdConvert<PortableFloatToInteger<SampleFormat::S32>,
+		      &PcmSimdKernels::convert_float_to_32> {};
+
 /**
  * A template class that attempts to use the "optimized" algorithm for
  * large portions of the buffer, and calls the "portable" algorithm"
@@ -96,6 +128,13 @@ struct FloatToInteger<SampleFormat::S16, SampleTraits<SampleFormat::S16>>
 	: GlueOptimizedConvert<NeonFloatTo16,
 			       PortableFloatToInteger<SampleFormat::S16>> {};
 
+#else
+
+template<>
+struct FloatToInteger<SampleFormat::S16, SampleTraits<SampleFormat::S16>>
+	: SimdConvert<PortableFloatToInteger<SampleFormat::S16>,
+		      &PcmSimdKernels::convert_float_to_16> {};
+
 #endif
 
 template<class C>
@@ -178,8 +217,9 @@ struct Convert8To24
 						  SampleFormat::S24_P32>> {};
 
 struct Convert16To24
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
-						  SampleFormat::S24_P32>> {};
+	: SimdConvert<PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
+							      SampleFormat::S24_P32>>,
+		      &PcmSimdKernels::convert_16_to_24> {};
 
 static std::span<const int32_t>
 pcm_allocate_8_to_24(PcmBuffer &buffer, std::span<const int8_t> src)
@@ -194,8 +234,9 @@ pcm_allocate_16_to_24(PcmBuffer &buffer, std::span<const int16_t> src)
 }
 
 struct Convert32To24
-	: PerSampleConvert<RightShiftSampleConvert<SampleFormat::S32,
-						   SampleFormat::S24_P32>> {};
+	: SimdConvert<PerSampleConvert<RightShiftSampleConvert<SampleFormat::S32,
+							       SampleFormat::S24_P32>>,
+		      &PcmSimdKernels::convert_32_to_24> {};
 
 static std::span<const int32_t>
 pcm_allocate_32_to_24(PcmBuffer &buffer, std::span<const int32_t> src)
@@ -246,12 +287,14 @@ struct Convert8To32
 						  SampleFormat::S32>> {};
 
 struct Convert16To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
-						  SampleFormat::S32>> {};
+	: SimdConvert<PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
+							      SampleFormat::S32>>,
+		      &PcmSimdKernels::convert_16_to_32> {};
 
 struct Convert24To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S24_P32,
-						  SampleFormat::S32>> {};
+	: SimdConvert<PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S24_P32,
+							      SampleFormat::S32>>,
+		      &PcmSimdKernels::convert_24_to_32> {};
 
 static std::span<const int32_t>
 pcm_allocate_8_to_32(PcmBuffer &buffer, std::span<const int8_t> src)
@@ -313,13 +356,16 @@ struct Convert8ToFloat
 	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S8>> {};
 
 struct Convert16ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S16>> {};
+	: SimdConvert<PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S16>>,
+		      &PcmSimdKernels::convert_16_to_float> {};
 
 struct Convert24ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>> {};
+	: SimdConvert<PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>>,
+		      &PcmSimdKernels::convert_24_to_float> {};
 
 struct Convert32ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S32>> {};
+	: SimdConvert<PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S32>>,
+		      &PcmSimdKernels::convert_32_to_float> {};
 
 static std::span<const float>
 pcm_allocate_8_to_float(PcmBuffer &buffer, std::span<const int8_t> src)
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Simd.hxx"
+#include "config.h"
+
+#include <algorithm>
+
+#ifdef ENABLE_PCM_SIMD
+extern const PcmSimdKernels pcm_simd_sse2, pcm_simd_avx2;
+#endif
+
+PcmSimd
+PcmSimdDetect() noexcept
+{
+#ifdef ENABLE_PCM_SIMD
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return PcmSimd::AVX2;
+
+	if (__builtin_cpu_supports("sse2"))
+		return PcmSimd::SSE2;
+#endif
+
+	return PcmSimd::NONE;
+}
+
+static constexpr const PcmSimdKernels *
+GetKernels(PcmSimd simd) noexcept
+{
+	switch (simd) {
+	case PcmSimd::NONE:
+		break;
+
+#ifdef ENABLE_PCM_SIMD
+	case PcmSimd::SSE2:
+		return &pcm_simd_sse2;
+
+	case PcmSimd::AVX2:
+		return &pcm_simd_avx2;
+#else
+	case PcmSimd::SSE2:
+	case PcmSimd::AVX2:
+		break;
+#endif
+	}
+
+	return nullptr;
+}
+
+static const PcmSimdKernels *pcm_simd_kernels = GetKernels(PcmSimdDetect());
+
+PcmSimd
+PcmSimdSelect(PcmSimd simd) noexcept
+{
+	simd = std::min(simd, PcmSimdDetect());
+	pcm_simd_kernels = GetKernels(simd);
+	return simd;
+}
+
+const PcmSimdKernels *
+GetPcmSimdKernels() noexcept
+{
+	return pcm_simd_kernels;
+}
+
+const char *
+ToString(PcmSimd simd) noexcept
+{
+	switch (simd) {
+	case PcmSimd::NONE:
+		break;
+
+	case PcmSimd::SSE2:
+		return "sse2";
+
+	case PcmSimd::AVX2:
+		return "avx2";
+	}
+
+	return "none";
+}
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_PCM_SIMD_HXX
+#define MPD_PCM_SIMD_HXX
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A SIMD instruction set which may be used for PCM processing.
+ */
+enum class PcmSimd : uint8_t {
+	NONE,
+	SSE2,
+	AVX2,
+};
+
+/**
+ * A table of SIMD implementations of PCM processing loops.  All of
+ * them produce exactly the same results as the portable code.
+ *
+ * Each function processes as many samples as fit into whole vector
+ * registers and returns that number; the caller is responsible for
+ * processing the remaining samples with the portable code.  Pointers
+ * do not need to be aligned.  For the functions which modify the
+ * first buffer ("a"), the second buffer must not overlap with it.
+ *
+ * A function pointer is nullptr if the portable code is just as fast
+ * (because the compiler vectorizes it already).
+ */
+struct PcmSimdKernels {
+	/**
+	 * dest[i] = src[i] * volume
+	 */
+	std::size_t (*volume_float)(float *dest, const float *src,
+				    std::size_t n, float volume) noexcept;
+
+	/**
+	 * Apply a fixed-point volume (10 fractional bits, see
+	 * #PCM_VOLUME_BITS) and convert S16 to S24_P32.
+	 */
+	std::size_t (*volume_16_to_24)(int32_t *dest, const int16_t *src,
+				       std::size_t n, int volume) noexcept;
+
+	/**
+	 * a[i] = a[i] * volume1 + b[i] * volume2
+	 */
+	std::size_t (*add_volume_float)(float *a, const float *b,
+					std::size_t n,
+					float volume1, float volume2) noexcept;
+
+	/* a[i] = a[i] + b[i], clipped */
+	std::size_t (*add_8)(int8_t *a, const int8_t *b,
+			     std::size_t n) noexcept;
+	std::size_t (*add_16)(int16_t *a, const int16_t *b,
+			      std::size_t n) noexcept;
+	std::size_t (*add_24)(int32_t *a, const int32_t *b,
+			      std::size_t n) noexcept;
+	std::size_t (*add_32)(int32_t *a, const int32_t *b,
+			      std::size_t n) noexcept;
+	std::size_t (*add_float)(float *a, const float *b,
+				 std::size_t n) noexcept;
+
+	/* sample format conversions */
+	std::size_t (*convert_16_to_24)(int32_t *dest, const int16_t *src,
+					std::size_t n) noexcept;
+	std::size_t (*convert_16_to_32)(int32_t *dest, const int16_t *src,
+					std::size_t n) noexcept;
+	std::size_t (*convert_24_to_32)(int32_t *dest, const int32_t *src,
+					std::size_t n) noexcept;
+	std::size_t (*convert_32_to_24)(int32_t *dest, const int32_t *src,
+					std::size_t n) noexcept;
+	std::size_t (*convert_16_to_float)(float *dest, const int16_t *src,
+					   std::size_t n) noexcept;
+	std::size_t (*convert_24_to_float)(float *dest, const int32_t *src,
+					   std::size_t n) noexcept;
+	std::size_t (*convert_32_to_float)(float *dest, const int32_t *src,
+					   std::size_t n) noexcept;
+	std::size_t (*convert_float_to_16)(int16_t *dest, const float *src,
+					   std::size_t n) noexcept;
+	std::size_t (*convert_float_to_24)(int32_t *dest, const float *src,
+					   std::size_t n) noexcept;
+	std::size_t (*convert_float_to_32)(int32_t *dest, const float *src,
+					   std::size_t n) noexcept;
+
+	/**
+	 * The number of lookup tables used by #dsd2pcm_float and
+	 * #dsd2pcm_s24.
+	 */
+	static constexpr std::size_t DSD2PCM_TABLES = 6;
+
+	/**
+	 * Calculate PCM samples with the dsd2pcm FIR filter (see
+	 * Dsd2Pcm.cxx), one per DSD byte.
+	 *
+	 * @param window the new DSD bytes of one channel, preceded
+	 * by the (DSD2PCM_TABLES * 2 - 1) previous ones
+	 * @param reversed the same bytes, bit-reversed
+	 * @param tables the #DSD2PCM_TABLES lookup tables with 256
+	 * entries each
+	 */
+	std::size_t (*dsd2pcm_float)(float *dest, const std::byte *window,
+				     const std::byte *reversed, std::size_t n,
+				     const float *tables) noexcept;
+	std::size_t (*dsd2pcm_s24)(int32_t *dest, const std::byte *window,
+				   const std::byte *reversed, std::size_t n,
+				   const int32_t *tables) noexcept;
+};
+
+/**
+ * Determine the best SIMD instruction set supported by this CPU.
+ */
+[[gnu::const]]
+PcmSimd
+PcmSimdDetect() noexcept;
+
+/**
+ * Select a SIMD instruction set.  If the CPU does not support it,
+ * the best one it supports is selected instead.  This is meant for
+ * benchmarks and debugging; it must not be called while other
+ * threads process PCM data.
+ *
+ * @return the instruction set which was selected
+ */
+PcmSimd
+PcmSimdSelect(PcmSimd simd) noexcept;
+
+/**
+ * Returns the SIMD kernels which shall be used or nullptr if there
+ * are none.
+ */
+[[gnu::pure]]
+const PcmSimdKernels *
+GetPcmSimdKernels() noexcept;
+
+/**
+ * Look up one function in the selected #PcmSimdKernels.
+ *
+ * @return the function or nullptr if there is none
+ */
+template<typename T>
+[[gnu::pure]]
+T
+GetPcmSimdKernel(T PcmSimdKernels::*kernel) noexcept
+{
+	const auto *kernels = GetPcmSimdKernels();
+	return kernels != nullptr ? kernels->*kernel : nullptr;
+}
+
+[[gnu::const]]
+const char *
+ToString(PcmSimd simd) noexcept;
+
+#endif
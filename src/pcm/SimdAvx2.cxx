@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * This file is compiled with "-mavx2", and its code must only be
+ * called after PcmSimdDetect() has checked the CPU.
+ */
+
+#include "SimdKernels.hxx"
+
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2 {
+	using I = __m256i;
+	using F = __m256;
+
+	static constexpr std::size_t N = 8;
+
+	static I LoadI(const void *p) noexcept {
+		return _mm256_loadu_si256(static_cast<const __m256i *>(p));
+	}
+
+	static void StoreI(void *p, I v) noexcept {
+		_mm256_storeu_si256(static_cast<__m256i *>(p), v);
+	}
+
+	/**
+	 * Load 8 16 bit samples and sign-extend them to 32 bit.
+	 */
+	static I LoadS16(const int16_t *p) noexcept {
+		return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+	}
+
+	/**
+	 * Store 8 32 bit samples as 16 bit, clipping them.
+	 */
+	static void StoreS16(int16_t *p, I v) noexcept {
+		/* the pack instruction works on each 128 bit lane
+		   separately; move the results of both lanes
+		   together */
+		const I packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(v, v),
+							  _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+				 _mm256_castsi256_si128(packed));
+	}
+
+	static F LoadF(const float *p) noexcept {
+		return _mm256_loadu_ps(p);
+	}
+
+	static void StoreF(float *p, F v) noexcept {
+		_mm256_storeu_ps(p, v);
+	}
+
+	static I SetI(int32_t value) noexcept {
+		return _mm256_set1_epi32(value);
+	}
+
+	static F SetF(float value) noexcept {
+		return _mm256_set1_ps(value);
+	}
+
+	static I AddI(I a, I b) noexcept {
+		return _mm256_add_epi32(a, b);
+	}
+
+	static I MulI(I a, I b) noexcept {
+		return _mm256_mullo_epi32(a, b);
+	}
+
+	static I AddSat8(I a, I b) noexcept {
+		return _mm256_adds_epi8(a, b);
+	}
+
+	static I AddSat16(I a, I b) noexcept {
+		return _mm256_adds_epi16(a, b);
+	}
+
+	static I AddSat32(I a, I b) noexcept {
+		const I sum = _mm256_add_epi32(a, b);
+
+		/* overflow if both operands have a sign different
+		   from the sum's */
+		const I overflow = _mm256_and_si256(_mm256_xor_si256(a, sum),
+						    _mm256_xor_si256(b, sum));
+		const I saturated = _mm256_xor_si256(_mm256_srai_epi32(a, 31),
+						     _mm256_set1_epi32(0x7fffffff));
+
+		/* the blend instruction looks only at the sign
+		   bit */
+		return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(sum),
+							    _mm256_castsi256_ps(saturated),
+							    _mm256_castsi256_ps(overflow)));
+	}
+
+	static I ClampI(I v, I min, I max) noexcept {
+		return _mm256_min_epi32(_mm256_max_epi32(v, min), max);
+	}
+
+	static I XorI(I a, I b) noexcept {
+		return _mm256_xor_si256(a, b);
+	}
+
+	template<int shift>
+	static I ShiftLeft(I v) noexcept {
+		return _mm256_slli_epi32(v, shift);
+	}
+
+	template<int shift>
+	static I ShiftRight(I v) noexcept {
+		return _mm256_srai_epi32(v, shift);
+	}
+
+	static F AddF(F a, F b) noexcept {
+		return _mm256_add_ps(a, b);
+	}
+
+	static F MulF(F a, F b) noexcept {
+		return _mm256_mul_ps(a, b);
+	}
+
+	/**
+	 * @return the maximum; "min" if "v" is NaN
+	 */
+	static F MaxF(F v, F min) noexcept {
+		return _mm256_max_ps(v, min);
+	}
+
+	static F MinF(F v, F max) noexcept {
+		return _mm256_min_ps(v, max);
+	}
+
+	static I CmpGeF(F a, F b) noexcept {
+		return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GE_OQ));
+	}
+
+	static F ToF(I v) noexcept {
+		return _mm256_cvtepi32_ps(v);
+	}
+
+	static I TruncF(F v) noexcept {
+		return _mm256_cvttps_epi32(v);
+	}
+};
+
+/**
+ * Load 8 bytes and zero-extend them to 32 bit.
+ */
+static __m256i
+LoadU8(const std::byte *p) noexcept
+{
+	return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+
+static constexpr std::ptrdiff_t DSD2PCM_TABLES = PcmSimdKernels::DSD2PCM_TABLES;
+static constexpr std::ptrdiff_t DSD2PCM_HISTORY = DSD2PCM_TABLES * 2 - 1;
+
+struct Dsd2PcmIndices {
+	__m256i index1, index2;
+};
+
+static Dsd2PcmIndices
+GetDsd2PcmIndices(const std::byte *window, const std::byte *reversed,
+	       std::ptrdiff_t i) noexcept
+{
+	const __m256i offset = _mm256_set1_epi32(i * 256);
+	return {
+		_mm256_add_epi32(LoadU8(window - i), offset),
+		_mm256_add_epi32(LoadU8(reversed - DSD2PCM_HISTORY + i), offset),
+	};
+}
+
+/**
+ * Look up the sum of the two table values for 8 consecutive output
+ * samples, just like Dsd2Pcm::CalcOutputSample() does for one.
+ */
+static __m256
+Dsd2PcmLookup(const float *tables, const std::byte *window,
+	      const std::byte *reversed, std::ptrdiff_t i) noexcept
+{
+	const auto [index1, index2] = GetDsd2PcmIndices(window, reversed, i);
+	return _mm256_add_ps(_mm256_i32gather_ps(tables, index1, 4),
+			     _mm256_i32gather_ps(tables, index2, 4));
+}
+
+static __m256i
+Dsd2PcmLookup(const int32_t *tables, const std::byte *window,
+	      const std::byte *reversed, std::ptrdiff_t i) noexcept
+{
+	const auto [index1, index2] = GetDsd2PcmIndices(window, reversed, i);
+	return _mm256_add_epi32(_mm256_i32gather_epi32(tables, index1, 4),
+				_mm256_i32gather_epi32(tables, index2, 4));
+}
+
+static std::size_t
+Dsd2PcmFloat(float *dest, const std::byte *window, const std::byte *reversed,
+	     std::size_t n, const float *tables) noexcept
+{
+	std::size_t j = 0;
+	for (; j + 8 <= n; j += 8) {
+		/* the portable code accumulates in double
+		   precision */
+		__m256d acc_lo = _mm256_setzero_pd(), acc_hi = acc_lo;
+
+		for (std::ptrdiff_t i = 0; i < DSD2PCM_TABLES; ++i) {
+			const __m256 sum = Dsd2PcmLookup(tables, window + j,
+							 reversed + j, i);
+			acc_lo = _mm256_add_pd(acc_lo,
+					       _mm256_cvtps_pd(_mm256_castps256_ps128(sum)));
+			acc_hi = _mm256_add_pd(acc_hi,
+					       _mm256_cvtps_pd(_mm256_extractf128_ps(sum, 1)));
+		}
+
+		_mm_storeu_ps(dest + j, _mm256_cvtpd_ps(acc_lo));
+		_mm_storeu_ps(dest + j + 4, _mm256_cvtpd_ps(acc_hi));
+	}
+
+	return j;
+}
+
+static std::size_t
+Dsd2PcmS24(int32_t *dest, const std::byte *window, const std::byte *reversed,
+	   std::size_t n, const int32_t *tables) noexcept
+{
+	std::size_t j = 0;
+	for (; j + 8 <= n; j += 8) {
+		__m256i acc = _mm256_setzero_si256();
+
+		for (std::ptrdiff_t i = 0; i < DSD2PCM_TABLES; ++i)
+			acc = _mm256_add_epi32(acc,
+					       Dsd2PcmLookup(tables, window + j,
+							     reversed + j, i));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + j), acc);
+	}
+
+	return j;
+}
+
+static constexpr PcmSimdKernels
+MakeAvx2Kernels() noexcept
+{
+	auto k = SimdKernels<Avx2>::kernels;
+	k.dsd2pcm_float = Dsd2PcmFloat;
+	k.dsd2pcm_s24 = Dsd2PcmS24;
+	return k;
+}
+
+} // anonymous namespace
+
+extern const PcmSimdKernels pcm_simd_avx2;
+const PcmSimdKernels pcm_simd_avx2 = MakeAvx2Kernels();
@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Generic implementations of the #PcmSimdKernels.  This header is
+ * included by one source file per instruction set, each compiled with
+ * different compiler flags, and the parameter "V" abstracts the
+ * vector registers of that instruction set.
+ *
+ * Everything here has internal linkage, because these functions must
+ * not be shared with code compiled for a different CPU; for the same
+ * reason, this header must not include any library headers with
+ * inline functions.
+ */
+
+#ifndef MPD_PCM_SIMD_KERNELS_HXX
+#define MPD_PCM_SIMD_KERNELS_HXX
+
+#include "Simd.hxx"
+
+namespace {
+
+template<typename V>
+struct SimdKernels {
+	using I = typename V::I;
+	using F = typename V::F;
+
+	/**
+	 * The number of 32 bit samples per vector register.
+	 */
+	static constexpr std::size_t N = V::N;
+
+	static std::size_t VolumeFloat(float *dest, const float *src,
+				       std::size_t n, float volume) noexcept {
+		const F v = V::SetF(volume);
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreF(dest + i, V::MulF(V::LoadF(src + i), v));
+		return i;
+	}
+
+	static std::size_t Volume16To24(int32_t *dest, const int16_t *src,
+					std::size_t n, int volume) noexcept {
+		/* 16 sample bits plus 10 volume bits, shifted to 24
+		   bits (like PcmVolumeConvert()) */
+		constexpr int shift = 16 + 10 - 24;
+
+		const I v = V::SetI(volume);
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreI(dest + i,
+				  V::template ShiftRight<shift>(V::MulI(V::LoadS16(src + i), v)));
+		return i;
+	}
+
+	static std::size_t AddVolumeFloat(float *a, const float *b,
+					  std::size_t n,
+					  float volume1, float volume2) noexcept {
+		const F v1 = V::SetF(volume1), v2 = V::SetF(volume2);
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreF(a + i,
+				  V::AddF(V::MulF(V::LoadF(a + i), v1),
+					  V::MulF(V::LoadF(b + i), v2)));
+		return i;
+	}
+
+	static std::size_t Add8(int8_t *a, const int8_t *b,
+				std::size_t n) noexcept {
+		constexpr std::size_t N8 = N * 4;
+
+		std::size_t i = 0;
+		for (; i + N8 <= n; i += N8)
+			V::StoreI(a + i, V::AddSat8(V::LoadI(a + i),
+						    V::LoadI(b + i)));
+		return i;
+	}
+
+	static std::size_t Add16(int16_t *a, const int16_t *b,
+				 std::size_t n) noexcept {
+		constexpr std::size_t N16 = N * 2;
+
+		std::size_t i = 0;
+		for (; i + N16 <= n; i += N16)
+			V::StoreI(a + i, V::AddSat16(V::LoadI(a + i),
+						     V::LoadI(b + i)));
+		return i;
+	}
+
+	static std::size_t Add24(int32_t *a, const int32_t *b,
+				 std::size_t n) noexcept {
+		const I min = V::SetI(-0x800000), max = V::SetI(0x7fffff);
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreI(a + i, V::ClampI(V::AddI(V::LoadI(a + i),
+							   V::LoadI(b + i)),
+						   min, max));
+		return i;
+	}
+
+	static std::size_t Add32(int32_t *a, const int32_t *b,
+				 std::size_t n) noexcept {
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreI(a + i, V::AddSat32(V::LoadI(a + i),
+						     V::LoadI(b + i)));
+		return i;
+	}
+
+	static std::size_t AddFloat(float *a, const float *b,
+				    std::size_t n) noexcept {
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreF(a + i, V::AddF(V::LoadF(a + i),
+						 V::LoadF(b + i)));
+		return i;
+	}
+
+	template<int shift>
+	static std::size_t Convert16To32(int32_t *dest, const int16_t *src,
+					 std::size_t n) noexcept {
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreI(dest + i,
+				  V::template ShiftLeft<shift>(V::LoadS16(src + i)));
+		return i;
+	}
+
+	static std::size_t Convert24To32(int32_t *dest, const int32_t *src,
+					 std::size_t n) noexcept {
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreI(dest + i,
+				  V::template ShiftLeft<8>(V::LoadI(src + i)));
+		return i;
+	}
+
+	static std::size_t Convert32To24(int32_t *dest, const int32_t *src,
+					 std::size_t n) noexcept {
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreI(dest + i,
+				  V::template ShiftRight<8>(V::LoadI(src + i)));
+		return i;
+	}
+
+	static std::size_t Convert16ToFloat(float *dest, const int16_t *src,
+					    std::size_t n) noexcept {
+		const F factor = V::SetF(1.0f / 0x8000);
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreF(dest + i,
+				  V::MulF(V::ToF(V::LoadS16(src + i)), factor));
+		return i;
+	}
+
+	/**
+	 * Convert S24_P32 or S32 to float.
+	 */
+	template<unsigned bits>
+	static std::size_t Convert32ToFloat(float *dest, const int32_t *src,
+					    std::size_t n) noexcept {
+		const F factor = V::SetF(1.0f / (uint32_t(1) << (bits - 1)));
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreF(dest + i,
+				  V::MulF(V::ToF(V::LoadI(src + i)), factor));
+		return i;
+	}
+
+	static std::size_t ConvertFloatTo16(int16_t *dest, const float *src,
+					    std::size_t n) noexcept {
+		/* like the portable code, truncate to 32 bit first
+		   (out-of-range values become INT32_MIN) and then
+		   clip to 16 bit */
+		const F factor = V::SetF(0x8000);
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N)
+			V::StoreS16(dest + i,
+				    V::TruncF(V::MulF(V::LoadF(src + i),
+						      factor)));
+		return i;
+	}
+
+	static std::size_t ConvertFloatTo24(int32_t *dest, const float *src,
+					    std::size_t n) noexcept {
+		/* 24 bit values are exactly representable as float,
+		   so clipping before truncating gives the same
+		   results as the portable code */
+		const F factor = V::SetF(0x800000);
+		const F min = V::SetF(-0x800000), max = V::SetF(0x7fffff);
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N) {
+			const F x = V::MulF(V::LoadF(src + i), factor);
+			V::StoreI(dest + i,
+				  V::TruncF(V::MinF(V::MaxF(x, min), max)));
+		}
+		return i;
+	}
+
+	static std::size_t ConvertFloatTo32(int32_t *dest, const float *src,
+					    std::size_t n) noexcept {
+		/* the truncation instruction returns INT32_MIN for
+		   all values which are out of range; flipping all
+		   bits turns this into INT32_MAX for positive
+		   values */
+		const F factor = V::SetF(2147483648.f);
+
+		std::size_t i = 0;
+		for (; i + N <= n; i += N) {
+			const F x = V::MulF(V::LoadF(src + i), factor);
+			V::StoreI(dest + i,
+				  V::XorI(V::TruncF(x),
+					  V::CmpGeF(x, factor)));
+		}
+		return i;
+	}
+
+	static constexpr PcmSimdKernels kernels{
+		VolumeFloat,
+		Volume16To24,
+		AddVolumeFloat,
+		Add8,
+		Add16,
+		Add24,
+		Add32,
+		AddFloat,
+		Convert16To32<8>,
+		Convert16To32<16>,
+		Convert24To32,
+		Convert32To24,
+		Convert16ToFloat,
+		Convert32ToFloat<24>,
+		Convert32ToFloat<32>,
+		ConvertFloatTo16,
+		ConvertFloatTo24,
+		ConvertFloatTo32,
+
+		/* the dsd2pcm kernels need "gather" instructions;
+		   they are implemented only for AVX2 */
+		nullptr,
+		nullptr,
+	};
+};
+
+} // anonymous namespace
+
+#endif
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "SimdKernels.hxx"
+
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2 {
+	using I = __m128i;
+	using F = __m128;
+
+	static constexpr std::size_t N = 4;
+
+	static I LoadI(const void *p) noexcept {
+		return _mm_loadu_si128(static_cast<const __m128i *>(p));
+	}
+
+	static void StoreI(void *p, I v) noexcept {
+		_mm_storeu_si128(static_cast<__m128i *>(p), v);
+	}
+
+	/**
+	 * Load 4 16 bit samples and sign-extend them to 32 bit.
+	 */
+	static I LoadS16(const int16_t *p) noexcept {
+		const I v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+		return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+	}
+
+	/**
+	 * Store 4 32 bit samples as 16 bit, clipping them.
+	 */
+	static void StoreS16(int16_t *p, I v) noexcept {
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(p),
+				 _mm_packs_epi32(v, v));
+	}
+
+	static F LoadF(const float *p) noexcept {
+		return _mm_loadu_ps(p);
+	}
+
+	static void StoreF(float *p, F v) noexcept {
+		_mm_storeu_ps(p, v);
+	}
+
+	static I SetI(int32_t value) noexcept {
+		return _mm_set1_epi32(value);
+	}
+
+	static F SetF(float value) noexcept {
+		return _mm_set1_ps(value);
+	}
+
+	static I AddI(I a, I b) noexcept {
+		return _mm_add_epi32(a, b);
+	}
+
+	/**
+	 * Multiply 32 bit integers, keeping the lower 32 bits (SSE2
+	 * has no instruction for that).
+	 */
+	static I MulI(I a, I b) noexcept {
+		const I even = _mm_mul_epu32(a, b);
+		const I odd = _mm_mul_epu32(_mm_srli_epi64(a, 32),
+					    _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+					  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+
+	static I AddSat8(I a, I b) noexcept {
+		return _mm_adds_epi8(a, b);
+	}
+
+	static I AddSat16(I a, I b) noexcept {
+		return _mm_adds_epi16(a, b);
+	}
+
+	static I Select(I mask, I a, I b) noexcept {
+		return _mm_or_si128(_mm_and_si128(mask, a),
+				    _mm_andnot_si128(mask, b));
+	}
+
+	static I AddSat32(I a, I b) noexcept {
+		const I sum = _mm_add_epi32(a, b);
+
+		/* overflow if both operands have a sign different
+		   from the sum's */
+		const I overflow = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, sum),
+								_mm_xor_si128(b, sum)),
+						  31);
+		const I saturated = _mm_xor_si128(_mm_srai_epi32(a, 31),
+						  _mm_set1_epi32(0x7fffffff));
+		return Select(overflow, saturated, sum);
+	}
+
+	static I ClampI(I v, I min, I max) noexcept {
+		v = Select(_mm_cmplt_epi32(v, min), min, v);
+		return Select(_mm_cmpgt_epi32(v, max), max, v);
+	}
+
+	static I XorI(I a, I b) noexcept {
+		return _mm_xor_si128(a, b);
+	}
+
+	template<int shift>
+	static I ShiftLeft(I v) noexcept {
+		return _mm_slli_epi32(v, shift);
+	}
+
+	template<int shift>
+	static I ShiftRight(I v) noexcept {
+		return _mm_srai_epi32(v, shift);
+	}
+
+	static F AddF(F a, F b) noexcept {
+		return _mm_add_ps(a, b);
+	}
+
+	static F MulF(F a, F b) noexcept {
+		return _mm_mul_ps(a, b);
+	}
+
+	/**
+	 * @return the maximum; "min" if "v" is NaN
+	 */
+	static F MaxF(F v, F min) noexcept {
+		return _mm_max_ps(v, min);
+	}
+
+	static F MinF(F v, F max) noexcept {
+		return _mm_min_ps(v, max);
+	}
+
+	static I CmpGeF(F a, F b) noexcept {
+		return _mm_castps_si128(_mm_cmpge_ps(a, b));
+	}
+
+	static F ToF(I v) noexcept {
+		return _mm_cvtepi32_ps(v);
+	}
+
+	static I TruncF(F v) noexcept {
+		return _mm_cvttps_epi32(v);
+	}
+};
+
+} // anonymous namespace
+
+/**
+ * Omit the kernels which are not faster than the portable code,
+ * because the compiler vectorizes that with SSE2 already.
+ */
+static constexpr PcmSimdKernels
+MakeSse2Kernels() noexcept
+{
+	auto k = SimdKernels<Sse2>::kernels;
+	k.volume_float = nullptr;
+	k.volume_16_to_24 = nullptr;
+	k.add_volume_float = nullptr;
+	k.add_24 = nullptr;
+	k.add_float = nullptr;
+	k.convert_16_to_24 = nullptr;
+	k.convert_16_to_32 = nullptr;
+	k.convert_24_to_32 = nullptr;
+	k.convert_32_to_24 = nullptr;
+	k.convert_16_to_float = nullptr;
+	k.convert_24_to_float = nullptr;
+	k.convert_32_to_float = nullptr;
+	return k;
+}
+
+extern const PcmSimdKernels pcm_simd_sse2;
+const PcmSimdKernels pcm_simd_sse2 = MakeSse2Kernels();
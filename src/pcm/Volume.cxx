@@ -3,6 +3,7 @@
 
 #include "Volume.hxx"
 #include "Silence.hxx"
+#include "Simd.hxx"
 #include "Traits.hxx"
 #include "lib/fmt/AudioFormatFormatter.hxx"
 #include "lib/fmt/RuntimeError.hxx"
@@ -97,6 +98,16 @@ static void
 PcmVolumeChange16to32(int32_t *dest, const int16_t *src, size_t n,
 		      int volume) noexcept
 {
+	static_assert(PCM_VOLUME_BITS == 10,
+		      "SIMD kernel assumes 10 volume bits");
+
+	if (const auto simd = GetPcmSimdKernel(&PcmSimdKernels::volume_16_to_24)) {
+		const size_t done = simd(dest, src, n, volume);
+		dest += done;
+		src += done;
+		n -= done;
+	}
+
 	transform_n(src, n, dest,
 		    [volume](auto x){
 			    return PcmVolumeConvert<SampleFormat::S16,
@@ -126,6 +137,13 @@ static void
 pcm_volume_change_float(float *dest, const float *src, size_t n,
 			float volume) noexcept
 {
+	if (const auto simd = GetPcmSimdKernel(&PcmSimdKernels::volume_float)) {
+		const size_t done = simd(dest, src, n, volume);
+		dest += done;
+		src += done;
+		n -= done;
+	}
+
 	transform_n(src, n, dest,
 		    [volume](float x){ return x * volume; });
 }
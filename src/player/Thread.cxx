@@ -75,16 +75,6 @@ class Player {
 	 */
 	unsigned buffer_before_play;
 
-	/**
-	 * If the decoder pipe gets consumed below this threshold,
-	 * it's time to wake up the decoder.
-	 *
-	 * It is calculated in a way which should prevent a wakeup
-	 * after each single consumed chunk; it is more efficient to
-	 * make the decoder decode a larger block at a time.
-	 */
-	const unsigned decoder_wakeup_threshold;
-
 	/**
 	 * Are we waiting for #buffer_before_play?
 	 */
@@ -181,8 +171,7 @@ class Player {
 public:
 	Player(PlayerControl &_pc, DecoderControl &_dc,
 	       MusicBuffer &_buffer) noexcept
-		:pc(_pc), dc(_dc), buffer(_buffer),
-		 decoder_wakeup_threshold(buffer.GetSize() * 3 / 4)
+		:pc(_pc), dc(_dc), buffer(_buffer)
 	{
 	}
 
@@ -195,6 +184,31 @@ private:
 		xfade_state = CrossFadeState::UNKNOWN;
 	}
 
+	/**
+	 * If the decoder pipe gets consumed below this threshold,
+	 * it's time to wake up the decoder.
+	 *
+	 * It is calculated in a way which should prevent a wakeup
+	 * after each single consumed chunk; it is more efficient to
+	 * make the decoder decode a larger block at a time.  It
+	 * depends on the chunk size, which may change with each new
+	 * audio format (see MusicBuffer::Adapt()).
+	 */
+	[[gnu::pure]]
+	unsigned GetDecoderWakeupThreshold() const noexcept {
+		return buffer.GetSize() * 3 / 4;
+	}
+
+	/**
+	 * Convert a number of bytes to a number of chunks (rounding
+	 * up).
+	 */
+	[[gnu::pure]]
+	std::size_t SizeToChunks(std::size_t size) const noexcept {
+		const std::size_t chunk_capacity = buffer.GetChunkCapacity();
+		return (size + chunk_capacity - 1) / chunk_capacity;
+	}
+
 	template<typename P>
 	void ReplacePipe(P &&_pipe) noexcept {
 		ResetCrossFade();
@@ -513,8 +527,7 @@ Player::MixRampScannerReady() noexcept
 		const std::size_t want_pipe_bytes =
 			dc.out_audio_format.TimeToSize(std::chrono::seconds{20});
 		const std::size_t want_pipe_chunks =
-			std::min((want_pipe_bytes + sizeof(MusicChunk::data) - 1)
-				 / sizeof(MusicChunk::data),
+			std::min(SizeToChunks(want_pipe_bytes),
 				 buffer.GetSize() / std::size_t{3});
 
 		if (dc.pipe->GetSize() < want_pipe_chunks) {
@@ -597,9 +610,7 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 
 		const size_t buffer_before_play_size =
 			play_audio_format.TimeToSize(buffer_before_play_duration);
-		buffer_before_play =
-			(buffer_before_play_size + sizeof(MusicChunk::data) - 1)
-			/ sizeof(MusicChunk::data);
+		buffer_before_play = SizeToChunks(buffer_before_play_size);
 
 		pc.listener.OnPlayerStateChanged();
 
@@ -883,6 +894,7 @@ Player::CheckCrossFade() noexcept
 					dc.GetMixRampStart(),
 					dc.GetMixRampPreviousEnd(),
 					play_audio_format,
+					buffer.GetChunkCapacity(),
 					buffer.GetSize() -
 					buffer_before_play);
 	if (cross_fade_chunks > 0)
@@ -1050,7 +1062,7 @@ Player::PlayNextChunk() noexcept
 	/* this formula should prevent that the decoder gets woken up
 	   with each chunk; it is more efficient to make it decode a
 	   larger block at a time */
-	if (!dc.IsIdle() && dc.pipe->GetSize() <= decoder_wakeup_threshold) {
+	if (!dc.IsIdle() && dc.pipe->GetSize() <= GetDecoderWakeupThreshold()) {
 		if (!decoder_woken) {
 			decoder_woken = true;
 			dc.Signal();
@@ -1246,7 +1258,7 @@ try {
 			  config.replay_gain);
 	dc.StartThread();
 
-	MusicBuffer buffer{config.buffer_chunks};
+	MusicBuffer buffer{config.buffer_size, config.chunk_size};
 
 	std::unique_lock<Mutex> lock(mutex);
 
@@ -5,22 +5,16 @@
 #define MPD_ID_TABLE_HXX
 
 #include <cassert>
+#include <vector>
 
 /**
- * A table that maps id numbers to position numbers.
+ * A table that maps id numbers to objects.  It grows as more ids are
+ * needed, up to the given size.
  */
+template<typename T>
 class IdTable {
 	const unsigned size;
 
-	/**
-	 * How many members of "data" are initialized?
-	 *
-	 * The initial value is 1 and not 0 because the first element
-	 * of the array is never used, because 0 is not a valid song
-	 * id.
-	 */
-	unsigned initialized = 1;
-
 	/**
 	 * An incrementing counter helping GenerateId() to generate
 	 * the next id.
@@ -29,30 +23,29 @@ class IdTable {
 
 	/**
 	 * A lookup table: the index is the id number and the value is
-	 * the position; -1 means this id is unassigned.
+	 * the object; nullptr means this id is unassigned.
+	 *
+	 * The first element of the array is never used, because 0 is
+	 * not a valid id.
 	 */
-	int *const data = new int[size];
+	std::vector<T *> data{nullptr};
 
 public:
-	explicit constexpr IdTable(unsigned _size) noexcept
+	explicit IdTable(unsigned _size) noexcept
 		:size(_size) {}
 
-	constexpr ~IdTable() noexcept {
-		delete[] data;
-	}
-
 	IdTable(const IdTable &) = delete;
 	IdTable &operator=(const IdTable &) = delete;
 
-	constexpr int IdToPosition(unsigned id) const noexcept {
-		return id < initialized
+	T *Get(unsigned id) const noexcept {
+		return id < data.size()
 			? data[id]
-			: -1;
+			: nullptr;
 	}
 
-	constexpr unsigned GenerateId() noexcept {
+	unsigned GenerateId() noexcept {
 		assert(next > 0);
-		assert(next <= initialized);
+		assert(next <= data.size());
 
 		while (true) {
 			unsigned id = next;
@@ -61,39 +54,32 @@ public:
 			if (next == size)
 				next = 1;
 
-			if (id == initialized) {
+			if (id == data.size()) {
 				/* the caller will initialize
 				   data[id] */
-				++initialized;
+				data.push_back(nullptr);
 				return id;
 			}
 
-			assert(id < initialized);
+			assert(id < data.size());
 
-			if (data[id] < 0)
+			if (data[id] == nullptr)
 				return id;
 		}
 	}
 
-	constexpr unsigned Insert(unsigned position) noexcept {
+	unsigned Insert(T &value) noexcept {
 		unsigned id = GenerateId();
-		assert(id < initialized);
-		data[id] = position;
+		assert(id < data.size());
+		data[id] = &value;
 		return id;
 	}
 
-	constexpr void Move(unsigned id, unsigned position) noexcept {
-		assert(id < initialized);
-		assert(data[id] >= 0);
-
-		data[id] = position;
-	}
-
-	constexpr void Erase(unsigned id) noexcept {
-		assert(id < initialized);
-		assert(data[id] >= 0);
+	void Erase(unsigned id) noexcept {
+		assert(id < data.size());
+		assert(data[id] != nullptr);
 
-		data[id] = -1;
+		data[id] = nullptr;
 	}
 };
 
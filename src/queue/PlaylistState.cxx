@@ -44,8 +44,9 @@
 #define PLAYLIST_STATE_FILE_STATE_STOP		"stop"
 
 void
-playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
-		    PlayerControl &pc)
+playlist_state_save_status(BufferedOutputStream &os,
+			   const struct playlist &playlist,
+			   PlayerControl &pc)
 {
 	const auto player_status = pc.LockGetStatus();
 
@@ -85,6 +86,13 @@ playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
 	       pc.GetMixRampDb());
 	os.Fmt(FMT_STRING(PLAYLIST_STATE_FILE_MIXRAMPDELAY "{}\n"),
 	       pc.GetMixRampDelay().count());
+}
+
+void
+playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
+		    PlayerControl &pc)
+{
+	playlist_state_save_status(os, playlist, pc);
 	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_BEGIN "\n");
 	queue_save(os, playlist.queue);
 	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_END "\n");
@@ -20,6 +20,14 @@ void
 playlist_state_save(BufferedOutputStream &os, const playlist &playlist,
 		    PlayerControl &pc);
 
+/**
+ * Like playlist_state_save(), but omit the queue.  This is used by
+ * the state journal, which saves only the modified queue items.
+ */
+void
+playlist_state_save_status(BufferedOutputStream &os, const playlist &playlist,
+			   PlayerControl &pc);
+
 bool
 playlist_state_restore(const StateFileConfig &config,
 		       const char *line, LineReader &file,
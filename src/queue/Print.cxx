@@ -25,16 +25,22 @@
  * @param end the index of the last song (excluding)
  */
 static void
-queue_print_song_info(Response &r, const Queue &queue,
-		      unsigned position)
+queue_print_song_info(Response &r, unsigned position,
+		      const Queue::Item &item)
 {
-	song_print_info(r, queue.Get(position));
+	song_print_info(r, item.song);
 	r.Fmt(FMT_STRING("Pos: {}\nId: {}\n"),
-	      position, queue.PositionToId(position));
+	      position, item.id);
 
-	uint8_t priority = queue.GetPriorityAtPosition(position);
-	if (priority != 0)
-		r.Fmt(FMT_STRING("Prio: {}\n"), priority);
+	if (item.priority != 0)
+		r.Fmt(FMT_STRING("Prio: {}\n"), item.priority);
+}
+
+static void
+queue_print_song_info(Response &r, const Queue &queue,
+		      unsigned position)
+{
+	queue_print_song_info(r, position, queue.GetItem(position));
 }
 
 void
@@ -44,8 +50,10 @@ queue_print_info(Response &r, const Queue &queue,
 	assert(start <= end);
 	assert(end <= queue.GetLength());
 
-	for (unsigned i = start; i < end; ++i)
-		queue_print_song_info(r, queue, i);
+	queue.ForEachPosition(start, end, [&r](unsigned position,
+					       const Queue::Item &item){
+		queue_print_song_info(r, position, item);
+	});
 }
 
 void
@@ -55,10 +63,11 @@ queue_print_uris(Response &r, const Queue &queue,
 	assert(start <= end);
 	assert(end <= queue.GetLength());
 
-	for (unsigned i = start; i < end; ++i) {
-		r.Fmt(FMT_STRING("{}:"), i);
-		song_print_uri(r, queue.Get(i));
-	}
+	queue.ForEachPosition(start, end, [&r](unsigned position,
+					       const Queue::Item &item){
+		r.Fmt(FMT_STRING("{}:"), position);
+		song_print_uri(r, item.song);
+	});
 }
 
 void
@@ -69,9 +78,11 @@ queue_print_changes_info(Response &r, const Queue &queue,
 	assert(start <= end);
 	assert(end <= queue.GetLength());
 
-	for (unsigned i = start; i < end; i++)
-		if (queue.IsNewerAtPosition(i, version))
-			queue_print_song_info(r, queue, i);
+	queue.ForEachNewerPosition(start, end, version,
+				   [&r](unsigned position,
+					const Queue::Item &item){
+		queue_print_song_info(r, position, item);
+	});
 }
 
 void
@@ -82,10 +93,12 @@ queue_print_changes_position(Response &r, const Queue &queue,
 	assert(start <= end);
 	assert(end <= queue.GetLength());
 
-	for (unsigned i = start; i < end; i++)
-		if (queue.IsNewerAtPosition(i, version))
-			r.Fmt(FMT_STRING("cpos: {}\nId: {}\n"),
-			      i, queue.PositionToId(i));
+	queue.ForEachNewerPosition(start, end, version,
+				   [&r](unsigned position,
+					const Queue::Item &item){
+		r.Fmt(FMT_STRING("cpos: {}\nId: {}\n"),
+		      position, item.id);
+	});
 }
 
 [[gnu::pure]]
@@ -9,8 +9,6 @@
 
 Queue::Queue(unsigned _max_length) noexcept
 	:max_length(_max_length),
-	 items(new Item[max_length]),
-	 order(new unsigned[max_length]),
 	 id_table(max_length * HASH_MULT)
 {
 }
@@ -18,19 +16,20 @@ Queue::Queue(unsigned _max_length) noexcept
 Queue::~Queue() noexcept
 {
 	Clear();
+}
 
-	delete[] items;
-	delete[] order;
+LightSong
+Queue::GetLight(const Item &item) noexcept
+{
+	LightSong song{item.song};
+	song.priority = item.priority;
+	return song;
 }
 
 LightSong
 Queue::GetLight(unsigned position) const noexcept
 {
-	assert(position < length);
-
-	LightSong song{Get(position)};
-	song.priority = GetPriorityAtPosition(position);
-	return song;
+	return GetLight(GetItem(position));
 }
 
 int
@@ -58,10 +57,14 @@ Queue::IncrementVersion() noexcept
 	version++;
 
 	if (version >= max) {
-		for (unsigned i = 0; i < length; i++)
-			items[i].version = 0;
-
+		/* all items are considered modified by the new
+		   version 1; clients which have an older version
+		   will get the whole queue because their version
+		   number is larger */
 		version = 1;
+
+		positions.ClearStamps();
+		positions.SetStamp(0, length, version);
 	}
 }
 
@@ -70,8 +73,8 @@ Queue::ModifyAtOrder(unsigned _order) noexcept
 {
 	assert(_order < length);
 
-	unsigned position = order[_order];
-	ModifyAtPosition(position);
+	SequenceTree::SetStamp(Item::FromOrder(order[_order]).position_hook,
+			       version);
 }
 
 unsigned
@@ -79,112 +82,46 @@ Queue::Append(DetachedSong &&song, uint8_t priority) noexcept
 {
 	assert(!IsFull());
 
-	const unsigned position = length++;
-	const unsigned id = id_table.Insert(position);
-
-	auto &item = items[position];
-	item.song = new DetachedSong(std::move(song));
-	item.id = id;
-	item.version = version;
-	item.priority = priority;
+	auto *item = new Item(std::move(song), priority);
+	item->id = id_table.Insert(*item);
+	item->position_hook.stamp = version;
 
-	order[position] = position;
+	positions.push_back(item->position_hook);
+	order.push_back(item->order_hook);
+	++length;
 
-	return id;
+	return item->id;
 }
 
 void
 Queue::SwapPositions(unsigned position1, unsigned position2) noexcept
 {
-	unsigned id1 = items[position1].id;
-	unsigned id2 = items[position2].id;
-
-	std::swap(items[position1], items[position2]);
+	positions.Swap(position1, position2);
 
-	items[position1].version = version;
-	items[position2].version = version;
-
-	id_table.Move(id1, position2);
-	id_table.Move(id2, position1);
+	ModifyAtPosition(position1);
+	ModifyAtPosition(position2);
 }
 
 void
 Queue::MovePostion(unsigned from, unsigned to) noexcept
 {
-	const Item tmp = items[from];
-
-	/* move songs to one less in from->to */
-
-	for (unsigned i = from; i < to; i++)
-		MoveItemTo(i + 1, i);
-
-	/* move songs to one more in to->from */
-
-	for (unsigned i = from; i > to; i--)
-		MoveItemTo(i - 1, i);
-
-	/* put song at _to_ */
-
-	id_table.Move(tmp.id, to);
-	items[to] = tmp;
-	items[to].version = version;
-
-	/* now deal with order */
-
-	if (random) {
-		for (unsigned i = 0; i < length; i++) {
-			if (order[i] > from && order[i] <= to)
-				order[i]--;
-			else if (order[i] < from &&
-				 order[i] >= to)
-				order[i]++;
-			else if (from == order[i])
-				order[i] = to;
-		}
-	}
+	MoveRange(from, from + 1, to);
 }
 
 void
 Queue::MoveRange(unsigned start, unsigned end, unsigned to) noexcept
 {
-	const auto tmp = std::make_unique<Item[]>(end - start);
-
-	// Copy the original block [start,end-1]
-	for (unsigned i = start; i < end; i++)
-		tmp[i - start] = items[i];
-
-	// If to > start, we need to move to-start items to start, starting from end
-	for (unsigned i = end; i < end + to - start; i++)
-		MoveItemTo(i, start + i - end);
-
-	// If to < start, we need to move start-to items to newend (= end + to - start), starting from to
-	// This is the same as moving items from start-1 to to (decreasing), with start-1 going to end-1
-	// We have to iterate in this order to avoid writing over something we haven't yet moved
-	for (int i = start - 1; i >= int(to); i--)
-		MoveItemTo(i, i + end - start);
-
-	// Copy the original block back in, starting at to.
-	for (unsigned i = start; i< end; i++)
-	{
-		id_table.Move(tmp[i - start].id, to + i - start);
-		items[to + i - start] = tmp[i-start];
-		items[to + i - start].version = version;
-	}
+	assert(start <= end);
+	assert(to + (end - start) <= length);
 
-	if (random) {
-		// Update the positions in the queue.
-		// Note that the ranges for these cases are the same as the ranges of
-		// the loops above.
-		for (unsigned i = 0; i < length; i++) {
-			if (order[i] >= end && order[i] < to + end - start)
-				order[i] -= end - start;
-			else if (order[i] < start &&
-				 order[i] >= to)
-				order[i] += end - start;
-			else if (start <= order[i] && order[i] < end)
-				order[i] += to - start;
-		}
-	}
+	positions.MoveRange(start, end, to);
+
+	/* all items between the old and the new location have
+	   changed their position; the "order" tree links the items
+	   themselves and needs no adjustment */
+	positions.SetStamp(std::min(start, to),
+			   std::max(end, to + (end - start)),
+			   version);
 }
 
 unsigned
@@ -193,17 +130,7 @@ Queue::MoveOrder(unsigned from_order, unsigned to_order) noexcept
 	assert(from_order < length);
 	assert(to_order <= length);
 
-	const unsigned from_position = OrderToPosition(from_order);
-
-	if (from_order < to_order) {
-		for (unsigned i = from_order; i < to_order; ++i)
-			order[i] = order[i + 1];
-	} else {
-		for (unsigned i = from_order; i > to_order; --i)
-			order[i] = order[i - 1];
-	}
-
-	order[to_order] = from_position;
+	order.MoveRange(from_order, from_order + 1, to_order);
 	return to_order;
 }
 
@@ -230,65 +157,47 @@ Queue::DeletePosition(unsigned position) noexcept
 {
 	assert(position < length);
 
-	delete items[position].song;
-
-	const unsigned id = PositionToId(position);
-	const unsigned _order = PositionToOrder(position);
+	auto &item = Item::FromPosition(positions[position]);
 
+	positions.erase(item.position_hook);
+	order.erase(item.order_hook);
 	--length;
 
 	/* release the song id */
 
-	id_table.Erase(id);
-
-	/* delete song from songs array */
+	id_table.Erase(item.id);
+	delete &item;
 
-	for (unsigned i = position; i < length; i++)
-		MoveItemTo(i + 1, i);
+	/* all following items have moved */
 
-	/* delete the entry from the order array */
-
-	for (unsigned i = _order; i < length; i++)
-		order[i] = order[i + 1];
-
-	/* readjust values in the order array */
-
-	for (unsigned i = 0; i < length; i++)
-		if (order[i] > position)
-			--order[i];
+	positions.SetStamp(position, length, version);
 }
 
 void
 Queue::Clear() noexcept
 {
-	for (unsigned i = 0; i < length; i++) {
-		Item *item = &items[i];
-
-		delete item->song;
+	for (auto *hook : positions.Cut(0, length)) {
+		auto *item = &Item::FromPosition(*hook);
 
 		id_table.Erase(item->id);
+		delete item;
 	}
 
+	order.clear();
 	length = 0;
 }
 
-static void
-queue_sort_order_by_priority(Queue *queue,
-			     unsigned start, unsigned end) noexcept
+void
+Queue::RestoreOrder() noexcept
 {
-	assert(queue != nullptr);
-	assert(queue->random);
-	assert(start <= end);
-	assert(end <= queue->length);
+	auto nodes = positions.Cut(0, length);
+	positions.Paste(0, nodes);
 
-	auto cmp = [queue](unsigned a_pos, unsigned b_pos){
-		const Queue::Item &a = queue->items[a_pos];
-		const Queue::Item &b = queue->items[b_pos];
-
-		return a.priority > b.priority;
-	};
+	for (auto &i : nodes)
+		i = &Item::FromPosition(*i).order_hook;
 
-	std::stable_sort(queue->order + start, queue->order + end, cmp);
+	order.clear();
+	order.Paste(0, nodes);
 }
 
 void
@@ -298,8 +207,15 @@ Queue::ShuffleOrderRange(unsigned start, unsigned end) noexcept
 	assert(start <= end);
 	assert(end <= length);
 
+	if (start == end)
+		return;
+
+	auto nodes = order.Cut(start, end);
+
 	rand.AutoCreate();
-	std::shuffle(order + start, order + end, rand);
+	std::shuffle(nodes.begin(), nodes.end(), rand);
+
+	order.Paste(start, nodes);
 }
 
 /**
@@ -316,28 +232,35 @@ Queue::ShuffleOrderRangeWithPriority(unsigned start, unsigned end) noexcept
 	if (start == end)
 		return;
 
+	auto nodes = order.Cut(start, end);
+
 	/* first group the range by priority */
-	queue_sort_order_by_priority(this, start, end);
+	const auto cmp = [](auto *a, auto *b){
+		return Item::FromOrder(*a).priority >
+			Item::FromOrder(*b).priority;
+	};
 
-	/* now shuffle each priority group */
-	unsigned group_start = start;
-	uint8_t group_priority = GetOrderPriority(start);
+	if (!std::is_sorted(nodes.begin(), nodes.end(), cmp))
+		std::stable_sort(nodes.begin(), nodes.end(), cmp);
 
-	for (unsigned i = start + 1; i < end; ++i) {
-		const uint8_t priority = GetOrderPriority(i);
-		assert(priority <= group_priority);
+	/* now shuffle each priority group */
+	rand.AutoCreate();
 
-		if (priority != group_priority) {
+	auto group_start = nodes.begin();
+	for (auto i = nodes.begin(); i != nodes.end(); ++i) {
+		if (Item::FromOrder(**i).priority !=
+		    Item::FromOrder(**group_start).priority) {
 			/* start of a new group - shuffle the one that
 			   has just ended */
-			ShuffleOrderRange(group_start, i);
+			std::shuffle(group_start, i, rand);
 			group_start = i;
-			group_priority = priority;
 		}
 	}
 
 	/* shuffle the last group */
-	ShuffleOrderRange(group_start, end);
+	std::shuffle(group_start, nodes.end(), rand);
+
+	order.Paste(start, nodes);
 }
 
 void
@@ -364,8 +287,8 @@ Queue::ShuffleOrderLastWithPriority(unsigned start, unsigned end) noexcept
 	/* skip all items at the start which have a higher priority,
 	   because the last item shall only be shuffled within its
 	   priority group */
-	const auto last_priority = items[OrderToPosition(end - 1)].priority;
-	while (items[OrderToPosition(start)].priority != last_priority) {
+	const auto last_priority = GetOrderPriority(end - 1);
+	while (GetOrderPriority(start) != last_priority) {
 		++start;
 		assert(start < end);
 	}
@@ -382,14 +305,16 @@ Queue::ShuffleRange(unsigned start, unsigned end) noexcept
 	assert(start <= end);
 	assert(end <= length);
 
+	if (start == end)
+		return;
+
+	auto nodes = positions.Cut(start, end);
+
 	rand.AutoCreate();
+	std::shuffle(nodes.begin(), nodes.end(), rand);
 
-	for (unsigned i = start; i < end; i++) {
-		std::uniform_int_distribution<unsigned> distribution(start,
-								     end - 1);
-		unsigned ri = distribution(rand);
-		SwapPositions(i, ri);
-	}
+	positions.Paste(start, nodes);
+	positions.SetStamp(start, end, version);
 }
 
 unsigned
@@ -400,9 +325,8 @@ Queue::FindPriorityOrder(unsigned start_order, uint8_t priority,
 	assert(start_order <= length);
 
 	for (unsigned i = start_order; i < length; ++i) {
-		const unsigned position = OrderToPosition(i);
-		const Item *item = &items[position];
-		if (item->priority <= priority && i != exclude_order)
+		const Item &item = GetOrderItem(i);
+		if (item.priority <= priority && i != exclude_order)
 			return i;
 	}
 
@@ -416,9 +340,8 @@ Queue::CountSamePriority(unsigned start_order, uint8_t priority) const noexcept
 	assert(start_order <= length);
 
 	for (unsigned i = start_order; i < length; ++i) {
-		const unsigned position = OrderToPosition(i);
-		const Item *item = &items[position];
-		if (item->priority != priority)
+		const Item &item = GetOrderItem(i);
+		if (item.priority != priority)
 			return i - start_order;
 	}
 
@@ -431,13 +354,13 @@ Queue::SetPriority(unsigned position, uint8_t priority, int after_order,
 {
 	assert(position < length);
 
-	Item *item = &items[position];
-	uint8_t old_priority = item->priority;
+	Item &item = Item::FromPosition(positions[position]);
+	uint8_t old_priority = item.priority;
 	if (old_priority == priority)
 		return false;
 
-	item->version = version;
-	item->priority = priority;
+	SequenceTree::SetStamp(item.position_hook, version);
+	item.priority = priority;
 
 	if (!random || !reorder)
 		/* don't reorder if not in random mode */
@@ -455,12 +378,8 @@ Queue::SetPriority(unsigned position, uint8_t priority, int after_order,
 			   increased and is now bigger than the
 			   current one's */
 
-			const unsigned after_position =
-				OrderToPosition(after_order);
-			const Item *after_item =
-				&items[after_position];
 			if (priority <= old_priority ||
-			    priority <= after_item->priority)
+			    priority <= GetOrderPriority(after_order))
 				/* priority hasn't become bigger */
 				return true;
 		}
@@ -5,8 +5,11 @@
 #define MPD_QUEUE_HXX
 
 #include "IdTable.hxx"
+#include "SequenceTree.hxx"
 #include "SingleMode.hxx"
 #include "ConsumeMode.hxx"
+#include "song/DetachedSong.hxx"
+#include "util/Cast.hxx"
 #include "util/LazyRandomEngine.hxx"
 
 #include <cassert>
@@ -14,7 +17,6 @@
 #include <utility>
 
 struct LightSong;
-class DetachedSong;
 
 /**
  * A queue of songs.  This is the backend of the playlist: it contains
@@ -25,6 +27,10 @@ class DetachedSong;
  * - the position in the queue
  * - the unique id (which stays the same, regardless of moves)
  * - the order number (which only differs from "position" in random mode)
+ *
+ * The items are linked into two #SequenceTree instances, one in
+ * "position" order and one in "order" order, so all conversions
+ * between these, and moving ranges, take O(log n) time.
  */
 struct Queue {
 	/**
@@ -38,20 +44,44 @@ struct Queue {
 	 * information attached.
 	 */
 	struct Item {
-		DetachedSong *song;
+		/**
+		 * The link in #positions.  Its stamp is the version
+		 * number of the last change of this item (including
+		 * changes of its position).
+		 */
+		SequenceTreeHook position_hook;
+
+		/**
+		 * The link in #order.
+		 */
+		SequenceTreeHook order_hook;
 
 		/** the unique id of this item in the queue */
 		unsigned id;
 
-		/** when was this item last changed? */
-		uint32_t version;
-
 		/**
 		 * The priority of this item, between 0 and 255.  High
 		 * priority value means that this song gets played first in
 		 * "random" mode.
 		 */
 		uint8_t priority;
+
+		DetachedSong song;
+
+		Item(DetachedSong &&_song, uint8_t _priority) noexcept
+			:priority(_priority), song(std::move(_song)) {}
+
+		static Item &FromPosition(SequenceTreeHook &hook) noexcept {
+			return ContainerCast(hook, &Item::position_hook);
+		}
+
+		static const Item &FromPosition(const SequenceTreeHook &hook) noexcept {
+			return ContainerCast(hook, &Item::position_hook);
+		}
+
+		static Item &FromOrder(SequenceTreeHook &hook) noexcept {
+			return ContainerCast(hook, &Item::order_hook);
+		}
 	};
 
 	/** configured maximum length of the queue */
@@ -63,14 +93,17 @@ struct Queue {
 	/** the current version number */
 	uint32_t version = 1;
 
+private:
 	/** all songs in "position" order */
-	Item *const items;
+	SequenceTree positions;
+
+	/** all songs in "order" order */
+	SequenceTree order;
 
-	/** map order numbers to positions */
-	unsigned *const order;
+	/** map song ids to items */
+	IdTable<Item> id_table;
 
-	/** map song ids to positions */
-	IdTable id_table;
+public:
 
 	/** repeat playback when the end of the queue has been
 	    reached? */
@@ -130,46 +163,46 @@ struct Queue {
 		return _order < length;
 	}
 
+	[[gnu::pure]]
 	int IdToPosition(unsigned id) const noexcept {
-		return id_table.IdToPosition(id);
+		const Item *item = id_table.Get(id);
+		return item != nullptr
+			? (int)SequenceTree::GetIndex(item->position_hook)
+			: -1;
 	}
 
+	[[gnu::pure]]
 	int PositionToId(unsigned position) const noexcept {
-		assert(position < length);
-
-		return items[position].id;
+		return GetItem(position).id;
 	}
 
 	[[gnu::pure]]
 	unsigned OrderToPosition(unsigned _order) const noexcept {
-		assert(_order < length);
-
-		return order[_order];
+		return SequenceTree::GetIndex(GetOrderItem(_order).position_hook);
 	}
 
 	[[gnu::pure]]
 	unsigned PositionToOrder(unsigned position) const noexcept {
-		assert(position < length);
-
-		for (unsigned i = 0;; ++i) {
-			assert(i < length);
-
-			if (order[i] == position)
-				return i;
-		}
+		return SequenceTree::GetIndex(GetItem(position).order_hook);
 	}
 
 	[[gnu::pure]]
 	uint8_t GetPriorityAtPosition(unsigned position) const noexcept {
+		return GetItem(position).priority;
+	}
+
+	[[gnu::pure]]
+	const Item &GetItem(unsigned position) const noexcept {
 		assert(position < length);
 
-		return items[position].priority;
+		return Item::FromPosition(positions[position]);
 	}
 
+	[[gnu::pure]]
 	const Item &GetOrderItem(unsigned i) const noexcept {
 		assert(IsValidOrder(i));
 
-		return items[OrderToPosition(i)];
+		return Item::FromOrder(order[i]);
 	}
 
 	uint8_t GetOrderPriority(unsigned i) const noexcept {
@@ -182,14 +215,49 @@ struct Queue {
 	DetachedSong &Get(unsigned position) const noexcept {
 		assert(position < length);
 
-		return *items[position].song;
+		return Item::FromPosition(positions[position]).song;
 	}
 
 	/**
 	 * Like Get(), but return a #LightSong instance.
 	 */
+	[[gnu::pure]]
 	LightSong GetLight(unsigned position) const noexcept;
 
+	[[gnu::pure]]
+	static LightSong GetLight(const Item &item) noexcept;
+
+	/**
+	 * Invoke f(position, item) for each item in the (position)
+	 * range [start, end).  This is faster than looking up each
+	 * position.
+	 */
+	template<typename F>
+	void ForEachPosition(unsigned start, unsigned end, F &&f) const {
+		ForEachNewerPosition(start, end, 0, std::forward<F>(f));
+	}
+
+	/**
+	 * Like ForEachPosition(), but visit only items which are
+	 * newer than the specified version (see
+	 * IsNewerAtPosition()).  Unmodified parts of the queue are
+	 * skipped quickly.
+	 */
+	template<typename F>
+	void ForEachNewerPosition(unsigned start, unsigned end,
+				  uint32_t _version, F &&f) const {
+		assert(start <= end);
+		assert(end <= length);
+
+		if (_version > version)
+			_version = 0;
+
+		positions.ForEach(start, end, _version,
+				  [&f](unsigned position, const SequenceTreeHook &hook, uint32_t){
+			f(position, Item::FromPosition(hook));
+		});
+	}
+
 	/**
 	 * Returns the song at the specified order number.
 	 */
@@ -201,13 +269,13 @@ struct Queue {
 	 * Is the song at the specified position newer than the specified
 	 * version?
 	 */
+	[[gnu::pure]]
 	bool IsNewerAtPosition(unsigned position,
 			       uint32_t _version) const noexcept {
 		assert(position < length);
 
 		return _version > version ||
-			items[position].version >= _version ||
-			items[position].version == 0;
+			SequenceTree::GetStamp(positions[position]) >= _version;
 	}
 
 	/**
@@ -233,7 +301,7 @@ struct Queue {
 	void ModifyAtPosition(unsigned position) noexcept {
 		assert(position < length);
 
-		items[position].version = version;
+		SequenceTree::SetStamp(positions[position], version);
 	}
 
 	/**
@@ -264,7 +332,7 @@ struct Queue {
 	 * Swaps two songs, addressed by their order number.
 	 */
 	void SwapOrders(unsigned order1, unsigned order2) noexcept {
-		std::swap(order[order1], order[order2]);
+		order.Swap(order1, order2);
 	}
 
 	/**
@@ -313,12 +381,9 @@ struct Queue {
 	void Clear() noexcept;
 
 	/**
-	 * Initializes the "order" array, and restores "normal" order.
+	 * Restores "normal" order, i.e. "order" equals "position".
 	 */
-	void RestoreOrder() noexcept {
-		for (unsigned i = 0; i < length; ++i)
-			order[i] = i;
-	}
+	void RestoreOrder() noexcept;
 
 	/**
 	 * Shuffle the order of items in the specified range, ignoring
@@ -362,14 +427,6 @@ struct Queue {
 			      uint8_t priority, int after_order) noexcept;
 
 private:
-	void MoveItemTo(unsigned from, unsigned to) noexcept {
-		unsigned from_id = items[from].id;
-
-		items[to] = items[from];
-		items[to].version = version;
-		id_table.Move(from_id, to);
-	}
-
 	/**
 	 * Find the first item that has this specified priority or
 	 * higher.
@@ -48,15 +48,21 @@ queue_save_song(BufferedOutputStream &os, int idx, const DetachedSong &song)
 }
 
 void
-queue_save(BufferedOutputStream &os, const Queue &queue)
+queue_save_position(BufferedOutputStream &os, const Queue &queue,
+		    unsigned position)
 {
-	for (unsigned i = 0; i < queue.GetLength(); i++) {
-		uint8_t prio = queue.GetPriorityAtPosition(i);
-		if (prio != 0)
-			os.Fmt(FMT_STRING(PRIO_LABEL "{}\n"), prio);
+	uint8_t prio = queue.GetPriorityAtPosition(position);
+	if (prio != 0)
+		os.Fmt(FMT_STRING(PRIO_LABEL "{}\n"), prio);
 
-		queue_save_song(os, i, queue.Get(i));
-	}
+	queue_save_song(os, position, queue.Get(position));
+}
+
+void
+queue_save(BufferedOutputStream &os, const Queue &queue)
+{
+	for (unsigned i = 0; i < queue.GetLength(); i++)
+		queue_save_position(os, queue, i);
 }
 
 static DetachedSong
@@ -16,6 +16,14 @@ class SongLoader;
 void
 queue_save(BufferedOutputStream &os, const Queue &queue);
 
+/**
+ * Save the item at the specified position, in the same format as
+ * queue_save().
+ */
+void
+queue_save_position(BufferedOutputStream &os, const Queue &queue,
+		    unsigned position);
+
 /**
  * Loads one song from the state file and appends it to the queue.
  *
@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "SequenceTree.hxx"
+
+#include <cassert>
+
+/**
+ * Calculate the (pseudo-random) heap priority of a node from its
+ * address.  This saves storing a random number in each node.
+ */
+[[gnu::const]]
+static uint32_t
+GetPriority(const SequenceTreeHook *node) noexcept
+{
+	/* the finalizer of MurmurHash3 */
+	uint64_t x = reinterpret_cast<std::uintptr_t>(node);
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return static_cast<uint32_t>(x);
+}
+
+SequenceTreeHook &
+SequenceTree::operator[](unsigned i) const noexcept
+{
+	assert(i < size());
+
+	Hook *t = root;
+	while (true) {
+		const unsigned left_size = Size(t->left);
+		if (i < left_size) {
+			t = t->left;
+		} else if (i == left_size) {
+			return *t;
+		} else {
+			i -= left_size + 1;
+			t = t->right;
+		}
+	}
+}
+
+unsigned
+SequenceTree::GetIndex(const Hook &node) noexcept
+{
+	unsigned i = Size(node.left);
+
+	for (const Hook *t = &node; t->parent != nullptr; t = t->parent)
+		if (t == t->parent->right)
+			i += Size(t->parent->left) + 1;
+
+	return i;
+}
+
+uint32_t
+SequenceTree::GetStamp(const Hook &node) noexcept
+{
+	uint32_t stamp = node.stamp;
+
+	for (const Hook *t = node.parent; t != nullptr; t = t->parent)
+		stamp = std::max(stamp, t->pending_stamp);
+
+	return stamp;
+}
+
+void
+SequenceTree::SetStamp(Hook &node, uint32_t stamp) noexcept
+{
+	node.stamp = std::max(node.stamp, stamp);
+
+	for (Hook *t = &node; t != nullptr && t->max_stamp < stamp;
+	     t = t->parent)
+		t->max_stamp = stamp;
+}
+
+inline void
+SequenceTree::ApplyStamp(Hook *t, uint32_t stamp) noexcept
+{
+	if (t != nullptr) {
+		t->stamp = std::max(t->stamp, stamp);
+		t->pending_stamp = std::max(t->pending_stamp, stamp);
+		t->max_stamp = std::max(t->max_stamp, stamp);
+	}
+}
+
+inline void
+SequenceTree::PushDown(Hook &t) noexcept
+{
+	if (t.pending_stamp != 0) {
+		ApplyStamp(t.left, t.pending_stamp);
+		ApplyStamp(t.right, t.pending_stamp);
+		t.pending_stamp = 0;
+	}
+}
+
+inline void
+SequenceTree::Update(Hook &t) noexcept
+{
+	assert(t.pending_stamp == 0);
+
+	t.size = 1 + Size(t.left) + Size(t.right);
+	t.max_stamp = t.stamp;
+
+	if (t.left != nullptr) {
+		t.left->parent = &t;
+		t.max_stamp = std::max(t.max_stamp, t.left->max_stamp);
+	}
+
+	if (t.right != nullptr) {
+		t.right->parent = &t;
+		t.max_stamp = std::max(t.max_stamp, t.right->max_stamp);
+	}
+}
+
+void
+SequenceTree::Split(Hook *t, unsigned n, Hook *&a, Hook *&b) noexcept
+{
+	if (t == nullptr) {
+		a = b = nullptr;
+		return;
+	}
+
+	PushDown(*t);
+
+	const unsigned left_size = Size(t->left);
+	if (left_size < n) {
+		Split(t->right, n - left_size - 1, t->right, b);
+		a = t;
+	} else {
+		Split(t->left, n, a, t->left);
+		b = t;
+	}
+
+	Update(*t);
+}
+
+SequenceTreeHook *
+SequenceTree::Merge(Hook *a, Hook *b) noexcept
+{
+	if (a == nullptr)
+		return b;
+	if (b == nullptr)
+		return a;
+
+	if (GetPriority(a) > GetPriority(b)) {
+		PushDown(*a);
+		a->right = Merge(a->right, b);
+		Update(*a);
+		return a;
+	} else {
+		PushDown(*b);
+		b->left = Merge(a, b->left);
+		Update(*b);
+		return b;
+	}
+}
+
+SequenceTreeHook *
+SequenceTree::Build(std::span<Hook *const> nodes) noexcept
+{
+	/* build the Cartesian tree with a stack containing the right
+	   spine of the tree built so far */
+
+	std::vector<Hook *> spine;
+
+	for (Hook *node : nodes) {
+		node->left = node->right = nullptr;
+		node->pending_stamp = 0;
+
+		Hook *last = nullptr;
+		while (!spine.empty() &&
+		       GetPriority(spine.back()) < GetPriority(node)) {
+			last = spine.back();
+			spine.pop_back();
+			Update(*last);
+		}
+
+		node->left = last;
+		if (!spine.empty())
+			spine.back()->right = node;
+
+		spine.push_back(node);
+	}
+
+	if (spine.empty())
+		return nullptr;
+
+	while (spine.size() > 1) {
+		Update(*spine.back());
+		spine.pop_back();
+	}
+
+	Hook *result = spine.front();
+	Update(*result);
+	result->parent = nullptr;
+	return result;
+}
+
+void
+SequenceTree::Split3(unsigned start, unsigned end,
+		     Hook *&a, Hook *&b, Hook *&c) noexcept
+{
+	assert(start <= end);
+	assert(end <= size());
+
+	Hook *bc;
+	Split(root, start, a, bc);
+	Split(bc, end - start, b, c);
+	root = nullptr;
+
+	for (Hook *i : {a, b, c})
+		if (i != nullptr)
+			i->parent = nullptr;
+}
+
+void
+SequenceTree::SetStamp(unsigned start, unsigned end, uint32_t stamp) noexcept
+{
+	if (start >= end)
+		return;
+
+	Hook *a, *b, *c;
+	Split3(start, end, a, b, c);
+	ApplyStamp(b, stamp);
+	root = Merge(Merge(a, b), c);
+	root->parent = nullptr;
+}
+
+void
+SequenceTree::ClearStamps() noexcept
+{
+	std::vector<Hook *> stack;
+	if (root != nullptr)
+		stack.push_back(root);
+
+	while (!stack.empty()) {
+		Hook *t = stack.back();
+		stack.pop_back();
+
+		t->stamp = t->pending_stamp = t->max_stamp = 0;
+
+		if (t->left != nullptr)
+			stack.push_back(t->left);
+		if (t->right != nullptr)
+			stack.push_back(t->right);
+	}
+}
+
+void
+SequenceTree::push_back(Hook &node) noexcept
+{
+	node.left = node.right = nullptr;
+	node.pending_stamp = 0;
+	node.size = 1;
+	node.max_stamp = node.stamp;
+
+	root = Merge(root, &node);
+	root->parent = nullptr;
+}
+
+void
+SequenceTree::erase(Hook &node) noexcept
+{
+	const unsigned i = GetIndex(node);
+
+	Hook *a, *b, *c;
+	Split3(i, i + 1, a, b, c);
+	assert(b == &node);
+
+	root = Merge(a, c);
+	if (root != nullptr)
+		root->parent = nullptr;
+}
+
+void
+SequenceTree::MoveRange(unsigned start, unsigned end, unsigned to) noexcept
+{
+	assert(start <= end);
+	assert(to + (end - start) <= size());
+
+	Hook *a, *b, *c;
+	Split3(start, end, a, b, c);
+
+	Hook *x, *y;
+	Split(Merge(a, c), to, x, y);
+
+	root = Merge(Merge(x, b), y);
+	if (root != nullptr)
+		root->parent = nullptr;
+}
+
+void
+SequenceTree::Swap(unsigned a, unsigned b) noexcept
+{
+	if (a == b)
+		return;
+
+	if (a > b)
+		std::swap(a, b);
+
+	MoveRange(b, b + 1, a);
+	MoveRange(a + 1, a + 2, b);
+}
+
+std::vector<SequenceTreeHook *>
+SequenceTree::Cut(unsigned start, unsigned end) noexcept
+{
+	Hook *a, *b, *c;
+	Split3(start, end, a, b, c);
+
+	root = Merge(a, c);
+	if (root != nullptr)
+		root->parent = nullptr;
+
+	/* collect the nodes with an in-order traversal, applying
+	   all pending stamps */
+
+	std::vector<Hook *> result;
+	result.reserve(end - start);
+
+	std::vector<Hook *> stack;
+	for (Hook *t = b; t != nullptr || !stack.empty();) {
+		if (t != nullptr) {
+			PushDown(*t);
+			stack.push_back(t);
+			t = t->left;
+		} else {
+			t = stack.back();
+			stack.pop_back();
+			result.push_back(t);
+			t = t->right;
+		}
+	}
+
+	return result;
+}
+
+void
+SequenceTree::Paste(unsigned i, std::span<Hook *const> nodes) noexcept
+{
+	assert(i <= size());
+
+	Hook *a, *c;
+	Split(root, i, a, c);
+
+	root = Merge(Merge(a, Build(nodes)), c);
+	if (root != nullptr)
+		root->parent = nullptr;
+}
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_QUEUE_SEQUENCE_TREE_HXX
+#define MPD_QUEUE_SEQUENCE_TREE_HXX
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * The links of one item in a #SequenceTree.  An item may be linked
+ * into several trees at the same time, with one hook for each.
+ */
+struct SequenceTreeHook {
+	SequenceTreeHook *parent, *left, *right;
+
+	/**
+	 * The number of items in this subtree.
+	 */
+	unsigned size;
+
+	/**
+	 * A number attached to this item (e.g. the version number of
+	 * its last modification).  The effective value is the maximum
+	 * of this and the #pending_stamp of all ancestors.
+	 */
+	uint32_t stamp = 0;
+
+	/**
+	 * A stamp which has been raised for the whole subtree, but
+	 * has not yet been applied to the children.
+	 */
+	uint32_t pending_stamp = 0;
+
+	/**
+	 * The maximum stamp in this subtree (including the
+	 * #pending_stamp).  This allows skipping subtrees which
+	 * contain no item with a certain minimum stamp.
+	 */
+	uint32_t max_stamp = 0;
+};
+
+/**
+ * A sequence of items which allows looking up an item by its index,
+ * and the index of an item, in O(log n).  Moving ranges of items
+ * around costs O(log n), too.
+ *
+ * This is an intrusive container: it does not own the items, it only
+ * links their #SequenceTreeHook.  It is implemented as a treap with
+ * implicit keys (the subtree sizes); the heap priority of each node is
+ * derived from its address.
+ */
+class SequenceTree {
+	using Hook = SequenceTreeHook;
+
+	Hook *root = nullptr;
+
+public:
+	SequenceTree() noexcept = default;
+
+	SequenceTree(const SequenceTree &) = delete;
+	SequenceTree &operator=(const SequenceTree &) = delete;
+
+	[[gnu::pure]]
+	unsigned size() const noexcept {
+		return root != nullptr ? root->size : 0;
+	}
+
+	[[gnu::pure]]
+	bool empty() const noexcept {
+		return root == nullptr;
+	}
+
+	/**
+	 * Unlink all items (without touching them).
+	 */
+	void clear() noexcept {
+		root = nullptr;
+	}
+
+	/**
+	 * Returns the item at the given index.
+	 */
+	[[gnu::pure]]
+	Hook &operator[](unsigned i) const noexcept;
+
+	/**
+	 * Returns the index of the given item.
+	 */
+	[[gnu::pure]]
+	static unsigned GetIndex(const Hook &node) noexcept;
+
+	/**
+	 * Returns the effective stamp of the given item.
+	 */
+	[[gnu::pure]]
+	static uint32_t GetStamp(const Hook &node) noexcept;
+
+	/**
+	 * Raise the stamp of the given item.  This takes O(log n)
+	 * time.
+	 */
+	static void SetStamp(Hook &node, uint32_t stamp) noexcept;
+
+	/**
+	 * Raise the stamp of all items in the range [start, end).
+	 */
+	void SetStamp(unsigned start, unsigned end, uint32_t stamp) noexcept;
+
+	/**
+	 * Reset all stamps to zero.
+	 */
+	void ClearStamps() noexcept;
+
+	void push_back(Hook &node) noexcept;
+
+	void erase(Hook &node) noexcept;
+
+	/**
+	 * Move the items [start, end) so the first one is at index
+	 * "to" afterwards.
+	 */
+	void MoveRange(unsigned start, unsigned end, unsigned to) noexcept;
+
+	/**
+	 * Swap the items at the two given indexes.
+	 */
+	void Swap(unsigned a, unsigned b) noexcept;
+
+	/**
+	 * Remove the items [start, end) and return them in their
+	 * order.  This takes O(log n + (end - start)) time.
+	 */
+	std::vector<Hook *> Cut(unsigned start, unsigned end) noexcept;
+
+	/**
+	 * Insert the given items (which must not be linked yet) at
+	 * the given index.  This takes O(log n + nodes.size()) time.
+	 */
+	void Paste(unsigned i, std::span<Hook *const> nodes) noexcept;
+
+	/**
+	 * Invoke f(index, hook, stamp) for each item in the range
+	 * [start, end) whose stamp is at least #min_stamp, in their
+	 * order.  This takes O(log n + (end - start)) time, but
+	 * subtrees without matching items are skipped, so finding a
+	 * few recently stamped items is much cheaper than that.
+	 */
+	template<typename F>
+	void ForEach(unsigned start, unsigned end, uint32_t min_stamp,
+		     F &&f) const {
+		if (start < end)
+			ForEach(root, 0, start, end, min_stamp, 0, f);
+	}
+
+private:
+	template<typename F>
+	static void ForEach(const Hook *t, unsigned offset,
+			    unsigned start, unsigned end,
+			    uint32_t min_stamp, uint32_t inherited_stamp,
+			    F &f) {
+		/* start and end are relative to this subtree, and
+		   the range is not empty; "offset" is the index of
+		   this subtree's first item */
+
+		if (std::max(t->max_stamp, inherited_stamp) < min_stamp)
+			return;
+
+		inherited_stamp = std::max(inherited_stamp, t->pending_stamp);
+
+		const unsigned left_size = Size(t->left);
+
+		if (start < left_size)
+			ForEach(t->left, offset,
+				start, std::min(end, left_size),
+				min_stamp, inherited_stamp, f);
+
+		if (start <= left_size && left_size < end) {
+			const uint32_t stamp = std::max(t->stamp, inherited_stamp);
+			if (stamp >= min_stamp)
+				f(offset + left_size, *t, stamp);
+		}
+
+		if (end > left_size + 1)
+			ForEach(t->right, offset + left_size + 1,
+				start > left_size ? start - left_size - 1 : 0,
+				end - left_size - 1,
+				min_stamp, inherited_stamp, f);
+	}
+
+	static unsigned Size(const Hook *t) noexcept {
+		return t != nullptr ? t->size : 0;
+	}
+
+	static void ApplyStamp(Hook *t, uint32_t stamp) noexcept;
+	static void PushDown(Hook &t) noexcept;
+	static void Update(Hook &t) noexcept;
+
+	/**
+	 * Split the given tree after the first "n" items.
+	 */
+	static void Split(Hook *t, unsigned n, Hook *&a, Hook *&b) noexcept;
+
+	static Hook *Merge(Hook *a, Hook *b) noexcept;
+
+	/**
+	 * Build a tree from the given items in O(n).
+	 */
+	static Hook *Build(std::span<Hook *const> nodes) noexcept;
+
+	/**
+	 * Split this tree into the items before "start", the range
+	 * [start, end) and the items after it.
+	 */
+	void Split3(unsigned start, unsigned end,
+		    Hook *&a, Hook *&b, Hook *&c) noexcept;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #ifndef MPD_DETACHED_SONG_HXX
 #define MPD_DETACHED_SONG_HXX
 
+#include "ResponseCache.hxx"
 #include "tag/Tag.hxx"
 #include "pcm/AudioFormat.hxx"
 #include "Chrono.hxx"
@@ -83,6 +84,12 @@ class DetachedSong {
 	 */
 	AudioFormat audio_format = AudioFormat::Undefined();
 
+	/**
+	 * The formatted protocol response; cleared by all methods
+	 * which modify this object.
+	 */
+	SongResponseCache response_cache;
+
 public:
 	explicit DetachedSong(const char *_uri) noexcept
 		:uri(_uri) {}
@@ -189,19 +196,24 @@ public:
 	}
 
 	Tag &WritableTag() noexcept {
+		response_cache.Clear();
 		return tag;
 	}
 
 	void SetTag(const Tag &_tag) noexcept {
 		tag = Tag(_tag);
+		response_cache.Clear();
 	}
 
 	void SetTag(Tag &&_tag) noexcept {
 		tag = std::move(_tag);
+		response_cache.Clear();
 	}
 
 	void MoveTagFrom(DetachedSong &&other) noexcept {
 		tag = std::move(other.tag);
+		response_cache.Clear();
+		other.response_cache.Clear();
 	}
 
 	/**
@@ -210,6 +222,8 @@ public:
 	 */
 	void MoveTagItemsFrom(DetachedSong &&other) noexcept {
 		tag.MoveItemsFrom(std::move(other.tag));
+		response_cache.Clear();
+		other.response_cache.Clear();
 	}
 
 	std::chrono::system_clock::time_point GetLastModified() const noexcept {
@@ -218,6 +232,7 @@ public:
 
 	void SetLastModified(std::chrono::system_clock::time_point _value) noexcept {
 		mtime = _value;
+		response_cache.Clear();
 	}
 
 	std::chrono::system_clock::time_point GetAdded() const noexcept {
@@ -228,6 +243,7 @@ public:
 
 	void SetAdded(std::chrono::system_clock::time_point _value) noexcept {
 		added = _value;
+		response_cache.Clear();
 	}
 
 	SongTime GetStartTime() const noexcept {
@@ -236,6 +252,7 @@ public:
 
 	void SetStartTime(SongTime _value) noexcept {
 		start_time = _value;
+		response_cache.Clear();
 	}
 
 	SongTime GetEndTime() const noexcept {
@@ -244,17 +261,23 @@ public:
 
 	void SetEndTime(SongTime _value) noexcept {
 		end_time = _value;
+		response_cache.Clear();
 	}
 
 	[[gnu::pure]]
 	SignedSongTime GetDuration() const noexcept;
 
+	const SongResponseCache &GetResponseCache() const noexcept {
+		return response_cache;
+	}
+
 	const AudioFormat &GetAudioFormat() const noexcept {
 		return audio_format;
 	}
 
 	void SetAudioFormat(const AudioFormat &src) noexcept {
 		audio_format = src;
+		response_cache.Clear();
 	}
 
 	/**
@@ -11,6 +11,7 @@
 #include <chrono>
 
 struct Tag;
+class SongResponseCache;
 
 /**
  * A reference to a song file.  Unlike the other "Song" classes in the
@@ -79,6 +80,14 @@ struct LightSong {
 	 */
 	uint8_t priority = 0;
 
+	/**
+	 * If not nullptr, then song_print_info() may use this to
+	 * cache the formatted response.  It must only be set if all
+	 * other attributes are owned by the object which owns the
+	 * cache (and thus clears it when they are modified).
+	 */
+	const SongResponseCache *response_cache = nullptr;
+
 	LightSong(const char *_uri, const Tag &_tag) noexcept
 		:uri(_uri), tag(_tag) {}
 
@@ -86,6 +95,9 @@ struct LightSong {
 	 * A copy constructor which copies all fields, but only sets
 	 * the tag to a caller-provided reference.  This is used by
 	 * the #ExportedSong move constructor.
+	 *
+	 * The #response_cache is not copied, because it was rendered
+	 * from the other tag.
 	 */
 	LightSong(const LightSong &src, const Tag &_tag) noexcept
 		:directory(src.directory), uri(src.uri),
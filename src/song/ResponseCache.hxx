@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_SONG_RESPONSE_CACHE_HXX
+#define MPD_SONG_RESPONSE_CACHE_HXX
+
+#include "tag/Mask.hxx"
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * Caches the protocol representation of a song's attributes (as
+ * generated by song_print_info(), excluding the URI) for one
+ * #TagMask, so repeated responses can be assembled without
+ * formatting anything.
+ *
+ * Lookups may happen concurrently (e.g. with the shared database
+ * lock); a rendered block is only installed if there is none yet, so
+ * it stays valid until Clear() is called, which requires exclusive
+ * access to the song.
+ */
+class SongResponseCache {
+	struct Block {
+		TagMask tag_mask;
+		std::string text;
+	};
+
+	mutable std::atomic<Block *> block{nullptr};
+
+public:
+	SongResponseCache() noexcept = default;
+
+	~SongResponseCache() noexcept {
+		delete block.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Copies start with an empty cache.
+	 */
+	SongResponseCache(const SongResponseCache &) noexcept {}
+
+	SongResponseCache(SongResponseCache &&src) noexcept
+		:block(src.block.exchange(nullptr, std::memory_order_relaxed)) {}
+
+	SongResponseCache &operator=(SongResponseCache &&src) noexcept {
+		Clear();
+		block.store(src.block.exchange(nullptr, std::memory_order_relaxed),
+			    std::memory_order_relaxed);
+		return *this;
+	}
+
+	/**
+	 * Discard the cached block.  The caller must have exclusive
+	 * access to the song.
+	 */
+	void Clear() noexcept {
+		delete block.exchange(nullptr, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Look up the cached block for the given #TagMask.
+	 *
+	 * @return the text or nullptr if there is no matching block
+	 */
+	[[gnu::pure]]
+	const std::string *Get(TagMask tag_mask) const noexcept {
+		const Block *b = block.load(std::memory_order_acquire);
+		return b != nullptr && b->tag_mask == tag_mask
+			? &b->text
+			: nullptr;
+	}
+
+	/**
+	 * Install a rendered block unless there is one already.
+	 */
+	void Put(TagMask tag_mask, std::string_view text) const noexcept {
+		if (block.load(std::memory_order_relaxed) != nullptr)
+			return;
+
+		auto *b = new Block{tag_mask, std::string{text}};
+		Block *expected = nullptr;
+		if (!block.compare_exchange_strong(expected, b,
+						   std::memory_order_release,
+						   std::memory_order_relaxed))
+			delete b;
+	}
+};
+
+#endif
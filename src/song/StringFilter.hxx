@@ -85,6 +85,16 @@ public:
 		return negated;
 	}
 
+	/**
+	 * Does this filter match only strings which are equal to the
+	 * value (case-sensitive, no regular expression, no
+	 * negation)?
+	 */
+	bool IsExactMatch() const noexcept {
+		return position == Position::FULL && !fold_case &&
+			!IsRegex() && !negated;
+	}
+
 	void ToggleNegated() noexcept {
 		negated = !negated;
 	}
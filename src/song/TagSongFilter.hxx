@@ -38,6 +38,10 @@ public:
 		return filter.IsNegated();
 	}
 
+	bool IsExactMatch() const noexcept {
+		return filter.IsExactMatch();
+	}
+
 	void ToggleNegated() noexcept {
 		filter.ToggleNegated();
 	}
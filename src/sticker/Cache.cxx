@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Cache.hxx"
+#include "util/DeleteDisposer.hxx"
+
+StickerCache::~StickerCache() noexcept
+{
+	items_by_key.clear();
+	items_by_time.clear_and_dispose(DeleteDisposer{});
+}
+
+const Sticker *
+StickerCache::Get(std::string_view type, std::string_view uri) noexcept
+{
+	auto i = items_by_key.find(Key{type, uri});
+	if (i == items_by_key.end())
+		return nullptr;
+
+	/* refresh */
+	items_by_time.erase(items_by_time.iterator_to(*i));
+	items_by_time.push_back(*i);
+
+	return &i->sticker;
+}
+
+Sticker *
+StickerCache::Modify(std::string_view type, std::string_view uri,
+		     uint_least64_t serial) noexcept
+{
+	auto i = items_by_key.find(Key{type, uri});
+	if (i == items_by_key.end())
+		return nullptr;
+
+	i->serial = serial;
+	return &i->sticker;
+}
+
+inline void
+StickerCache::Evict(Item &item) noexcept
+{
+	items_by_key.erase(items_by_key.iterator_to(item));
+	items_by_time.erase(items_by_time.iterator_to(item));
+	delete &item;
+}
+
+const Sticker &
+StickerCache::Put(std::string_view type, std::string_view uri,
+		  Sticker &&sticker)
+{
+	auto [bucket, inserted] = items_by_key.insert_check(Key{type, uri});
+	if (!inserted) {
+		/* replace the existing item in-place, so pointers
+		   returned by Get() remain valid */
+		bucket->sticker = std::move(sticker);
+
+		items_by_time.erase(items_by_time.iterator_to(*bucket));
+		items_by_time.push_back(*bucket);
+		return bucket->sticker;
+	}
+
+	auto *item = new Item(type, uri, std::move(sticker));
+	items_by_key.insert_commit(bucket, *item);
+	items_by_time.push_back(*item);
+
+	/* evict the least recently used items, but skip the pinned
+	   ones (if all are pinned, the cache grows beyond
+	   max_size) */
+	for (auto i = items_by_time.begin();
+	     items_by_key.size() > max_size && i != items_by_time.end();) {
+		auto &oldest = *i++;
+		if (!IsPinned(oldest))
+			Evict(oldest);
+	}
+
+	return item->sticker;
+}
+
+void
+StickerCache::Remove(std::string_view type, std::string_view uri) noexcept
+{
+	auto i = items_by_key.find(Key{type, uri});
+	if (i == items_by_key.end())
+		return;
+
+	Evict(*i);
+}
+
+void
+StickerCache::Clear() noexcept
+{
+	for (auto i = items_by_time.begin(); i != items_by_time.end();) {
+		auto &item = *i++;
+		if (!IsPinned(item))
+			Evict(item);
+	}
+}
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "Sticker.hxx"
+#include "util/IntrusiveHashSet.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * An in-memory cache of the complete #Sticker (i.e. all name/value
+ * pairs) of recently used objects.  The least recently used ones are
+ * evicted when the cache is full.
+ *
+ * An object without stickers is cached as an empty #Sticker, so
+ * repeated lookups of objects which have no sticker don't hit the
+ * database either.
+ *
+ * Objects with modifications which have not yet been committed to
+ * the database (see #StickerWriter) are never evicted, because the
+ * database would return stale data for them.
+ *
+ * This class is not thread-safe.
+ */
+class StickerCache {
+	using Key = std::pair<std::string_view, std::string_view>;
+
+	struct Item final
+		: IntrusiveHashSetHook<>,
+		  IntrusiveListHook<>
+	{
+		const std::string type, uri;
+
+		Sticker sticker;
+
+		/**
+		 * The serial of the last modification of this
+		 * object.  The item must not be evicted before it has
+		 * been committed.
+		 */
+		uint_least64_t serial = 0;
+
+		Item(std::string_view _type, std::string_view _uri,
+		     Sticker &&_sticker) noexcept
+			:type(_type), uri(_uri), sticker(std::move(_sticker)) {}
+
+		struct GetKey {
+			[[gnu::pure]]
+			Key operator()(const Item &item) const noexcept {
+				return {item.type, item.uri};
+			}
+		};
+	};
+
+	struct Hash {
+		[[gnu::pure]]
+		std::size_t operator()(Key key) const noexcept {
+			const std::hash<std::string_view> h;
+			return h(key.first) ^ h(key.second);
+		}
+	};
+
+	const std::size_t max_size;
+
+	/**
+	 * All modifications up to this serial have been committed.
+	 */
+	uint_least64_t committed = 0;
+
+	/**
+	 * All items; the least recently used one comes first.
+	 */
+	IntrusiveList<Item> items_by_time;
+
+	IntrusiveHashSet<
+		Item, 4093,
+		IntrusiveHashSetOperators<Item, Item::GetKey, Hash,
+					  std::equal_to<Key>>,
+		IntrusiveHashSetBaseHookTraits<Item>,
+		IntrusiveHashSetOptions{.constant_time_size = true}> items_by_key;
+
+public:
+	explicit StickerCache(std::size_t _max_size) noexcept
+		:max_size(_max_size) {}
+
+	~StickerCache() noexcept;
+
+	StickerCache(const StickerCache &) = delete;
+	StickerCache &operator=(const StickerCache &) = delete;
+
+	/**
+	 * Look up an object and mark it as recently used.
+	 *
+	 * @return the cached #Sticker or nullptr if the object is not
+	 * in the cache
+	 */
+	const Sticker *Get(std::string_view type, std::string_view uri) noexcept;
+
+	/**
+	 * Look up a cached object for modification and pin it until
+	 * SetCommitted() is called with the given serial (or a newer
+	 * one).
+	 *
+	 * @return the cached #Sticker or nullptr if the object is not
+	 * in the cache
+	 */
+	Sticker *Modify(std::string_view type, std::string_view uri,
+			uint_least64_t serial) noexcept;
+
+	/**
+	 * All modifications up to the given serial have been
+	 * committed; their objects may be evicted from now on.
+	 */
+	void SetCommitted(uint_least64_t serial) noexcept {
+		committed = serial;
+	}
+
+	/**
+	 * Add an object to the cache (or replace the cached #Sticker),
+	 * evicting the least recently used object if the cache is
+	 * full.  Items which have been returned by Get() or Put()
+	 * remain valid until max_size other items have been used.
+	 *
+	 * @return the cached #Sticker
+	 */
+	const Sticker &Put(std::string_view type, std::string_view uri,
+			   Sticker &&sticker);
+
+	/**
+	 * Remove an object from the cache, e.g. because it was
+	 * modified.
+	 */
+	void Remove(std::string_view type, std::string_view uri) noexcept;
+
+	/**
+	 * Remove all objects except for those with uncommitted
+	 * modifications.
+	 */
+	void Clear() noexcept;
+
+private:
+	[[gnu::pure]]
+	bool IsPinned(const Item &item) const noexcept {
+		return item.serial > committed;
+	}
+
+	void Evict(Item &item) noexcept;
+};
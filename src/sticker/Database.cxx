@@ -2,6 +2,7 @@
 // Copyright The Music Player Daemon Project
 
 #include "Database.hxx"
+#include "Writer.hxx"
 #include "Sticker.hxx"
 #include "lib/sqlite/Util.hxx"
 #include "fs/Path.hxx"
@@ -9,8 +10,10 @@
 #include "Idle.hxx"
 #include "util/StringCompare.hxx"
 #include "util/ScopeExit.hxx"
+#include "util/StaticVector.hxx"
 
 #include <fmt/format.h>
+#include <algorithm>
 #include <cassert>
 #include <iterator>
 #include <array>
@@ -18,25 +21,9 @@
 
 using namespace Sqlite;
 
-enum sticker_sql_find {
-	STICKER_SQL_FIND,
-	STICKER_SQL_FIND_VALUE,
-	STICKER_SQL_FIND_LT,
-	STICKER_SQL_FIND_GT,
-
-	STICKER_SQL_FIND_EQ_INT,
-	STICKER_SQL_FIND_LT_INT,
-	STICKER_SQL_FIND_GT_INT,
-
-	STICKER_SQL_FIND_CONTAINS,
-	STICKER_SQL_FIND_STARTS_WITH,
-
-	STICKER_SQL_FIND_COUNT
-};
-
 enum sticker_sql {
-	STICKER_SQL_GET,
 	STICKER_SQL_LIST,
+	STICKER_SQL_LIST_MANY,
 	STICKER_SQL_UPDATE,
 	STICKER_SQL_INSERT,
 	STICKER_SQL_DELETE,
@@ -50,40 +37,25 @@ enum sticker_sql {
 	STICKER_SQL_COUNT
 };
 
-static constexpr auto sticker_sql_find = std::array {
-	//[STICKER_SQL_FIND] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=?",
-
-	//[STICKER_SQL_FIND_VALUE] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND value=?",
-
-	//[STICKER_SQL_FIND_LT] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND value<?",
+/**
+ * The number of URI parameters of #STICKER_SQL_LIST_MANY.
+ */
+static constexpr std::size_t LIST_MANY_SIZE = 64;
 
-	//[STICKER_SQL_FIND_GT] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND value>?",
-
-	//[STICKER_SQL_FIND_EQ_INT] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND CAST(value AS INT)=?",
-
-	//[STICKER_SQL_FIND_LT_INT] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND CAST(value AS INT)<?",
-
-	//[STICKER_SQL_FIND_GT_INT] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND CAST(value AS INT)>?",
-
-	//[STICKER_SQL_FIND_CONTAINS] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND value LIKE ('%' || ? || '%')",
-
-	//[STICKER_SQL_FIND_STARTS_WITH] =
-	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND value LIKE (? || '%')",
-};
+/**
+ * The maximum number of objects in the #StickerCache.
+ */
+static constexpr std::size_t STICKER_CACHE_SIZE = 16384;
 
 static constexpr auto sticker_sql = std::array {
-	//[STICKER_SQL_GET] =
-	"SELECT value FROM sticker WHERE type=? AND uri=? AND name=?",
 	//[STICKER_SQL_LIST] =
 	"SELECT name,value FROM sticker WHERE type=? AND uri=?",
+	//[STICKER_SQL_LIST_MANY] =
+	"SELECT uri,name,value FROM sticker WHERE type=? AND uri IN ("
+	"?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,"
+	"?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,"
+	"?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,"
+	"?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)",
 	//[STICKER_SQL_UPDATE] =
 	"UPDATE sticker SET value=? WHERE type=? AND uri=? AND name=?",
 	//[STICKER_SQL_INSERT] =
@@ -118,11 +90,18 @@ static constexpr const char sticker_sql_create[] =
 	");"
 	"CREATE UNIQUE INDEX IF NOT EXISTS"
 	" sticker_value ON sticker(type, uri, name);"
+	/* for "sticker find" with a value operator and/or sorted by
+	   value */
+	"CREATE INDEX IF NOT EXISTS"
+	" sticker_name_value ON sticker(type, name, value);"
+	"CREATE INDEX IF NOT EXISTS"
+	" sticker_name_value_int ON sticker(type, name, CAST(value AS INT));"
 	"";
 
 StickerDatabase::StickerDatabase(const char *_path)
 	:path(_path),
-	 db(path.c_str())
+	 db(path.c_str()),
+	 cache(STICKER_CACHE_SIZE)
 {
 	int ret;
 
@@ -141,13 +120,28 @@ StickerDatabase::StickerDatabase(const char *_path)
 
 		stmt[i] = Prepare(db, sticker_sql[i]);
 	}
+
+	/* while the other connection (see StickerWriter) holds a
+	   lock, let SQLite sleep instead of busy-spinning in
+	   ExecuteBusy(), which would steal CPU time from the lock
+	   holder */
+	sqlite3_busy_timeout(db, 100);
 }
 
 StickerDatabase::StickerDatabase(Path _path)
-	:StickerDatabase(NarrowPath{_path}) {}
+	:StickerDatabase(NarrowPath{_path})
+{
+	/* another connection to an in-memory database would see a
+	   different database */
+	if (path != ":memory:")
+		writer = std::make_unique<StickerWriter>(*this);
+}
 
 StickerDatabase::~StickerDatabase() noexcept
 {
+	/* commit all pending modifications */
+	writer.reset();
+
 	if (db == nullptr)
 		return;
 
@@ -161,8 +155,6 @@ StickerDatabase::~StickerDatabase() noexcept
 std::string
 StickerDatabase::LoadValue(const char *type, const char *uri, const char *name)
 {
-	sqlite3_stmt *const s = stmt[STICKER_SQL_GET];
-
 	assert(type != nullptr);
 	assert(uri != nullptr);
 	assert(name != nullptr);
@@ -170,18 +162,61 @@ StickerDatabase::LoadValue(const char *type, const char *uri, const char *name)
 	if (StringIsEmpty(name))
 		return {};
 
-	BindAll(s, type, uri, name);
+	const auto &table = LoadCached(type, uri).table;
+	if (auto i = table.find(name); i != table.end())
+		return i->second;
 
-	AtScopeExit(s) {
-		sqlite3_reset(s);
-		sqlite3_clear_bindings(s);
-	};
+	return {};
+}
 
-	std::string value;
-	if (ExecuteRow(s))
-		value = (const char*)sqlite3_column_text(s, 0);
+void
+StickerDatabase::LoadValues(const char *type,
+			    std::span<const char *const> uris,
+			    const char *name,
+			    void (*func)(const char *uri, const char *value,
+					 void *user_data),
+			    void *user_data)
+{
+	assert(type != nullptr);
+	assert(name != nullptr);
+	assert(func != nullptr);
+
+	static_assert(STICKER_CACHE_SIZE >= LIST_MANY_SIZE);
+
+	DiscardFailed();
 
-	return value;
+	while (!uris.empty()) {
+		const auto chunk = uris.first(std::min(uris.size(),
+						       LIST_MANY_SIZE));
+		uris = uris.subspan(chunk.size());
+
+		/* look up the whole chunk in the cache and load
+		   the missing ones with one query; this cannot evict
+		   items of this chunk, because they're the most
+		   recently used ones */
+		std::array<const Sticker *, LIST_MANY_SIZE> stickers;
+		StaticVector<const char *, LIST_MANY_SIZE> missing;
+
+		for (std::size_t i = 0; i < chunk.size(); ++i) {
+			stickers[i] = cache.Get(type, chunk[i]);
+			if (stickers[i] == nullptr)
+				missing.push_back(chunk[i]);
+		}
+
+		if (!missing.empty())
+			ListValuesMany(type, missing);
+
+		for (std::size_t i = 0; i < chunk.size(); ++i) {
+			if (stickers[i] == nullptr)
+				stickers[i] = cache.Get(type, chunk[i]);
+
+			assert(stickers[i] != nullptr);
+
+			const auto &table = stickers[i]->table;
+			if (auto j = table.find(name); j != table.end())
+				func(chunk[i], j->second.c_str(), user_data);
+		}
+	}
 }
 
 void
@@ -207,6 +242,99 @@ StickerDatabase::ListValues(std::map<std::string, std::string, std::less<>> &tab
 	});
 }
 
+void
+StickerDatabase::ListValuesMany(const char *type,
+				std::span<const char *const> uris)
+{
+	sqlite3_stmt *const s = stmt[STICKER_SQL_LIST_MANY];
+
+	assert(type != nullptr);
+	assert(!uris.empty());
+	assert(uris.size() <= LIST_MANY_SIZE);
+
+	std::map<std::string_view, Sticker, std::less<>> result;
+	for (const char *uri : uris)
+		result.try_emplace(uri);
+
+	/* unused parameters remain NULL, which never matches */
+	Bind(s, 1, type);
+	for (std::size_t i = 0; i < uris.size(); ++i)
+		Bind(s, i + 2, uris[i]);
+
+	AtScopeExit(s) {
+		sqlite3_reset(s);
+		sqlite3_clear_bindings(s);
+	};
+
+	ExecuteForEach(s, [s, &result](){
+		const char *uri = (const char *)sqlite3_column_text(s, 0);
+		const char *name = (const char *)sqlite3_column_text(s, 1);
+		const char *value = (const char *)sqlite3_column_text(s, 2);
+
+		if (auto i = result.find(std::string_view{uri}); i != result.end())
+			i->second.table.emplace(name, value);
+	});
+
+	UpdateCommitted();
+	for (auto &[uri, sticker] : result)
+		cache.Put(type, uri, std::move(sticker));
+}
+
+const Sticker &
+StickerDatabase::LoadCached(const char *type, const char *uri)
+{
+	DiscardFailed();
+
+	if (const auto *sticker = cache.Get(type, uri))
+		return *sticker;
+
+	/* objects which are not in the cache have no pending
+	   modifications (see StickerCache::Modify()), so the database
+	   is up to date */
+	Sticker sticker;
+	ListValues(sticker.table, type, uri);
+
+	UpdateCommitted();
+	return cache.Put(type, uri, std::move(sticker));
+}
+
+void
+StickerDatabase::WaitCommitted() noexcept
+{
+	if (writer)
+		writer->WaitCommitted();
+}
+
+inline void
+StickerDatabase::UpdateCommitted() noexcept
+{
+	if (writer)
+		cache.SetCommitted(writer->GetCommitted());
+}
+
+inline void
+StickerDatabase::DiscardFailed() noexcept
+{
+	if (!writer || !writer->HasFailed()) [[likely]]
+		return;
+
+	/* wait for newer modifications of these objects, so they
+	   are not pinned anymore and the database is up to date
+	   when they are loaded again */
+	writer->WaitCommitted();
+	UpdateCommitted();
+
+	for (const auto &[type, uri] : writer->TakeFailed())
+		cache.Remove(type, uri);
+}
+
+void
+StickerDatabase::ClearCache() noexcept
+{
+	UpdateCommitted();
+	cache.Clear();
+}
+
 bool
 StickerDatabase::UpdateValue(const char *type, const char *uri,
 			     const char *name, const char *value)
@@ -226,11 +354,7 @@ StickerDatabase::UpdateValue(const char *type, const char *uri,
 		sqlite3_clear_bindings(s);
 	};
 
-	bool modified = ExecuteModified(s);
-
-	if (modified)
-		idle_add(IDLE_STICKER);
-	return modified;
+	return ExecuteModified(s);
 }
 
 void
@@ -253,7 +377,14 @@ StickerDatabase::InsertValue(const char *type, const char *uri,
 	};
 
 	ExecuteCommand(s);
-	idle_add(IDLE_STICKER);
+}
+
+void
+StickerDatabase::StoreValueNoIdle(const char *type, const char *uri,
+				  const char *name, const char *value)
+{
+	if (!UpdateValue(type, uri, name, value))
+		InsertValue(type, uri, name, value);
 }
 
 void
@@ -268,12 +399,27 @@ StickerDatabase::StoreValue(const char *type, const char *uri,
 	if (StringIsEmpty(name))
 		return;
 
-	if (!UpdateValue(type, uri, name, value))
-		InsertValue(type, uri, name, value);
+	if (writer) {
+		/* make sure the object is in the cache, which
+		   will hold the new value until it is committed */
+		LoadCached(type, uri);
+
+		const auto serial = writer->Push({
+			StickerWriter::Operation::Type::STORE,
+			type, uri, name, value,
+		});
+
+		cache.Modify(type, uri, serial)->table.insert_or_assign(name, value);
+	} else {
+		cache.Remove(type, uri);
+		StoreValueNoIdle(type, uri, name, value);
+	}
+
+	idle_add(IDLE_STICKER);
 }
 
 bool
-StickerDatabase::Delete(const char *type, const char *uri)
+StickerDatabase::DeleteNoIdle(const char *type, const char *uri)
 {
 	sqlite3_stmt *const s = stmt[STICKER_SQL_DELETE];
 
@@ -287,15 +433,40 @@ StickerDatabase::Delete(const char *type, const char *uri)
 		sqlite3_clear_bindings(s);
 	};
 
-	bool modified = ExecuteModified(s);
+	return ExecuteModified(s);
+}
+
+bool
+StickerDatabase::Delete(const char *type, const char *uri)
+{
+	assert(type != nullptr);
+	assert(uri != nullptr);
+
+	bool modified;
+
+	if (writer) {
+		modified = !LoadCached(type, uri).table.empty();
+		if (modified) {
+			const auto serial = writer->Push({
+				StickerWriter::Operation::Type::DELETE,
+				type, uri, {}, {},
+			});
+
+			cache.Modify(type, uri, serial)->table.clear();
+		}
+	} else {
+		cache.Remove(type, uri);
+		modified = DeleteNoIdle(type, uri);
+	}
+
 	if (modified)
 		idle_add(IDLE_STICKER);
 	return modified;
 }
 
 bool
-StickerDatabase::DeleteValue(const char *type, const char *uri,
-			     const char *name)
+StickerDatabase::DeleteValueNoIdle(const char *type, const char *uri,
+				   const char *name)
 {
 	sqlite3_stmt *const s = stmt[STICKER_SQL_DELETE_VALUE];
 
@@ -309,20 +480,143 @@ StickerDatabase::DeleteValue(const char *type, const char *uri,
 		sqlite3_clear_bindings(s);
 	};
 
-	bool modified = ExecuteModified(s);
+	return ExecuteModified(s);
+}
+
+bool
+StickerDatabase::DeleteValue(const char *type, const char *uri,
+			     const char *name)
+{
+	assert(type != nullptr);
+	assert(uri != nullptr);
+
+	bool modified;
+
+	if (writer) {
+		modified = LoadCached(type, uri).table.contains(name);
+		if (modified) {
+			const auto serial = writer->Push({
+				StickerWriter::Operation::Type::DELETE_VALUE,
+				type, uri, name, {},
+			});
+
+			auto &table = cache.Modify(type, uri, serial)->table;
+			table.erase(table.find(name));
+		}
+	} else {
+		cache.Remove(type, uri);
+		modified = DeleteValueNoIdle(type, uri, name);
+	}
+
 	if (modified)
 		idle_add(IDLE_STICKER);
 	return modified;
 }
 
+void
+StickerDatabase::BeginTransaction()
+{
+	sqlite3_stmt *const s = stmt[STICKER_SQL_TRANSACTION_BEGIN];
+
+	AtScopeExit(s) {
+		sqlite3_reset(s);
+	};
+
+	ExecuteCommand(s);
+}
+
+void
+StickerDatabase::CommitTransaction()
+{
+	sqlite3_stmt *const s = stmt[STICKER_SQL_TRANSACTION_COMMIT];
+
+	AtScopeExit(s) {
+		sqlite3_reset(s);
+	};
+
+	ExecuteCommand(s);
+}
+
+void
+StickerDatabase::RollbackTransaction() noexcept
+{
+	sqlite3_stmt *const s = stmt[STICKER_SQL_TRANSACTION_ROLLBACK];
+
+	/* this fails if SQLite has already rolled back the
+	   transaction automatically, but no harm is caused by
+	   this */
+	ExecuteBusy(s);
+	sqlite3_reset(s);
+}
+
 Sticker
 StickerDatabase::Load(const char *type, const char *uri)
 {
-	Sticker s;
+	return LoadCached(type, uri);
+}
 
-	ListValues(s.table, type, uri);
+/**
+ * Returns the SQL condition which implements the given operator (to
+ * be appended to the "WHERE" clause), or an empty string if the
+ * operator has no operand.
+ */
+[[gnu::const]]
+static const char *
+GetFindCondition(StickerOperator op) noexcept
+{
+	switch (op) {
+	case StickerOperator::EXISTS:
+		return "";
 
-	return s;
+	case StickerOperator::EQUALS:
+		return " AND value=?";
+
+	case StickerOperator::LESS_THAN:
+		return " AND value<?";
+
+	case StickerOperator::GREATER_THAN:
+		return " AND value>?";
+
+	case StickerOperator::EQUALS_INT:
+		return " AND CAST(value AS INT)=?";
+
+	case StickerOperator::LESS_THAN_INT:
+		return " AND CAST(value AS INT)<?";
+
+	case StickerOperator::GREATER_THAN_INT:
+		return " AND CAST(value AS INT)>?";
+
+	case StickerOperator::CONTAINS:
+		return " AND value LIKE ('%' || ? || '%')";
+
+	case StickerOperator::STARTS_WITH:
+		return " AND value LIKE (? || '%')";
+	}
+
+	assert(false);
+	gcc_unreachable();
+}
+
+/**
+ * Determine the smallest string which is larger than all strings
+ * beginning with the given prefix (in SQLite's "BINARY" collation,
+ * i.e. memcmp()).
+ *
+ * @return the upper bound or an empty string if there is none (all
+ * bytes of the prefix are 0xff)
+ */
+static std::string
+PrefixUpperBound(std::string_view prefix) noexcept
+{
+	std::string result{prefix};
+
+	while (!result.empty() && (unsigned char)result.back() == 0xff)
+		result.pop_back();
+
+	if (!result.empty())
+		++result.back();
+
+	return result;
 }
 
 sqlite3_stmt *
@@ -337,6 +631,18 @@ StickerDatabase::BindFind(const char *type, const char *base_uri,
 	if (base_uri == nullptr)
 		base_uri = "";
 
+	/* match the URI prefix with a range instead of LIKE, which
+	   cannot use an index (and treats '%' and '_' as
+	   wildcards) */
+	const std::string upper_bound = PrefixUpperBound(base_uri);
+	const char *const uri_condition = StringIsEmpty(base_uri)
+		? ""
+		: upper_bound.empty()
+		? " AND uri>=?"
+		: " AND uri>=? AND uri<?";
+
+	const char *const value_condition = GetFindCondition(op);
+
 	auto order_by = StringIsEmpty(sort)
 		? std::string()
 		: StringIsEqual(sort, "value_int")
@@ -349,76 +655,44 @@ StickerDatabase::BindFind(const char *type, const char *base_uri,
 			? fmt::format("LIMIT -1 OFFSET {}", window.start)
 			: fmt::format("LIMIT {} OFFSET {}", window.Count(), window.start);
 
-	std::string sql_str;
-	sqlite3_stmt *sql;
-
-	switch (op) {
-	case StickerOperator::EXISTS:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name);
-		return sql;
+	const auto sql_str =
+		fmt::format("SELECT uri,value FROM sticker WHERE type=? AND name=?{}{} {} {}",
+			    uri_condition, value_condition, order_by, offset);
 
-	case StickerOperator::EQUALS:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND_VALUE], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name, value);
-		return sql;
-
-	case StickerOperator::LESS_THAN:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND_LT], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name, value);
-		return sql;
-
-	case StickerOperator::GREATER_THAN:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND_GT], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name, value);
-		return sql;
-
-	case StickerOperator::EQUALS_INT:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND_EQ_INT], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name, value);
-		return sql;
-
-	case StickerOperator::LESS_THAN_INT:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND_LT_INT], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name, value);
-		return sql;
+	sqlite3_stmt *const sql = Prepare(db, sql_str.c_str());
 
-	case StickerOperator::GREATER_THAN_INT:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND_GT_INT], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name, value);
-		return sql;
+	try {
+		unsigned i = 1;
+		Bind(sql, i++, type);
+		Bind(sql, i++, name);
+
+		if (!StringIsEmpty(base_uri)) {
+			Bind(sql, i++, base_uri);
+			if (!upper_bound.empty()) {
+				/* this is a local variable, so SQLite
+				   needs to copy it */
+				int result = sqlite3_bind_text(sql, i++,
+							       upper_bound.data(),
+							       upper_bound.size(),
+							       SQLITE_TRANSIENT);
+				if (result != SQLITE_OK)
+					throw SqliteError(sql, result,
+							  "sqlite3_bind_text() failed");
+			}
+		}
 
-	case StickerOperator::CONTAINS:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND_CONTAINS], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name, value);
-		return sql;
+		if (!StringIsEmpty(value_condition)) {
+			assert(value != nullptr);
+			Bind(sql, i++, value);
+		}
 
-	case StickerOperator::STARTS_WITH:
-		sql_str = fmt::format("{} {} {}",
-			sticker_sql_find[STICKER_SQL_FIND_STARTS_WITH], order_by, offset);
-		sql = Prepare(db, sql_str.c_str());
-		BindAll(sql, type, base_uri, name, value);
-		return sql;
+		assert(int(i - 1) == sqlite3_bind_parameter_count(sql));
+	} catch (...) {
+		sqlite3_finalize(sql);
+		throw;
 	}
 
-	assert(false);
-	gcc_unreachable();
+	return sql;
 }
 
 void
@@ -431,6 +705,8 @@ StickerDatabase::Find(const char *type, const char *base_uri, const char *name,
 {
 	assert(func != nullptr);
 
+	WaitCommitted();
+
 	sqlite3_stmt *const s = BindFind(type, base_uri, name, op, value, sort, descending, window);
 	assert(s != nullptr);
 
@@ -448,6 +724,8 @@ StickerDatabase::Find(const char *type, const char *base_uri, const char *name,
 std::list<StickerDatabase::StickerTypeUriPair>
 StickerDatabase::GetUniqueStickers()
 {
+	WaitCommitted();
+
 	auto result = std::list<StickerTypeUriPair>{};
 	sqlite3_stmt *const s = stmt[STICKER_SQL_DISTINCT_TYPE_URI];
 	assert(s != nullptr);
@@ -466,6 +744,8 @@ StickerDatabase::Names(void (*func)(const char *value, void *user_data), void *u
 {
 	assert(func != nullptr);
 
+	WaitCommitted();
+
 	sqlite3_stmt *const s = stmt[STICKER_SQL_NAMES];
 	assert(s != nullptr);
 
@@ -487,6 +767,8 @@ StickerDatabase::BatchDeleteNoIdle(const std::list<StickerTypeUriPair> &stickers
 	sqlite3_stmt *const rollback = stmt[STICKER_SQL_TRANSACTION_ROLLBACK];
 	sqlite3_stmt *const commit = stmt[STICKER_SQL_TRANSACTION_COMMIT];
 
+	cache.Clear();
+
 	try {
 		ExecuteBusy(begin);
 
@@ -27,22 +27,26 @@
 #define MPD_STICKER_DATABASE_HXX
 
 #include "Match.hxx"
+#include "Cache.hxx"
 #include "lib/sqlite/Database.hxx"
 #include "protocol/RangeArg.hxx"
 
 #include <sqlite3.h>
 
 #include <map>
+#include <memory>
+#include <span>
 #include <string>
 #include <list>
 
 class Path;
 struct Sticker;
+class StickerWriter;
 
 class StickerDatabase {
 	enum SQL {
-		  SQL_GET,
 		  SQL_LIST,
+		  SQL_LIST_MANY,
 		  SQL_UPDATE,
 		  SQL_INSERT,
 		  SQL_DELETE,
@@ -56,27 +60,22 @@ class StickerDatabase {
 		  SQL_COUNT
 	};
 
-	enum SQL_FIND {
-		  SQL_FIND,
-		  SQL_FIND_VALUE,
-		  SQL_FIND_LT,
-		  SQL_FIND_GT,
-
-		  SQL_FIND_EQ_INT,
-		  SQL_FIND_LT_INT,
-		  SQL_FIND_GT_INT,
-
-		  SQL_FIND_CONTAINS,
-		  SQL_FIND_STARTS_WITH,
-
-		  SQL_FIND_COUNT
-	};
-
 	std::string path;
 
 	Sqlite::Database db;
 	sqlite3_stmt *stmt[SQL_COUNT];
 
+	StickerCache cache;
+
+	/**
+	 * Executes modifications in a separate thread.  This is
+	 * nullptr in connections created by Reopen() (which execute
+	 * modifications synchronously) and in in-memory databases.
+	 */
+	std::unique_ptr<StickerWriter> writer;
+
+	friend class StickerWriter;
+
 	explicit StickerDatabase(const char *_path);
 
 public:
@@ -88,8 +87,8 @@ public:
 	StickerDatabase(Path path);
 	~StickerDatabase() noexcept;
 
-	StickerDatabase(StickerDatabase &&) noexcept = default;
-	StickerDatabase &operator=(StickerDatabase &&) noexcept = default;
+	StickerDatabase(const StickerDatabase &) = delete;
+	StickerDatabase &operator=(const StickerDatabase &) = delete;
 
 	/**
 	 * Open another connection to the same database file.
@@ -108,10 +107,31 @@ public:
 	std::string LoadValue(const char *type, const char *uri,
 			      const char *name);
 
+	/**
+	 * Looks up one value of many objects.  The callback is invoked
+	 * (in the order of the given URIs) for each object which has
+	 * a value with this name.
+	 *
+	 * This is much faster than calling LoadValue() for each
+	 * object, because all objects which are not in the cache are
+	 * loaded with few SQL queries.
+	 *
+	 * Throws #SqliteError on error.
+	 */
+	void LoadValues(const char *type, std::span<const char *const> uris,
+			const char *name,
+			void (*func)(const char *uri, const char *value,
+				     void *user_data),
+			void *user_data);
+
 	/**
 	 * Sets a sticker value in the specified object.  Overwrites existing
 	 * values.
 	 *
+	 * Modifications are committed asynchronously by the
+	 * #StickerWriter; they are visible to all other methods
+	 * immediately.
+	 *
 	 * Throws #SqliteError on error.
 	 */
 	void StoreValue(const char *type, const char *uri,
@@ -174,6 +194,12 @@ public:
 	 */
 	std::list<StickerTypeUriPair> GetUniqueStickers();
 
+	/**
+	 * Discard the cache.  This must be called after another
+	 * connection (see Reopen()) has modified the database.
+	 */
+	void ClearCache() noexcept;
+
 	/**
 	 * Delete stickers by type and uri
 	 * @param stickers A list of stickers to delete
@@ -184,12 +210,60 @@ private:
 	void ListValues(std::map<std::string, std::string, std::less<>> &table,
 			const char *type, const char *uri);
 
+	/**
+	 * Load the stickers of up to #LIST_MANY_SIZE objects with one
+	 * query and add them to the cache.
+	 */
+	void ListValuesMany(const char *type,
+			    std::span<const char *const> uris);
+
+	/**
+	 * Returns the sticker of the specified object from the cache,
+	 * loading it if it is not in the cache yet.  The reference is
+	 * valid until the cache is modified.
+	 */
+	const Sticker &LoadCached(const char *type, const char *uri);
+
+	/**
+	 * Make sure that all modifications have been committed to
+	 * the database, because the following query cannot be
+	 * answered by the #cache.
+	 */
+	void WaitCommitted() noexcept;
+
+	/**
+	 * Let the #cache know which modifications have been committed
+	 * by the #writer.
+	 */
+	void UpdateCommitted() noexcept;
+
+	/**
+	 * Remove objects from the #cache whose modifications the
+	 * #writer has failed to commit, so they get loaded from the
+	 * database again.
+	 */
+	void DiscardFailed() noexcept;
+
 	bool UpdateValue(const char *type, const char *uri,
 			 const char *name, const char *value);
 
 	void InsertValue(const char *type, const char *uri,
 			 const char *name, const char *value);
 
+	/* the following methods execute modifications synchronously
+	   and don't emit idle events; they are used by
+	   #StickerWriter */
+
+	void StoreValueNoIdle(const char *type, const char *uri,
+			      const char *name, const char *value);
+	bool DeleteNoIdle(const char *type, const char *uri);
+	bool DeleteValueNoIdle(const char *type, const char *uri,
+			       const char *name);
+
+	void BeginTransaction();
+	void CommitTransaction();
+	void RollbackTransaction() noexcept;
+
 	sqlite3_stmt *BindFind(const char *type, const char *base_uri,
 			       const char *name,
 			       StickerOperator op, const char *value,
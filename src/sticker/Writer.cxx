@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Writer.hxx"
+#include "Idle.hxx"
+#include "IdleFlags.hxx"
+#include "thread/Name.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <utility>
+
+static constexpr Domain sticker_domain{"sticker"};
+
+StickerWriter::StickerWriter(const StickerDatabase &parent)
+	:db(parent.Reopen())
+{
+	thread.Start();
+}
+
+StickerWriter::~StickerWriter() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+	}
+
+	cond.notify_one();
+	thread.Join();
+}
+
+uint_least64_t
+StickerWriter::Push(Operation &&operation)
+{
+	uint_least64_t serial;
+
+	{
+		const std::scoped_lock lock{mutex};
+		queue.emplace_back(std::move(operation));
+		serial = ++queued_serial;
+	}
+
+	cond.notify_one();
+	return serial;
+}
+
+void
+StickerWriter::WaitCommitted() noexcept
+{
+	std::unique_lock lock{mutex};
+	committed_cond.wait(lock, [this]{
+		return GetCommitted() == queued_serial;
+	});
+}
+
+std::vector<std::pair<std::string, std::string>>
+StickerWriter::TakeFailed() noexcept
+{
+	const std::scoped_lock lock{mutex};
+	has_failed.store(false, std::memory_order_relaxed);
+	return std::exchange(failed, {});
+}
+
+inline void
+StickerWriter::Execute(const Operation &operation)
+{
+	const char *const type = operation.sticker_type.c_str();
+	const char *const uri = operation.uri.c_str();
+
+	switch (operation.type) {
+	case Operation::Type::STORE:
+		db.StoreValueNoIdle(type, uri, operation.name.c_str(),
+				    operation.value.c_str());
+		break;
+
+	case Operation::Type::DELETE:
+		db.DeleteNoIdle(type, uri);
+		break;
+
+	case Operation::Type::DELETE_VALUE:
+		db.DeleteValueNoIdle(type, uri, operation.name.c_str());
+		break;
+	}
+}
+
+inline void
+StickerWriter::ExecuteTransaction(const std::vector<Operation> &operations)
+{
+	db.BeginTransaction();
+
+	try {
+		for (const auto &i : operations)
+			Execute(i);
+
+		db.CommitTransaction();
+	} catch (...) {
+		db.RollbackTransaction();
+		throw;
+	}
+}
+
+void
+StickerWriter::Run() noexcept
+{
+	SetThreadName("sticker");
+
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		if (queue.empty()) {
+			if (quit)
+				break;
+
+			cond.wait(lock);
+			continue;
+		}
+
+		const auto operations = std::exchange(queue, {});
+		const auto serial = queued_serial;
+		lock.unlock();
+
+		bool success = true;
+
+		try {
+			ExecuteTransaction(operations);
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to write stickers");
+			success = false;
+		}
+
+		lock.lock();
+
+		if (!success) {
+			/* the modifications are lost; the
+			   StickerDatabase must drop them from its
+			   cache, so readers see what is really in
+			   the database */
+			for (const auto &i : operations)
+				failed.emplace_back(i.sticker_type, i.uri);
+			has_failed.store(true, std::memory_order_relaxed);
+		}
+
+		committed_serial.store(serial, std::memory_order_release);
+		committed_cond.notify_all();
+
+		if (!success)
+			/* let clients know that the stickers they
+			   have modified have changed back */
+			idle_add(IDLE_STICKER);
+	}
+}
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "Database.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Executes sticker modifications in a separate thread (with its own
+ * database connection), so the main thread does not have to wait
+ * for SQLite to commit them to disk.  All modifications which queue
+ * up while a transaction is being committed are combined in the next
+ * transaction.
+ *
+ * Each modification gets a serial number; the #StickerCache keeps
+ * the modified objects until GetCommitted() has reached it.
+ */
+class StickerWriter {
+public:
+	struct Operation {
+		enum class Type : uint8_t {
+			STORE,
+			DELETE,
+			DELETE_VALUE,
+		} type;
+
+		std::string sticker_type, uri, name, value;
+	};
+
+private:
+	StickerDatabase db;
+
+	Thread thread{BIND_THIS_METHOD(Run)};
+
+	Mutex mutex;
+
+	/**
+	 * Wakes up the thread.
+	 */
+	Cond cond;
+
+	/**
+	 * Signalled by the thread after a transaction.
+	 */
+	Cond committed_cond;
+
+	/**
+	 * Modifications which have not yet been submitted to SQLite.
+	 * Protected by #mutex.
+	 */
+	std::vector<Operation> queue;
+
+	/**
+	 * The serial of the most recent Push() call.  Protected by
+	 * #mutex.
+	 */
+	uint_least64_t queued_serial = 0;
+
+	/**
+	 * All modifications up to this serial have been executed
+	 * (committed or, on error, discarded).
+	 */
+	std::atomic<uint_least64_t> committed_serial{0};
+
+	/**
+	 * The objects ("type" and "uri") whose modifications were
+	 * lost because a transaction failed.  Protected by #mutex.
+	 */
+	std::vector<std::pair<std::string, std::string>> failed;
+
+	/**
+	 * Is #failed non-empty?  This allows checking it without
+	 * locking the #mutex.
+	 */
+	std::atomic_bool has_failed{false};
+
+	/**
+	 * Shall the thread exit after executing all queued
+	 * modifications?  Protected by #mutex.
+	 */
+	bool quit = false;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param parent the database whose modifications will be
+	 * executed by this object (on a new connection)
+	 */
+	explicit StickerWriter(const StickerDatabase &parent);
+
+	/**
+	 * Executes all pending modifications and stops the thread.
+	 */
+	~StickerWriter() noexcept;
+
+	StickerWriter(const StickerWriter &) = delete;
+	StickerWriter &operator=(const StickerWriter &) = delete;
+
+	/**
+	 * Submit a modification.
+	 *
+	 * @return the serial of this modification
+	 */
+	uint_least64_t Push(Operation &&operation);
+
+	uint_least64_t GetCommitted() const noexcept {
+		return committed_serial.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Wait until all modifications have been committed.  Call
+	 * this before queries which cannot be answered from the
+	 * #StickerCache.
+	 */
+	void WaitCommitted() noexcept;
+
+	bool HasFailed() const noexcept {
+		return has_failed.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Returns (and clears) the list of objects whose
+	 * modifications were lost because a transaction failed.
+	 * Their cached #Sticker must be discarded.
+	 */
+	std::vector<std::pair<std::string, std::string>> TakeFailed() noexcept;
+
+private:
+	void Execute(const Operation &operation);
+	void ExecuteTransaction(const std::vector<Operation> &operations);
+
+	void Run() noexcept;
+};
@@ -33,6 +33,8 @@ public:
 		return ~None();
 	}
 
+	constexpr bool operator==(const TagMask &) const noexcept = default;
+
 	constexpr TagMask operator~() const noexcept {
 		return TagMask(~value);
 	}
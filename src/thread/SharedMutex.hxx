@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_THREAD_SHARED_MUTEX_HXX
+#define MPD_THREAD_SHARED_MUTEX_HXX
+
+#ifdef _WIN32
+
+#include <synchapi.h>
+
+/**
+ * Wrapper for a SRWLOCK, a reader/writer lock which is compatible
+ * with std::shared_mutex.
+ */
+class SharedMutex {
+	SRWLOCK srwlock = SRWLOCK_INIT;
+
+public:
+	SharedMutex() noexcept = default;
+
+	SharedMutex(const SharedMutex &other) = delete;
+	SharedMutex &operator=(const SharedMutex &other) = delete;
+
+	void lock() noexcept {
+		::AcquireSRWLockExclusive(&srwlock);
+	}
+
+	bool try_lock() noexcept {
+		return ::TryAcquireSRWLockExclusive(&srwlock) != 0;
+	}
+
+	void unlock() noexcept {
+		::ReleaseSRWLockExclusive(&srwlock);
+	}
+
+	void lock_shared() noexcept {
+		::AcquireSRWLockShared(&srwlock);
+	}
+
+	bool try_lock_shared() noexcept {
+		return ::TryAcquireSRWLockShared(&srwlock) != 0;
+	}
+
+	void unlock_shared() noexcept {
+		::ReleaseSRWLockShared(&srwlock);
+	}
+};
+
+#else
+
+#include "Mutex.hxx"
+#include "Cond.hxx"
+
+/**
+ * A reader/writer lock which is compatible with std::shared_mutex.
+ * Unlike the glibc implementation of std::shared_mutex, it prefers
+ * writers: new readers are blocked while a writer is waiting, so
+ * a steady stream of overlapping readers cannot starve writers.
+ */
+class SharedMutex {
+	Mutex mutex;
+	Cond readers_cond, writers_cond;
+
+	/**
+	 * The number of threads holding the shared lock.
+	 */
+	unsigned n_readers = 0;
+
+	/**
+	 * The number of threads waiting for the exclusive lock.
+	 */
+	unsigned n_waiting_writers = 0;
+
+	/**
+	 * Does a thread hold the exclusive lock?
+	 */
+	bool writing = false;
+
+public:
+	SharedMutex() noexcept = default;
+
+	SharedMutex(const SharedMutex &other) = delete;
+	SharedMutex &operator=(const SharedMutex &other) = delete;
+
+	void lock() noexcept {
+		std::unique_lock lock{mutex};
+		++n_waiting_writers;
+		writers_cond.wait(lock, [this]{
+			return !writing && n_readers == 0;
+		});
+		--n_waiting_writers;
+		writing = true;
+	}
+
+	bool try_lock() noexcept {
+		const std::scoped_lock lock{mutex};
+		if (writing || n_readers > 0)
+			return false;
+
+		writing = true;
+		return true;
+	}
+
+	void unlock() noexcept {
+		const std::scoped_lock lock{mutex};
+		writing = false;
+
+		if (n_waiting_writers > 0)
+			writers_cond.notify_one();
+		else
+			readers_cond.notify_all();
+	}
+
+	void lock_shared() noexcept {
+		std::unique_lock lock{mutex};
+		readers_cond.wait(lock, [this]{
+			return !writing && n_waiting_writers == 0;
+		});
+		++n_readers;
+	}
+
+	bool try_lock_shared() noexcept {
+		const std::scoped_lock lock{mutex};
+		if (writing || n_waiting_writers > 0)
+			return false;
+
+		++n_readers;
+		return true;
+	}
+
+	void unlock_shared() noexcept {
+		const std::scoped_lock lock{mutex};
+		if (--n_readers == 0 && n_waiting_writers > 0)
+			writers_cond.notify_one();
+	}
+};
+
+#endif
+
+#endif
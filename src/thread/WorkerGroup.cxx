@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "WorkerGroup.hxx"
+#include "Name.hxx"
+
+#include <cassert>
+
+WorkerGroup::WorkerGroup(unsigned n_threads, const char *_name)
+	:name(_name)
+{
+	assert(n_threads > 0);
+
+	for (unsigned i = 0; i < n_threads; ++i) {
+		auto &thread = threads.emplace_back(BIND_THIS_METHOD(ThreadFunc));
+
+		try {
+			thread.Start();
+		} catch (...) {
+			threads.pop_back();
+
+			if (threads.empty())
+				throw;
+
+			break;
+		}
+	}
+}
+
+WorkerGroup::~WorkerGroup() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		wake_cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		thread.Join();
+}
+
+inline void
+WorkerGroup::Work() noexcept
+{
+	while (next < n) {
+		const unsigned i = next++;
+
+		{
+			const ScopeUnlock unlock{mutex};
+			function(ctx, i);
+		}
+
+		if (--pending == 0)
+			done_cond.notify_one();
+	}
+}
+
+void
+WorkerGroup::Run(unsigned _n, Function _function, void *_ctx) noexcept
+{
+	std::unique_lock lock{mutex};
+	assert(pending == 0);
+
+	function = _function;
+	ctx = _ctx;
+	next = 0;
+	n = pending = _n;
+	wake_cond.notify_all();
+
+	Work();
+
+	/* wait for the items still being processed by other
+	   threads */
+	done_cond.wait(lock, [this]{ return pending == 0; });
+}
+
+inline void
+WorkerGroup::ThreadFunc() noexcept
+{
+	SetThreadName(name);
+
+	std::unique_lock lock{mutex};
+
+	while (!quit) {
+		Work();
+		wake_cond.wait(lock);
+	}
+}
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_THREAD_WORKER_GROUP_HXX
+#define MPD_THREAD_WORKER_GROUP_HXX
+
+#include "Mutex.hxx"
+#include "Cond.hxx"
+#include "Thread.hxx"
+
+#include <list>
+#include <type_traits>
+
+/**
+ * A small set of threads which help one thread process a number of
+ * independent work items in parallel, e.g. the channels of a PCM
+ * buffer.  Only the thread which owns this object may call
+ * ForEach(); it participates in the work.
+ */
+class WorkerGroup final {
+	using Function = void (*)(void *ctx, unsigned i) noexcept;
+
+	Mutex mutex;
+
+	/**
+	 * Signalled when a new job has been submitted or when the
+	 * threads shall quit.
+	 */
+	Cond wake_cond;
+
+	/**
+	 * Signalled when the last item of the current job has been
+	 * completed.
+	 */
+	Cond done_cond;
+
+	std::list<Thread> threads;
+
+	/**
+	 * The name of all threads (for debugging).
+	 */
+	const char *const name;
+
+	Function function;
+	void *ctx;
+
+	/**
+	 * The index of the next item to be processed.
+	 */
+	unsigned next = 0;
+
+	/**
+	 * The number of items of the current job.
+	 */
+	unsigned n = 0;
+
+	/**
+	 * The number of items which have not yet been completed.
+	 */
+	unsigned pending = 0;
+
+	bool quit = false;
+
+public:
+	/**
+	 * Throws if not even one thread could be launched; if only
+	 * some of them fail, the group continues with fewer threads.
+	 *
+	 * @param _name the thread name; the pointer must remain
+	 * valid for the lifetime of this object
+	 */
+	WorkerGroup(unsigned n_threads, const char *_name);
+
+	~WorkerGroup() noexcept;
+
+	WorkerGroup(const WorkerGroup &) = delete;
+	WorkerGroup &operator=(const WorkerGroup &) = delete;
+
+	/**
+	 * Invoke f(i) for each i in [0, n) and return after all calls
+	 * have completed.
+	 */
+	template<typename F>
+	void ForEach(unsigned _n, F &&f) noexcept {
+		using T = std::remove_reference_t<F>;
+		Run(_n, [](void *_ctx, unsigned i) noexcept {
+			(*static_cast<T *>(_ctx))(i);
+		}, &f);
+	}
+
+private:
+	void Run(unsigned _n, Function _function, void *_ctx) noexcept;
+
+	/**
+	 * Process items of the current job until there are none
+	 * left.  Caller must lock the mutex.
+	 */
+	void Work() noexcept;
+
+	void ThreadFunc() noexcept;
+};
+
+#endif
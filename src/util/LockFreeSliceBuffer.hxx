@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_LOCK_FREE_SLICE_BUFFER_HXX
+#define MPD_LOCK_FREE_SLICE_BUFFER_HXX
+
+#include "HugeAllocator.hxx"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+/**
+ * A variant of #SliceBuffer which may be used by multiple threads
+ * without a mutex.  It manages uninitialized memory slices whose
+ * size is chosen at runtime, and which may be changed while no slice
+ * is allocated.
+ *
+ * Free slices are managed in a lock-free stack whose top is tagged
+ * with a modification counter to avoid the ABA problem.
+ */
+class LockFreeSliceBuffer {
+	static constexpr uint32_t NONE = UINT32_MAX;
+
+	/**
+	 * This bit is set in #n_allocated while Reset() runs.
+	 */
+	static constexpr uint32_t LOCKED = uint32_t(1) << 31;
+
+	HugeArray<std::byte> buffer;
+
+	/**
+	 * For each free slice, the index of the next free slice in
+	 * the #available stack.  This array is large enough for the
+	 * smallest slice size.
+	 */
+	const std::unique_ptr<std::atomic<uint32_t>[]> links;
+
+	/**
+	 * The size of each slice.  It is only modified by Reset().
+	 */
+	std::atomic_size_t slice_size;
+
+	/**
+	 * The number of slices which fit into #buffer.
+	 */
+	std::atomic<uint32_t> n_slices;
+
+	/**
+	 * The number of slices that are initialized.  This is used to
+	 * avoid page faulting on the new allocation, so the kernel
+	 * does not need to reserve physical memory pages.
+	 */
+	std::atomic<uint32_t> n_initialized{0};
+
+	/**
+	 * The number of slices currently allocated (including those
+	 * which are being allocated right now), plus the #LOCKED
+	 * flag.
+	 */
+	std::atomic<uint32_t> n_allocated{0};
+
+	/**
+	 * The top of the stack of free slices.  The lower 32 bits are
+	 * the slice index (#NONE if the stack is empty); the upper 32
+	 * bits are incremented by each modification.
+	 */
+	std::atomic<uint64_t> available{NONE};
+
+public:
+	/**
+	 * @param size the total size of the buffer in bytes
+	 * @param _slice_size the initial size of each slice
+	 * @param min_slice_size the smallest slice size which will
+	 * ever be passed to SetSliceSize()
+	 */
+	LockFreeSliceBuffer(std::size_t size, std::size_t _slice_size,
+			    std::size_t min_slice_size)
+		:buffer(size),
+		 links(std::make_unique<std::atomic<uint32_t>[]>(size / min_slice_size)),
+		 slice_size(_slice_size),
+		 n_slices(size / _slice_size) {
+		assert(min_slice_size > 0);
+		assert(_slice_size >= min_slice_size);
+		assert(size / min_slice_size < LOCKED);
+
+		buffer.ForkCow(false);
+	}
+
+	~LockFreeSliceBuffer() noexcept {
+		/* all slices must be freed explicitly, and this
+		   assertion checks for leaks */
+		assert(n_allocated.load(std::memory_order_relaxed) == 0);
+	}
+
+	LockFreeSliceBuffer(const LockFreeSliceBuffer &other) = delete;
+	LockFreeSliceBuffer &operator=(const LockFreeSliceBuffer &other) = delete;
+
+	/**
+	 * Returns the total size of the buffer in bytes.
+	 */
+	std::size_t GetTotalSize() const noexcept {
+		return buffer.size();
+	}
+
+	/**
+	 * Returns the number of slices.
+	 */
+	unsigned GetCapacity() const noexcept {
+		return n_slices.load(std::memory_order_relaxed);
+	}
+
+	std::size_t GetSliceSize() const noexcept {
+		return slice_size.load(std::memory_order_relaxed);
+	}
+
+	bool empty() const noexcept {
+		return (n_allocated.load(std::memory_order_relaxed) & ~LOCKED) == 0;
+	}
+
+	bool IsFull() const noexcept {
+		return n_allocated.load(std::memory_order_relaxed) == GetCapacity();
+	}
+
+	void SetName(const char *name) noexcept {
+		buffer.SetName(name);
+	}
+
+	/**
+	 * Change the size of all slices.  This is only possible
+	 * while no slice is allocated.  The new size must not be
+	 * smaller than the "min_slice_size" constructor parameter.
+	 *
+	 * @return true on success, false if a slice is allocated
+	 */
+	bool SetSliceSize(std::size_t new_slice_size) noexcept {
+		return GetSliceSize() == new_slice_size ||
+			Reset(new_slice_size);
+	}
+
+	/**
+	 * Allocate a slice.
+	 *
+	 * @return a pointer to the uninitialized slice or nullptr if
+	 * the buffer is full
+	 */
+	void *Allocate() noexcept {
+		if (!Reserve())
+			/* out of (internal) memory, buffer is full */
+			return nullptr;
+
+		return &buffer[Pop() * GetSliceSize()];
+	}
+
+	/**
+	 * Give a slice back.  The caller must have destructed all
+	 * objects stored in it.
+	 */
+	void Free(void *p) noexcept {
+		assert(!empty());
+
+		const auto *slice = static_cast<const std::byte *>(p);
+		assert(slice >= &buffer.front() && slice <= &buffer.back());
+
+		const std::size_t offset = slice - &buffer.front();
+		assert(offset % GetSliceSize() == 0);
+
+		Push(offset / GetSliceSize());
+
+		/* give memory back to the kernel when the last slice
+		   was freed */
+		if (n_allocated.fetch_sub(1, std::memory_order_release) == 1)
+			Reset(GetSliceSize());
+	}
+
+private:
+	static constexpr uint64_t MakeTop(uint64_t old_top,
+					  uint32_t index) noexcept {
+		return (((old_top >> 32) + 1) << 32) | index;
+	}
+
+	/**
+	 * Reserve one slice by incrementing #n_allocated.
+	 *
+	 * @return false if the buffer is full
+	 */
+	bool Reserve() noexcept {
+		uint32_t n = n_allocated.load(std::memory_order_relaxed);
+		while (true) {
+			if (n & LOCKED) {
+				/* another thread is inside Reset();
+				   this takes only a moment */
+				std::this_thread::yield();
+				n = n_allocated.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (n == GetCapacity())
+				return false;
+
+			if (n_allocated.compare_exchange_weak(n, n + 1,
+							      std::memory_order_acquire,
+							      std::memory_order_relaxed))
+				return true;
+		}
+	}
+
+	/**
+	 * Obtain the index of a free slice.  The caller must have
+	 * called Reserve() successfully, which guarantees that there
+	 * is one.
+	 */
+	uint32_t Pop() noexcept {
+		while (true) {
+			uint64_t top = available.load(std::memory_order_acquire);
+			const uint32_t i = uint32_t(top);
+			if (i != NONE) {
+				const uint32_t next = links[i].load(std::memory_order_relaxed);
+				if (available.compare_exchange_weak(top, MakeTop(top, next),
+								    std::memory_order_acquire,
+								    std::memory_order_relaxed))
+					return i;
+
+				continue;
+			}
+
+			/* the stack is empty: use a slice which was
+			   never used before */
+			uint32_t n = n_initialized.load(std::memory_order_relaxed);
+			if (n < GetCapacity() &&
+			    n_initialized.compare_exchange_weak(n, n + 1,
+								std::memory_order_relaxed))
+				return n;
+
+			/* all slices are initialized, and another
+			   thread is about to push one; try again */
+		}
+	}
+
+	void Push(uint32_t i) noexcept {
+		uint64_t top = available.load(std::memory_order_relaxed);
+		do {
+			links[i].store(uint32_t(top), std::memory_order_relaxed);
+		} while (!available.compare_exchange_weak(top, MakeTop(top, i),
+							  std::memory_order_release,
+							  std::memory_order_relaxed));
+	}
+
+	/**
+	 * Discard all slices and give the memory back to the kernel,
+	 * unless another thread has allocated a slice meanwhile.
+	 *
+	 * @return true on success
+	 */
+	bool Reset(std::size_t new_slice_size) noexcept {
+		uint32_t expected = 0;
+		if (!n_allocated.compare_exchange_strong(expected, LOCKED,
+							 std::memory_order_acquire,
+							 std::memory_order_relaxed))
+			return false;
+
+		slice_size.store(new_slice_size, std::memory_order_relaxed);
+		n_slices.store(buffer.size() / new_slice_size,
+			       std::memory_order_relaxed);
+		n_initialized.store(0, std::memory_order_relaxed);
+		available.store(MakeTop(available.load(std::memory_order_relaxed),
+					NONE),
+				std::memory_order_relaxed);
+		buffer.Discard();
+
+		n_allocated.store(0, std::memory_order_release);
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_PERFECT_HASH_HXX
+#define MPD_PERFECT_HASH_HXX
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+/**
+ * A perfect hash function for a fixed set of strings, which can be
+ * generated at compile time ("hash and displace"): each key is
+ * assigned to a bucket, and each bucket gets a displacement value
+ * which moves all of its keys to distinct slots.
+ *
+ * A lookup costs one pass over the key and two table reads.  Since
+ * unknown keys map to arbitrary slots, the caller must compare the
+ * key with the one at the returned index.
+ *
+ * @param N the maximum number of keys
+ */
+template<std::size_t N>
+class PerfectHash {
+	static_assert(N > 0 && N < 0xffff);
+
+	static constexpr std::size_t N_BUCKETS = N / 2 + 1;
+	static constexpr std::size_t N_SLOTS = std::bit_ceil(N * 2);
+
+	static constexpr uint_least16_t EMPTY = 0xffff;
+
+	/**
+	 * The displacement of each bucket.
+	 */
+	std::array<uint_least16_t, N_BUCKETS> displacements{};
+
+	/**
+	 * The key index in each slot, or #EMPTY.
+	 */
+	std::array<uint_least16_t, N_SLOTS> slots{};
+
+public:
+	static constexpr std::size_t NOT_FOUND = ~std::size_t{};
+
+	/**
+	 * Build the hash function.  Throws std::invalid_argument if
+	 * there are too many keys or if there are duplicates (which
+	 * is a compile-time error in a constant expression).
+	 */
+	explicit constexpr PerfectHash(std::span<const std::string_view> keys) {
+		if (keys.size() > N)
+			throw std::invalid_argument{"Too many keys"};
+
+		slots.fill(EMPTY);
+
+		std::array<uint_least64_t, N> hashes{};
+		std::array<std::size_t, N_BUCKETS> bucket_sizes{};
+		std::size_t max_bucket_size = 0;
+		for (std::size_t i = 0; i < keys.size(); ++i) {
+			hashes[i] = Hash(keys[i]);
+
+			const std::size_t size =
+				++bucket_sizes[GetBucket(hashes[i])];
+			if (size > max_bucket_size)
+				max_bucket_size = size;
+		}
+
+		/* place the large buckets first, while there are
+		   still many free slots */
+		for (std::size_t size = max_bucket_size; size > 0; --size)
+			for (std::size_t bucket = 0; bucket < N_BUCKETS; ++bucket)
+				if (bucket_sizes[bucket] == size)
+					PlaceBucket(bucket, {hashes.data(), keys.size()});
+	}
+
+	/**
+	 * Find the index of the given key.
+	 *
+	 * @return the index of the only key which may be equal to the
+	 * given one, or #NOT_FOUND
+	 */
+	[[gnu::pure]]
+	constexpr std::size_t Find(std::string_view key) const noexcept {
+		const auto hash = Hash(key);
+		const auto index =
+			slots[GetSlot(hash, displacements[GetBucket(hash)])];
+		return index != EMPTY ? index : NOT_FOUND;
+	}
+
+private:
+	/**
+	 * 64 bit FNV-1a.
+	 */
+	static constexpr uint_least64_t Hash(std::string_view key) noexcept {
+		uint_least64_t hash = 0xcbf29ce484222325ULL;
+		for (const char ch : key) {
+			hash ^= static_cast<unsigned char>(ch);
+			hash *= 0x100000001b3ULL;
+		}
+
+		return hash;
+	}
+
+	static constexpr std::size_t GetBucket(uint_least64_t hash) noexcept {
+		return (hash >> 32) % N_BUCKETS;
+	}
+
+	static constexpr std::size_t GetSlot(uint_least64_t hash,
+					     uint_least16_t displacement) noexcept {
+		hash += displacement * 0x9e3779b97f4a7c15ULL;
+		hash ^= hash >> 29;
+		hash *= 0xbf58476d1ce4e5b9ULL;
+		hash ^= hash >> 32;
+		return hash & (N_SLOTS - 1);
+	}
+
+	/**
+	 * Find a displacement which moves all keys of the given
+	 * bucket to free slots, and occupy these slots.
+	 */
+	constexpr void PlaceBucket(std::size_t bucket,
+				   std::span<const uint_least64_t> hashes) {
+		for (uint_least16_t displacement = 0; displacement < EMPTY;
+		     ++displacement) {
+			if (!TryPlaceBucket(bucket, displacement, hashes))
+				continue;
+
+			displacements[bucket] = displacement;
+			return;
+		}
+
+		throw std::invalid_argument{"Duplicate key"};
+	}
+
+	constexpr bool TryPlaceBucket(std::size_t bucket,
+				      uint_least16_t displacement,
+				      std::span<const uint_least64_t> hashes) noexcept {
+		for (std::size_t i = 0; i < hashes.size(); ++i) {
+			if (GetBucket(hashes[i]) != bucket)
+				continue;
+
+			auto &slot = slots[GetSlot(hashes[i], displacement)];
+			if (slot != EMPTY) {
+				/* collision: roll back the slots
+				   occupied so far */
+				for (std::size_t j = 0; j < i; ++j)
+					if (GetBucket(hashes[j]) == bucket)
+						slots[GetSlot(hashes[j], displacement)] = EMPTY;
+				return false;
+			}
+
+			slot = i;
+		}
+
+		return true;
+	}
+};
+
+#endif
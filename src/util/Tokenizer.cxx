@@ -5,8 +5,11 @@
 #include "CharUtil.hxx"
 #include "StringStrip.hxx"
 
+#include <cstddef>
 #include <stdexcept>
 
+#include <string.h>
+
 static inline bool
 valid_word_first_char(char ch)
 {
@@ -95,11 +98,20 @@ Tokenizer::NextUnquoted()
 	return word;
 }
 
+/**
+ * Returns the number of characters before the next double quote,
+ * backslash or end of string.  This uses strcspn(), which is
+ * vectorized in most C libraries.
+ */
+static inline std::size_t
+SpanUnescaped(const char *p) noexcept
+{
+	return strcspn(p, "\"\\");
+}
+
 char *
 Tokenizer::NextString()
 {
-	char *const word = input, *dest = input;
-
 	if (*input == 0)
 		/* end of line */
 		return nullptr;
@@ -109,34 +121,41 @@ Tokenizer::NextString()
 	if (*input != '"')
 		throw std::runtime_error("'\"' expected");
 
-	++input;
+	/* the string begins right after the opening quote; as long
+	   as there are no backslashes, nothing needs to be copied */
+
+	char *const word = input + 1;
+	char *p = word + SpanUnescaped(word), *dest = p;
 
-	/* copy all characters */
+	while (*p != '"') {
+		if (*p == 0)
+			throw std::runtime_error("Missing closing '\"'");
 
-	while (*input != '"') {
-		if (*input == '\\')
-			/* the backslash escapes the following
-			   character */
-			++input;
+		/* the backslash escapes the following character */
+		++p;
 
-		if (*input == 0)
+		if (*p == 0)
 			throw std::runtime_error("Missing closing '\"'");
 
-		/* copy one character */
-		*dest++ = *input++;
+		/* copy the escaped character and everything up to
+		   the next special character */
+		const std::size_t length = 1 + SpanUnescaped(p + 1);
+		memmove(dest, p, length);
+		dest += length;
+		p += length;
 	}
 
 	/* the following character must be a whitespace (or end of
 	   line) */
 
-	++input;
-	if (!IsWhitespaceFast(*input))
+	++p;
+	if (!IsWhitespaceFast(*p))
 		throw std::runtime_error("Space expected after closing '\"'");
 
 	/* finish the string and return it */
 
 	*dest = 0;
-	input = StripLeft(input);
+	input = StripLeft(p);
 	return word;
 }
 
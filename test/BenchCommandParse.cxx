@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Measure the cost of parsing client commands: splitting the input
+ * into lines, tokenizing each line (the way command_process() does)
+ * and looking up the command name, with a binary search (the old
+ * implementation) and with a #PerfectHash.
+ *
+ * The input is a recorded command stream (one command per line, as
+ * sent by a client); without a file name, a synthetic stream of
+ * command lists full of "addid" plus some "status" polling is used.
+ */
+
+#include "util/PerfectHash.hxx"
+#include "util/StaticVector.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/StringStrip.hxx"
+#include "util/Tokenizer.hxx"
+#include "util/PrintException.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The command names of the MPD protocol; the key set for the
+ * lookup benchmark.
+ */
+static constexpr std::string_view command_names =
+	"add addid addtagid albumart binarylimit channels clear clearerror "
+	"cleartagid close commands compress config consume count crossfade "
+	"currentsong decoders delete deleteid delpartition disableoutput "
+	"enableoutput find findadd getfingerprint getvol idle kill list "
+	"listall listallinfo listfiles listmounts listneighbors "
+	"listpartitions listplaylist listplaylistinfo listplaylists load "
+	"lsinfo mixrampdb mixrampdelay mount move moveid moveoutput "
+	"newpartition next notcommands outputs outputset partition password "
+	"pause ping play playid playlist playlistadd playlistclear "
+	"playlistdelete playlistfind playlistid playlistinfo playlistlength "
+	"playlistmove playlistsearch plchanges plchangesposid previous prio "
+	"prioid random rangeid readcomments readmessages "
+	"readpicture rename repeat replay_gain_mode replay_gain_status "
+	"rescan responseformat rm save search searchadd searchaddpl searchcount "
+	"searchplaylist seek seekcur seekid sendmessage setvol shuffle "
+	"single stats status sticker stickernames stop subscribe swap "
+	"swapid tagtypes toggleoutput unmount unsubscribe update urlhandlers "
+	"volume";
+
+static constexpr std::size_t MAX_COMMANDS = 256;
+
+/*
+ * The most we ever use is for search/find; see AllCommands.cxx
+ */
+static constexpr std::size_t COMMAND_ARGV_MAX = 128;
+
+using Clock = std::chrono::steady_clock;
+
+static void
+Report(const char *operation, std::size_t n,
+       Clock::time_point start) noexcept
+{
+	const std::chrono::duration<double, std::nano> duration =
+		Clock::now() - start;
+
+	printf("operation=%s count=%zu ns_per_line=%.1f\n",
+	       operation, n, duration.count() / n);
+}
+
+static std::string
+LoadFile(const char *path)
+{
+	std::ifstream file{path, std::ios::binary};
+	if (!file)
+		throw std::runtime_error("Failed to open file");
+
+	std::ostringstream s;
+	s << file.rdbuf();
+	return std::move(s).str();
+}
+
+static std::string
+MakeSyntheticStream()
+{
+	std::string s;
+
+	for (unsigned list = 0; list < 100; ++list) {
+		s += "command_list_ok_begin\n";
+		for (unsigned i = 0; i < 100; ++i) {
+			char line[256];
+			snprintf(line, sizeof(line),
+				 "addid \"Artist %u/Album %u (Deluxe Edition)/%02u - Track \\\"%u\\\".flac\"\n",
+				 list, list, i, i);
+			s += line;
+		}
+		s += "command_list_end\n";
+
+		s += "status\ncurrentsong\nplchanges 123\n"
+			"find \"((Artist == 'Foo') AND (Album != 'Bar'))\" sort Track window 0:50\n"
+			"idle\nnoidle\n";
+	}
+
+	return s;
+}
+
+/**
+ * Tokenize all lines of the stream, like Client::OnSocketInput()
+ * and command_process() do.
+ *
+ * @return the number of lines
+ */
+static std::size_t
+Tokenize(char *p, char *const end, std::vector<std::string_view> *names)
+{
+	std::size_t n_lines = 0;
+
+	while (true) {
+		char *newline = (char *)memchr(p, '\n', end - p);
+		if (newline == nullptr)
+			break;
+
+		char *line = p;
+		p = newline + 1;
+		*StripRight(line, newline) = 0;
+		++n_lines;
+
+		Tokenizer tokenizer{line};
+		const char *name = tokenizer.NextWord();
+		if (name == nullptr)
+			continue;
+
+		if (names != nullptr)
+			names->emplace_back(name);
+
+		StaticVector<const char *, COMMAND_ARGV_MAX> argv;
+		while (const char *a = tokenizer.NextParam()) {
+			if (argv.full())
+				throw std::runtime_error("Too many arguments");
+
+			argv.push_back(a);
+		}
+	}
+
+	return n_lines;
+}
+
+static void
+Bench(const std::string &stream, unsigned n)
+{
+	std::string buffer;
+
+	auto start = Clock::now();
+	std::size_t n_lines = 0;
+	for (unsigned i = 0; i < n; ++i) {
+		/* the tokenizer modifies the buffer, so start with a
+		   fresh copy (like the socket buffer) each time */
+		buffer = stream;
+		n_lines += Tokenize(buffer.data(),
+				    buffer.data() + buffer.size(), nullptr);
+	}
+	Report("tokenize", n_lines, start);
+
+	/* collect the command names of the stream */
+	buffer = stream;
+	std::vector<std::string_view> names;
+	Tokenize(buffer.data(), buffer.data() + buffer.size(), &names);
+
+	/* the key set: all protocol commands (sorted, which is what
+	   the binary search needs) */
+	std::vector<std::string> keys;
+	for (const auto i : IterableSplitString(command_names, ' '))
+		keys.emplace_back(i);
+	std::sort(keys.begin(), keys.end());
+	if (keys.size() > MAX_COMMANDS)
+		throw std::runtime_error("Too many commands");
+
+	const std::vector<std::string_view> key_views(keys.begin(), keys.end());
+
+	std::vector<std::string> names_z(names.begin(), names.end());
+
+	start = Clock::now();
+	std::size_t found = 0;
+	for (unsigned i = 0; i < n; ++i) {
+		for (const auto &name : names_z) {
+			std::size_t a = 0, b = keys.size();
+			do {
+				const std::size_t j = (a + b) / 2;
+				const int cmp = strcmp(name.c_str(),
+						       keys[j].c_str());
+				if (cmp == 0) {
+					++found;
+					break;
+				} else if (cmp < 0)
+					b = j;
+				else
+					a = j + 1;
+			} while (a < b);
+		}
+	}
+	Report("lookup_bsearch", n * names.size(), start);
+
+	const PerfectHash<MAX_COMMANDS> hash{key_views};
+
+	start = Clock::now();
+	std::size_t found2 = 0;
+	for (unsigned i = 0; i < n; ++i) {
+		for (const auto &name : names_z) {
+			const std::string_view s{name.c_str()};
+			const std::size_t j = hash.Find(s);
+			if (j != hash.NOT_FOUND && s == keys[j])
+				++found2;
+		}
+	}
+	Report("lookup_perfect_hash", n * names.size(), start);
+
+	if (found != found2)
+		throw std::runtime_error("Lookup mismatch");
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 3) {
+		fprintf(stderr, "Usage: BenchCommandParse [FILE [ITERATIONS]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const std::string stream = argc > 1
+		? LoadFile(argv[1])
+		: MakeSyntheticStream();
+
+	const unsigned n = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 100;
+	if (n == 0)
+		throw std::runtime_error("Invalid number of iterations");
+
+	Bench(stream, n);
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Measure how long the "curl" input plugin takes to deliver the first
+ * byte of a file (which approximates the time to first audio), to
+ * deliver data after seeking and to read the whole file.  The file is
+ * served by a local HTTP server which delays each response and limits
+ * the bandwidth of each connection to simulate a high-latency link.
+ *
+ * Usage: BenchCurlLatency [LATENCY_MS [PARALLEL_RANGES [KBYTES_PER_SECOND [FILE_SIZE]]]]
+ *
+ * Example (compare with and without parallel "Range" requests):
+ *
+ *   BenchCurlLatency 100 1 4096
+ *   BenchCurlLatency 100 4 4096
+ */
+
+#include "DelayHttpServer.hxx"
+#include "input/InputStream.hxx"
+#include "input/Init.hxx"
+#include "config/Block.hxx"
+#include "config/Data.hxx"
+#include "event/Call.hxx"
+#include "event/Thread.hxx"
+#include "thread/Mutex.hxx"
+#include "util/PrintException.hxx"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+#include <stdlib.h>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * The number of seeks to be measured.
+ */
+static constexpr unsigned N_SEEKS = 16;
+
+static double
+ToMilliseconds(Clock::duration d) noexcept
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static unsigned long long
+ParseNumber(const char *s)
+{
+	char *endptr;
+	const auto value = strtoull(s, &endptr, 10);
+	if (endptr == s || *endptr != 0)
+		throw std::runtime_error("Failed to parse number");
+	return value;
+}
+
+static void
+ReadSome(InputStream &is, std::unique_lock<Mutex> &lock)
+{
+	std::byte buffer[4096];
+	if (is.Read(lock, buffer, sizeof(buffer)) == 0)
+		throw std::runtime_error("Premature end of file");
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc > 5) {
+		fmt::print(stderr, "Usage: BenchCurlLatency [LATENCY_MS [PARALLEL_RANGES [KBYTES_PER_SECOND [FILE_SIZE]]]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const auto latency = std::chrono::milliseconds(argc > 1 ? ParseNumber(argv[1]) : 50);
+	const char *const parallel_ranges = argc > 2 ? argv[2] : "1";
+	const std::size_t bandwidth = 1024 * (argc > 3
+					      ? ParseNumber(argv[3])
+					      : 4096);
+	const uint_least64_t file_size = argc > 4
+		? ParseNumber(argv[4])
+		: 16 * 1024 * 1024;
+	if (file_size == 0)
+		throw std::runtime_error("Invalid file size");
+
+	ConfigBlock block;
+	block.AddBlockParam("plugin", "curl");
+	block.AddBlockParam("parallel_ranges", parallel_ranges);
+
+	ConfigData config;
+	config.AddBlock(ConfigBlockOption::INPUT, std::move(block));
+
+	EventThread io_thread;
+	io_thread.Start();
+
+	const ScopeInputPluginsInit input_plugins_init{config, io_thread.GetEventLoop()};
+
+	std::unique_ptr<DelayHttpServer> server;
+	BlockingCall(io_thread.GetEventLoop(), [&](){
+		server = std::make_unique<DelayHttpServer>(io_thread.GetEventLoop(),
+							   file_size, latency,
+							   bandwidth);
+	});
+
+	Mutex mutex;
+
+	/* time to first byte */
+
+	const auto open_time = Clock::now();
+	auto is = InputStream::OpenReady(server->GetURL().c_str(), mutex);
+
+	std::unique_lock lock{mutex};
+	ReadSome(*is, lock);
+
+	const auto first_byte_time = Clock::now();
+
+	/* seek to pseudo-random offsets */
+
+	Clock::duration seek_duration{};
+	uint_least64_t offset = 0;
+	for (unsigned i = 0; i < N_SEEKS; ++i) {
+		offset = (offset * 6364136223846793005ULL + 1442695040888963407ULL) % file_size;
+
+		const auto start = Clock::now();
+		is->Seek(lock, offset);
+		ReadSome(*is, lock);
+		seek_duration += Clock::now() - start;
+	}
+
+	/* read the whole file */
+
+	const auto read_time = Clock::now();
+
+	is->Seek(lock, 0);
+
+	std::byte buffer[16384];
+	while (is->Read(lock, buffer, sizeof(buffer)) > 0) {}
+	is->Check();
+
+	const auto complete_time = Clock::now();
+
+	lock.unlock();
+	is.reset();
+
+	fmt::print("latency:     {} ms\n", latency.count());
+	fmt::print("first byte:  {:.1f} ms\n",
+		   ToMilliseconds(first_byte_time - open_time));
+	fmt::print("seek:        {:.1f} ms (average of {})\n",
+		   ToMilliseconds(seek_duration) / N_SEEKS, N_SEEKS);
+	fmt::print("complete:    {:.1f} ms ({:.1f} MB/s)\n",
+		   ToMilliseconds(complete_time - read_time),
+		   file_size / ToMilliseconds(complete_time - read_time) / 1000.);
+	fmt::print("requests:    {}\n", server->GetRequestCount());
+	fmt::print("connections: {}\n", server->GetConnectionCount());
+
+	BlockingCall(io_thread.GetEventLoop(), [&](){
+		server.reset();
+	});
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
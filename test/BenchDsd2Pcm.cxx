@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Measure the throughput of the DSD to PCM conversion with the SIMD
+ * kernels and with channel threads compared with the portable code,
+ * and verify that all of them produce exactly the same output.
+ */
+
+#include "pcm/PcmDsd.hxx"
+#include "pcm/Simd.hxx"
+#include "pcm/ChannelDefs.hxx"
+#include "util/PrintException.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Mode {
+	const char *name;
+	PcmSimd simd;
+	bool threads;
+};
+
+static constexpr Mode modes[] = {
+	{"portable", PcmSimd::NONE, false},
+	{"simd", PcmSimd::AVX2, false},
+	{"threads", PcmSimd::NONE, true},
+	{"simd+threads", PcmSimd::AVX2, true},
+};
+
+/**
+ * Splits the input into chunks of random size (between one frame and
+ * twice the given size), so both the SIMD code and the portable code
+ * get to handle a part of it, and the state gets passed between them.
+ */
+static std::vector<std::size_t>
+MakeChunks(std::size_t n_frames, std::size_t chunk_frames,
+	   std::minstd_rand &engine)
+{
+	std::uniform_int_distribution<std::size_t> dis(1, chunk_frames * 2);
+
+	std::vector<std::size_t> chunks;
+	while (n_frames > 0) {
+		const std::size_t n = std::min(dis(engine), n_frames);
+		chunks.push_back(n);
+		n_frames -= n;
+	}
+
+	return chunks;
+}
+
+template<typename T>
+static std::span<const T>
+Convert(PcmDsd &dsd, unsigned channels, std::span<const std::byte> src);
+
+template<>
+std::span<const float>
+Convert<float>(PcmDsd &dsd, unsigned channels, std::span<const std::byte> src)
+{
+	return dsd.ToFloat(channels, src);
+}
+
+template<>
+std::span<const int32_t>
+Convert<int32_t>(PcmDsd &dsd, unsigned channels, std::span<const std::byte> src)
+{
+	return dsd.ToS24(channels, src);
+}
+
+struct Result {
+	Clock::duration duration;
+	std::unique_ptr<std::byte[]> output;
+};
+
+/**
+ * Convert all of the input with a new #PcmDsd instance.
+ */
+template<typename T>
+static Result
+Run(unsigned channels, std::span<const std::byte> input,
+    std::span<const std::size_t> chunks)
+{
+	PcmDsd dsd;
+	Result result{
+		{},
+		std::make_unique<std::byte[]>(input.size() * sizeof(T)),
+	};
+
+	auto *dest = reinterpret_cast<T *>(result.output.get());
+	const std::byte *src = input.data();
+
+	for (const std::size_t n_frames : chunks) {
+		const std::size_t size = n_frames * channels;
+
+		const auto start = Clock::now();
+		const auto output = Convert<T>(dsd, channels, {src, size});
+		result.duration += Clock::now() - start;
+
+		if (output.size() != size)
+			throw std::runtime_error("Wrong output size");
+
+		std::copy(output.begin(), output.end(), dest);
+		dest += size;
+		src += size;
+	}
+
+	return result;
+}
+
+template<typename T>
+static bool
+Measure(const char *format_name, unsigned channels,
+	std::span<const std::byte> input, std::span<const std::size_t> chunks)
+{
+	const PcmSimd best = PcmSimdDetect();
+	const std::size_t output_size = input.size() * sizeof(T);
+
+	std::unique_ptr<std::byte[]> reference;
+	double portable_speed = 0;
+	bool all_exact = true;
+
+	for (const auto &mode : modes) {
+		if (mode.simd > best)
+			continue;
+
+		PcmSimdSelect(mode.simd);
+		pcm_dsd_global_init(mode.threads ? channels - 1 : 0);
+
+		auto result = Run<T>(channels, input, chunks);
+		const double samples_per_second = double(input.size()) /
+			std::chrono::duration<double>(result.duration).count();
+
+		bool exact = true;
+		if (reference == nullptr) {
+			/* the first mode is the portable code */
+			reference = std::move(result.output);
+			portable_speed = samples_per_second;
+		} else
+			exact = memcmp(result.output.get(), reference.get(),
+				       output_size) == 0;
+
+		if (!exact)
+			all_exact = false;
+
+		printf("format=%s channels=%u mode=%s samples_per_second=%.0f speedup=%.2f exact=%s\n",
+		       format_name, channels, mode.name,
+		       samples_per_second,
+		       samples_per_second / portable_speed,
+		       exact ? "yes" : "NO");
+	}
+
+	PcmSimdSelect(best);
+	pcm_dsd_global_init(0);
+
+	return all_exact;
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 4) {
+		fprintf(stderr, "Usage: BenchDsd2Pcm [CHANNELS [N_FRAMES [CHUNK_FRAMES]]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned channels = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 2;
+	const std::size_t n_frames = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 1 << 22;
+	const std::size_t chunk_frames = argc > 3
+		? strtoul(argv[3], nullptr, 10)
+		: 4096;
+
+	if (channels == 0 || channels > MAX_CHANNELS)
+		throw std::runtime_error("Invalid number of channels");
+
+	if (n_frames == 0 || chunk_frames == 0)
+		throw std::runtime_error("Need at least one frame");
+
+	std::minstd_rand engine;
+
+	const std::size_t size = n_frames * channels;
+	const auto input = std::make_unique<std::byte[]>(size);
+	for (auto &i : std::span{input.get(), size})
+		i = std::byte(engine());
+
+	const auto chunks = MakeChunks(n_frames, chunk_frames, engine);
+
+	bool all_exact = Measure<float>("float", channels, {input.get(), size},
+					chunks);
+	if (!Measure<int32_t>("s24", channels, {input.get(), size}, chunks))
+		all_exact = false;
+
+	return all_exact ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
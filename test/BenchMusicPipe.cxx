@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Measure the #MusicPipe and #MusicBuffer throughput between a
+ * producer thread (like the decoder) and a consumer thread (like the
+ * player), and how long a sleeping consumer takes to receive a new
+ * chunk.
+ */
+
+#include "MusicPipe.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/PrintException.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr AudioFormat audio_format{44100, SampleFormat::S16, 2};
+
+/**
+ * A thread which sleeps on a #Cond until another thread wakes it up.
+ * The "waiting" flag is atomic, so the other thread needs to lock
+ * the mutex only if this thread really sleeps, just like the player
+ * and the decoder do it.
+ */
+class Sleeper {
+	Mutex mutex;
+	Cond cond;
+	std::atomic_bool waiting{false};
+
+public:
+	unsigned n_wakeups = 0;
+
+	/**
+	 * Sleep until the given predicate becomes true.  Wake() makes
+	 * this thread check it again.
+	 */
+	template<typename P>
+	void Wait(P &&predicate) noexcept {
+		while (true) {
+			waiting = true;
+			if (predicate()) {
+				waiting = false;
+				return;
+			}
+
+			std::unique_lock lock{mutex};
+			cond.wait(lock, [this]{ return !waiting; });
+			++n_wakeups;
+		}
+	}
+
+	void Wake() noexcept {
+		if (waiting.exchange(false)) {
+			const std::scoped_lock lock{mutex};
+			cond.notify_one();
+		}
+	}
+};
+
+class Benchmark {
+	const unsigned n_chunks;
+
+	MusicBuffer buffer;
+	MusicPipe pipe;
+
+	Sleeper producer, consumer;
+
+	Thread producer_thread{BIND_THIS_METHOD(RunProducer)};
+
+public:
+	Clock::duration total_latency{}, max_latency{};
+	unsigned n_latency_samples = 0;
+
+	Benchmark(unsigned _n_chunks, unsigned n_buffer_chunks,
+		  std::size_t chunk_size)
+		:n_chunks(_n_chunks),
+		 buffer(n_buffer_chunks * chunk_size, chunk_size) {}
+
+	unsigned GetWakeups() const noexcept {
+		return producer.n_wakeups + consumer.n_wakeups;
+	}
+
+	void Run() {
+		producer_thread.Start();
+		RunConsumer();
+		producer_thread.Join();
+	}
+
+private:
+	MusicChunkPtr AllocateChunk() noexcept {
+		MusicChunkPtr chunk;
+		producer.Wait([this, &chunk]{
+			chunk = buffer.Allocate();
+			return chunk != nullptr;
+		});
+
+		return chunk;
+	}
+
+	void RunProducer() noexcept {
+		for (unsigned i = 0; i < n_chunks; ++i) {
+			auto chunk = AllocateChunk();
+
+			const auto w = chunk->Write(audio_format,
+						    SongTime::zero(), 0);
+			const auto now = Clock::now();
+			memcpy(w.data(), &now, sizeof(now));
+			chunk->Expand(audio_format, w.size());
+
+			pipe.Push(std::move(chunk));
+			consumer.Wake();
+		}
+	}
+
+	void RunConsumer() noexcept {
+		for (unsigned i = 0; i < n_chunks; ++i) {
+			MusicChunkPtr chunk = pipe.Shift();
+			if (chunk == nullptr) {
+				consumer.Wait([this, &chunk]{
+					chunk = pipe.Shift();
+					return chunk != nullptr;
+				});
+
+				Clock::time_point pushed;
+				memcpy(&pushed, chunk->GetData(), sizeof(pushed));
+				const auto latency = Clock::now() - pushed;
+				total_latency += latency;
+				max_latency = std::max(max_latency, latency);
+				++n_latency_samples;
+			}
+
+			/* return the chunk to the buffer and wake up
+			   the producer if it waits for a free chunk */
+			chunk.reset();
+			producer.Wake();
+		}
+	}
+};
+
+static double
+ToUS(Clock::duration d) noexcept
+{
+	return std::chrono::duration<double, std::micro>(d).count();
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 4) {
+		fprintf(stderr, "Usage: BenchMusicPipe [N_CHUNKS [BUFFER_CHUNKS [CHUNK_SIZE]]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned n_chunks = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 1000000;
+	const unsigned n_buffer_chunks = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 1024;
+	const std::size_t chunk_size = argc > 3
+		? strtoul(argv[3], nullptr, 10)
+		: DEFAULT_CHUNK_SIZE;
+
+	if (n_buffer_chunks == 0)
+		throw std::runtime_error("Need at least one buffer chunk");
+
+	if (chunk_size < MIN_CHUNK_SIZE || chunk_size > MAX_CHUNK_SIZE ||
+	    chunk_size % alignof(MusicChunk) != 0)
+		throw std::runtime_error("Bad chunk size");
+
+	Benchmark benchmark(n_chunks, n_buffer_chunks, chunk_size);
+
+	const auto start = Clock::now();
+	benchmark.Run();
+	const auto duration = Clock::now() - start;
+
+	const double seconds = std::chrono::duration<double>(duration).count();
+
+	printf("chunks=%u chunk_size=%zu chunks_per_second=%.0f"
+	       " bytes_per_second=%.0f wakeups=%u"
+	       " avg_wakeup_latency=%.1fus max_wakeup_latency=%.1fus\n",
+	       n_chunks, chunk_size,
+	       n_chunks / seconds,
+	       n_chunks * double(chunk_size - sizeof(MusicChunk)) / seconds,
+	       benchmark.GetWakeups(),
+	       benchmark.n_latency_samples > 0
+	       ? ToUS(benchmark.total_latency) / benchmark.n_latency_samples
+	       : 0.,
+	       ToUS(benchmark.max_latency));
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Measure the throughput of the SIMD implementations of software
+ * volume, mixing and sample format conversion compared with the
+ * portable code, and verify that all of them produce exactly the
+ * same output.
+ */
+
+#include "pcm/Simd.hxx"
+#include "pcm/Volume.hxx"
+#include "pcm/Mix.hxx"
+#include "pcm/PcmFormat.hxx"
+#include "pcm/Buffer.hxx"
+#include "pcm/Dither.hxx"
+#include "pcm/SampleFormat.hxx"
+#include "util/PrintException.hxx"
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <span>
+#include <stdexcept>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * The state shared by all kernels.
+ */
+struct Context {
+	PcmBuffer buffer;
+	PcmDither dither;
+	PcmVolume volume;
+
+	/**
+	 * A copy of the first input buffer for pcm_mix(), which
+	 * modifies it.
+	 */
+	std::unique_ptr<std::byte[]> mix;
+};
+
+struct Kernel {
+	const char *name;
+
+	/**
+	 * The input sample format.
+	 */
+	SampleFormat format;
+
+	/**
+	 * Prepare the next Run() call; this is not part of the
+	 * measurement.
+	 */
+	void (*prepare)(Context &ctx, std::span<const std::byte> a);
+
+	std::span<const std::byte> (*run)(Context &ctx,
+					  std::span<const std::byte> a,
+					  std::span<const std::byte> b);
+};
+
+static void
+PrepareNothing(Context &, std::span<const std::byte>)
+{
+}
+
+static void
+PrepareMix(Context &ctx, std::span<const std::byte> a)
+{
+	memcpy(ctx.mix.get(), a.data(), a.size());
+}
+
+template<SampleFormat F, bool convert=false>
+static std::span<const std::byte>
+RunVolume(Context &ctx, std::span<const std::byte> a,
+	  std::span<const std::byte>)
+{
+	ctx.volume.Open(F, convert);
+	ctx.volume.SetVolume(PCM_VOLUME_1 * 3 / 4);
+	const auto result = ctx.volume.Apply(a);
+	ctx.volume.Close();
+	return result;
+}
+
+template<SampleFormat F, int portion_percent>
+static std::span<const std::byte>
+RunMix(Context &ctx, std::span<const std::byte> a,
+       std::span<const std::byte> b)
+{
+	if (!pcm_mix(ctx.dither, ctx.mix.get(), b.data(), a.size(), F,
+		     portion_percent / 100.f))
+		throw std::runtime_error("pcm_mix() failed");
+
+	return {ctx.mix.get(), a.size()};
+}
+
+template<SampleFormat F>
+static std::span<const std::byte>
+RunConvertTo16(Context &ctx, std::span<const std::byte> a,
+	       std::span<const std::byte>)
+{
+	return std::as_bytes(pcm_convert_to_16(ctx.buffer, ctx.dither, F, a));
+}
+
+template<SampleFormat F>
+static std::span<const std::byte>
+RunConvertTo24(Context &ctx, std::span<const std::byte> a,
+	       std::span<const std::byte>)
+{
+	return std::as_bytes(pcm_convert_to_24(ctx.buffer, F, a));
+}
+
+template<SampleFormat F>
+static std::span<const std::byte>
+RunConvertTo32(Context &ctx, std::span<const std::byte> a,
+	       std::span<const std::byte>)
+{
+	return std::as_bytes(pcm_convert_to_32(ctx.buffer, F, a));
+}
+
+template<SampleFormat F>
+static std::span<const std::byte>
+RunConvertToFloat(Context &ctx, std::span<const std::byte> a,
+		  std::span<const std::byte>)
+{
+	return std::as_bytes(pcm_convert_to_float(ctx.buffer, F, a));
+}
+
+static constexpr Kernel kernels[] = {
+	{"volume_float", SampleFormat::FLOAT,
+	 PrepareNothing, RunVolume<SampleFormat::FLOAT>},
+	{"volume_16_to_24", SampleFormat::S16,
+	 PrepareNothing, RunVolume<SampleFormat::S16, true>},
+	{"mix_float", SampleFormat::FLOAT,
+	 PrepareMix, RunMix<SampleFormat::FLOAT, 30>},
+	{"add_8", SampleFormat::S8,
+	 PrepareMix, RunMix<SampleFormat::S8, -100>},
+	{"add_16", SampleFormat::S16,
+	 PrepareMix, RunMix<SampleFormat::S16, -100>},
+	{"add_24", SampleFormat::S24_P32,
+	 PrepareMix, RunMix<SampleFormat::S24_P32, -100>},
+	{"add_32", SampleFormat::S32,
+	 PrepareMix, RunMix<SampleFormat::S32, -100>},
+	{"add_float", SampleFormat::FLOAT,
+	 PrepareMix, RunMix<SampleFormat::FLOAT, -100>},
+	{"convert_16_to_24", SampleFormat::S16,
+	 PrepareNothing, RunConvertTo24<SampleFormat::S16>},
+	{"convert_16_to_32", SampleFormat::S16,
+	 PrepareNothing, RunConvertTo32<SampleFormat::S16>},
+	{"convert_24_to_32", SampleFormat::S24_P32,
+	 PrepareNothing, RunConvertTo32<SampleFormat::S24_P32>},
+	{"convert_32_to_24", SampleFormat::S32,
+	 PrepareNothing, RunConvertTo24<SampleFormat::S32>},
+	{"convert_16_to_float", SampleFormat::S16,
+	 PrepareNothing, RunConvertToFloat<SampleFormat::S16>},
+	{"convert_24_to_float", SampleFormat::S24_P32,
+	 PrepareNothing, RunConvertToFloat<SampleFormat::S24_P32>},
+	{"convert_32_to_float", SampleFormat::S32,
+	 PrepareNothing, RunConvertToFloat<SampleFormat::S32>},
+	{"convert_float_to_16", SampleFormat::FLOAT,
+	 PrepareNothing, RunConvertTo16<SampleFormat::FLOAT>},
+	{"convert_float_to_24", SampleFormat::FLOAT,
+	 PrepareNothing, RunConvertTo24<SampleFormat::FLOAT>},
+	{"convert_float_to_32", SampleFormat::FLOAT,
+	 PrepareNothing, RunConvertTo32<SampleFormat::FLOAT>},
+};
+
+/**
+ * Fill the buffer with random samples.  Integer samples cover the
+ * whole range of the format; float samples exceed the nominal range
+ * a bit to check clipping.
+ */
+static void
+FillRandom(std::span<std::byte> dest, SampleFormat format,
+	   std::minstd_rand &engine) noexcept
+{
+	switch (format) {
+	case SampleFormat::FLOAT: {
+		std::uniform_real_distribution<float> dis(-1.2f, 1.2f);
+		for (auto &i : std::span{(float *)dest.data(), dest.size() / sizeof(float)})
+			i = dis(engine);
+		break;
+	}
+
+	case SampleFormat::S24_P32:
+		for (auto &i : std::span{(int32_t *)dest.data(), dest.size() / sizeof(int32_t)})
+			i = int32_t(engine() << 8) >> 8;
+		break;
+
+	default:
+		for (auto &i : dest)
+			i = std::byte(engine());
+		break;
+	}
+}
+
+struct Result {
+	double samples_per_second;
+	bool exact;
+};
+
+static Result
+Measure(const Kernel &kernel, std::span<const std::byte> a,
+	std::span<const std::byte> b, std::span<const std::byte> reference,
+	std::size_t n_samples, unsigned n_iterations)
+{
+	Context ctx;
+	ctx.mix = std::make_unique<std::byte[]>(a.size());
+
+	/* the first run is not measured; it allocates the buffers
+	   and produces the output which gets compared */
+	kernel.prepare(ctx, a);
+	const auto output = kernel.run(ctx, a, b);
+	const bool exact = output.size() == reference.size() &&
+		memcmp(output.data(), reference.data(), output.size()) == 0;
+
+	Clock::duration total{};
+	for (unsigned i = 0; i < n_iterations; ++i) {
+		kernel.prepare(ctx, a);
+
+		const auto start = Clock::now();
+		kernel.run(ctx, a, b);
+		total += Clock::now() - start;
+	}
+
+	return {
+		double(n_samples) * n_iterations / std::chrono::duration<double>(total).count(),
+		exact,
+	};
+}
+
+/**
+ * Run the kernel once with the portable code and return a copy of
+ * its output.
+ */
+static std::unique_ptr<std::byte[]>
+MakeReference(const Kernel &kernel, std::span<const std::byte> a,
+	      std::span<const std::byte> b, std::size_t &size_r)
+{
+	Context ctx;
+	ctx.mix = std::make_unique<std::byte[]>(a.size());
+
+	kernel.prepare(ctx, a);
+	const auto output = kernel.run(ctx, a, b);
+
+	auto result = std::make_unique<std::byte[]>(output.size());
+	memcpy(result.get(), output.data(), output.size());
+	size_r = output.size();
+	return result;
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 3) {
+		fprintf(stderr, "Usage: BenchPcmSimd [N_SAMPLES [ITERATIONS]]\n");
+		return EXIT_FAILURE;
+	}
+
+	/* the default is a prime number to check the trailing
+	   samples which are not handled by the SIMD code */
+	const std::size_t n_samples = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 65521;
+	const unsigned n_iterations = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 200;
+
+	if (n_samples == 0 || n_iterations == 0)
+		throw std::runtime_error("Need at least one sample and one iteration");
+
+	const PcmSimd best = PcmSimdDetect();
+	std::minstd_rand engine;
+	bool all_exact = true;
+
+	for (const auto &kernel : kernels) {
+		const std::size_t size = n_samples * sample_format_size(kernel.format);
+		const auto a = std::make_unique<std::byte[]>(size);
+		const auto b = std::make_unique<std::byte[]>(size);
+		FillRandom({a.get(), size}, kernel.format, engine);
+		FillRandom({b.get(), size}, kernel.format, engine);
+
+		PcmSimdSelect(PcmSimd::NONE);
+
+		std::size_t reference_size;
+		const auto reference = MakeReference(kernel, {a.get(), size},
+						     {b.get(), size},
+						     reference_size);
+
+		double portable_speed = 0;
+
+		for (auto simd : {PcmSimd::NONE, PcmSimd::SSE2, PcmSimd::AVX2}) {
+			if (simd > best)
+				break;
+
+			PcmSimdSelect(simd);
+
+			const auto result = Measure(kernel,
+						    {a.get(), size},
+						    {b.get(), size},
+						    {reference.get(), reference_size},
+						    n_samples, n_iterations);
+			if (simd == PcmSimd::NONE)
+				portable_speed = result.samples_per_second;
+
+			if (!result.exact)
+				all_exact = false;
+
+			printf("kernel=%s simd=%s samples_per_second=%.0f speedup=%.2f exact=%s\n",
+			       kernel.name, ToString(simd),
+			       result.samples_per_second,
+			       result.samples_per_second / portable_speed,
+			       result.exact ? "yes" : "NO");
+		}
+	}
+
+	PcmSimdSelect(best);
+
+	return all_exact ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Measure the cost of the queue editing operations behind the
+ * commands "add", "move", "moveid" (ranges), "deleteid",
+ * "shuffle", "plchanges" and lookups in random mode at various
+ * queue lengths.
+ */
+
+#include "queue/Queue.hxx"
+#include "song/DetachedSong.hxx"
+#include "song/LightSong.hxx"
+#include "util/PrintException.hxx"
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+Tag::Tag(const Tag &) noexcept {}
+void Tag::Clear() noexcept {}
+
+DetachedSong::operator LightSong() const noexcept
+{
+	return {uri.c_str(), tag};
+}
+
+using Clock = std::chrono::steady_clock;
+
+static void
+Report(unsigned length, const char *operation, unsigned n,
+       Clock::time_point start) noexcept
+{
+	const std::chrono::duration<double, std::micro> duration =
+		Clock::now() - start;
+
+	printf("length=%u operation=%s count=%u us_per_operation=%.3f\n",
+	       length, operation, n, duration.count() / n);
+}
+
+static void
+Fill(Queue &queue, unsigned length)
+{
+	for (unsigned i = 0; i < length; ++i)
+		queue.Append(DetachedSong("song.ogg"), 0);
+}
+
+static void
+Bench(unsigned length, unsigned n)
+{
+	std::minstd_rand rng;
+	const auto random = [&rng](unsigned max){
+		return std::uniform_int_distribution<unsigned>{0, max - 1}(rng);
+	};
+
+	auto queue = std::make_unique<Queue>(length);
+
+	auto start = Clock::now();
+	Fill(*queue, length);
+	Report(length, "add", length, start);
+
+	start = Clock::now();
+	for (unsigned i = 0; i < n; ++i)
+		queue->MovePostion(random(length), random(length));
+	Report(length, "move", n, start);
+
+	constexpr unsigned range_size = 100;
+	start = Clock::now();
+	for (unsigned i = 0; i < n; ++i) {
+		const unsigned range_start = random(length - range_size);
+		queue->MoveRange(range_start, range_start + range_size,
+				 random(length - range_size));
+	}
+	Report(length, "move_range", n, start);
+
+	queue->IncrementVersion();
+	const uint32_t version = queue->version;
+	for (unsigned i = 0; i < 16; ++i)
+		queue->ModifyAtPosition(random(length));
+	queue->IncrementVersion();
+
+	start = Clock::now();
+	unsigned n_changes = 0;
+	queue->ForEachNewerPosition(0, length, version,
+				    [&n_changes](unsigned, const Queue::Item &){
+		++n_changes;
+	});
+	Report(length, "plchanges", 1, start);
+	if (n_changes < 1 || n_changes > 16)
+		throw std::runtime_error("Wrong number of changes");
+
+	queue->random = true;
+
+	start = Clock::now();
+	queue->ShuffleOrder();
+	Report(length, "shuffle", 1, start);
+
+	start = Clock::now();
+	unsigned sum = 0;
+	for (unsigned i = 0; i < n; ++i)
+		sum += queue->PositionToOrder(random(length));
+	Report(length, "position_to_order", n, start);
+
+	start = Clock::now();
+	for (unsigned i = 0; i < n; ++i)
+		sum += queue->OrderToPosition(random(length));
+	Report(length, "order_to_position", n, start);
+
+	/* collect some ids to be deleted */
+	std::vector<unsigned> ids;
+	for (unsigned i = 0; i < n; ++i)
+		ids.push_back(queue->PositionToId(i));
+
+	start = Clock::now();
+	for (const unsigned id : ids) {
+		const int position = queue->IdToPosition(id);
+		if (position < 0)
+			throw std::runtime_error("Id not found");
+
+		queue->DeletePosition(position);
+	}
+	Report(length, "delete_id", n, start);
+
+	start = Clock::now();
+	queue->Clear();
+	Report(length, "clear", 1, start);
+
+	/* prevent the compiler from optimizing the lookups away */
+	if (sum == 0)
+		printf("\n");
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 2) {
+		fprintf(stderr, "Usage: BenchQueue [OPERATIONS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned n = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 1000;
+
+	for (const unsigned length : {10000U, 100000U, 1000000U}) {
+		if (n == 0 || n > length / 2)
+			throw std::runtime_error("Invalid number of operations");
+
+		Bench(length, n);
+	}
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Measure the cost of sticker lookups on a large sticker database:
+ * single lookups (like "sticker get") and batched lookups (like
+ * "sticker getmany"), both with a cold and a warm cache, and "sticker
+ * find" with a value operator, sort and window.
+ *
+ * If the given database file does not contain any stickers yet, it
+ * is filled with the specified number of synthetic song stickers
+ * (default: one million).
+ */
+
+#include "sticker/Database.hxx"
+#include "lib/sqlite/Database.hxx"
+#include "lib/sqlite/Util.hxx"
+#include "fs/Path.hxx"
+#include "util/PrintException.hxx"
+#include "Idle.hxx"
+
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void
+idle_add([[maybe_unused]] unsigned flags)
+{
+}
+
+/**
+ * The number of songs in a "view", i.e. the number of lookups per
+ * round.
+ */
+static constexpr std::size_t VIEW_SIZE = 5000;
+
+using Clock = std::chrono::steady_clock;
+
+static void
+Report(const char *operation, std::size_t n, std::size_t n_found,
+       Clock::time_point start) noexcept
+{
+	const std::chrono::duration<double, std::micro> duration =
+		Clock::now() - start;
+
+	printf("operation=%s count=%zu found=%zu us_total=%.0f us_per_op=%.2f\n",
+	       operation, n, n_found, duration.count(), duration.count() / n);
+}
+
+static std::string
+MakeUri(unsigned i)
+{
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer),
+		 "Artist %u/Album %u/%02u - Track.flac",
+		 i / 1000, i / 10 % 100, i % 10);
+	return buffer;
+}
+
+static void
+Populate(const char *path, unsigned n_songs)
+{
+	Sqlite::Database db{path};
+
+	sqlite3_stmt *const s =
+		Sqlite::Prepare(db, "INSERT INTO sticker(type,uri,name,value) VALUES('song',?,?,?)");
+
+	sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr);
+
+	for (unsigned i = 0; i < n_songs; ++i) {
+		const auto uri = MakeUri(i);
+		const auto rating = std::to_string(i * 7 % 11);
+		Sqlite::BindAll(s, uri.c_str(), "rating", rating.c_str());
+		Sqlite::ExecuteCommand(s);
+		sqlite3_reset(s);
+	}
+
+	sqlite3_finalize(s);
+
+	if (sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK)
+		throw std::runtime_error("Failed to commit");
+}
+
+static void
+CountFound([[maybe_unused]] const char *uri,
+	   [[maybe_unused]] const char *value, void *user_data)
+{
+	++*static_cast<std::size_t *>(user_data);
+}
+
+static void
+BenchGet(StickerDatabase &db, const std::vector<const char *> &view,
+	 const char *operation)
+{
+	const auto start = Clock::now();
+	std::size_t n_found = 0;
+	for (const char *uri : view)
+		if (!db.LoadValue("song", uri, "rating").empty())
+			++n_found;
+	Report(operation, view.size(), n_found, start);
+}
+
+static void
+BenchGetMany(StickerDatabase &db, const std::vector<const char *> &view,
+	     const char *operation)
+{
+	const auto start = Clock::now();
+	std::size_t n_found = 0;
+	db.LoadValues("song", view, "rating", CountFound, &n_found);
+	Report(operation, view.size(), n_found, start);
+}
+
+static void
+BenchFind(StickerDatabase &db, const char *operation, const char *base_uri,
+	  StickerOperator op, const char *value,
+	  const char *sort, bool descending, RangeArg window)
+{
+	constexpr unsigned n = 10;
+
+	const auto start = Clock::now();
+	std::size_t n_found = 0;
+	for (unsigned i = 0; i < n; ++i)
+		db.Find("song", base_uri, "rating", op, value,
+			sort, descending, window, CountFound, &n_found);
+	Report(operation, n, n_found / n, start);
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: BenchSticker PATH [SONGS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const char *const path = argv[1];
+	const unsigned n_songs = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 1000000;
+	if (n_songs < VIEW_SIZE)
+		throw std::runtime_error("Too few songs");
+
+	StickerDatabase db{Path::FromFS(path)};
+
+	if (db.GetUniqueStickers().empty()) {
+		const auto start = Clock::now();
+		Populate(path, n_songs);
+		Report("populate", n_songs, n_songs, start);
+	}
+
+	/* a random "view" of songs; about 10% don't exist */
+	std::vector<std::string> view_uris;
+	std::minstd_rand rng{42};
+	for (std::size_t i = 0; i < VIEW_SIZE; ++i)
+		view_uris.emplace_back(MakeUri(rng() % (n_songs + n_songs / 10)));
+
+	const std::vector<const char *> view = [&view_uris]{
+		std::vector<const char *> result;
+		for (const auto &i : view_uris)
+			result.push_back(i.c_str());
+		return result;
+	}();
+
+	db.ClearCache();
+	BenchGet(db, view, "get_cold");
+	BenchGet(db, view, "get_warm");
+
+	db.ClearCache();
+	BenchGetMany(db, view, "getmany_cold");
+	BenchGetMany(db, view, "getmany_warm");
+
+	BenchFind(db, "find_gt_int_sort_window", "",
+		  StickerOperator::GREATER_THAN_INT, "5",
+		  "value_int", true, {0, 50});
+	BenchFind(db, "find_eq_sort_window", "",
+		  StickerOperator::EQUALS, "7",
+		  "uri", false, {100, 150});
+	BenchFind(db, "find_prefix", "Artist 42/",
+		  StickerOperator::EXISTS, nullptr,
+		  "uri", false, RangeArg::All());
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
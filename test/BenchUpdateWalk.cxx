@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Measure how long a full database update of a synthetic music
+ * directory takes with different numbers of update threads.
+ */
+
+#include "db/update/Walk.hxx"
+#include "db/update/Config.hxx"
+#include "db/DatabaseListener.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "storage/plugins/LocalStorage.hxx"
+#include "storage/StorageInterface.hxx"
+#include "config/Data.hxx"
+#include "decoder/DecoderList.hxx"
+#include "input/Init.hxx"
+#include "event/Thread.hxx"
+#include "fs/Path.hxx"
+#include "fs/NarrowPath.hxx"
+#include "util/PrintException.hxx"
+#include "SyntheticTree.hxx"
+
+#include <chrono>
+#include <memory>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+class NullDatabaseListener final : public DatabaseListener {
+public:
+	void OnDatabaseModified() noexcept override {}
+	void OnDatabaseSongRemoved(const char *) noexcept override {}
+};
+
+[[gnu::pure]]
+static unsigned
+CountSongs(const Directory &directory) noexcept
+{
+	unsigned n = directory.songs.size();
+	for (const auto &child : directory.children)
+		n += CountSongs(child);
+	return n;
+}
+
+static void
+RunWalk(EventLoop &event_loop, Storage &storage, unsigned threads)
+{
+	ConfigData config_data;
+	UpdateConfig config{config_data};
+	config.threads = threads;
+
+	NullDatabaseListener listener;
+	std::unique_ptr<Directory> root{Directory::NewRoot()};
+
+	const auto start = std::chrono::steady_clock::now();
+
+	{
+		UpdateWalk walk(config, event_loop, listener, storage);
+		walk.Walk(*root, nullptr, nullptr, false);
+	}
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	unsigned n_songs;
+	{
+		const ScopeDatabaseReadLock protect;
+		n_songs = CountSongs(*root);
+	}
+
+	printf("threads=%u songs=%u time=%.3fs songs/s=%.0f\n",
+	       threads, n_songs, duration.count(),
+	       n_songs / duration.count());
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc < 4) {
+		fprintf(stderr, "Usage: BenchUpdateWalk SAMPLE_FILE N_DIRECTORIES N_FILES [THREADS...]\n");
+		return EXIT_FAILURE;
+	}
+
+	const char *sample = argv[1];
+	const unsigned n_directories = strtoul(argv[2], nullptr, 10);
+	const unsigned n_files = strtoul(argv[3], nullptr, 10);
+
+	EventThread io_thread;
+	io_thread.Start();
+
+	const ScopeInputPluginsInit input_plugins_init(ConfigData(),
+						       io_thread.GetEventLoop());
+	const ScopeDecoderPluginsInit decoder_plugins_init({});
+
+	const SyntheticTree tree(sample, n_directories, n_files);
+	const auto storage = CreateLocalStorage(FromNarrowPath(tree.GetBase()));
+
+	if (argc == 4) {
+		RunWalk(io_thread.GetEventLoop(), *storage, 1);
+		RunWalk(io_thread.GetEventLoop(), *storage, 4);
+	} else {
+		for (int i = 4; i < argc; ++i)
+			RunWalk(io_thread.GetEventLoop(), *storage,
+				strtoul(argv[i], nullptr, 10));
+	}
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
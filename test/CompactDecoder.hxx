@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * A reference decoder for the "compact" response format (see
+ * command "responseformat" in doc/protocol.rst).  It is meant to be
+ * readable, not fast; clients should use it as a specification.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <stdlib.h>
+
+/**
+ * Decodes the attribute records of a compact response, i.e. the
+ * concatenated payloads of its "binary" chunks.  The input may be
+ * passed in arbitrary pieces.
+ */
+class CompactDecoder {
+	/**
+	 * Key names indexed by key id (0 is not a valid key).
+	 */
+	std::array<std::string, 256> keys;
+
+	/**
+	 * Data which has not been decoded yet because the record is
+	 * incomplete.
+	 */
+	std::string pending;
+
+public:
+	using Attribute = std::pair<std::string, std::string>;
+
+	/**
+	 * Decode as many records as possible and append them to the
+	 * given vector.
+	 */
+	void Feed(std::string_view data, std::vector<Attribute> &result) {
+		pending.append(data);
+
+		std::size_t position = 0;
+		while (position < pending.size()) {
+			const std::size_t start = position;
+			if (!DecodeRecord(position, result)) {
+				/* incomplete; wait for more data */
+				position = start;
+				break;
+			}
+		}
+
+		pending.erase(0, position);
+	}
+
+	/**
+	 * Has all input been decoded?
+	 */
+	bool IsComplete() const noexcept {
+		return pending.empty();
+	}
+
+private:
+	/**
+	 * Read an unsigned LEB128 number.
+	 *
+	 * @return false if the input is incomplete
+	 */
+	bool ReadSize(std::size_t &position, std::size_t &value) const {
+		value = 0;
+		for (unsigned shift = 0;; shift += 7) {
+			if (position >= pending.size())
+				return false;
+
+			if (shift > 56)
+				throw std::runtime_error("Size too large");
+
+			const auto byte = static_cast<unsigned char>(pending[position++]);
+			value |= std::size_t(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+	}
+
+	/**
+	 * Read a length-prefixed string.
+	 *
+	 * @return false if the input is incomplete
+	 */
+	bool ReadString(std::size_t &position, std::string_view &value) const {
+		std::size_t size;
+		if (!ReadSize(position, size) ||
+		    pending.size() - position < size)
+			return false;
+
+		value = std::string_view{pending}.substr(position, size);
+		position += size;
+		return true;
+	}
+
+	bool DecodeRecord(std::size_t &position,
+			  std::vector<Attribute> &result) {
+		const auto id = static_cast<unsigned char>(pending[position++]);
+
+		if (id == 0) {
+			/* key definition */
+			if (position >= pending.size())
+				return false;
+
+			const auto defined_id =
+				static_cast<unsigned char>(pending[position++]);
+			if (defined_id == 0)
+				throw std::runtime_error("Invalid key id");
+
+			std::string_view name;
+			if (!ReadString(position, name))
+				return false;
+
+			keys[defined_id] = name;
+			return true;
+		}
+
+		std::string_view value;
+		if (!ReadString(position, value))
+			return false;
+
+		if (keys[id].empty())
+			throw std::runtime_error("Undefined key id");
+
+		result.emplace_back(keys[id], value);
+		return true;
+	}
+};
+
+/**
+ * Parse a complete compact response as received from MPD: zero or
+ * more "binary" chunks followed by "OK" or an "ACK" line.
+ *
+ * @param status receives the last line ("OK" or the error message)
+ * @return the attributes
+ */
+inline std::vector<CompactDecoder::Attribute>
+DecodeCompactResponse(std::string_view response, std::string &status)
+{
+	static constexpr std::string_view binary_prefix = "binary: ";
+
+	CompactDecoder decoder;
+	std::vector<CompactDecoder::Attribute> result;
+
+	while (true) {
+		const auto newline = response.find('\n');
+		if (newline == response.npos)
+			throw std::runtime_error("Incomplete response");
+
+		const auto line = response.substr(0, newline);
+		response.remove_prefix(newline + 1);
+
+		if (!line.starts_with(binary_prefix)) {
+			/* "OK" or "ACK ..." */
+			if (!decoder.IsComplete())
+				throw std::runtime_error("Truncated record");
+
+			status = line;
+			return result;
+		}
+
+		const std::string size_string{line.substr(binary_prefix.size())};
+		const std::size_t size = strtoul(size_string.c_str(), nullptr, 10);
+		if (response.size() < size + 1 || response[size] != '\n')
+			throw std::runtime_error("Malformed binary chunk");
+
+		decoder.Feed(response.substr(0, size), result);
+		response.remove_prefix(size + 1);
+	}
+}
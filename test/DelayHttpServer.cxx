@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "DelayHttpServer.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "event/Loop.hxx"
+#include "net/IPv4Address.hxx"
+#include "net/SocketError.hxx"
+#include "net/SocketUtil.hxx"
+#include "net/StaticSocketAddress.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/CNumberParser.hxx"
+#include "util/DeleteDisposer.hxx"
+#include "util/StringCompare.hxx"
+#include "util/StringStrip.hxx"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <string_view>
+
+#include <sys/socket.h>
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * One client connection.  It handles one request at a time.
+ */
+class DelayHttpServer::Connection final : public IntrusiveListHook<> {
+	DelayHttpServer &server;
+
+	SocketEvent event;
+
+	/**
+	 * Delays the response to the current request, and throttles
+	 * the response body if the bandwidth is limited.
+	 */
+	FineTimerEvent delay_timer;
+
+	/**
+	 * Received data which has not been parsed yet.
+	 */
+	std::string input;
+
+	/**
+	 * The response status line and headers; the part before
+	 * #header_position has been sent already.
+	 */
+	std::string header;
+	std::size_t header_position;
+
+	/**
+	 * The part of the file which still needs to be sent as
+	 * response body.
+	 */
+	uint_least64_t body_offset, body_end;
+
+	/**
+	 * Is a request currently being handled?
+	 */
+	bool busy = false;
+
+public:
+	Connection(DelayHttpServer &_server, UniqueSocketDescriptor fd) noexcept
+		:server(_server),
+		 event(server.event_loop, BIND_THIS_METHOD(OnSocketReady),
+		       fd.Release()),
+		 delay_timer(server.event_loop, BIND_THIS_METHOD(OnDelay))
+	{
+		event.GetSocket().SetNoDelay();
+		event.ScheduleRead();
+	}
+
+	~Connection() noexcept {
+		event.Close();
+	}
+
+private:
+	void Destroy() noexcept {
+		server.connections.erase(server.connections.iterator_to(*this));
+		delete this;
+	}
+
+	/**
+	 * Parse the next request from #input (if it is complete) and
+	 * schedule its response.
+	 */
+	void HandleRequest() noexcept;
+
+	/**
+	 * Send as much of the response as possible.
+	 *
+	 * @return false if the connection has been closed
+	 */
+	bool SendResponse() noexcept;
+
+	void OnDelay() noexcept {
+		event.ScheduleWrite();
+	}
+
+	void OnSocketReady(unsigned flags) noexcept;
+};
+
+/**
+ * Parse the value of a "Range" request header with a single range,
+ * e.g. "bytes=1024-2047" or "bytes=1024-".
+ *
+ * @return false if the syntax is not supported
+ */
+static bool
+ParseRange(std::string_view value, uint_least64_t &start,
+	   uint_least64_t &end) noexcept
+{
+	if (!SkipPrefix(value, "bytes="sv))
+		return false;
+
+	const std::string s{value};
+	char *endptr;
+	start = ParseUint64(s.c_str(), &endptr);
+	if (endptr == s.c_str() || *endptr != '-')
+		return false;
+
+	const char *p = endptr + 1;
+	if (*p == 0) {
+		end = UINT_LEAST64_MAX;
+		return true;
+	}
+
+	end = ParseUint64(p, &endptr);
+	return endptr != p && *endptr == 0 && end >= start;
+}
+
+inline void
+DelayHttpServer::Connection::HandleRequest() noexcept
+{
+	assert(!busy);
+
+	const auto end_of_headers = input.find("\r\n\r\n"sv);
+	if (end_of_headers == input.npos)
+		return;
+
+	const std::string_view request{input.data(), end_of_headers + 2};
+
+	bool have_range = false;
+	uint_least64_t start = 0, end = 0;
+
+	/* skip the request line; all URIs refer to the same file,
+	   and methods other than GET are not expected */
+	for (auto i = request.find("\r\n"sv); i + 2 < request.size();) {
+		const auto next = request.find("\r\n"sv, i + 2);
+		std::string_view line = request.substr(i + 2, next - i - 2);
+		i = next;
+
+		if (StringStartsWithIgnoreCase(line, "range:"sv)) {
+			line = Strip(line.substr(6));
+			have_range = ParseRange(line, start, end);
+		}
+	}
+
+	input.erase(0, end_of_headers + 4);
+	++server.n_requests;
+
+	const auto file_size = server.file_size;
+
+	if (!have_range) {
+		body_offset = 0;
+		body_end = file_size;
+		header = fmt::format("HTTP/1.1 200 OK\r\n"
+				     "Content-Type: application/octet-stream\r\n"
+				     "Content-Length: {}\r\n"
+				     "Accept-Ranges: bytes\r\n"
+				     "\r\n",
+				     file_size);
+	} else if (start >= file_size) {
+		body_offset = body_end = 0;
+		header = fmt::format("HTTP/1.1 416 Range Not Satisfiable\r\n"
+				     "Content-Range: bytes */{}\r\n"
+				     "Content-Length: 0\r\n"
+				     "\r\n",
+				     file_size);
+	} else {
+		end = std::min(end, file_size - 1);
+		body_offset = start;
+		body_end = end + 1;
+		header = fmt::format("HTTP/1.1 206 Partial Content\r\n"
+				     "Content-Type: application/octet-stream\r\n"
+				     "Content-Length: {}\r\n"
+				     "Content-Range: bytes {}-{}/{}\r\n"
+				     "\r\n",
+				     body_end - body_offset,
+				     start, end, file_size);
+	}
+
+	header_position = 0;
+	busy = true;
+	delay_timer.Schedule(server.latency);
+}
+
+inline bool
+DelayHttpServer::Connection::SendResponse() noexcept
+{
+	const auto s = event.GetSocket();
+
+	while (header_position < header.size()) {
+		const auto src = std::as_bytes(std::span{header}).subspan(header_position);
+		const auto nbytes = s.WriteNoWait(src);
+		if (nbytes < 0) {
+			if (IsSocketErrorSendWouldBlock(GetSocketError()))
+				return true;
+
+			Destroy();
+			return false;
+		}
+
+		header_position += nbytes;
+	}
+
+	while (body_offset < body_end) {
+		std::byte buffer[16 * 1024];
+		const std::size_t length =
+			std::min<uint_least64_t>(body_end - body_offset,
+						 sizeof(buffer));
+		for (std::size_t i = 0; i < length; ++i)
+			buffer[i] = PatternAt(body_offset + i);
+
+		const auto nbytes = s.WriteNoWait({buffer, length});
+		if (nbytes < 0) {
+			if (IsSocketErrorSendWouldBlock(GetSocketError()))
+				return true;
+
+			Destroy();
+			return false;
+		}
+
+		body_offset += nbytes;
+
+		if (server.bandwidth > 0) {
+			/* wait until this chunk is "allowed" */
+			event.CancelWrite();
+			delay_timer.Schedule(std::chrono::microseconds(nbytes * 1000000 / server.bandwidth));
+			return true;
+		}
+	}
+
+	/* the response is complete; wait for the next request */
+	busy = false;
+	event.CancelWrite();
+	HandleRequest();
+	return true;
+}
+
+void
+DelayHttpServer::Connection::OnSocketReady(unsigned flags) noexcept
+{
+	if (flags & SocketEvent::WRITE) {
+		if (!SendResponse())
+			return;
+	}
+
+	if (flags & (SocketEvent::READ|SocketEvent::HANGUP|SocketEvent::ERROR)) {
+		char buffer[4096];
+		const auto nbytes = event.GetSocket().ReadNoWait(std::as_writable_bytes(std::span{buffer}));
+		if (nbytes < 0 &&
+		    IsSocketErrorReceiveWouldBlock(GetSocketError()))
+			return;
+
+		if (nbytes <= 0) {
+			/* the client has closed the connection (or
+			   failed) */
+			Destroy();
+			return;
+		}
+
+		input.append(buffer, nbytes);
+
+		if (!busy)
+			HandleRequest();
+	}
+}
+
+DelayHttpServer::DelayHttpServer(EventLoop &_event_loop,
+				 uint_least64_t _file_size,
+				 Event::Duration _latency,
+				 std::size_t _bandwidth)
+	:event_loop(_event_loop),
+	 listener(event_loop, BIND_THIS_METHOD(OnAccept)),
+	 file_size(_file_size), latency(_latency), bandwidth(_bandwidth)
+{
+	auto fd = socket_bind_listen(AF_INET, SOCK_STREAM, 0,
+				     IPv4Address{IPv4Address::Loopback(), 0},
+				     16);
+	port = fd.GetLocalAddress().GetPort();
+
+	listener.Open(fd.Release());
+	listener.ScheduleRead();
+}
+
+DelayHttpServer::~DelayHttpServer() noexcept
+{
+	connections.clear_and_dispose(DeleteDisposer{});
+	listener.Close();
+}
+
+std::string
+DelayHttpServer::GetURL() const noexcept
+{
+	return fmt::format("http://127.0.0.1:{}/file", port);
+}
+
+void
+DelayHttpServer::OnAccept(unsigned) noexcept
+{
+	UniqueSocketDescriptor fd{listener.GetSocket().AcceptNonBlock()};
+	if (!fd.IsDefined())
+		return;
+
+	++n_connections;
+
+	auto *c = new Connection(*this, std::move(fd));
+	connections.push_back(*c);
+}
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_TEST_DELAY_HTTP_SERVER_HXX
+#define MPD_TEST_DELAY_HTTP_SERVER_HXX
+
+#include "event/SocketEvent.hxx"
+#include "event/Chrono.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * A minimal HTTP/1.1 server for testing HTTP clients on a
+ * high-latency link.  It serves a generated file (see PatternAt())
+ * at every URI, supports persistent connections and "Range"
+ * requests, and waits for a configurable time before responding to
+ * each request.  Optionally, the bandwidth of each connection is
+ * limited, like TCP on a high-latency link.
+ *
+ * It listens on an ephemeral port on the IPv4 loopback address.  All
+ * methods except the getters must be called in the #EventLoop
+ * thread.
+ */
+class DelayHttpServer final {
+	class Connection;
+
+	EventLoop &event_loop;
+
+	SocketEvent listener;
+
+	IntrusiveList<Connection> connections;
+
+	const uint_least64_t file_size;
+
+	const Event::Duration latency;
+
+	/**
+	 * The maximum number of bytes per second sent on each
+	 * connection; 0 means unlimited.
+	 */
+	const std::size_t bandwidth;
+
+	unsigned port;
+
+	std::atomic_uint n_connections{0}, n_requests{0};
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param _file_size the size of the generated file
+	 * @param _latency the delay before each response
+	 * @param _bandwidth the maximum number of bytes per second
+	 * sent on each connection; 0 means unlimited
+	 */
+	DelayHttpServer(EventLoop &_event_loop, uint_least64_t _file_size,
+			Event::Duration _latency, std::size_t _bandwidth=0);
+
+	~DelayHttpServer() noexcept;
+
+	DelayHttpServer(const DelayHttpServer &) = delete;
+	DelayHttpServer &operator=(const DelayHttpServer &) = delete;
+
+	/**
+	 * The contents of the generated file.
+	 */
+	static constexpr std::byte PatternAt(uint_least64_t offset) noexcept {
+		return std::byte(offset * 7 + offset / 251);
+	}
+
+	std::string GetURL() const noexcept;
+
+	/**
+	 * The number of connections which have been accepted.
+	 */
+	unsigned GetConnectionCount() const noexcept {
+		return n_connections;
+	}
+
+	/**
+	 * The number of requests which have been received.
+	 */
+	unsigned GetRequestCount() const noexcept {
+		return n_requests;
+	}
+
+private:
+	void OnAccept(unsigned flags) noexcept;
+};
+
+#endif
@@ -3,25 +3,66 @@
 
 #include "config.h"
 #include "db/plugins/simple/DatabaseSave.hxx"
+#include "db/plugins/simple/DatabaseBinary.hxx"
 #include "db/plugins/simple/Directory.hxx"
 #include "lib/zlib/AutoGunzipFileLineReader.hxx"
+#include "io/BufferedOutputStream.hxx"
+#include "io/FileOutputStream.hxx"
+#include "io/MappedFile.hxx"
 #include "fs/Path.hxx"
 #include "fs/NarrowPath.hxx"
 #include "util/PrintException.hxx"
+#include "util/StringAPI.hxx"
+
+#include <chrono>
+
+static void
+Save(Path path, const Directory &root, bool binary)
+{
+	FileOutputStream fos{path};
+	BufferedOutputStream bos{fos};
+
+	if (binary)
+		db_save_binary(bos, root);
+	else
+		db_save_internal(bos, root);
+
+	bos.Flush();
+	fos.Commit();
+}
 
 int
 main(int argc, char **argv)
 try {
-	if (argc != 2) {
-		fprintf(stderr, "Usage: LoadDatabase PATH\n");
+	if (argc != 2 && argc != 4) {
+		fprintf(stderr, "Usage: LoadDatabase PATH [OUTPUT_PATH text|binary]\n");
 		return EXIT_FAILURE;
 	}
 
 	const FromNarrowPath db_path = argv[1];
 
 	Directory root{{}, nullptr};
-	AutoGunzipFileLineReader line_reader{db_path};
-	db_load_internal(line_reader, root, true);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	{
+		const MappedFile mapped{db_path};
+		if (db_is_binary(mapped.GetData())) {
+			db_load_binary(mapped.GetData(), root, true);
+		} else {
+			AutoGunzipFileLineReader line_reader{db_path};
+			db_load_internal(line_reader, root, true);
+		}
+	}
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+	fprintf(stderr, "Loaded in %.3fs\n", duration.count());
+
+	if (argc == 4) {
+		const FromNarrowPath output_path = argv[2];
+		Save(output_path, root, StringIsEqual(argv[3], "binary"));
+	}
 
 	return EXIT_SUCCESS;
 } catch (...) {
@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Run concurrent database queries from several threads while the
+ * database is being updated over and over, and verify that all
+ * queries return consistent results.  Build with assertions enabled
+ * to check the database locking rules.
+ */
+
+#include "db/update/Walk.hxx"
+#include "db/update/Config.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "db/DatabaseListener.hxx"
+#include "db/Selection.hxx"
+#include "db/Stats.hxx"
+#include "song/LightSong.hxx"
+#include "song/Filter.hxx"
+#include "storage/plugins/LocalStorage.hxx"
+#include "storage/StorageInterface.hxx"
+#include "config/Block.hxx"
+#include "config/Data.hxx"
+#include "decoder/DecoderList.hxx"
+#include "input/Init.hxx"
+#include "event/Thread.hxx"
+#include "thread/Thread.hxx"
+#include "fs/Path.hxx"
+#include "fs/NarrowPath.hxx"
+#include "util/PrintException.hxx"
+#include "util/RecursiveMap.hxx"
+#include "SyntheticTree.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+class NullDatabaseListener final : public DatabaseListener {
+public:
+	void OnDatabaseModified() noexcept override {}
+	void OnDatabaseSongRemoved(const char *) noexcept override {}
+};
+
+using Clock = std::chrono::steady_clock;
+
+static std::atomic_bool quit, failed;
+
+static void
+Fail(const char *msg) noexcept
+{
+	fprintf(stderr, "FAILED: %s\n", msg);
+	failed = true;
+}
+
+/**
+ * A thread which runs database queries in a loop.
+ */
+class Reader {
+	const Database &db;
+	const unsigned id;
+	const unsigned n_directories;
+
+	Thread thread{BIND_THIS_METHOD(Run)};
+
+public:
+	unsigned n_queries = 0;
+	Clock::duration max_latency{};
+	Clock::duration total_latency{};
+
+	Reader(const Database &_db, unsigned _id,
+	       unsigned _n_directories) noexcept
+		:db(_db), id(_id), n_directories(_n_directories) {}
+
+	void Start() {
+		thread.Start();
+	}
+
+	void Join() noexcept {
+		thread.Join();
+	}
+
+private:
+	void Query(unsigned i);
+	void Run() noexcept;
+};
+
+inline void
+Reader::Query(unsigned i)
+{
+	switch (i % 4) {
+	case 0: {
+		/* walk the whole database */
+		unsigned n = 0;
+		db.Visit(DatabaseSelection("", true, nullptr),
+			 [&n](const LightSong &song){
+				 if (song.directory == nullptr ||
+				     strncmp(song.directory, "album", 5) != 0)
+					 Fail("Bad song directory");
+				 ++n;
+			 });
+		break;
+	}
+
+	case 1: {
+		/* search within one directory */
+		const std::string base = "album" + std::to_string(i % n_directories);
+
+		SongFilter filter;
+		const char *args[] = {"base", base.c_str()};
+		filter.Parse(args);
+
+		db.Visit(DatabaseSelection("", true, &filter),
+			 [&base](const LightSong &song){
+				 if (song.directory == nullptr ||
+				     base != song.directory)
+					 Fail("Song does not match filter");
+			 });
+		break;
+	}
+
+	case 2: {
+		static constexpr TagType types[] = {TAG_ALBUM};
+		db.CollectUniqueTags(DatabaseSelection("", true, nullptr),
+				     types);
+		break;
+	}
+
+	case 3: {
+		const auto stats = db.GetStats(DatabaseSelection("", true, nullptr));
+		if (stats.album_count > stats.song_count)
+			Fail("More albums than songs");
+		break;
+	}
+	}
+}
+
+void
+Reader::Run() noexcept
+{
+	for (unsigned i = id; !quit; ++i) {
+		const auto start = Clock::now();
+
+		try {
+			Query(i);
+		} catch (...) {
+			/* a directory may disappear while it is being
+			   queried; that's fine */
+		}
+
+		const auto latency = Clock::now() - start;
+		total_latency += latency;
+		max_latency = std::max(max_latency, latency);
+		++n_queries;
+	}
+}
+
+static double
+ToMS(Clock::duration d) noexcept
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc < 4 || argc > 6) {
+		fprintf(stderr, "Usage: StressDatabase SAMPLE_FILE N_DIRECTORIES N_FILES [N_READERS [SECONDS]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const char *sample = argv[1];
+	const unsigned n_directories = strtoul(argv[2], nullptr, 10);
+	const unsigned n_files = strtoul(argv[3], nullptr, 10);
+	const unsigned n_readers = argc > 4 ? strtoul(argv[4], nullptr, 10) : 4;
+	const std::chrono::seconds duration(argc > 5 ? strtoul(argv[5], nullptr, 10) : 10);
+
+	if (n_directories == 0)
+		throw std::runtime_error("Need at least one directory");
+
+	EventThread io_thread;
+	io_thread.Start();
+	auto &event_loop = io_thread.GetEventLoop();
+
+	const ScopeInputPluginsInit input_plugins_init(ConfigData(),
+						       event_loop);
+	const ScopeDecoderPluginsInit decoder_plugins_init({});
+
+	SyntheticTree tree(sample, n_directories, n_files);
+	const auto storage = CreateLocalStorage(FromNarrowPath(tree.GetBase()));
+
+	const std::string db_path = std::string(tree.GetBase()) + ".db";
+
+	ConfigBlock block;
+	block.AddBlockParam("path", db_path);
+	block.AddBlockParam("tag_index", "artist,album,genre");
+
+	NullDatabaseListener listener;
+	auto db_ptr = SimpleDatabase::Create(event_loop, event_loop,
+					     listener, block);
+	auto &db = static_cast<SimpleDatabase &>(*db_ptr);
+	db.Open();
+
+	ConfigData config_data;
+	UpdateConfig config{config_data};
+	config.threads = 2;
+
+	std::list<Reader> readers;
+	for (unsigned i = 0; i < n_readers; ++i)
+		readers.emplace_back(db, i, n_directories).Start();
+
+	unsigned n_rounds = 0;
+	Clock::duration max_walk{};
+
+	const auto end = Clock::now() + duration;
+	while (Clock::now() < end && !failed) {
+		/* remove or restore one directory per round, and
+		   rescan all files every other round */
+		const unsigned d = n_rounds % n_directories;
+		if (tree.HasDirectory(d))
+			tree.RemoveDirectory(d);
+		else
+			tree.CreateDirectory(d);
+
+		const auto start = Clock::now();
+
+		{
+			UpdateWalk walk(config, event_loop, listener, *storage);
+			walk.Walk(db.GetRoot(), db.GetTagIndex(), nullptr,
+				  n_rounds % 2 == 1);
+		}
+
+		max_walk = std::max(max_walk, Clock::now() - start);
+		++n_rounds;
+	}
+
+	quit = true;
+
+	unsigned n_queries = 0;
+	Clock::duration max_latency{}, total_latency{};
+	for (auto &reader : readers) {
+		reader.Join();
+		n_queries += reader.n_queries;
+		total_latency += reader.total_latency;
+		max_latency = std::max(max_latency, reader.max_latency);
+	}
+
+	db.Close();
+	unlink(db_path.c_str());
+
+	printf("rounds=%u max_walk=%.1fms queries=%u avg_latency=%.2fms max_latency=%.1fms\n",
+	       n_rounds, ToMS(max_walk), n_queries,
+	       n_queries > 0 ? ToMS(total_latency) / n_queries : 0.,
+	       ToMS(max_latency));
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,357 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Connect many simulated listeners to an HTTP stream (e.g. the
+ * "httpd" output of MPD or of run_output) and measure how fast each
+ * of them receives data.  Fast listeners read everything as soon as
+ * it arrives; slow listeners have a tiny socket receive buffer and
+ * read only a limited number of bytes per second, so the server has
+ * to keep pages for them or skip pages.
+ *
+ * Example (with "pv" feeding the output in real time):
+ *
+ *   pv -qL 176400 </dev/urandom | run_output httpd.conf httpd 44100:16:2 &
+ *   StressHttpd localhost:8000 450 50
+ */
+
+#include "event/Loop.hxx"
+#include "event/SocketEvent.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "net/AddressInfo.hxx"
+#include "net/Resolver.hxx"
+#include "net/SocketError.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/BindMethod.hxx"
+#include "util/PrintException.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <stdexcept>
+#include <string_view>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+using std::string_view_literals::operator""sv;
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * How often slow listeners read from their sockets.
+ */
+static constexpr Event::Duration SLOW_TICK = std::chrono::milliseconds(100);
+
+/**
+ * The number of connections which may be established at the same
+ * time; the server's listen backlog is small, and exceeding it would
+ * delay connections by the kernel's SYN retransmission timeout.
+ */
+static constexpr unsigned MAX_CONNECTING = 4;
+
+class Listener {
+	SocketEvent event;
+
+	/**
+	 * Invoked after the connection has been established (or has
+	 * failed).
+	 */
+	const BoundMethod<void() noexcept> on_connected;
+
+	/**
+	 * Reads data periodically (only for slow listeners).
+	 */
+	FineTimerEvent timer;
+
+	/**
+	 * The number of bytes per second this listener reads; 0
+	 * means unlimited.
+	 */
+	const std::size_t rate;
+
+	/**
+	 * When the request was sent.
+	 */
+	Clock::time_point start{};
+
+	Clock::time_point first_byte{};
+
+	std::size_t received = 0;
+
+	bool closed = false;
+
+public:
+	Listener(EventLoop &loop, const AddressInfo &address, std::size_t _rate,
+		 BoundMethod<void() noexcept> _on_connected)
+		:event(loop, BIND_THIS_METHOD(OnSocketReady)),
+		 on_connected(_on_connected),
+		 timer(loop, BIND_THIS_METHOD(OnTimer)),
+		 rate(_rate)
+	{
+		UniqueSocketDescriptor fd;
+		if (!fd.CreateNonBlock(address.GetFamily(), address.GetType(),
+				       address.GetProtocol()))
+			throw MakeSocketError("Failed to create socket");
+
+		if (rate > 0)
+			/* let the server notice quickly that this
+			   listener doesn't keep up */
+			fd.SetIntOption(SOL_SOCKET, SO_RCVBUF, 4096);
+
+		if (!fd.Connect(address) &&
+		    !IsSocketErrorConnectWouldBlock(GetSocketError()))
+			throw MakeSocketError("Failed to connect");
+
+		event.Open(fd.Release());
+		event.ScheduleWrite();
+	}
+
+	~Listener() noexcept {
+		event.Close();
+	}
+
+	Listener(const Listener &) = delete;
+	Listener &operator=(const Listener &) = delete;
+
+	bool IsSlow() const noexcept {
+		return rate > 0;
+	}
+
+	bool IsClosed() const noexcept {
+		return closed;
+	}
+
+	/**
+	 * The average number of bytes per second received so far.
+	 */
+	double GetRate(Clock::time_point now) const noexcept {
+		return received > 0
+			? received / std::chrono::duration<double>(now - start).count()
+			: 0;
+	}
+
+	/**
+	 * The time until the first byte was received (including the
+	 * response headers).
+	 */
+	std::chrono::duration<double> GetFirstByteDelay() const noexcept {
+		return received > 0 ? first_byte - start : Clock::duration{};
+	}
+
+private:
+	/**
+	 * Read up to the given number of bytes.
+	 */
+	void Read(std::size_t limit) noexcept {
+		std::byte buffer[16384];
+
+		while (limit > 0) {
+			const auto nbytes = event.GetSocket().ReadNoWait({buffer, std::min(limit, sizeof(buffer))});
+			if (nbytes < 0 && IsSocketErrorReceiveWouldBlock(GetSocketError()))
+				break;
+
+			if (nbytes <= 0) {
+				Fail();
+				break;
+			}
+
+			if (received == 0)
+				first_byte = Clock::now();
+
+			received += nbytes;
+			limit -= nbytes;
+		}
+	}
+
+	void Fail() noexcept {
+		closed = true;
+		timer.Cancel();
+		event.Close();
+	}
+
+	/**
+	 * The connection has been established (or has failed); send
+	 * the request.
+	 */
+	void OnConnected() noexcept {
+		static constexpr auto request = "GET / HTTP/1.1\r\n\r\n"sv;
+
+		on_connected();
+
+		if (event.GetSocket().GetError() != 0 ||
+		    event.GetSocket().WriteNoWait(std::as_bytes(std::span{request})) != (ssize_t)request.size()) {
+			Fail();
+			return;
+		}
+
+		start = Clock::now();
+
+		if (rate > 0) {
+			event.Cancel();
+			timer.Schedule(SLOW_TICK);
+		} else
+			event.Schedule(SocketEvent::READ);
+	}
+
+	void OnSocketReady(unsigned flags) noexcept {
+		if (flags & SocketEvent::WRITE) {
+			OnConnected();
+			return;
+		}
+
+		/* read only one buffer at a time, to be fair to the
+		   other listeners */
+		Read(16384);
+	}
+
+	void OnTimer() noexcept {
+		Read(rate * std::chrono::duration_cast<std::chrono::milliseconds>(SLOW_TICK).count() / 1000);
+
+		if (!closed)
+			timer.Schedule(SLOW_TICK);
+	}
+};
+
+/**
+ * Creates all #Listener instances, but lets only #MAX_CONNECTING of
+ * them connect at a time.
+ */
+class Connector {
+	EventLoop &loop;
+	const AddressInfo &address;
+
+	std::list<Listener> &listeners;
+
+	unsigned n_fast, n_slow;
+	const std::size_t slow_rate;
+
+	unsigned n_connecting = 0;
+
+	/**
+	 * Alternate between fast and slow listeners, so they are
+	 * spread over the server's client list.
+	 */
+	bool next_slow = false;
+
+public:
+	Connector(EventLoop &_loop, const AddressInfo &_address,
+		  std::list<Listener> &_listeners,
+		  unsigned _n_fast, unsigned _n_slow,
+		  std::size_t _slow_rate) noexcept
+		:loop(_loop), address(_address), listeners(_listeners),
+		 n_fast(_n_fast), n_slow(_n_slow), slow_rate(_slow_rate) {}
+
+	/**
+	 * Throws on error.
+	 */
+	void ConnectMore() {
+		while (n_connecting < MAX_CONNECTING && n_fast + n_slow > 0) {
+			const bool slow = n_fast == 0 || (n_slow > 0 && next_slow);
+			next_slow = !slow;
+
+			listeners.emplace_back(loop, address, slow ? slow_rate : 0,
+					       BIND_THIS_METHOD(OnConnected));
+			++n_connecting;
+
+			if (slow)
+				--n_slow;
+			else
+				--n_fast;
+		}
+	}
+
+private:
+	void OnConnected() noexcept {
+		--n_connecting;
+
+		try {
+			ConnectMore();
+		} catch (...) {
+			PrintException(std::current_exception());
+			loop.Break();
+		}
+	}
+};
+
+static void
+PrintStatistics(const char *name, const std::list<Listener> &listeners,
+		bool slow, Clock::time_point now)
+{
+	unsigned n = 0, n_closed = 0;
+	double sum = 0, min = 0, max = 0;
+	std::chrono::duration<double> first_byte{};
+
+	for (const auto &i : listeners) {
+		if (i.IsSlow() != slow)
+			continue;
+
+		const double rate = i.GetRate(now);
+		sum += rate;
+		min = n == 0 ? rate : std::min(min, rate);
+		max = std::max(max, rate);
+		first_byte = std::max(first_byte, i.GetFirstByteDelay());
+
+		++n;
+		if (i.IsClosed())
+			++n_closed;
+	}
+
+	if (n == 0)
+		return;
+
+	printf("listeners=%s n=%u closed=%u bytes_per_second_avg=%.0f min=%.0f max=%.0f max_first_byte_ms=%.1f\n",
+	       name, n, n_closed, sum / n, min, max,
+	       first_byte.count() * 1000);
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc < 4 || argc > 6) {
+		fprintf(stderr, "Usage: StressHttpd HOST:PORT N_FAST N_SLOW [SECONDS [SLOW_RATE]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned n_fast = strtoul(argv[2], nullptr, 10);
+	const unsigned n_slow = strtoul(argv[3], nullptr, 10);
+	const unsigned seconds = argc > 4
+		? strtoul(argv[4], nullptr, 10)
+		: 10;
+
+	/* the default is a bit less than a 128 kbit/s stream needs */
+	const std::size_t slow_rate = argc > 5
+		? strtoul(argv[5], nullptr, 10)
+		: 12000;
+
+	if (n_fast + n_slow == 0 || seconds == 0 || slow_rate == 0)
+		throw std::runtime_error("Invalid parameters");
+
+	const auto addresses = Resolve(argv[1], 8000, 0, SOCK_STREAM);
+	const auto &address = addresses.GetBest();
+
+	EventLoop loop;
+
+	std::list<Listener> listeners;
+	Connector connector(loop, address, listeners,
+			    n_fast, n_slow, slow_rate);
+	connector.ConnectMore();
+
+	CoarseTimerEvent stop(loop, BIND_METHOD(loop, &EventLoop::Break));
+	stop.Schedule(std::chrono::seconds(seconds));
+	loop.Run();
+
+	const auto now = Clock::now();
+	PrintStatistics("fast", listeners, false, now);
+	PrintStatistics("slow", listeners, true, now);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_TEST_SYNTHETIC_TREE_HXX
+#define MPD_TEST_SYNTHETIC_TREE_HXX
+
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+inline void
+CopyFile(const char *src, const char *dest)
+{
+	if (link(src, dest) == 0)
+		return;
+
+	/* fall back to copying if hard links are not supported */
+
+	const int in = open(src, O_RDONLY);
+	if (in < 0)
+		throw std::runtime_error("Failed to open sample file");
+
+	const int out = open(dest, O_WRONLY|O_CREAT|O_EXCL, 0666);
+	if (out < 0) {
+		close(in);
+		throw std::runtime_error("Failed to create file");
+	}
+
+	char buffer[65536];
+	ssize_t nbytes;
+	while ((nbytes = read(in, buffer, sizeof(buffer))) > 0)
+		if (write(out, buffer, nbytes) != nbytes)
+			break;
+
+	close(out);
+	close(in);
+}
+
+/**
+ * Creates a directory tree with #n_directories directories, each
+ * containing #n_files copies of a sample file.
+ */
+class SyntheticTree {
+	std::string sample;
+	std::string base;
+	std::string suffix;
+	unsigned n_directories, n_files;
+
+public:
+	SyntheticTree(const char *_sample, unsigned _n_directories,
+		      unsigned _n_files)
+		:sample(_sample),
+		 n_directories(_n_directories), n_files(_n_files)
+	{
+		const char *dot = strrchr(_sample, '.');
+		if (dot == nullptr)
+			throw std::runtime_error("Sample file has no suffix");
+		suffix = dot;
+
+		char tmpl[] = "/tmp/mpd-synthetic-XXXXXX";
+		if (mkdtemp(tmpl) == nullptr)
+			throw std::runtime_error("mkdtemp() failed");
+		base = tmpl;
+
+		for (unsigned d = 0; d < n_directories; ++d)
+			CreateDirectory(d);
+	}
+
+	~SyntheticTree() noexcept {
+		for (unsigned d = 0; d < n_directories; ++d)
+			RemoveDirectory(d);
+
+		rmdir(base.c_str());
+	}
+
+	const char *GetBase() const noexcept {
+		return base.c_str();
+	}
+
+	unsigned GetDirectoryCount() const noexcept {
+		return n_directories;
+	}
+
+	bool HasDirectory(unsigned d) const noexcept {
+		struct stat st;
+		return stat(GetDirectory(d).c_str(), &st) == 0;
+	}
+
+	void CreateDirectory(unsigned d) {
+		const auto dir = GetDirectory(d);
+		if (mkdir(dir.c_str(), 0777) < 0)
+			throw std::runtime_error("mkdir() failed");
+
+		for (unsigned f = 0; f < n_files; ++f)
+			CopyFile(sample.c_str(), GetFile(dir, f).c_str());
+	}
+
+	void RemoveDirectory(unsigned d) noexcept {
+		const auto dir = GetDirectory(d);
+		for (unsigned f = 0; f < n_files; ++f)
+			unlink(GetFile(dir, f).c_str());
+		rmdir(dir.c_str());
+	}
+
+private:
+	std::string GetDirectory(unsigned d) const noexcept {
+		return base + "/album" + std::to_string(d);
+	}
+
+	std::string GetFile(const std::string &dir, unsigned f) const noexcept {
+		return dir + "/track" + std::to_string(f) + suffix;
+	}
+};
+
+#endif
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "client/CommandPool.hxx"
+#include "event/Call.hxx"
+#include "event/InjectEvent.hxx"
+#include "event/Thread.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+/**
+ * A job which blocks in Run() until Release() is called.
+ */
+class GateJob final : public CommandPoolJob {
+	Mutex mutex;
+	Cond cond;
+
+	bool running = false, released = false, finished = false;
+
+public:
+	unsigned n_runs = 0;
+
+	void WaitRunning() noexcept {
+		std::unique_lock lock{mutex};
+		cond.wait(lock, [this]{ return running; });
+	}
+
+	void Release() noexcept {
+		const std::scoped_lock lock{mutex};
+		released = true;
+		cond.notify_all();
+	}
+
+	void WaitFinished() noexcept {
+		std::unique_lock lock{mutex};
+		cond.wait(lock, [this]{ return finished; });
+	}
+
+private:
+	/* virtual methods from class CommandPoolJob */
+	void Run() noexcept override {
+		std::unique_lock lock{mutex};
+		++n_runs;
+		running = true;
+		cond.notify_all();
+		cond.wait(lock, [this]{ return released; });
+	}
+
+	void OnFinished() noexcept override {
+		const std::scoped_lock lock{mutex};
+		finished = true;
+		cond.notify_all();
+	}
+};
+
+TEST(CommandPool, Push)
+{
+	CommandPool pool{2};
+
+	GateJob job;
+	job.Release();
+	pool.Push(job);
+	job.WaitFinished();
+
+	EXPECT_TRUE(pool.Remove(job));
+	EXPECT_EQ(job.n_runs, 1U);
+}
+
+TEST(CommandPool, RemoveQueued)
+{
+	CommandPool pool{1};
+
+	/* occupy the only thread */
+	GateJob a;
+	pool.Push(a);
+	a.WaitRunning();
+
+	GateJob b;
+	pool.Push(b);
+	EXPECT_TRUE(pool.Remove(b));
+
+	a.Release();
+	a.WaitFinished();
+	EXPECT_TRUE(pool.Remove(a));
+
+	/* b was removed from the queue, so it never runs */
+	pool.Stop();
+	EXPECT_EQ(b.n_runs, 0U);
+}
+
+TEST(CommandPool, RemoveRunning)
+{
+	CommandPool pool{1};
+
+	GateJob job;
+	pool.Push(job);
+	job.WaitRunning();
+
+	/* Remove() must not wait for a running job */
+	EXPECT_FALSE(pool.Remove(job));
+	EXPECT_FALSE(pool.Remove(job));
+
+	job.Release();
+	job.WaitFinished();
+	EXPECT_TRUE(pool.Remove(job));
+	EXPECT_EQ(job.n_runs, 1U);
+}
+
+/**
+ * A job which is disposed like PooledCommand: OnFinished() defers
+ * the completion to the #EventLoop, and if the client is closed
+ * earlier, Abandon() either disposes of it right away or leaves
+ * that to DeferredFinish().
+ */
+class AbandonJob final : public CommandPoolJob {
+	CommandPool &pool;
+
+	InjectEvent defer_finish;
+
+	std::atomic_uint &n_disposed;
+
+	const unsigned spin;
+
+	/**
+	 * Has Abandon() been called?  Only accessed in the
+	 * #EventLoop thread.
+	 */
+	bool abandoned = false;
+
+public:
+	AbandonJob(EventLoop &event_loop, CommandPool &_pool,
+		   std::atomic_uint &_n_disposed, unsigned _spin) noexcept
+		:pool(_pool),
+		 defer_finish(event_loop, BIND_THIS_METHOD(DeferredFinish)),
+		 n_disposed(_n_disposed), spin(_spin) {}
+
+	~AbandonJob() noexcept {
+		++n_disposed;
+	}
+
+	/**
+	 * @return true if the caller shall delete this object
+	 */
+	bool Abandon() noexcept {
+		abandoned = true;
+
+		if (!pool.Remove(*this))
+			return false;
+
+		defer_finish.Cancel();
+		return true;
+	}
+
+private:
+	void DeferredFinish() noexcept {
+		EXPECT_TRUE(abandoned);
+		EXPECT_TRUE(pool.Remove(*this));
+		delete this;
+	}
+
+	/* virtual methods from class CommandPoolJob */
+	void Run() noexcept override {
+		const auto until = std::chrono::steady_clock::now() +
+			std::chrono::microseconds(spin);
+		while (std::chrono::steady_clock::now() < until) {}
+	}
+
+	void OnFinished() noexcept override {
+		defer_finish.Schedule();
+	}
+};
+
+TEST(CommandPool, AbandonRace)
+{
+	EventThread thread;
+	thread.Start();
+
+	CommandPool pool{4};
+
+	constexpr unsigned N = 2000;
+	std::atomic_uint n_disposed{0};
+
+	for (unsigned i = 0; i < N; ++i) {
+		BlockingCall(thread.GetEventLoop(), [&, i]{
+			auto *job = new AbandonJob(thread.GetEventLoop(),
+						   pool, n_disposed,
+						   i % 7 * 10);
+			pool.Push(*job);
+
+			/* let the job get queued, start running or
+			   finish (and schedule DeferredFinish())
+			   before the client is closed */
+			const auto until = std::chrono::steady_clock::now() +
+				std::chrono::microseconds(i % 5 * 10);
+			while (std::chrono::steady_clock::now() < until) {}
+
+			if (job->Abandon())
+				delete job;
+		});
+	}
+
+	/* each job is disposed of exactly once, either by Abandon()
+	   or by DeferredFinish() */
+	for (unsigned i = 0; i < 500 && n_disposed < N; ++i)
+		std::this_thread::sleep_for(10ms);
+
+	EXPECT_EQ(n_disposed, N);
+
+	pool.Stop();
+}
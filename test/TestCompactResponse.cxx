@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "CompactDecoder.hxx"
+#include "client/CompactEncoder.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using Attributes = std::vector<CompactDecoder::Attribute>;
+
+static Attributes
+RoundTrip(std::string_view text, std::size_t piece_size)
+{
+	CompactEncoder encoder;
+	while (!text.empty()) {
+		const auto piece = text.substr(0, piece_size);
+		encoder.Feed(piece);
+		text.remove_prefix(piece.size());
+	}
+
+	encoder.Finish();
+
+	/* decode the output in pieces, too */
+	CompactDecoder decoder;
+	Attributes result;
+	auto output = encoder.GetOutput();
+	while (!output.empty()) {
+		const auto piece = output.substr(0, piece_size);
+		decoder.Feed(piece, result);
+		output.remove_prefix(piece.size());
+	}
+
+	EXPECT_TRUE(decoder.IsComplete());
+	return result;
+}
+
+TEST(CompactResponse, RoundTrip)
+{
+	std::string text;
+	Attributes expected;
+	for (unsigned i = 0; i < 100; ++i) {
+		const std::string uri = "dir/" + std::to_string(i) + ".flac";
+		text += "file: " + uri + "\n";
+		expected.emplace_back("file", uri);
+
+		text += "Title: Song " + std::to_string(i) + "\n";
+		expected.emplace_back("Title", "Song " + std::to_string(i));
+
+		if (i % 3 == 0) {
+			/* a value longer than 127 bytes */
+			const std::string comment(300 + i, 'x');
+			text += "Comment: " + comment + "\n";
+			expected.emplace_back("Comment", comment);
+		}
+
+		text += "Time: 42\n";
+		expected.emplace_back("Time", "42");
+	}
+
+	/* a line without a value, and an empty value */
+	text += "list_OK\nArtist: \n";
+	expected.emplace_back("list_OK", "");
+	expected.emplace_back("Artist", "");
+
+	for (const std::size_t piece_size : {1U, 7U, 4096U})
+		EXPECT_EQ(RoundTrip(text, piece_size), expected);
+}
+
+TEST(CompactResponse, ManyKeys)
+{
+	/* more keys than there are ids */
+	std::string text;
+	Attributes expected;
+	for (unsigned i = 0; i < 600; ++i) {
+		const std::string key = "Key" + std::to_string(i % 300);
+		text += key + ": " + std::to_string(i) + "\n";
+		expected.emplace_back(key, std::to_string(i));
+	}
+
+	EXPECT_EQ(RoundTrip(text, 4096), expected);
+}
+
+TEST(CompactResponse, Response)
+{
+	CompactEncoder encoder;
+	encoder.Feed("file: a.flac\nTime: 1\n");
+	encoder.Finish();
+	const auto payload = encoder.GetOutput();
+
+	/* split the payload into two "binary" chunks */
+	std::string response;
+	response += "binary: 5\n";
+	response += payload.substr(0, 5);
+	response += "\nbinary: " + std::to_string(payload.size() - 5) + "\n";
+	response += payload.substr(5);
+	response += "\nOK\n";
+
+	std::string status;
+	const auto result = DecodeCompactResponse(response, status);
+	EXPECT_EQ(status, "OK");
+	EXPECT_EQ(result, (Attributes{{"file", "a.flac"}, {"Time", "1"}}));
+
+	EXPECT_THROW(DecodeCompactResponse("binary: 10\nabc\nOK\n", status),
+		     std::runtime_error);
+}
@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "DelayHttpServer.hxx"
+#include "input/InputStream.hxx"
+#include "input/Init.hxx"
+#include "config/Block.hxx"
+#include "config/Data.hxx"
+#include "event/Call.hxx"
+#include "event/Thread.hxx"
+#include "thread/Mutex.hxx"
+
+#include <gtest/gtest.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+
+using std::chrono_literals::operator""ms;
+
+static constexpr std::size_t RANGE_SIZE = 1024 * 1024;
+static constexpr std::size_t FILE_SIZE = 5 * RANGE_SIZE + 1234;
+
+static ConfigData
+MakeConfig(unsigned parallel_ranges) noexcept
+{
+	ConfigBlock block;
+	block.AddBlockParam("plugin", "curl");
+	block.AddBlockParam("parallel_ranges",
+			    fmt::format_int{parallel_ranges}.c_str());
+
+	ConfigData config;
+	config.AddBlock(ConfigBlockOption::INPUT, std::move(block));
+	return config;
+}
+
+/**
+ * The parameter is the "parallel_ranges" setting.
+ */
+class CurlInputStreamTest : public ::testing::TestWithParam<unsigned> {
+protected:
+	const ConfigData config{MakeConfig(GetParam())};
+
+	EventThread io_thread;
+
+	std::optional<ScopeInputPluginsInit> input_plugins_init;
+
+	std::unique_ptr<DelayHttpServer> server;
+
+	void SetUp() override {
+		io_thread.Start();
+		input_plugins_init.emplace(config, io_thread.GetEventLoop());
+
+		BlockingCall(io_thread.GetEventLoop(), [this](){
+			server = std::make_unique<DelayHttpServer>(io_thread.GetEventLoop(),
+								   FILE_SIZE,
+								   10ms);
+		});
+	}
+
+	void TearDown() override {
+		input_plugins_init.reset();
+
+		BlockingCall(io_thread.GetEventLoop(), [this](){
+			server.reset();
+		});
+	}
+};
+
+static void
+ExpectRead(InputStream &is, std::unique_lock<Mutex> &lock,
+	   std::size_t length)
+{
+	std::byte buffer[16384];
+
+	while (length > 0) {
+		const offset_type offset = is.GetOffset();
+		const std::size_t nbytes =
+			is.Read(lock, buffer, std::min(length, sizeof(buffer)));
+		ASSERT_GT(nbytes, 0U);
+
+		for (std::size_t i = 0; i < nbytes; ++i)
+			ASSERT_EQ(buffer[i], DelayHttpServer::PatternAt(offset + i))
+				<< "offset=" << offset + i;
+
+		length -= nbytes;
+	}
+}
+
+TEST_P(CurlInputStreamTest, Sequential)
+{
+	Mutex mutex;
+	auto is = InputStream::OpenReady(server->GetURL().c_str(), mutex);
+
+	std::unique_lock lock{mutex};
+	ASSERT_TRUE(is->KnownSize());
+	EXPECT_EQ(is->GetSize(), offset_type(FILE_SIZE));
+	EXPECT_TRUE(is->IsSeekable());
+
+	ExpectRead(*is, lock, FILE_SIZE);
+
+	std::byte dummy;
+	EXPECT_EQ(is->Read(lock, &dummy, 1), 0U);
+	EXPECT_TRUE(is->IsEOF());
+	is->Check();
+
+	if (GetParam() > 1) {
+		/* one request per range, but no more connections
+		   than were used at the same time */
+		EXPECT_EQ(server->GetRequestCount(),
+			  (FILE_SIZE + RANGE_SIZE - 1) / RANGE_SIZE);
+		EXPECT_LE(server->GetConnectionCount(), GetParam());
+	}
+}
+
+TEST_P(CurlInputStreamTest, Seek)
+{
+	Mutex mutex;
+	auto is = InputStream::OpenReady(server->GetURL().c_str(), mutex);
+
+	std::unique_lock lock{mutex};
+
+	for (const std::size_t offset : {
+			std::size_t(0), RANGE_SIZE + 17, 2 * RANGE_SIZE - 3,
+			FILE_SIZE - 1, 4 * RANGE_SIZE, 100 * std::size_t(1000),
+			std::size_t(12345), 3 * RANGE_SIZE }) {
+		SCOPED_TRACE(offset);
+		is->Seek(lock, offset);
+		EXPECT_EQ(is->GetOffset(), offset_type(offset));
+		ExpectRead(*is, lock,
+			   std::min<std::size_t>(100000, FILE_SIZE - offset));
+	}
+
+	is->Seek(lock, FILE_SIZE);
+	EXPECT_TRUE(is->IsEOF());
+	is->Check();
+}
+
+INSTANTIATE_TEST_SUITE_P(ParallelRanges, CurlInputStreamTest,
+			 ::testing::Values(1U, 4U));
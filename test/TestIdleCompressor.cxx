@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "client/IdleCompressor.hxx"
+#include "event/Call.hxx"
+#include "event/Thread.hxx"
+
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+/**
+ * Collects the compressed data in a string.
+ */
+class StringCompressor final : public IdleCompressor {
+public:
+	std::string output;
+
+	/**
+	 * If non-zero, WriteCompressed() fails once #output would
+	 * exceed this size.
+	 */
+	std::size_t max_size = 0;
+
+	unsigned n_errors = 0;
+
+	explicit StringCompressor(EventLoop &event_loop)
+		:IdleCompressor(event_loop) {}
+
+	~StringCompressor() noexcept = default;
+
+	bool Compress(std::string_view s) noexcept {
+		return IdleCompressor::Compress(std::as_bytes(std::span{s}));
+	}
+
+private:
+	/* virtual methods from class IdleCompressor */
+	void WriteCompressed(std::span<const std::byte> src) override {
+		if (max_size > 0 && output.size() + src.size() > max_size)
+			throw std::runtime_error("Output buffer is full");
+
+		output.append((const char *)src.data(), src.size());
+	}
+
+	void OnCompressorError(std::exception_ptr) noexcept override {
+		++n_errors;
+	}
+};
+
+/**
+ * Decompresses a gzip stream incrementally, like a client would.
+ */
+class Gunzip {
+	z_stream z{};
+
+	std::size_t position = 0;
+
+public:
+	std::string output;
+
+	bool finished = false;
+
+	Gunzip() noexcept {
+		inflateInit2(&z, 16 + MAX_WBITS);
+	}
+
+	~Gunzip() noexcept {
+		inflateEnd(&z);
+	}
+
+	Gunzip(const Gunzip &) = delete;
+	Gunzip &operator=(const Gunzip &) = delete;
+
+	/**
+	 * Decompress all new data from the given (growing) string.
+	 */
+	void Feed(const std::string &input) {
+		z.next_in = (Bytef *)const_cast<char *>(input.data() + position);
+		z.avail_in = input.size() - position;
+
+		while (!finished) {
+			char buffer[4096];
+			z.next_out = (Bytef *)buffer;
+			z.avail_out = sizeof(buffer);
+
+			const int result = inflate(&z, Z_NO_FLUSH);
+			if (result == Z_STREAM_END)
+				finished = true;
+			else if (result == Z_BUF_ERROR)
+				break;
+			else if (result != Z_OK)
+				throw std::runtime_error("inflate() failed");
+
+			output.append(buffer, sizeof(buffer) - z.avail_out);
+
+			if (z.avail_in == 0 && z.avail_out > 0)
+				break;
+		}
+
+		position = input.size() - z.avail_in;
+	}
+};
+
+static std::string
+MakeResponse(unsigned i)
+{
+	std::string s;
+	for (unsigned j = 0; j < 100; ++j)
+		s += "file: music/artist" + std::to_string(i % 7) +
+			"/song" + std::to_string(j) + ".flac\n"
+			"Title: Song " + std::to_string(i * j) + "\n";
+	s += "OK\n";
+	return s;
+}
+
+TEST(IdleCompressor, SyncFlush)
+{
+	EventThread thread;
+	thread.Start();
+
+	StringCompressor compressor{thread.GetEventLoop()};
+	Gunzip gunzip;
+	std::string input;
+
+	for (unsigned i = 0; i < 20; ++i) {
+		const auto response = MakeResponse(i);
+		input += response;
+
+		BlockingCall(thread.GetEventLoop(), [&]{
+			EXPECT_TRUE(compressor.Compress(response));
+		});
+
+		/* after the EventLoop has become idle, the client
+		   must be able to decompress everything sent so far
+		   (Z_SYNC_FLUSH); the IdleEvent may run after the
+		   next BlockingCall(), so retry for a while */
+		for (unsigned j = 0; j < 100 && gunzip.output.size() < input.size(); ++j) {
+			if (j > 0)
+				std::this_thread::sleep_for(10ms);
+
+			BlockingCall(thread.GetEventLoop(), [&]{
+				gunzip.Feed(compressor.output);
+			});
+		}
+
+		EXPECT_EQ(gunzip.output, input);
+		EXPECT_FALSE(gunzip.finished);
+	}
+
+	BlockingCall(thread.GetEventLoop(), [&]{
+		EXPECT_TRUE(compressor.Finish());
+		gunzip.Feed(compressor.output);
+	});
+
+	EXPECT_TRUE(gunzip.finished);
+	EXPECT_EQ(gunzip.output, input);
+	EXPECT_EQ(compressor.n_errors, 0U);
+	EXPECT_LT(compressor.output.size(), input.size() / 4);
+}
+
+TEST(IdleCompressor, Error)
+{
+	EventThread thread;
+	thread.Start();
+
+	StringCompressor compressor{thread.GetEventLoop()};
+	compressor.max_size = 16;
+
+	BlockingCall(thread.GetEventLoop(), [&]{
+		EXPECT_TRUE(compressor.Compress(MakeResponse(0)));
+
+		/* the output does not fit; this error must be
+		   reported, e.g. to "compress none" */
+		EXPECT_FALSE(compressor.Finish());
+	});
+
+	EXPECT_EQ(compressor.n_errors, 1U);
+}
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "input/cache/Chunks.hxx"
+#include "input/InputStream.hxx"
+#include "thread/Mutex.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+static constexpr std::byte
+PatternAt(std::size_t offset) noexcept
+{
+	return std::byte(offset * 7 + offset / 251);
+}
+
+/**
+ * A seekable #InputStream which generates a pattern.
+ */
+class PatternInputStream final : public InputStream {
+public:
+	PatternInputStream(Mutex &_mutex, std::size_t _size) noexcept
+		:InputStream("pattern://", _mutex) {
+		size = _size;
+		seekable = true;
+		SetReady();
+	}
+
+	/* virtual methods from InputStream */
+	void Seek(std::unique_lock<Mutex> &, offset_type new_offset) override {
+		offset = new_offset;
+	}
+
+	bool IsEOF() const noexcept override {
+		return offset == size;
+	}
+
+	size_t Read(std::unique_lock<Mutex> &,
+		    void *ptr, size_t read_size) override {
+		const std::size_t nbytes = std::min<std::size_t>(read_size,
+								 size - offset);
+		auto *p = static_cast<std::byte *>(ptr);
+		for (std::size_t i = 0; i < nbytes; ++i)
+			p[i] = PatternAt(offset + i);
+		offset += nbytes;
+		return nbytes;
+	}
+};
+
+static constexpr std::size_t CHUNK_SIZE = InputCacheChunks::CHUNK_SIZE;
+
+static void
+ExpectRead(InputCacheChunks &chunks, std::unique_lock<Mutex> &lock,
+	   std::size_t offset, std::size_t length)
+{
+	std::byte buffer[4096];
+
+	while (length > 0) {
+		const std::size_t nbytes =
+			chunks.Read(lock, offset, buffer,
+				    std::min(length, sizeof(buffer)));
+		ASSERT_GT(nbytes, 0U);
+
+		for (std::size_t i = 0; i < nbytes; ++i)
+			ASSERT_EQ(buffer[i], PatternAt(offset + i));
+
+		offset += nbytes;
+		length -= nbytes;
+	}
+}
+
+TEST(InputCacheChunks, Sequential)
+{
+	Mutex mutex;
+	const std::size_t size = 20 * CHUNK_SIZE + 1234;
+	InputCacheChunks chunks(std::make_unique<PatternInputStream>(mutex, size),
+				InputCacheChunks::MIN_CHUNKS);
+	chunks.Start();
+
+	std::unique_lock lock{mutex};
+	EXPECT_EQ(chunks.size(), size);
+
+	for (std::size_t offset = 0; offset < size; offset += CHUNK_SIZE) {
+		ExpectRead(chunks, lock,
+			   offset, std::min(CHUNK_SIZE, size - offset));
+		EXPECT_LE(chunks.GetResidentSize(), chunks.GetMaxResidentSize());
+	}
+
+	std::byte dummy;
+	EXPECT_EQ(chunks.Read(lock, size, &dummy, 1), 0U);
+
+	chunks.Check();
+}
+
+TEST(InputCacheChunks, Seek)
+{
+	Mutex mutex;
+	const std::size_t size = 50 * CHUNK_SIZE;
+	InputCacheChunks chunks(std::make_unique<PatternInputStream>(mutex, size),
+				InputCacheChunks::MIN_CHUNKS);
+	chunks.Start();
+
+	std::unique_lock lock{mutex};
+
+	for (const std::size_t offset : {
+			std::size_t(0), 30 * CHUNK_SIZE + 17, 5 * CHUNK_SIZE - 3,
+			size - 1, 42 * CHUNK_SIZE, 17 * CHUNK_SIZE + 100,
+			std::size_t(12345) }) {
+		ExpectRead(chunks, lock, offset,
+			   std::min<std::size_t>(10000, size - offset));
+		EXPECT_LE(chunks.GetResidentSize(), chunks.GetMaxResidentSize());
+	}
+}
+
+TEST(InputCacheChunks, Pinned)
+{
+	Mutex mutex;
+	const std::size_t size = 30 * CHUNK_SIZE + 1;
+	InputCacheChunks chunks(std::make_unique<PatternInputStream>(mutex, size),
+				InputCacheChunks::MIN_CHUNKS);
+	chunks.Start();
+
+	std::unique_lock lock{mutex};
+
+	/* read the whole file, which evicts most chunks */
+	ExpectRead(chunks, lock, 0, size);
+
+	/* the first and the last chunk are still there */
+	EXPECT_TRUE(chunks.IsAvailable(0));
+	EXPECT_TRUE(chunks.IsAvailable(CHUNK_SIZE - 1));
+	EXPECT_TRUE(chunks.IsAvailable(size - 1));
+
+	/* but not the ones in the middle */
+	EXPECT_FALSE(chunks.IsAvailable(10 * CHUNK_SIZE));
+}
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "input/cache/Disk.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/DirectoryReader.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/Traits.hxx"
+#include "io/FileOutputStream.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+class InputCacheDiskTest : public ::testing::Test {
+protected:
+	AllocatedPath base = nullptr, cache_path = nullptr;
+
+	void SetUp() override {
+		char tmpl[] = "/tmp/mpd-input-cache-XXXXXX";
+		ASSERT_NE(mkdtemp(tmpl), nullptr);
+		base = AllocatedPath::FromFS(tmpl);
+		cache_path = base / Path::FromFS("cache");
+	}
+
+	void TearDown() override {
+		for (auto *dir : {&cache_path, &base}) {
+			if (!DirectoryExists(*dir))
+				continue;
+
+			DirectoryReader reader{*dir};
+			while (reader.ReadEntry()) {
+				const auto name = reader.GetEntry();
+				if (!PathTraitsFS::IsSpecialFilename(name.c_str()))
+					unlink((*dir / name).c_str());
+			}
+
+			rmdir(dir->c_str());
+		}
+	}
+
+	/**
+	 * Create a file in the temporary directory and return its
+	 * path (which is also its URI).
+	 */
+	std::string CreateFile(const char *name, std::string_view contents) {
+		const auto path = base / Path::FromFS(name);
+		FileOutputStream file{path};
+		file.Write(std::as_bytes(std::span{contents}));
+		file.Commit();
+		return path.c_str();
+	}
+
+	static bool Store(InputCacheDisk &disk, const std::string &uri,
+			  std::string_view contents) {
+		return disk.Store(uri,
+				  FileInfo{Path::FromFS(uri.c_str())}.GetModificationTime(),
+				  std::as_bytes(std::span{contents}));
+	}
+
+	static std::string Lookup(InputCacheDisk &disk, const std::string &uri) {
+		auto mapping = disk.Lookup(uri);
+		if (!mapping)
+			return "(none)";
+
+		const auto data = mapping->GetData();
+		return {(const char *)data.data(), data.size()};
+	}
+};
+
+TEST_F(InputCacheDiskTest, StoreLookup)
+{
+	InputCacheDisk disk{AllocatedPath{cache_path}, 1024 * 1024};
+	disk.Load();
+
+	const auto a = CreateFile("a", "foo");
+	const auto b = CreateFile("b", "bar");
+
+	EXPECT_EQ(Lookup(disk, a), "(none)");
+
+	EXPECT_TRUE(Store(disk, a, "foo"));
+	EXPECT_EQ(Lookup(disk, a), "foo");
+	EXPECT_EQ(Lookup(disk, b), "(none)");
+
+	/* the copy must be discarded after the original has been
+	   modified */
+	CreateFile("a", "foobar");
+	EXPECT_EQ(Lookup(disk, a), "(none)");
+
+	/* the URI is too long */
+	EXPECT_FALSE(disk.Store(std::string(InputCacheDisk::HEADER_SIZE, 'x'),
+				{}, std::as_bytes(std::span{"x", 1})));
+}
+
+TEST_F(InputCacheDiskTest, Evict)
+{
+	const std::string contents(1000, 'x');
+
+	/* room for three files */
+	InputCacheDisk disk{AllocatedPath{cache_path},
+			    3 * (InputCacheDisk::HEADER_SIZE + contents.size())};
+	disk.Load();
+
+	const auto a = CreateFile("a", contents);
+	const auto b = CreateFile("b", contents);
+	const auto c = CreateFile("c", contents);
+	const auto d = CreateFile("d", contents);
+
+	EXPECT_TRUE(Store(disk, a, contents));
+	EXPECT_TRUE(Store(disk, b, contents));
+	EXPECT_TRUE(Store(disk, c, contents));
+
+	/* refresh "a", therefore "b" gets evicted */
+	EXPECT_EQ(Lookup(disk, a), contents);
+	EXPECT_TRUE(Store(disk, d, contents));
+
+	EXPECT_EQ(Lookup(disk, a), contents);
+	EXPECT_EQ(Lookup(disk, b), "(none)");
+	EXPECT_EQ(Lookup(disk, c), contents);
+	EXPECT_EQ(Lookup(disk, d), contents);
+
+	/* too large */
+	EXPECT_FALSE(Store(disk, a, std::string(12 * contents.size(), 0)));
+}
+
+TEST_F(InputCacheDiskTest, Load)
+{
+	const auto a = CreateFile("a", "foo");
+
+	{
+		InputCacheDisk disk{AllocatedPath{cache_path}, 1024 * 1024};
+		disk.Load();
+		EXPECT_TRUE(Store(disk, a, "foo"));
+	}
+
+	/* a new instance finds the files of the previous one */
+	InputCacheDisk disk{AllocatedPath{cache_path}, 1024 * 1024};
+	EXPECT_EQ(Lookup(disk, a), "(none)");
+	disk.Load();
+	EXPECT_EQ(Lookup(disk, a), "foo");
+}
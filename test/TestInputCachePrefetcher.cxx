@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "input/cache/Manager.hxx"
+#include "input/cache/Config.hxx"
+#include "input/cache/RateLimiter.hxx"
+#include "config/Block.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "io/FileOutputStream.hxx"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+TEST(InputCacheRateLimiter, Consume)
+{
+	InputCacheRateLimiter limiter{1000};
+
+	/* one second worth of data */
+	auto d = limiter.Consume(1000);
+	EXPECT_GT(d, 900ms);
+	EXPECT_LE(d, 1s);
+
+	/* the next transfer has to wait for the previous one */
+	d = limiter.Consume(500);
+	EXPECT_GT(d, 1400ms);
+	EXPECT_LE(d, 1500ms);
+}
+
+TEST(InputCacheRateLimiter, NoBurst)
+{
+	InputCacheRateLimiter limiter{1000000};
+
+	EXPECT_LE(limiter.Consume(1), 1ms);
+
+	/* idle time must not be saved up for a burst later */
+	std::this_thread::sleep_for(50ms);
+	EXPECT_GT(limiter.Consume(100000), 90ms);
+}
+
+class InputCachePrefetcherTest : public ::testing::Test {
+protected:
+	std::string base;
+	std::vector<std::string> files;
+
+	void SetUp() override {
+		char tmpl[] = "/tmp/mpd-prefetch-XXXXXX";
+		ASSERT_NE(mkdtemp(tmpl), nullptr);
+		base = tmpl;
+	}
+
+	void TearDown() override {
+		for (const auto &i : files)
+			unlink(i.c_str());
+		rmdir(base.c_str());
+	}
+
+	/**
+	 * Create a file in the temporary directory and return its
+	 * path (which is also its URI).
+	 */
+	std::string CreateFile(const char *name, std::size_t size) {
+		const std::string path = base + "/" + name;
+		const std::string contents(size, 'x');
+
+		FileOutputStream file{AllocatedPath::FromFS(path)};
+		file.Write(std::as_bytes(std::span{contents}));
+		file.Commit();
+
+		files.push_back(path);
+		return path;
+	}
+};
+
+/**
+ * Wait until the given condition is true, but not longer than a few
+ * seconds.
+ */
+template<typename F>
+static bool
+WaitFor(F &&f)
+{
+	for (unsigned i = 0; i < 500; ++i) {
+		if (f())
+			return true;
+
+		std::this_thread::sleep_for(10ms);
+	}
+
+	return false;
+}
+
+TEST_F(InputCachePrefetcherTest, Cancel)
+{
+	/* at this rate, "a" takes much longer to be prefetched than
+	   the test waits */
+	const auto a = CreateFile("a", 4 * 1024 * 1024);
+	const auto b = CreateFile("b", 1000);
+
+	ConfigBlock block;
+	block.AddBlockParam("size", "64 MB");
+	block.AddBlockParam("prefetch_depth", "1");
+	block.AddBlockParam("prefetch_bandwidth", "256 kB");
+
+	InputCacheManager manager{InputCacheConfig{block}};
+
+	int owner;
+
+	manager.SchedulePrefetch(&owner, {a});
+	ASSERT_TRUE(WaitFor([&]{ return manager.Contains(a.c_str()); }));
+
+	/* the next song has changed: the unfinished prefetch of "a"
+	   is cancelled and dropped from the cache, and the single
+	   prefetch thread becomes available for "b" */
+	manager.SchedulePrefetch(&owner, {b});
+	EXPECT_TRUE(WaitFor([&]{
+		return !manager.Contains(a.c_str()) &&
+			manager.Contains(b.c_str());
+	}));
+
+	/* cancel everything */
+	manager.SchedulePrefetch(&owner, {});
+}
+
+TEST_F(InputCachePrefetcherTest, Failed)
+{
+	const std::string a = base + "/a";
+	const auto b = CreateFile("b", 1000);
+	const auto c = CreateFile("c", 1000);
+
+	ConfigBlock block;
+	block.AddBlockParam("size", "64 MB");
+	block.AddBlockParam("prefetch_depth", "2");
+	block.AddBlockParam("prefetch_threads", "1");
+
+	InputCacheManager manager{InputCacheConfig{block}};
+
+	int owner;
+
+	/* "a" does not exist; the single prefetch thread processes
+	   the jobs in order, so "a" has failed once "b" is there */
+	manager.SchedulePrefetch(&owner, {a, b});
+	ASSERT_TRUE(WaitFor([&]{ return manager.Contains(b.c_str()); }));
+	EXPECT_FALSE(manager.Contains(a.c_str()));
+
+	/* the failure is remembered: even though "a" exists now, it
+	   is not retried on the next Schedule() */
+	CreateFile("a", 1000);
+	manager.SchedulePrefetch(&owner, {a, c});
+	ASSERT_TRUE(WaitFor([&]{ return manager.Contains(c.c_str()); }));
+	EXPECT_FALSE(manager.Contains(a.c_str()));
+
+	/* after the queue or the database has changed, it is */
+	manager.ForgetFailedPrefetches();
+	manager.SchedulePrefetch(&owner, {a, c});
+	EXPECT_TRUE(WaitFor([&]{ return manager.Contains(a.c_str()); }));
+
+	manager.SchedulePrefetch(&owner, {});
+}
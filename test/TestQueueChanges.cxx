@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "queue/Queue.hxx"
+#include "song/DetachedSong.hxx"
+#include "song/LightSong.hxx"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+Tag::Tag(const Tag &) noexcept {}
+void Tag::Clear() noexcept {}
+
+DetachedSong::operator LightSong() const noexcept
+{
+	return {uri.c_str(), tag};
+}
+
+/**
+ * Collect the positions reported by Queue::ForEachNewerPosition()
+ * and verify them against Queue::IsNewerAtPosition().
+ */
+static std::vector<unsigned>
+CollectChanges(const Queue &queue, uint32_t version)
+{
+	std::vector<unsigned> result;
+	queue.ForEachNewerPosition(0, queue.GetLength(), version,
+				   [&result](unsigned position,
+					     const Queue::Item &){
+		result.push_back(position);
+	});
+
+	std::vector<unsigned> expected;
+	for (unsigned i = 0; i < queue.GetLength(); ++i)
+		if (queue.IsNewerAtPosition(i, version))
+			expected.push_back(i);
+
+	EXPECT_EQ(result, expected);
+	return result;
+}
+
+static std::vector<unsigned>
+MakeRange(unsigned start, unsigned end)
+{
+	std::vector<unsigned> result;
+	for (unsigned i = start; i < end; ++i)
+		result.push_back(i);
+	return result;
+}
+
+TEST(QueueChanges, Changes)
+{
+	Queue queue(256);
+
+	for (unsigned i = 0; i < 100; ++i)
+		queue.Append(DetachedSong("x.ogg"), 0);
+	queue.IncrementVersion();
+
+	/* a client which has seen everything */
+	const uint32_t v1 = queue.version;
+	EXPECT_TRUE(CollectChanges(queue, v1).empty());
+
+	/* moving a song changes all positions in between */
+	queue.MovePostion(10, 20);
+	queue.IncrementVersion();
+	EXPECT_EQ(CollectChanges(queue, v1), MakeRange(10, 21));
+
+	const uint32_t v2 = queue.version;
+	EXPECT_TRUE(CollectChanges(queue, v2).empty());
+
+	/* deleting a song changes all following positions */
+	queue.DeletePosition(90);
+	queue.IncrementVersion();
+	EXPECT_EQ(CollectChanges(queue, v2), MakeRange(90, 99));
+
+	auto expected = MakeRange(10, 21);
+	const auto tail = MakeRange(90, 99);
+	expected.insert(expected.end(), tail.begin(), tail.end());
+	EXPECT_EQ(CollectChanges(queue, v1), expected);
+
+	/* modifying single songs */
+	const uint32_t v3 = queue.version;
+	queue.ModifyAtPosition(42);
+	queue.SetPriority(3, 10, -1);
+	queue.IncrementVersion();
+	EXPECT_EQ(CollectChanges(queue, v3), (std::vector<unsigned>{3, 42}));
+
+	/* a range move */
+	const uint32_t v4 = queue.version;
+	queue.MoveRange(60, 70, 30);
+	queue.IncrementVersion();
+	EXPECT_EQ(CollectChanges(queue, v4), MakeRange(30, 70));
+
+	/* a version from the future (e.g. from before a restart)
+	   reports everything */
+	EXPECT_EQ(CollectChanges(queue, queue.version + 1),
+		  MakeRange(0, queue.GetLength()));
+
+	/* version 0 reports everything */
+	EXPECT_EQ(CollectChanges(queue, 0), MakeRange(0, queue.GetLength()));
+}
@@ -0,0 +1,467 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Stream a directory tree like "listall" does (#DirectoryTreeWalker,
+ * #ResponseStreamer) to a socket whose output buffer is much smaller
+ * than the response.
+ */
+
+#include "client/ResponseStreamer.hxx"
+#include "db/DirectoryTreeWalker.hxx"
+#include "db/DatabaseError.hxx"
+#include "db/DatabasePlugin.hxx"
+#include "db/Interface.hxx"
+#include "db/LightDirectory.hxx"
+#include "db/PlaylistInfo.hxx"
+#include "db/Selection.hxx"
+#include "db/Stats.hxx"
+#include "event/Call.hxx"
+#include "event/FullyBufferedSocket.hxx"
+#include "event/Thread.hxx"
+#include "net/SocketDescriptor.hxx"
+#include "song/LightSong.hxx"
+#include "tag/Tag.hxx"
+#include "util/RecursiveMap.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cassert>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+static constexpr DatabasePlugin fake_database_plugin = {
+	"fake",
+	0,
+	nullptr,
+};
+
+/**
+ * A database with a generated directory tree.
+ */
+class FakeDatabase final : public Database {
+	struct Directory {
+		std::vector<std::string> children, songs, playlists;
+	};
+
+	std::map<std::string, Directory, std::less<>> directories;
+
+	const Tag tag;
+
+public:
+	FakeDatabase() noexcept
+		:Database(fake_database_plugin)
+	{
+		auto &root = directories[{}];
+		for (unsigned i = 0; i < 20; ++i) {
+			const std::string a = "artist" + std::to_string(i);
+			root.children.push_back(a);
+
+			auto &artist = directories[a];
+			artist.songs.emplace_back("single.flac");
+
+			for (unsigned j = 0; j < 10; ++j) {
+				const std::string b = a + "/album" + std::to_string(j);
+				artist.children.push_back(b);
+
+				auto &album = directories[b];
+				for (unsigned k = 0; k < 200; ++k)
+					album.songs.emplace_back("song" + std::to_string(k) + ".flac");
+				album.playlists.emplace_back("album.cue");
+			}
+		}
+
+		root.songs.emplace_back("root.flac");
+	}
+
+	void RemoveDirectory(std::string_view uri) noexcept {
+		directories.erase(directories.find(uri));
+	}
+
+	/**
+	 * Generate the expected output of the given directory (like
+	 * a recursive Database::Visit()).
+	 */
+	void PrintRecursive(std::string &dest, const std::string &uri) const {
+		if (!uri.empty())
+			dest += "directory: " + uri + "\n";
+
+		const auto i = directories.find(uri);
+		if (i == directories.end())
+			return;
+
+		const std::string prefix = uri.empty() ? uri : uri + "/";
+
+		for (const auto &song : i->second.songs)
+			dest += "file: " + prefix + song + "\n";
+
+		for (const auto &playlist : i->second.playlists)
+			dest += "playlist: " + prefix + playlist + "\n";
+
+		for (const auto &child : i->second.children)
+			PrintRecursive(dest, child);
+	}
+
+	/* virtual methods from class Database */
+	const LightSong *GetSong(std::string_view) const override {
+		throw std::runtime_error("Not implemented");
+	}
+
+	void ReturnSong(const LightSong *) const noexcept override {}
+
+	void Visit(const DatabaseSelection &selection,
+		   VisitDirectory visit_directory,
+		   VisitSong visit_song,
+		   VisitPlaylist visit_playlist) const override {
+		assert(!selection.recursive);
+
+		const auto i = directories.find(selection.uri);
+		if (i == directories.end())
+			throw DatabaseError(DatabaseErrorCode::NOT_FOUND,
+					    "No such directory");
+
+		const LightDirectory directory{selection.uri.c_str(), {}};
+
+		if (visit_directory)
+			for (const auto &child : i->second.children)
+				visit_directory(LightDirectory{child.c_str(), {}});
+
+		if (visit_song) {
+			for (const auto &name : i->second.songs) {
+				LightSong song{name.c_str(), tag};
+				if (!directory.IsRoot())
+					song.directory = directory.GetPath();
+				visit_song(song);
+			}
+		}
+
+		if (visit_playlist)
+			for (const auto &name : i->second.playlists)
+				visit_playlist(PlaylistInfo{name}, directory);
+	}
+
+	RecursiveMap<std::string> CollectUniqueTags(const DatabaseSelection &,
+						    std::span<const TagType>) const override {
+		throw std::runtime_error("Not implemented");
+	}
+
+	DatabaseStats GetStats(const DatabaseSelection &) const override {
+		throw std::runtime_error("Not implemented");
+	}
+
+	std::chrono::system_clock::time_point GetUpdateStamp() const noexcept override {
+		return {};
+	}
+};
+
+/**
+ * Print the next directory from the #DirectoryTreeWalker in the
+ * format of FakeDatabase::PrintRecursive().
+ */
+static void
+PrintNext(std::string &dest, DirectoryTreeWalker &walker)
+{
+	const auto d = [&dest](const LightDirectory &directory){
+		if (!directory.IsRoot())
+			dest += "directory: " + std::string{directory.GetPath()} + "\n";
+	};
+
+	const auto s = [&dest](const LightSong &song){
+		dest += "file: " + song.GetURI() + "\n";
+	};
+
+	const auto p = [&dest](const PlaylistInfo &playlist,
+			       const LightDirectory &directory){
+		dest += "playlist: ";
+		if (!directory.IsRoot()) {
+			dest += directory.GetPath();
+			dest += '/';
+		}
+		dest += playlist.name + "\n";
+	};
+
+	walker.VisitNext(d, s, p);
+}
+
+static std::string
+WalkAll(const FakeDatabase &db, std::string_view uri)
+{
+	DirectoryTreeWalker walker{db};
+	if (!walker.Open(uri))
+		throw std::runtime_error("Not a directory");
+
+	std::string result;
+	while (!walker.IsFinished())
+		PrintNext(result, walker);
+	return result;
+}
+
+TEST(DirectoryTreeWalker, Order)
+{
+	const FakeDatabase db;
+
+	std::string expected;
+	db.PrintRecursive(expected, {});
+	EXPECT_EQ(WalkAll(db, {}), expected);
+
+	expected.clear();
+	db.PrintRecursive(expected, "artist3");
+	EXPECT_EQ(WalkAll(db, "artist3"), expected);
+
+	expected.clear();
+	db.PrintRecursive(expected, "artist3/album7");
+	EXPECT_EQ(WalkAll(db, "artist3/album7"), expected);
+}
+
+TEST(DirectoryTreeWalker, NotDirectory)
+{
+	const FakeDatabase db;
+
+	DirectoryTreeWalker walker{db};
+	EXPECT_FALSE(walker.Open("artist3/single.flac"));
+	EXPECT_FALSE(walker.Open("artist3/nonexistent"));
+	EXPECT_THROW(walker.Open("nonexistent/foo"), DatabaseError);
+}
+
+TEST(DirectoryTreeWalker, Removed)
+{
+	FakeDatabase db;
+
+	DirectoryTreeWalker walker{db};
+	ASSERT_TRUE(walker.Open("artist3"));
+
+	std::string result;
+	PrintNext(result, walker);
+
+	/* a pending directory has been deleted by the database
+	   update meanwhile; it is skipped */
+	db.RemoveDirectory("artist3/album0");
+
+	while (!walker.IsFinished())
+		PrintNext(result, walker);
+
+	std::string expected;
+	db.PrintRecursive(expected, "artist3");
+	EXPECT_EQ(result, expected);
+}
+
+/**
+ * The server side of a connection which streams the whole
+ * #FakeDatabase, like a #Client running "listall".  Its output buffer
+ * can hold only two chunks, so a response which is not streamed
+ * would overflow it.
+ */
+class StreamConnection final : FullyBufferedSocket, public ResponseStreamer {
+	DirectoryTreeWalker walker;
+
+public:
+	unsigned n_generated = 0;
+
+	bool finished = false, closed = false;
+
+	StreamConnection(SocketDescriptor fd, EventLoop &event_loop,
+			 const Database &db)
+		:FullyBufferedSocket(fd, event_loop, CHUNK_SIZE, CHUNK_SIZE),
+		 ResponseStreamer(event_loop),
+		 walker(db)
+	{
+		walker.Open({});
+	}
+
+	~StreamConnection() noexcept {
+		if (FullyBufferedSocket::IsDefined())
+			FullyBufferedSocket::Close();
+		CancelStream();
+	}
+
+	void Start() {
+		if (StartStream())
+			throw std::runtime_error("Response was not streamed");
+	}
+
+private:
+	void Disconnect() noexcept {
+		CancelStream();
+		FullyBufferedSocket::Close();
+		closed = true;
+	}
+
+	/* virtual methods from class ResponseStreamer */
+	bool GenerateMore(std::string &dest) override {
+		EXPECT_FALSE(closed);
+		++n_generated;
+		PrintNext(dest, walker);
+		return !walker.IsFinished();
+	}
+
+	bool WriteChunk(std::string_view src) noexcept override {
+		EXPECT_LE(src.size(), CHUNK_SIZE);
+		return FullyBufferedSocket::Write(src.data(), src.size());
+	}
+
+	void OnStreamFinished(std::exception_ptr ep) noexcept override {
+		EXPECT_FALSE(ep);
+		EXPECT_FALSE(finished);
+		finished = true;
+		FullyBufferedSocket::Write("OK\n", 3);
+	}
+
+	/* virtual methods from class FullyBufferedSocket */
+	void OnSocketDrained() noexcept override {
+		/* like Client::OnSocketDrained(), which forwards
+		   this only while the command is running */
+		if (!finished)
+			OnStreamDrained();
+	}
+
+	/* virtual methods from class BufferedSocket */
+	InputResult OnSocketInput(std::span<std::byte> src) noexcept override {
+		ConsumeInput(src.size());
+		return InputResult::MORE;
+	}
+
+	void OnSocketError(std::exception_ptr) noexcept override {
+		Disconnect();
+	}
+
+	void OnSocketClosed() noexcept override {
+		Disconnect();
+	}
+};
+
+class ResponseStreamerTest : public ::testing::Test {
+protected:
+	EventThread thread;
+
+	const FakeDatabase db;
+
+	std::unique_ptr<StreamConnection> connection;
+
+	/**
+	 * The client side of the connection.
+	 */
+	int client_fd = -1;
+
+	void SetUp() override {
+		int fds[2];
+		ASSERT_EQ(socketpair(AF_LOCAL, SOCK_STREAM|SOCK_CLOEXEC, 0, fds), 0);
+		client_fd = fds[0];
+
+		/* a small socket buffer, so the server has to wait
+		   for the client */
+		const int size = 4096;
+		setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+		thread.Start();
+
+		BlockingCall(thread.GetEventLoop(), [&]{
+			connection = std::make_unique<StreamConnection>(SocketDescriptor{fds[1]},
+									thread.GetEventLoop(),
+									db);
+			connection->Start();
+		});
+	}
+
+	void TearDown() override {
+		BlockingCall(thread.GetEventLoop(), [this]{
+			connection.reset();
+		});
+
+		if (client_fd >= 0)
+			close(client_fd);
+	}
+
+	/**
+	 * Read from the client side.
+	 *
+	 * @return the number of bytes read; 0 at the end of the stream
+	 */
+	std::size_t Receive(std::string &dest, std::size_t max_size) {
+		char buffer[4096];
+		const auto nbytes = read(client_fd, buffer,
+					 std::min(sizeof(buffer), max_size));
+		if (nbytes < 0)
+			throw std::runtime_error("read() failed");
+
+		dest.append(buffer, nbytes);
+		return nbytes;
+	}
+};
+
+TEST_F(ResponseStreamerTest, Complete)
+{
+	std::string expected;
+	db.PrintRecursive(expected, {});
+	expected += "OK\n";
+
+	/* the response is much larger than the output buffer */
+	ASSERT_GT(expected.size(), 64 * ResponseStreamer::CHUNK_SIZE);
+
+	/* read slowly, in odd sizes */
+	std::string received;
+	for (unsigned i = 0; received.size() < expected.size(); ++i) {
+		if (Receive(received, 1000 + i % 3000) == 0)
+			break;
+
+		if (i % 100 == 0)
+			std::this_thread::sleep_for(1ms);
+	}
+
+	EXPECT_EQ(received, expected);
+
+	BlockingCall(thread.GetEventLoop(), [this]{
+		EXPECT_TRUE(connection->finished);
+		EXPECT_FALSE(connection->closed);
+	});
+}
+
+TEST_F(ResponseStreamerTest, Disconnect)
+{
+	std::string expected;
+	db.PrintRecursive(expected, {});
+
+	std::string received;
+	while (received.size() < 100000)
+		ASSERT_GT(Receive(received, 4096), 0U);
+
+	/* the data received so far is a prefix of the response */
+	EXPECT_EQ(received, expected.substr(0, received.size()));
+
+	/* the client disconnects in the middle of the response */
+	close(client_fd);
+	client_fd = -1;
+
+	bool closed = false;
+	for (unsigned i = 0; i < 500 && !closed; ++i) {
+		std::this_thread::sleep_for(10ms);
+		BlockingCall(thread.GetEventLoop(), [this, &closed]{
+			closed = connection->closed;
+		});
+	}
+
+	ASSERT_TRUE(closed);
+
+	/* nothing is generated after the stream has been
+	   cancelled */
+	unsigned n_generated;
+	BlockingCall(thread.GetEventLoop(), [this, &n_generated]{
+		n_generated = connection->n_generated;
+	});
+
+	std::this_thread::sleep_for(50ms);
+
+	BlockingCall(thread.GetEventLoop(), [this, n_generated]{
+		EXPECT_EQ(connection->n_generated, n_generated);
+		EXPECT_FALSE(connection->finished);
+	});
+}
@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "queue/SequenceTree.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Item {
+	SequenceTreeHook hook;
+	unsigned value;
+};
+
+/**
+ * Compare the tree with a plain vector which has been edited the
+ * same way.
+ */
+static void
+Check(const SequenceTree &tree, const std::vector<Item *> &model,
+      const std::vector<uint32_t> &stamps)
+{
+	ASSERT_EQ(tree.size(), model.size());
+
+	for (unsigned i = 0; i < model.size(); ++i) {
+		EXPECT_EQ(&tree[i], &model[i]->hook);
+		EXPECT_EQ(SequenceTree::GetIndex(model[i]->hook), i);
+		EXPECT_EQ(SequenceTree::GetStamp(model[i]->hook),
+			  stamps[model[i]->value]);
+	}
+
+	unsigned i = 0;
+	tree.ForEach(0, tree.size(), 0, [&](unsigned index,
+					    const SequenceTreeHook &hook,
+					    uint32_t stamp){
+		ASSERT_EQ(index, i);
+		ASSERT_LT(i, model.size());
+		EXPECT_EQ(&hook, &model[i]->hook);
+		EXPECT_EQ(stamp, stamps[model[i]->value]);
+		++i;
+	});
+	EXPECT_EQ(i, model.size());
+}
+
+/**
+ * Check that ForEach() with a minimum stamp visits exactly the
+ * matching items in the given range.
+ */
+static void
+CheckNewer(const SequenceTree &tree, const std::vector<Item *> &model,
+	   const std::vector<uint32_t> &stamps,
+	   unsigned start, unsigned end, uint32_t min_stamp)
+{
+	std::vector<unsigned> expected, visited;
+	for (unsigned i = start; i < end; ++i)
+		if (stamps[model[i]->value] >= min_stamp)
+			expected.push_back(i);
+
+	tree.ForEach(start, end, min_stamp, [&](unsigned index,
+						const SequenceTreeHook &hook,
+						uint32_t stamp){
+		EXPECT_EQ(&hook, &model[index]->hook);
+		EXPECT_GE(stamp, min_stamp);
+		visited.push_back(index);
+	});
+
+	EXPECT_EQ(visited, expected);
+}
+
+} // anonymous namespace
+
+TEST(SequenceTree, Basic)
+{
+	Item a{{}, 0}, b{{}, 1}, c{{}, 2};
+	SequenceTree tree;
+
+	EXPECT_TRUE(tree.empty());
+	EXPECT_EQ(tree.size(), 0U);
+
+	tree.push_back(a.hook);
+	tree.push_back(b.hook);
+	tree.push_back(c.hook);
+	EXPECT_FALSE(tree.empty());
+	EXPECT_EQ(tree.size(), 3U);
+	EXPECT_EQ(&tree[0], &a.hook);
+	EXPECT_EQ(&tree[2], &c.hook);
+
+	/* move "a" to the end */
+	tree.MoveRange(0, 1, 2);
+	EXPECT_EQ(&tree[0], &b.hook);
+	EXPECT_EQ(&tree[1], &c.hook);
+	EXPECT_EQ(&tree[2], &a.hook);
+	EXPECT_EQ(SequenceTree::GetIndex(a.hook), 2U);
+
+	tree.Swap(0, 2);
+	EXPECT_EQ(&tree[0], &a.hook);
+	EXPECT_EQ(&tree[2], &b.hook);
+
+	tree.SetStamp(1, 3, 42);
+	EXPECT_EQ(SequenceTree::GetStamp(a.hook), 0U);
+	EXPECT_EQ(SequenceTree::GetStamp(b.hook), 42U);
+	EXPECT_EQ(SequenceTree::GetStamp(c.hook), 42U);
+
+	tree.erase(c.hook);
+	EXPECT_EQ(tree.size(), 2U);
+	EXPECT_EQ(&tree[1], &b.hook);
+
+	tree.ClearStamps();
+	EXPECT_EQ(SequenceTree::GetStamp(b.hook), 0U);
+
+	tree.clear();
+	EXPECT_TRUE(tree.empty());
+}
+
+TEST(SequenceTree, Random)
+{
+	std::mt19937 rng{42};
+	const auto random = [&rng](unsigned n){
+		return std::uniform_int_distribution<unsigned>{0, n - 1}(rng);
+	};
+
+	std::deque<Item> items;
+	std::vector<Item *> model;
+	std::vector<uint32_t> stamps;
+	uint32_t stamp = 0;
+
+	SequenceTree tree;
+
+	for (unsigned iteration = 0; iteration < 2000; ++iteration) {
+		++stamp;
+
+		const unsigned size = model.size();
+		switch (size < 8 ? 0 : random(7)) {
+		case 0: {
+			auto &item = items.emplace_back(Item{{}, unsigned(stamps.size())});
+			item.hook.stamp = stamp;
+			stamps.push_back(stamp);
+			tree.push_back(item.hook);
+			model.push_back(&item);
+			break;
+		}
+
+		case 1: {
+			const unsigned i = random(size);
+			tree.erase(model[i]->hook);
+			model.erase(model.begin() + i);
+			break;
+		}
+
+		case 2: {
+			const unsigned start = random(size);
+			const unsigned end = start + random(size - start) + 1;
+			const unsigned to = random(size - (end - start) + 1);
+
+			tree.MoveRange(start, end, to);
+
+			std::vector<Item *> block(model.begin() + start,
+						  model.begin() + end);
+			model.erase(model.begin() + start, model.begin() + end);
+			model.insert(model.begin() + to,
+				     block.begin(), block.end());
+			break;
+		}
+
+		case 3: {
+			const unsigned a = random(size), b = random(size);
+			tree.Swap(a, b);
+			std::swap(model[a], model[b]);
+			break;
+		}
+
+		case 4: {
+			const unsigned start = random(size);
+			const unsigned end = start + random(size - start) + 1;
+
+			tree.SetStamp(start, end, stamp);
+			for (unsigned i = start; i < end; ++i)
+				stamps[model[i]->value] = stamp;
+			break;
+		}
+
+		case 5: {
+			const unsigned i = random(size);
+			SequenceTree::SetStamp(model[i]->hook, stamp);
+			stamps[model[i]->value] = stamp;
+			break;
+		}
+
+		case 6: {
+			const unsigned start = random(size);
+			const unsigned end = start + random(size - start) + 1;
+
+			auto nodes = tree.Cut(start, end);
+			ASSERT_EQ(nodes.size(), end - start);
+			for (unsigned i = start; i < end; ++i)
+				EXPECT_EQ(nodes[i - start], &model[i]->hook);
+
+			std::reverse(nodes.begin(), nodes.end());
+			std::reverse(model.begin() + start, model.begin() + end);
+
+			tree.Paste(start, nodes);
+			break;
+		}
+		}
+
+		Check(tree, model, stamps);
+
+		if (!model.empty()) {
+			const unsigned start = random(model.size());
+			const unsigned end = start + random(model.size() - start) + 1;
+			CheckNewer(tree, model, stamps, start, end,
+				   stamp - random(50));
+		}
+	}
+}
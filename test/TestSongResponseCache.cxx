@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Verify that every modification of a song's attributes discards
+ * its cached protocol response (#SongResponseCache).
+ */
+
+#include "MakeTag.hxx"
+#include "song/DetachedSong.hxx"
+#include "song/LightSong.hxx"
+#include "song/ResponseCache.hxx"
+#include "db/update/Editor.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/ExportedSong.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseListener.hxx"
+#include "db/DatabaseLock.hxx"
+#include "storage/plugins/LocalStorage.hxx"
+#include "storage/StorageInterface.hxx"
+#include "storage/FileInfo.hxx"
+#include "config/Data.hxx"
+#include "decoder/DecoderList.hxx"
+#include "input/Init.hxx"
+#include "event/Thread.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "io/FileOutputStream.hxx"
+#include "pcm/AudioFormat.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+static constexpr TagMask TEST_TAG_MASK = TagMask(TAG_ARTIST);
+
+static void
+Fill(const SongResponseCache &cache) noexcept
+{
+	cache.Put(TEST_TAG_MASK, "Artist: foo\n");
+	ASSERT_NE(cache.Get(TEST_TAG_MASK), nullptr);
+}
+
+static bool
+IsCached(const SongResponseCache &cache) noexcept
+{
+	return cache.Get(TEST_TAG_MASK) != nullptr;
+}
+
+TEST(SongResponseCache, DetachedSongSetters)
+{
+	DetachedSong song{"foo.ogg", MakeTag(TAG_ARTIST, "foo")};
+	const auto &cache = song.GetResponseCache();
+
+	Fill(cache);
+	song.SetTag(MakeTag(TAG_ARTIST, "bar"));
+	EXPECT_FALSE(IsCached(cache));
+
+	Fill(cache);
+	const Tag tag = MakeTag(TAG_ARTIST, "baz");
+	song.SetTag(tag);
+	EXPECT_FALSE(IsCached(cache));
+
+	Fill(cache);
+	song.WritableTag();
+	EXPECT_FALSE(IsCached(cache));
+
+	Fill(cache);
+	song.SetLastModified(std::chrono::system_clock::now());
+	EXPECT_FALSE(IsCached(cache));
+
+	Fill(cache);
+	song.SetAdded(std::chrono::system_clock::now());
+	EXPECT_FALSE(IsCached(cache));
+
+	Fill(cache);
+	song.SetStartTime(SongTime::FromMS(1000));
+	EXPECT_FALSE(IsCached(cache));
+
+	Fill(cache);
+	song.SetEndTime(SongTime::FromMS(2000));
+	EXPECT_FALSE(IsCached(cache));
+
+	Fill(cache);
+	song.SetAudioFormat(AudioFormat(44100, SampleFormat::S16, 2));
+	EXPECT_FALSE(IsCached(cache));
+
+	DetachedSong other{"other.ogg", MakeTag(TAG_ARTIST, "other")};
+	Fill(cache);
+	Fill(other.GetResponseCache());
+	song.MoveTagFrom(std::move(other));
+	EXPECT_FALSE(IsCached(cache));
+	EXPECT_FALSE(IsCached(other.GetResponseCache()));
+
+	DetachedSong other2{"other2.ogg", MakeTag(TAG_ARTIST, "other2")};
+	Fill(cache);
+	Fill(other2.GetResponseCache());
+	song.MoveTagItemsFrom(std::move(other2));
+	EXPECT_FALSE(IsCached(cache));
+	EXPECT_FALSE(IsCached(other2.GetResponseCache()));
+
+	/* copies start with an empty cache */
+	Fill(cache);
+	const DetachedSong copy{song};
+	EXPECT_FALSE(IsCached(copy.GetResponseCache()));
+}
+
+TEST(SongResponseCache, LightSongWithOtherTag)
+{
+	const Tag tag1 = MakeTag(TAG_ARTIST, "foo");
+	const Tag tag2 = MakeTag(TAG_ARTIST, "bar");
+
+	SongResponseCache cache;
+	LightSong song{"foo.ogg", tag1};
+	song.response_cache = &cache;
+
+	/* the cache was rendered from tag1 and must not be used
+	   with tag2 */
+	const LightSong other{song, tag2};
+	EXPECT_EQ(other.response_cache, nullptr);
+}
+
+class NullDatabaseListener final : public DatabaseListener {
+public:
+	void OnDatabaseModified() noexcept override {}
+	void OnDatabaseSongRemoved(const char *) noexcept override {}
+};
+
+TEST(SongResponseCache, UpdateSongTag)
+{
+	EventThread thread;
+	NullDatabaseListener listener;
+	DatabaseEditor editor{thread.GetEventLoop(), listener};
+
+	std::unique_ptr<Directory> root{Directory::NewRoot()};
+	auto new_song = std::make_unique<Song>("foo.ogg", *root);
+	new_song->tag = MakeTag(TAG_ARTIST, "foo");
+	Song *song = new_song.get();
+
+	const ScopeDatabaseLock protect;
+	editor.AddSong(*root, std::move(new_song));
+
+	Fill(song->response_cache);
+	editor.UpdateSongTag(*song, MakeTag(TAG_ARTIST, "bar"));
+	EXPECT_FALSE(IsCached(song->response_cache));
+
+	/* the exported song refers to the song's cache and keeps
+	   it when moved, because the tag stays the same */
+	Fill(song->response_cache);
+	ExportedSong exported = song->Export();
+	EXPECT_EQ(exported.response_cache, &song->response_cache);
+	ExportedSong moved{std::move(exported)};
+	EXPECT_EQ(moved.response_cache, &song->response_cache);
+}
+
+static void
+AppendLE(std::vector<std::byte> &v, uint64_t value, std::size_t size) noexcept
+{
+	for (std::size_t i = 0; i < size; ++i)
+		v.push_back(std::byte(value >> (8 * i)));
+}
+
+static void
+AppendId(std::vector<std::byte> &v, const char *id) noexcept
+{
+	for (std::size_t i = 0; i < 4; ++i)
+		v.push_back(std::byte(id[i]));
+}
+
+/**
+ * Generate a minimal DSF file (one block of silence in stereo),
+ * which is supported by the built-in "dsf" decoder plugin.
+ */
+static std::vector<std::byte>
+MakeDsf() noexcept
+{
+	constexpr std::size_t block_size = 4096, channels = 2;
+	constexpr std::size_t data_size = block_size * channels;
+	constexpr std::size_t file_size = 28 + 52 + 12 + data_size;
+
+	std::vector<std::byte> v;
+
+	AppendId(v, "DSD ");
+	AppendLE(v, 28, 8);
+	AppendLE(v, file_size, 8);
+	AppendLE(v, 0, 8); // no metadata
+
+	AppendId(v, "fmt ");
+	AppendLE(v, 52, 8);
+	AppendLE(v, 1, 4); // version
+	AppendLE(v, 0, 4); // DSD raw
+	AppendLE(v, channels, 4); // channel type
+	AppendLE(v, channels, 4);
+	AppendLE(v, 2822400, 4);
+	AppendLE(v, 1, 4); // bits per sample
+	AppendLE(v, block_size * 8, 8); // samples per channel
+	AppendLE(v, block_size, 4);
+	AppendLE(v, 0, 4);
+
+	AppendId(v, "data");
+	AppendLE(v, 12 + data_size, 8);
+	v.insert(v.end(), data_size, std::byte{0x69});
+
+	return v;
+}
+
+class SongUpdateFileTest : public ::testing::Test {
+protected:
+	std::string base;
+	std::string path;
+
+	void SetUp() override {
+		char tmpl[] = "/tmp/mpd-response-cache-XXXXXX";
+		ASSERT_NE(mkdtemp(tmpl), nullptr);
+		base = tmpl;
+
+		path = base + "/foo.dsf";
+		const auto dsf = MakeDsf();
+		FileOutputStream file{AllocatedPath::FromFS(path)};
+		file.Write(dsf);
+		file.Commit();
+	}
+
+	void TearDown() override {
+		unlink(path.c_str());
+		rmdir(base.c_str());
+	}
+};
+
+TEST_F(SongUpdateFileTest, UpdateFile)
+{
+	EventThread io_thread;
+	io_thread.Start();
+
+	const ScopeInputPluginsInit input_plugins_init(ConfigData(),
+						       io_thread.GetEventLoop());
+	const ScopeDecoderPluginsInit decoder_plugins_init({});
+
+	const auto storage = CreateLocalStorage(AllocatedPath::FromFS(base));
+	const auto info = storage->GetInfo("foo.dsf", true);
+
+	std::unique_ptr<Directory> root{Directory::NewRoot()};
+	auto song = Song::LoadFile(*storage, "foo.dsf", info, *root);
+	ASSERT_NE(song, nullptr);
+
+	Fill(song->response_cache);
+	ASSERT_TRUE(song->UpdateFile(*storage, info));
+	EXPECT_FALSE(IsCached(song->response_cache));
+}
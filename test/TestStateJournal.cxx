@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "StateJournal.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileSystem.hxx"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+static constexpr char snapshot[] =
+	"sw_volume: 42\n"
+	"state: stop\n"
+	"random: 0\n"
+	"playlist_begin\n"
+	"0:a.flac\n"
+	"Prio: 7\n"
+	"1:b.flac\n"
+	"song_begin: http://example.com/c.ogg\n"
+	"Title: C\n"
+	"song_end\n"
+	"3:d.flac\n"
+	"playlist_end\n";
+
+static std::string
+MakeJournal(std::string_view records)
+{
+	std::ostringstream s;
+	s << "journal_snapshot: " << std::hex << HashStateFile(snapshot) << "\n"
+	  << records;
+	return std::move(s).str();
+}
+
+TEST(StateJournal, RoundTrip)
+{
+	StateFileContents contents;
+	contents.ParseSnapshot(snapshot);
+	EXPECT_TRUE(contents.have_queue);
+	EXPECT_EQ(contents.queue.size(), 4U);
+	EXPECT_EQ(contents.queue[1], "Prio: 7\n1:b.flac\n");
+	EXPECT_EQ(contents.queue[2],
+		  "song_begin: http://example.com/c.ogg\nTitle: C\nsong_end\n");
+	EXPECT_EQ(contents.ToString(), snapshot);
+}
+
+TEST(StateJournal, Apply)
+{
+	StateFileContents contents;
+	contents.ParseSnapshot(snapshot);
+
+	const auto journal = MakeJournal(
+		/* modify position 1, append one item */
+		"journal_begin\n"
+		"journal_position: 1\n"
+		"1:x.flac\n"
+		"journal_position: 4\n"
+		"Prio: 3\n"
+		"4:y.flac\n"
+		"journal_length: 5\n"
+		"sw_volume: 50\n"
+		"state: pause\n"
+		"journal_end\n"
+		/* delete position 0 (which modifies all others) */
+		"journal_begin\n"
+		"journal_position: 0\n"
+		"0:x.flac\n"
+		"journal_position: 1\n"
+		"song_begin: http://example.com/c.ogg\n"
+		"Title: C\n"
+		"song_end\n"
+		"journal_position: 2\n"
+		"2:d.flac\n"
+		"journal_position: 3\n"
+		"Prio: 3\n"
+		"3:y.flac\n"
+		"journal_length: 4\n"
+		"sw_volume: 60\n"
+		"state: play\n"
+		"journal_end\n"
+		/* incomplete record */
+		"journal_begin\n"
+		"journal_position: 0\n"
+		"0:z.flac\n"
+		"journal_length: 1\n"
+		"sw_volume: 0\n");
+
+	EXPECT_TRUE(contents.ApplyJournal(journal, HashStateFile(snapshot)));
+	EXPECT_EQ(contents.ToString(),
+		  "sw_volume: 60\n"
+		  "state: play\n"
+		  "playlist_begin\n"
+		  "0:x.flac\n"
+		  "song_begin: http://example.com/c.ogg\n"
+		  "Title: C\n"
+		  "song_end\n"
+		  "2:d.flac\n"
+		  "Prio: 3\n"
+		  "3:y.flac\n"
+		  "playlist_end\n");
+}
+
+TEST(StateJournal, Obsolete)
+{
+	StateFileContents contents;
+	contents.ParseSnapshot(snapshot);
+
+	const auto journal = MakeJournal("journal_begin\n"
+					 "journal_length: 0\n"
+					 "journal_end\n");
+
+	/* the journal belongs to a different snapshot */
+	EXPECT_FALSE(contents.ApplyJournal(journal, HashStateFile("foo\n")));
+	EXPECT_EQ(contents.ToString(), snapshot);
+}
+
+static std::string
+ReadFile(const AllocatedPath &path)
+{
+	std::ifstream file{path.c_str(), std::ios::binary};
+	std::ostringstream s;
+	s << file.rdbuf();
+	return std::move(s).str();
+}
+
+TEST(StateJournal, Writer)
+{
+	char tmpl[] = "/tmp/mpd-state-XXXXXX";
+	ASSERT_NE(mkdtemp(tmpl), nullptr);
+
+	const auto snapshot_path = AllocatedPath::FromFS(tmpl) / Path::FromFS("state");
+
+	{
+		StateJournal journal{snapshot_path};
+
+		journal.Push("journal_begin\n"
+			     "journal_position: 0\n"
+			     "0:a.flac\n"
+			     "journal_position: 1\n"
+			     "1:b.flac\n"
+			     "journal_length: 2\n"
+			     "state: stop\n"
+			     "journal_end\n", true);
+
+		journal.Push("journal_begin\n"
+			     "journal_position: 1\n"
+			     "1:c.flac\n"
+			     "journal_length: 2\n"
+			     "state: play\n"
+			     "journal_end\n", false);
+
+		journal.Stop();
+
+		/* the first record has replaced the state file, the
+		   second one was appended to the journal */
+		EXPECT_EQ(ReadFile(snapshot_path),
+			  "state: stop\n"
+			  "playlist_begin\n"
+			  "0:a.flac\n"
+			  "1:b.flac\n"
+			  "playlist_end\n");
+
+		EXPECT_EQ(LoadStateFile(snapshot_path,
+					journal.GetJournalPath()).ToString(),
+			  "state: play\n"
+			  "playlist_begin\n"
+			  "0:a.flac\n"
+			  "1:c.flac\n"
+			  "playlist_end\n");
+
+		unlink(journal.GetJournalPath().c_str());
+	}
+
+	unlink(snapshot_path.c_str());
+	rmdir(tmpl);
+}
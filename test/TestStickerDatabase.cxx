@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "sticker/Database.hxx"
+#include "sticker/Sticker.hxx"
+#include "fs/Path.hxx"
+#include "Idle.hxx"
+
+#include <gtest/gtest.h>
+
+#include <sqlite3.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+void
+idle_add([[maybe_unused]] unsigned flags)
+{
+}
+
+using Found = std::vector<std::pair<std::string, std::string>>;
+
+static void
+Collect(const char *uri, const char *value, void *user_data)
+{
+	auto &found = *static_cast<Found *>(user_data);
+	found.emplace_back(uri, value);
+}
+
+static Found
+LoadValues(StickerDatabase &db, std::vector<const char *> uris,
+	   const char *name)
+{
+	Found found;
+	db.LoadValues("song", uris, name, Collect, &found);
+	return found;
+}
+
+static Found
+Find(StickerDatabase &db, const char *base_uri, const char *name,
+     StickerOperator op=StickerOperator::EXISTS, const char *value=nullptr,
+     const char *sort="", RangeArg window=RangeArg::All())
+{
+	Found found;
+	db.Find("song", base_uri, name, op, value, sort, false, window,
+		Collect, &found);
+	return found;
+}
+
+TEST(StickerDatabase, Cache)
+{
+	StickerDatabase db{Path::FromFS(":memory:")};
+
+	EXPECT_EQ(db.LoadValue("song", "a", "rating"), "");
+
+	/* modifications must invalidate the (negative) cache
+	   entries */
+	db.StoreValue("song", "a", "rating", "5");
+	EXPECT_EQ(db.LoadValue("song", "a", "rating"), "5");
+
+	db.StoreValue("song", "a", "rating", "7");
+	db.StoreValue("song", "a", "playcount", "1");
+	EXPECT_EQ(db.LoadValue("song", "a", "rating"), "7");
+	EXPECT_EQ(db.Load("song", "a").table.size(), 2U);
+
+	EXPECT_TRUE(db.DeleteValue("song", "a", "rating"));
+	EXPECT_EQ(db.LoadValue("song", "a", "rating"), "");
+	EXPECT_EQ(db.LoadValue("song", "a", "playcount"), "1");
+
+	EXPECT_TRUE(db.Delete("song", "a"));
+	EXPECT_EQ(db.LoadValue("song", "a", "playcount"), "");
+	EXPECT_TRUE(db.Load("song", "a").table.empty());
+}
+
+TEST(StickerDatabase, LoadValues)
+{
+	StickerDatabase db{Path::FromFS(":memory:")};
+
+	std::vector<std::string> uris;
+	for (unsigned i = 0; i < 200; ++i) {
+		uris.emplace_back("song" + std::to_string(i));
+		if (i % 3 == 0)
+			db.StoreValue("song", uris.back().c_str(), "rating",
+				      std::to_string(i).c_str());
+	}
+
+	db.StoreValue("playlist", "song1", "rating", "x");
+
+	/* warm the cache with some of them */
+	EXPECT_EQ(db.LoadValue("song", "song3", "rating"), "3");
+	EXPECT_EQ(db.LoadValue("song", "song4", "rating"), "");
+
+	/* more than one chunk, in reverse order, with duplicates */
+	std::vector<const char *> request;
+	Found expected;
+	for (unsigned i = 200; i-- > 0;) {
+		request.push_back(uris[i].c_str());
+		if (i % 3 == 0)
+			expected.emplace_back(uris[i], std::to_string(i));
+	}
+
+	request.push_back("song0");
+	expected.emplace_back("song0", "0");
+	request.push_back("nonexistent");
+
+	EXPECT_EQ(LoadValues(db, request, "rating"), expected);
+
+	/* again, now everything is cached */
+	EXPECT_EQ(LoadValues(db, request, "rating"), expected);
+
+	EXPECT_TRUE(LoadValues(db, request, "playcount").empty());
+}
+
+TEST(StickerDatabase, FindPrefix)
+{
+	StickerDatabase db{Path::FromFS(":memory:")};
+
+	db.StoreValue("song", "a/1", "rating", "1");
+	db.StoreValue("song", "a/2", "rating", "2");
+	db.StoreValue("song", "A/3", "rating", "3");
+	db.StoreValue("song", "a_b/4", "rating", "4");
+	db.StoreValue("song", "ab/5", "rating", "5");
+	db.StoreValue("song", "\xff/6", "rating", "6");
+
+	EXPECT_EQ(Find(db, "", "rating", StickerOperator::EXISTS, nullptr,
+		       "uri").size(), 6U);
+
+	/* the prefix is case-sensitive and has no wildcards */
+	EXPECT_EQ(Find(db, "a/", "rating", StickerOperator::EXISTS, nullptr,
+		       "uri"),
+		  (Found{{"a/1", "1"}, {"a/2", "2"}}));
+	EXPECT_EQ(Find(db, "a_", "rating"), (Found{{"a_b/4", "4"}}));
+	EXPECT_EQ(Find(db, "\xff", "rating"), (Found{{"\xff/6", "6"}}));
+
+	EXPECT_EQ(Find(db, "", "rating", StickerOperator::GREATER_THAN_INT,
+		       "2", "value_int", RangeArg{1, 3}),
+		  (Found{{"a_b/4", "4"}, {"ab/5", "5"}}));
+}
+
+TEST(StickerDatabase, WriteBehind)
+{
+	char tmpl[] = "/tmp/mpd-sticker-XXXXXX";
+	ASSERT_NE(mkdtemp(tmpl), nullptr);
+
+	const std::string path = std::string{tmpl} + "/sticker.sql";
+
+	{
+		StickerDatabase db{Path::FromFS(path.c_str())};
+
+		/* more objects than fit into the cache; the ones
+		   which have not been committed yet must not be
+		   evicted */
+		for (unsigned i = 0; i < 20000; ++i)
+			db.StoreValue("song", ("song" + std::to_string(i)).c_str(),
+				      "rating", std::to_string(i).c_str());
+
+		EXPECT_EQ(db.LoadValue("song", "song0", "rating"), "0");
+		EXPECT_EQ(db.LoadValue("song", "song19999", "rating"), "19999");
+
+		EXPECT_TRUE(db.DeleteValue("song", "song1", "rating"));
+		EXPECT_FALSE(db.DeleteValue("song", "song1", "rating"));
+		EXPECT_TRUE(db.Delete("song", "song2"));
+		EXPECT_FALSE(db.Delete("song", "song2"));
+
+		/* queries which bypass the cache see all
+		   modifications */
+		EXPECT_EQ(Find(db, "song1", "rating", StickerOperator::EQUALS,
+			       "19999"),
+			  (Found{{"song19999", "19999"}}));
+		EXPECT_EQ(Find(db, "", "rating").size(), 19998U);
+	}
+
+	{
+		/* everything has been committed */
+		StickerDatabase db{Path::FromFS(path.c_str())};
+		EXPECT_EQ(db.LoadValue("song", "song0", "rating"), "0");
+		EXPECT_EQ(db.LoadValue("song", "song1", "rating"), "");
+		EXPECT_EQ(db.LoadValue("song", "song2", "rating"), "");
+		EXPECT_EQ(Find(db, "", "rating").size(), 19998U);
+	}
+
+	unlink(path.c_str());
+	rmdir(tmpl);
+}
+
+TEST(StickerDatabase, WriteFailure)
+{
+	char tmpl[] = "/tmp/mpd-sticker-XXXXXX";
+	ASSERT_NE(mkdtemp(tmpl), nullptr);
+
+	const std::string path = std::string{tmpl} + "/sticker.sql";
+
+	{
+		StickerDatabase db{Path::FromFS(path.c_str())};
+
+		/* let the writer's transaction fail for one
+		   object */
+		sqlite3 *other;
+		ASSERT_EQ(sqlite3_open(path.c_str(), &other), SQLITE_OK);
+		ASSERT_EQ(sqlite3_exec(other,
+				       "CREATE TRIGGER fail BEFORE INSERT ON sticker"
+				       " WHEN NEW.uri='bad'"
+				       " BEGIN SELECT RAISE(ABORT, 'test'); END;",
+				       nullptr, nullptr, nullptr),
+			  SQLITE_OK);
+		sqlite3_close(other);
+
+		db.StoreValue("song", "bad", "rating", "5");
+
+		/* this waits for the writer */
+		EXPECT_TRUE(Find(db, "", "rating").empty());
+
+		/* the lost modification is not served from the
+		   cache */
+		EXPECT_EQ(db.LoadValue("song", "bad", "rating"), "");
+
+		/* later modifications still work */
+		db.StoreValue("song", "good", "rating", "4");
+		EXPECT_EQ(db.LoadValue("song", "good", "rating"), "4");
+		EXPECT_EQ(Find(db, "", "rating"),
+			  (Found{{"good", "4"}}));
+	}
+
+	unlink(path.c_str());
+	rmdir(tmpl);
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "MakeTag.hxx"
+#include "db/plugins/simple/TagIndex.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+class TagIndexTest : public ::testing::Test {
+protected:
+	std::unique_ptr<Directory> root{Directory::NewRoot()};
+
+	TagIndex index{TagMask(TAG_ARTIST) | TagMask(TAG_ALBUM_ARTIST) |
+		       TagMask(TAG_GENRE)};
+
+	Song *AddSong(const char *name, Tag &&tag) {
+		auto song = std::make_unique<Song>(name, *root);
+		song->tag = std::move(tag);
+
+		Song *result = song.get();
+		index.Add(*result);
+		root->AddSong(std::move(song));
+		return result;
+	}
+
+	std::size_t Count(TagType type, std::string_view value) const noexcept {
+		const auto *songs = index.Find(type, value);
+		return songs != nullptr ? songs->size() : 0;
+	}
+
+	std::size_t CountValues(TagType type) const noexcept {
+		std::size_t n = 0;
+		index.ForEachValue(type, [&n](std::string_view, const auto &){
+			++n;
+		});
+		return n;
+	}
+};
+
+TEST_F(TagIndexTest, Basic)
+{
+	const ScopeDatabaseLock protect;
+
+	EXPECT_TRUE(index.IsIndexed(TAG_ARTIST));
+	EXPECT_FALSE(index.IsIndexed(TAG_TITLE));
+
+	AddSong("a", MakeTag(TAG_ARTIST, "foo", TAG_GENRE, "rock"));
+	AddSong("b", MakeTag(TAG_ARTIST, "foo", TAG_ARTIST, "bar"));
+	AddSong("c", MakeTag(TAG_ARTIST, "bar", TAG_GENRE, "jazz"));
+
+	EXPECT_EQ(Count(TAG_ARTIST, "foo"), 2u);
+	EXPECT_EQ(Count(TAG_ARTIST, "bar"), 2u);
+	EXPECT_EQ(Count(TAG_ARTIST, "baz"), 0u);
+	EXPECT_EQ(Count(TAG_GENRE, "rock"), 1u);
+	EXPECT_EQ(CountValues(TAG_ARTIST), 2u);
+
+	/* songs without the tag are indexed with an empty value */
+	EXPECT_EQ(Count(TAG_GENRE, ""), 1u);
+	EXPECT_EQ(CountValues(TAG_GENRE), 3u);
+}
+
+/**
+ * Values are indexed with tag fallbacks applied, just like
+ * #TagSongFilter matches them.
+ */
+TEST_F(TagIndexTest, Fallback)
+{
+	const ScopeDatabaseLock protect;
+
+	AddSong("a", MakeTag(TAG_ARTIST, "foo"));
+	AddSong("b", MakeTag(TAG_ARTIST, "foo", TAG_ALBUM_ARTIST, "bar"));
+
+	EXPECT_EQ(Count(TAG_ALBUM_ARTIST, "foo"), 1u);
+	EXPECT_EQ(Count(TAG_ALBUM_ARTIST, "bar"), 1u);
+	EXPECT_EQ(Count(TAG_ALBUM_ARTIST, ""), 0u);
+}
+
+TEST_F(TagIndexTest, Remove)
+{
+	const ScopeDatabaseLock protect;
+
+	Song *a = AddSong("a", MakeTag(TAG_ARTIST, "foo"));
+	AddSong("b", MakeTag(TAG_ARTIST, "foo"));
+
+	index.Remove(*a);
+	EXPECT_EQ(Count(TAG_ARTIST, "foo"), 1u);
+
+	/* modify the tag */
+	a->tag = MakeTag(TAG_ARTIST, "bar");
+	index.Add(*a);
+	EXPECT_EQ(Count(TAG_ARTIST, "foo"), 1u);
+	EXPECT_EQ(Count(TAG_ARTIST, "bar"), 1u);
+
+	/* empty values disappear */
+	index.Remove(*a);
+	EXPECT_EQ(Count(TAG_ARTIST, "bar"), 0u);
+	EXPECT_EQ(CountValues(TAG_ARTIST), 1u);
+}
+
+/**
+ * Songs with a target are not indexed by value.
+ */
+TEST_F(TagIndexTest, Target)
+{
+	const ScopeDatabaseLock protect;
+
+	auto song = std::make_unique<Song>("track0001", *root);
+	song->target = "../foo.flac";
+	song->tag = MakeTag(TAG_ARTIST, "foo");
+	index.Add(*song);
+
+	EXPECT_EQ(Count(TAG_ARTIST, "foo"), 0u);
+	EXPECT_EQ(index.GetUnindexed().size(), 1u);
+
+	index.Remove(*song);
+	EXPECT_TRUE(index.GetUnindexed().empty());
+}
+
+TEST_F(TagIndexTest, AddDirectory)
+{
+	const ScopeDatabaseLock protect;
+
+	Directory *child = root->CreateChild("child");
+	auto song = std::make_unique<Song>("a", *child);
+	song->tag = MakeTag(TAG_ARTIST, "foo");
+	child->AddSong(std::move(song));
+
+	index.AddDirectory(*root);
+	EXPECT_EQ(Count(TAG_ARTIST, "foo"), 1u);
+
+	index.Clear();
+	EXPECT_EQ(Count(TAG_ARTIST, "foo"), 0u);
+}
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "db/update/ReadAhead.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "io/FileOutputStream.hxx"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+class UpdateReadAheadTest : public ::testing::Test {
+protected:
+	std::string base;
+	std::vector<std::string> files;
+
+	void SetUp() override {
+		char tmpl[] = "/tmp/mpd-read-ahead-XXXXXX";
+		ASSERT_NE(mkdtemp(tmpl), nullptr);
+		base = tmpl;
+
+		for (unsigned i = 0; i < 100; ++i) {
+			const std::string path = base + "/" + std::to_string(i);
+			const std::string contents(1000 + i * 100, 'a' + i % 26);
+
+			FileOutputStream file{AllocatedPath::FromFS(path)};
+			file.Write(std::as_bytes(std::span{contents}));
+			file.Commit();
+
+			files.push_back(path);
+		}
+	}
+
+	void TearDown() override {
+		for (const auto &i : files)
+			unlink(i.c_str());
+		rmdir(base.c_str());
+	}
+};
+
+/**
+ * Call Collect() until all reads have completed, but not longer
+ * than a few seconds.
+ */
+static bool
+CollectAll(UpdateReadAhead &read_ahead)
+{
+	for (unsigned i = 0; i < 500; ++i) {
+		read_ahead.Collect();
+		if (read_ahead.GetInFlight() == 0)
+			return true;
+
+		std::this_thread::sleep_for(10ms);
+	}
+
+	return false;
+}
+
+TEST_F(UpdateReadAheadTest, Disabled)
+{
+	UpdateReadAhead read_ahead{0};
+
+	read_ahead.Add(Path::FromFS(files.front().c_str()), 1000);
+	EXPECT_EQ(read_ahead.GetInFlight(), 0U);
+	read_ahead.Collect();
+	EXPECT_EQ(read_ahead.GetInFlight(), 0U);
+}
+
+TEST_F(UpdateReadAheadTest, Ignored)
+{
+	UpdateReadAhead read_ahead{4096};
+
+	/* not a local file */
+	read_ahead.Add(nullptr, 1000);
+	EXPECT_EQ(read_ahead.GetInFlight(), 0U);
+
+	/* nothing to read */
+	read_ahead.Add(Path::FromFS(files.front().c_str()), 0);
+	EXPECT_EQ(read_ahead.GetInFlight(), 0U);
+
+	/* errors are ignored, and the slot is not leaked */
+	const std::string missing = base + "/missing";
+	for (unsigned i = 0; i < 100; ++i)
+		read_ahead.Add(Path::FromFS(missing.c_str()), 1000);
+	EXPECT_EQ(read_ahead.GetInFlight(), 0U);
+}
+
+TEST_F(UpdateReadAheadTest, Collect)
+{
+	UpdateReadAhead read_ahead{4096};
+
+	/* more files than reads may be in flight; Add() waits for a
+	   read to complete when all slots are occupied */
+	std::size_t max_in_flight = 0;
+	for (const auto &i : files) {
+		read_ahead.Add(Path::FromFS(i.c_str()), 1000 + files.size());
+		max_in_flight = std::max(max_in_flight,
+					 read_ahead.GetInFlight());
+	}
+
+	EXPECT_LT(max_in_flight, files.size());
+	EXPECT_TRUE(CollectAll(read_ahead));
+
+	/* the slots can be reused */
+	for (const auto &i : files)
+		read_ahead.Add(Path::FromFS(i.c_str()), 100);
+
+	EXPECT_TRUE(CollectAll(read_ahead));
+}
+
+TEST_F(UpdateReadAheadTest, DestructWhileInFlight)
+{
+	/* the destructor waits for all reads in flight, because the
+	   kernel may still write into the buffers */
+	for (unsigned n = 0; n < 10; ++n) {
+		UpdateReadAhead read_ahead{65536};
+		for (const auto &i : files)
+			read_ahead.Add(Path::FromFS(i.c_str()), 65536);
+	}
+}
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * Read a file with #UringInputStream (several read requests in
+ * flight) in odd-sized chunks, with seeks, and compare the data with
+ * the file contents.
+ */
+
+#include "input/plugins/UringInputPlugin.hxx"
+#include "input/InputStream.hxx"
+#include "event/Thread.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "io/FileOutputStream.hxx"
+#include "thread/Mutex.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <exception>
+#include <random>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Larger than the stream's buffer, so reading pauses and resumes.
+ */
+static constexpr std::size_t FILE_SIZE = 3 * 1024 * 1024 + 12345;
+
+class UringInputStreamTest : public ::testing::Test {
+protected:
+	EventThread thread;
+
+	std::string base, path;
+	std::string contents;
+
+	void SetUp() override {
+		char tmpl[] = "/tmp/mpd-uring-XXXXXX";
+		ASSERT_NE(mkdtemp(tmpl), nullptr);
+		base = tmpl;
+		path = base + "/data";
+
+		/* every offset has a distinct pattern, so misplaced
+		   data is detected */
+		contents.reserve(FILE_SIZE);
+		for (std::size_t i = 0; i < FILE_SIZE; ++i)
+			contents.push_back(char(i * 7 + i / 251));
+
+		FileOutputStream file{AllocatedPath::FromFS(path)};
+		file.Write(std::as_bytes(std::span{contents}));
+		file.Commit();
+
+		thread.Start();
+		InitUringInputPlugin(thread.GetEventLoop());
+	}
+
+	void TearDown() override {
+		unlink(path.c_str());
+		rmdir(base.c_str());
+	}
+
+	InputStreamPtr Open(Mutex &mutex) {
+		auto is = OpenUringInputStream(path.c_str(), mutex);
+		if (!is)
+			throw std::runtime_error("io_uring not available");
+		return is;
+	}
+};
+
+/**
+ * Read until the end of the stream in chunks of random size and
+ * compare with the expected contents.
+ */
+static void
+ReadRest(InputStream &is, const std::string &contents,
+	 std::minstd_rand &rng)
+{
+	std::uniform_int_distribution<std::size_t> size_dist{1, 100000};
+	char buffer[100000];
+
+	while (!is.LockIsEOF()) {
+		const auto offset = is.GetOffset();
+		const std::size_t nbytes = is.LockRead(buffer, size_dist(rng));
+		ASSERT_GT(nbytes, 0U);
+		ASSERT_LE(offset + nbytes, contents.size());
+		ASSERT_EQ(std::string_view(buffer, nbytes),
+			  std::string_view(contents).substr(offset, nbytes))
+			<< "at offset " << offset;
+	}
+
+	EXPECT_EQ(is.GetOffset(), contents.size());
+}
+
+TEST_F(UringInputStreamTest, Read)
+{
+	Mutex mutex;
+	auto is = Open(mutex);
+	ASSERT_EQ(is->GetSize(), FILE_SIZE);
+
+	std::minstd_rand rng;
+	ReadRest(*is, contents, rng);
+}
+
+TEST_F(UringInputStreamTest, Seek)
+{
+	Mutex mutex;
+	auto is = Open(mutex);
+
+	std::minstd_rand rng{42};
+	std::uniform_int_distribution<std::size_t> offset_dist{0, FILE_SIZE - 1};
+	char buffer[4096];
+
+	for (unsigned i = 0; i < 50; ++i) {
+		/* seek while reads are in flight */
+		const auto offset = offset_dist(rng);
+		is->LockSeek(offset);
+		ASSERT_EQ(is->GetOffset(), offset);
+
+		const std::size_t nbytes = is->LockRead(buffer, sizeof(buffer));
+		ASSERT_GT(nbytes, 0U);
+		ASSERT_EQ(std::string_view(buffer, nbytes),
+			  std::string_view(contents).substr(offset, nbytes));
+	}
+
+	/* seek back and read everything */
+	is->LockSeek(12345);
+	ReadRest(*is, contents, rng);
+
+	is->LockRewind();
+	ReadRest(*is, contents, rng);
+}
+
+TEST_F(UringInputStreamTest, Truncated)
+{
+	Mutex mutex;
+	auto is = Open(mutex);
+
+	/* the file shrinks while it is being read; requests beyond
+	   the new end return short reads or end-of-file */
+	static constexpr std::size_t NEW_SIZE = 1024 * 1024 + 777;
+	ASSERT_EQ(truncate(path.c_str(), NEW_SIZE), 0);
+
+	char buffer[65536];
+	std::size_t total = 0;
+
+	try {
+		while (!is->LockIsEOF()) {
+			const auto offset = is->GetOffset();
+			const std::size_t nbytes = is->LockRead(buffer, sizeof(buffer));
+			ASSERT_EQ(std::string_view(buffer, nbytes),
+				  std::string_view(contents).substr(offset, nbytes));
+			total += nbytes;
+		}
+
+		FAIL() << "No error after truncation";
+	} catch (const std::runtime_error &) {
+	}
+
+	/* the error is reported as soon as it occurs, even if
+	   buffered data has not been consumed yet; but nothing
+	   beyond the new end may have been delivered */
+	EXPECT_LE(total, NEW_SIZE);
+}
@@ -0,0 +1,54 @@
+/*
+ * Unit tests for src/util/
+ */
+
+#include "util/PerfectHash.hxx"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static constexpr std::array<std::string_view, 5> names{
+	"add", "addid", "ping", "status", "",
+};
+
+static constexpr PerfectHash<names.size()> hash{names};
+
+static_assert(hash.Find("ping") == 2);
+
+TEST(PerfectHash, Basic)
+{
+	for (std::size_t i = 0; i < names.size(); ++i)
+		EXPECT_EQ(hash.Find(names[i]), i);
+
+	/* unknown keys may map to any index; the caller compares */
+	for (const std::string_view unknown : {"foo", "pin", "statuses"}) {
+		const auto i = hash.Find(unknown);
+		if (i != hash.NOT_FOUND) {
+			EXPECT_NE(names[i], unknown);
+		}
+	}
+}
+
+TEST(PerfectHash, Many)
+{
+	std::vector<std::string> strings;
+	for (unsigned i = 0; i < 1000; ++i)
+		strings.emplace_back("key" + std::to_string(i));
+
+	const std::vector<std::string_view> views(strings.begin(),
+						  strings.end());
+	const PerfectHash<1000> many{views};
+	for (std::size_t i = 0; i < views.size(); ++i)
+		EXPECT_EQ(many.Find(views[i]), i);
+}
+
+TEST(PerfectHash, Duplicate)
+{
+	const std::array<std::string_view, 3> duplicates{"a", "b", "a"};
+	EXPECT_THROW(PerfectHash<3>{duplicates}, std::invalid_argument);
+}
@@ -0,0 +1,67 @@
+/*
+ * Unit tests for src/util/
+ */
+
+#include "util/Tokenizer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+TEST(Tokenizer, Word)
+{
+	char input[] = "foo_1  bar\tbaz";
+	Tokenizer t{input};
+	EXPECT_STREQ(t.NextWord(), "foo_1");
+	EXPECT_STREQ(t.NextWord(), "bar");
+	EXPECT_STREQ(t.NextWord(), "baz");
+	EXPECT_EQ(t.NextWord(), nullptr);
+
+	char invalid[] = "1foo";
+	Tokenizer t2{invalid};
+	EXPECT_THROW(t2.NextWord(), std::runtime_error);
+}
+
+TEST(Tokenizer, Unquoted)
+{
+	char input[] = "a/b.flac 1:5";
+	Tokenizer t{input};
+	EXPECT_STREQ(t.NextParam(), "a/b.flac");
+	EXPECT_STREQ(t.NextParam(), "1:5");
+	EXPECT_EQ(t.NextParam(), nullptr);
+
+	char invalid[] = "a'b";
+	Tokenizer t2{invalid};
+	EXPECT_THROW(t2.NextParam(), std::runtime_error);
+}
+
+TEST(Tokenizer, String)
+{
+	char input[] = R"("foo bar" "" "a\"b\\c\d" x)";
+	Tokenizer t{input};
+	EXPECT_STREQ(t.NextParam(), "foo bar");
+	EXPECT_STREQ(t.NextParam(), "");
+	EXPECT_STREQ(t.NextParam(), R"(a"b\cd)");
+	EXPECT_STREQ(t.NextParam(), "x");
+	EXPECT_EQ(t.NextParam(), nullptr);
+	EXPECT_TRUE(t.IsEnd());
+}
+
+TEST(Tokenizer, StringError)
+{
+	char missing_quote[] = R"("foo)";
+	Tokenizer t1{missing_quote};
+	EXPECT_THROW(t1.NextParam(), std::runtime_error);
+
+	char trailing_backslash[] = R"("foo\)";
+	Tokenizer t2{trailing_backslash};
+	EXPECT_THROW(t2.NextParam(), std::runtime_error);
+
+	char escaped_quote[] = R"("foo\")";
+	Tokenizer t3{escaped_quote};
+	EXPECT_THROW(t3.NextParam(), std::runtime_error);
+
+	char no_space[] = R"("foo"bar)";
+	Tokenizer t4{no_space};
+	EXPECT_THROW(t4.NextParam(), std::runtime_error);
+}